@@ -806,4 +806,32 @@ int avio_em_handshake(AVEMIOContext *c);
 
 int64_t avio_em_fast_seek_begin(AVEMIOContext *s);
 
+/**
+ * Counters of the process-wide pool of idle HTTP keep-alive connections.
+ */
+typedef struct AVIOHTTPPoolStat {
+    int64_t reused;     ///< connections handed out of the pool
+    int64_t fresh;      ///< poolable requests that had to open a new connection
+    int64_t idle;       ///< connections currently parked in the pool
+    int64_t expired;    ///< idle connections dropped by TTL, caps or health check
+} AVIOHTTPPoolStat;
+
+void avio_em_http_pool_get_stat(AVIOHTTPPoolStat *stat);
+
+/**
+ * Close all idle pooled connections, e.g. when the network changes.
+ */
+void avio_em_http_pool_flush(void);
+
+/**
+ * Counters of TLS client handshakes, over all connections of the process.
+ */
+typedef struct AVIOTLSStat {
+    int64_t handshakes;     ///< completed client handshakes
+    int64_t resumed;        ///< handshakes abbreviated with a cached session
+    int64_t handshake_us;   ///< total time spent in client handshakes
+} AVIOTLSStat;
+
+void avio_em_tls_get_stat(AVIOTLSStat *stat);
+
 #endif /* AVFORMAT_AVIO_H */
@@ -63,6 +63,8 @@ typedef struct AVAppAsyncStatistic {
     int64_t buf_backwards;
     int64_t buf_forwards;
     int64_t buf_capacity;
+    int64_t buf_parallel;           // allocated for byte ranges fetched in parallel
+    int64_t buf_parallel_limit;     // -1 on the way in, the application may lower it
 } AVAppAsyncStatistic;
 
 typedef struct AVAppAsyncReadSpeed {
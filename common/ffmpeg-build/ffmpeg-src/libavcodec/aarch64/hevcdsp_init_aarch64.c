@@ -0,0 +1,147 @@
+/*
+ * AArch64 NEON optimised HEVC DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/aarch64/cpu.h"
+#include "libavcodec/hevcdsp.h"
+
+#include "config.h"
+
+void em_hevc_v_loop_filter_luma_neon(uint8_t *pix, ptrdiff_t stride, int beta,
+                                     int32_t *tc, uint8_t *no_p, uint8_t *no_q);
+void em_hevc_h_loop_filter_luma_neon(uint8_t *pix, ptrdiff_t stride, int beta,
+                                     int32_t *tc, uint8_t *no_p, uint8_t *no_q);
+void em_hevc_v_loop_filter_chroma_neon(uint8_t *pix, ptrdiff_t stride,
+                                       int32_t *tc, uint8_t *no_p, uint8_t *no_q);
+void em_hevc_h_loop_filter_chroma_neon(uint8_t *pix, ptrdiff_t stride,
+                                       int32_t *tc, uint8_t *no_p, uint8_t *no_q);
+
+void em_hevc_transform_4x4_neon_8(int16_t *coeffs, int col_limit);
+void em_hevc_transform_8x8_neon_8(int16_t *coeffs, int col_limit);
+void em_hevc_transform_16x16_neon_8(int16_t *coeffs, int col_limit);
+void em_hevc_transform_luma_4x4_neon_8(int16_t *coeffs);
+void em_hevc_idct_4x4_dc_neon_8(int16_t *coeffs);
+void em_hevc_idct_8x8_dc_neon_8(int16_t *coeffs);
+void em_hevc_idct_16x16_dc_neon_8(int16_t *coeffs);
+void em_hevc_idct_32x32_dc_neon_8(int16_t *coeffs);
+void em_hevc_transform_add_4x4_neon_8(uint8_t *dst, int16_t *coeffs, ptrdiff_t stride);
+void em_hevc_transform_add_8x8_neon_8(uint8_t *dst, int16_t *coeffs, ptrdiff_t stride);
+void em_hevc_transform_add_16x16_neon_8(uint8_t *dst, int16_t *coeffs, ptrdiff_t stride);
+void em_hevc_transform_add_32x32_neon_8(uint8_t *dst, int16_t *coeffs, ptrdiff_t stride);
+
+void em_hevc_sao_band_filter_neon_8(uint8_t *dst, uint8_t *src,
+                                    ptrdiff_t stride_dst, ptrdiff_t stride_src,
+                                    int16_t *sao_offset_val, int sao_left_class,
+                                    int width, int height);
+void em_hevc_sao_edge_filter_neon_8(uint8_t *dst, uint8_t *src, ptrdiff_t stride_dst,
+                                    int16_t *sao_offset_val, int eo, int width, int height);
+
+#define PUT_FUNC(name)                                                        \
+void em_hevc_put_ ## name ## _neon_8(int16_t *dst, uint8_t *src,             \
+                                     ptrdiff_t srcstride, int height,         \
+                                     intptr_t mx, intptr_t my, int width)
+#define UNI_FUNC(name)                                                        \
+void em_hevc_put_ ## name ## _neon_8(uint8_t *dst, ptrdiff_t dststride,      \
+                                     uint8_t *src, ptrdiff_t srcstride,       \
+                                     int height, intptr_t mx, intptr_t my,    \
+                                     int width)
+#define BI_FUNC(name)                                                         \
+void em_hevc_put_ ## name ## _neon_8(uint8_t *dst, ptrdiff_t dststride,      \
+                                     uint8_t *src, ptrdiff_t srcstride,       \
+                                     int16_t *src2, int height, intptr_t mx,  \
+                                     intptr_t my, int width)
+
+PUT_FUNC(pel_pixels);
+UNI_FUNC(pel_uni_pixels);
+BI_FUNC(pel_bi_pixels);
+
+#define MC_FUNCS(fn)         \
+    PUT_FUNC(fn ## _h);      \
+    PUT_FUNC(fn ## _v);      \
+    PUT_FUNC(fn ## _hv);     \
+    UNI_FUNC(fn ## _uni_h);  \
+    UNI_FUNC(fn ## _uni_v);  \
+    UNI_FUNC(fn ## _uni_hv); \
+    BI_FUNC(fn ## _bi_h);    \
+    BI_FUNC(fn ## _bi_v);    \
+    BI_FUNC(fn ## _bi_hv)
+
+MC_FUNCS(qpel);
+MC_FUNCS(epel);
+
+#define SET_FILTER(tab, fn)                                                   \
+    c->tab[i][0][1]         = em_hevc_put_ ## fn ## _h_neon_8;                \
+    c->tab[i][1][0]         = em_hevc_put_ ## fn ## _v_neon_8;                \
+    c->tab[i][1][1]         = em_hevc_put_ ## fn ## _hv_neon_8;               \
+    c->tab ## _uni[i][0][1] = em_hevc_put_ ## fn ## _uni_h_neon_8;            \
+    c->tab ## _uni[i][1][0] = em_hevc_put_ ## fn ## _uni_v_neon_8;            \
+    c->tab ## _uni[i][1][1] = em_hevc_put_ ## fn ## _uni_hv_neon_8;           \
+    c->tab ## _bi[i][0][1]  = em_hevc_put_ ## fn ## _bi_h_neon_8;             \
+    c->tab ## _bi[i][1][0]  = em_hevc_put_ ## fn ## _bi_v_neon_8;             \
+    c->tab ## _bi[i][1][1]  = em_hevc_put_ ## fn ## _bi_hv_neon_8
+
+av_cold void em_hevc_dsp_init_aarch64(HEVCDSPContext *c, const int bit_depth)
+{
+    int cpu_flags = av_em_get_cpu_flags();
+    int i;
+
+    if (!have_neon(cpu_flags) || bit_depth != 8)
+        return;
+
+    c->hevc_v_loop_filter_luma   = em_hevc_v_loop_filter_luma_neon;
+    c->hevc_h_loop_filter_luma   = em_hevc_h_loop_filter_luma_neon;
+    c->hevc_v_loop_filter_chroma = em_hevc_v_loop_filter_chroma_neon;
+    c->hevc_h_loop_filter_chroma = em_hevc_h_loop_filter_chroma_neon;
+    c->idct[0]                   = em_hevc_transform_4x4_neon_8;
+    c->idct[1]                   = em_hevc_transform_8x8_neon_8;
+    c->idct[2]                   = em_hevc_transform_16x16_neon_8;
+    c->idct_dc[0]                = em_hevc_idct_4x4_dc_neon_8;
+    c->idct_dc[1]                = em_hevc_idct_8x8_dc_neon_8;
+    c->idct_dc[2]                = em_hevc_idct_16x16_dc_neon_8;
+    c->idct_dc[3]                = em_hevc_idct_32x32_dc_neon_8;
+    c->transform_add[0]          = em_hevc_transform_add_4x4_neon_8;
+    c->transform_add[1]          = em_hevc_transform_add_8x8_neon_8;
+    c->transform_add[2]          = em_hevc_transform_add_16x16_neon_8;
+    c->transform_add[3]          = em_hevc_transform_add_32x32_neon_8;
+    c->idct_4x4_luma             = em_hevc_transform_luma_4x4_neon_8;
+
+    for (i = 0; i < 5; i++) {
+        c->sao_band_filter[i] = em_hevc_sao_band_filter_neon_8;
+        c->sao_edge_filter[i] = em_hevc_sao_edge_filter_neon_8;
+    }
+
+    /* The MC functions work on columns of 8 pixels with a 4 pixel tail,
+     * widths 2 and 6 (index 0 and 2) stay with the C code. */
+    for (i = 1; i < 10; i++) {
+        if (i == 2)
+            continue;
+        c->put_hevc_qpel[i][0][0]     = em_hevc_put_pel_pixels_neon_8;
+        c->put_hevc_epel[i][0][0]     = em_hevc_put_pel_pixels_neon_8;
+        c->put_hevc_qpel_uni[i][0][0] = em_hevc_put_pel_uni_pixels_neon_8;
+        c->put_hevc_epel_uni[i][0][0] = em_hevc_put_pel_uni_pixels_neon_8;
+        c->put_hevc_qpel_bi[i][0][0]  = em_hevc_put_pel_bi_pixels_neon_8;
+        c->put_hevc_epel_bi[i][0][0]  = em_hevc_put_pel_bi_pixels_neon_8;
+        SET_FILTER(put_hevc_qpel, qpel);
+        SET_FILTER(put_hevc_epel, epel);
+    }
+}
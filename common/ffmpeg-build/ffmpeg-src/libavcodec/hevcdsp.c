@@ -261,6 +261,8 @@ int i = 0;
         em_hevc_dsp_init_x86(hevcdsp, bit_depth);
     if (ARCH_ARM)
         em_hevcdsp_init_arm(hevcdsp, bit_depth);
+    if (ARCH_AARCH64)
+        em_hevc_dsp_init_aarch64(hevcdsp, bit_depth);
     if (ARCH_MIPS)
         em_hevc_dsp_init_mips(hevcdsp, bit_depth);
 }
@@ -129,5 +129,6 @@ extern const int8_t em_hevc_qpel_filters[3][16];
 
 void em_hevc_dsp_init_x86(HEVCDSPContext *c, const int bit_depth);
 void em_hevcdsp_init_arm(HEVCDSPContext *c, const int bit_depth);
+void em_hevc_dsp_init_aarch64(HEVCDSPContext *c, const int bit_depth);
 void em_hevc_dsp_init_mips(HEVCDSPContext *c, const int bit_depth);
 #endif /* AVCODEC_HEVCDSP_H */
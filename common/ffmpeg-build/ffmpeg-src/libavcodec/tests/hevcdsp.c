@@ -0,0 +1,556 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * HEVC DSP test: every 8-bit hook the CPU specific init replaces is run
+ * against the C version on random input, extreme values and random
+ * strides, and the whole output buffer must match.
+ */
+
+#include "config.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/internal.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+
+#include "libavcodec/avcodec.h"
+#include "libavcodec/hevcdsp.h"
+
+#define ITERATIONS   200
+#define NB_ITS_SPEED 20000
+
+#define SRC_STRIDE_MAX (MAX_PB_SIZE + 160)
+#define DST_STRIDE_MAX (MAX_PB_SIZE + 64)
+#define EDGE_STRIDE    (2 * MAX_PB_SIZE + AV_INPUT_BUFFER_PADDING_SIZE)
+
+static const int pel_width[10]  = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+static const int pel_height[10] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+static const uint8_t sao_tab[8] = { 0, 1, 2, 2, 3, 3, 4, 4 };
+
+static HEVCDSPContext ref, opt;
+static AVLFG prng;
+static int speed, checked, failed;
+
+DECLARE_ALIGNED(32, static uint8_t,  src0)[(MAX_PB_SIZE + 8) * SRC_STRIDE_MAX];
+DECLARE_ALIGNED(32, static uint8_t,  dst0)[(MAX_PB_SIZE + 2) * DST_STRIDE_MAX];
+DECLARE_ALIGNED(32, static uint8_t,  dst1)[(MAX_PB_SIZE + 2) * DST_STRIDE_MAX];
+DECLARE_ALIGNED(32, static int16_t,  src2)[MAX_PB_SIZE * MAX_PB_SIZE];
+DECLARE_ALIGNED(32, static int16_t,  co0)[(MAX_PB_SIZE + 2) * MAX_PB_SIZE];
+DECLARE_ALIGNED(32, static int16_t,  co1)[(MAX_PB_SIZE + 2) * MAX_PB_SIZE];
+
+static int rnd(int n)
+{
+    return av_lfg_get(&prng) % n;
+}
+
+static int rnd_range(int lo, int hi)
+{
+    return lo + rnd(hi - lo + 1);
+}
+
+/* every third buffer only holds the extreme values */
+static void fill_u8(uint8_t *p, int n, int edge)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        p[i] = edge ? (rnd(2) ? 255 : 0) : rnd(256);
+}
+
+static void fill_i16(int16_t *p, int n, int lo, int hi, int edge)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        p[i] = edge ? (rnd(2) ? hi : lo) : rnd_range(lo, hi);
+}
+
+/* neighbouring pixels that differ by less than delta, so that the
+ * deblocking decisions go both ways */
+static void fill_smooth(uint8_t *p, int n, int delta)
+{
+    int i, v = rnd(256);
+    for (i = 0; i < n; i++)
+        p[i] = v = av_clip_uint8(v + rnd_range(-delta, delta));
+}
+
+static int report(const char *name, const void *a, const void *b, int size,
+                  const char *args)
+{
+    static char last[64];
+    const uint8_t *pa = a, *pb = b;
+    int i;
+
+    if (strcmp(name, last)) {
+        av_em_strlcpy(last, name, sizeof(last));
+        checked++;
+    }
+    if (!memcmp(a, b, size))
+        return 0;
+    for (i = 0; i < size && pa[i] == pb[i]; i++);
+    printf("%s: mismatch at byte %d (%d instead of %d) for %s\n",
+           name, i, pb[i], pa[i], args);
+    failed++;
+    return 1;
+}
+
+#define BENCH(name, ref_call, opt_call)                                       \
+    do {                                                                      \
+        int64_t t0, t_ref, t_opt;                                             \
+        int it;                                                               \
+        if (!speed)                                                           \
+            break;                                                            \
+        t0 = av_em_gettime_relative();                                        \
+        for (it = 0; it < NB_ITS_SPEED; it++)                                 \
+            ref_call;                                                         \
+        t_ref = av_em_gettime_relative() - t0;                                \
+        t0 = av_em_gettime_relative();                                        \
+        for (it = 0; it < NB_ITS_SPEED; it++)                                 \
+            opt_call;                                                         \
+        emms_c();                                                             \
+        t_opt = av_em_gettime_relative() - t0;                                \
+        printf("%-32s C %8.1f ns  opt %8.1f ns  %5.2fx\n", name,              \
+               t_ref * 1000.0 / NB_ITS_SPEED, t_opt * 1000.0 / NB_ITS_SPEED,  \
+               (double)t_ref / FFMAX(t_opt, 1));                              \
+    } while (0)
+
+/* the decoder only passes coefficients up to the last significant one,
+ * with the column limit derived from its position */
+static int fill_coeffs(int16_t *co, int size, int mode)
+{
+    int lx = rnd(size), ly = rnd(size), x, y, max_xy, col_limit;
+
+    if (!lx && !ly)
+        lx = 1;
+    max_xy    = FFMAX(lx, ly);
+    col_limit = lx + ly + 4;
+    if (max_xy < 4)
+        col_limit = FFMIN(4, col_limit);
+    else if (max_xy < 8)
+        col_limit = FFMIN(8, col_limit);
+    else if (max_xy < 12)
+        col_limit = FFMIN(24, col_limit);
+
+    memset(co, 0, size * size * sizeof(*co));
+    for (y = 0; y <= ly; y++)
+        for (x = 0; x <= lx; x++)
+            if (mode == 2 || rnd(4))
+                co[y * size + x] = mode ? (rnd(2) ? 32767 : -32768) : rnd_range(-32768, 32767);
+    return col_limit;
+}
+
+static void check_transform(void)
+{
+    char name[64], args[64];
+    int i, it;
+
+    for (i = 0; i < 4; i++) {
+        int size = 4 << i;
+
+        if (ref.idct[i] != opt.idct[i]) {
+            snprintf(name, sizeof(name), "idct[%d]", i);
+            for (it = 0; it < ITERATIONS; it++) {
+                int col_limit = fill_coeffs(co0, size, it % 3);
+                memcpy(co1, co0, sizeof(co0));
+                ref.idct[i](co0, col_limit);
+                opt.idct[i](co1, col_limit);
+                snprintf(args, sizeof(args), "col_limit %d", col_limit);
+                if (report(name, co0, co1, sizeof(co0), args))
+                    break;
+            }
+            BENCH(name, ref.idct[i](co0, size), opt.idct[i](co1, size));
+        }
+
+        if (ref.idct_dc[i] != opt.idct_dc[i]) {
+            snprintf(name, sizeof(name), "idct_dc[%d]", i);
+            for (it = 0; it < ITERATIONS; it++) {
+                fill_i16(co0, size * size, -32768, 32767, 0);
+                if (it % 3 == 0)
+                    co0[0] = rnd(2) ? 32767 : -32768;
+                memcpy(co1, co0, sizeof(co0));
+                ref.idct_dc[i](co0);
+                opt.idct_dc[i](co1);
+                if (report(name, co0, co1, sizeof(co0), "random block"))
+                    break;
+            }
+            BENCH(name, ref.idct_dc[i](co0), opt.idct_dc[i](co1));
+        }
+
+        if (ref.transform_add[i] != opt.transform_add[i]) {
+            snprintf(name, sizeof(name), "transform_add[%d]", i);
+            for (it = 0; it < ITERATIONS; it++) {
+                int stride = rnd_range(size, DST_STRIDE_MAX);
+                int edge   = it % 3 == 0;
+                fill_u8(dst0, sizeof(dst0), edge);
+                memcpy(dst1, dst0, sizeof(dst0));
+                if (edge)
+                    fill_i16(co0, size * size, -32768, 32767, 1);
+                else
+                    fill_i16(co0, size * size, -512, 511, 0);
+                memcpy(co1, co0, sizeof(co0));
+                ref.transform_add[i](dst0, co0, stride);
+                opt.transform_add[i](dst1, co1, stride);
+                snprintf(args, sizeof(args), "stride %d", stride);
+                if (report(name, dst0, dst1, sizeof(dst0), args))
+                    break;
+            }
+            BENCH(name, ref.transform_add[i](dst0, co0, size), opt.transform_add[i](dst1, co1, size));
+        }
+    }
+
+    if (ref.idct_4x4_luma != opt.idct_4x4_luma) {
+        for (it = 0; it < ITERATIONS; it++) {
+            fill_i16(co0, 16, -32768, 32767, it % 3 == 0);
+            memcpy(co1, co0, sizeof(co0));
+            ref.idct_4x4_luma(co0);
+            opt.idct_4x4_luma(co1);
+            if (report("idct_4x4_luma", co0, co1, sizeof(co0), "random block"))
+                break;
+        }
+        BENCH("idct_4x4_luma", ref.idct_4x4_luma(co0), opt.idct_4x4_luma(co1));
+    }
+
+    if (ref.transform_skip != opt.transform_skip) {
+        for (it = 0; it < ITERATIONS; it++) {
+            int log2_size = rnd_range(2, 5);
+            fill_i16(co0, 1 << 2 * log2_size, -32768, 32767, it % 3 == 0);
+            memcpy(co1, co0, sizeof(co0));
+            ref.transform_skip(co0, log2_size);
+            opt.transform_skip(co1, log2_size);
+            snprintf(args, sizeof(args), "log2_size %d", log2_size);
+            if (report("transform_skip", co0, co1, sizeof(co0), args))
+                break;
+        }
+        BENCH("transform_skip", ref.transform_skip(co0, 2), opt.transform_skip(co1, 2));
+    }
+
+    if (ref.transform_rdpcm != opt.transform_rdpcm) {
+        for (it = 0; it < ITERATIONS; it++) {
+            int log2_size = rnd_range(2, 5), mode = rnd(2);
+            fill_i16(co0, 1 << 2 * log2_size, -4096, 4095, it % 3 == 0);
+            memcpy(co1, co0, sizeof(co0));
+            ref.transform_rdpcm(co0, log2_size, mode);
+            opt.transform_rdpcm(co1, log2_size, mode);
+            snprintf(args, sizeof(args), "log2_size %d mode %d", log2_size, mode);
+            if (report("transform_rdpcm", co0, co1, sizeof(co0), args))
+                break;
+        }
+        BENCH("transform_rdpcm", ref.transform_rdpcm(co0, 3, 0), opt.transform_rdpcm(co1, 3, 0));
+    }
+}
+
+/* one MC call with random position, size and fractions; the source keeps
+ * a margin of the longest filter around the block */
+typedef struct MCArgs {
+    uint8_t *src;
+    ptrdiff_t srcstride, dststride;
+    int width, height, mx, my;
+    int denom, wx0, wx1, ox0, ox1;
+} MCArgs;
+
+static void mc_args(MCArgs *a, int idx, int v, int h, int epel, int it)
+{
+    int edge = it % 3 == 0;
+
+    a->width     = pel_width[idx];
+    a->height    = pel_height[rnd(10)];
+    a->srcstride = rnd_range(a->width + 8, SRC_STRIDE_MAX);
+    a->dststride = rnd_range(a->width, DST_STRIDE_MAX);
+    a->src       = src0 + 3 * a->srcstride + 4;
+    a->mx        = h ? rnd_range(1, epel ? 7 : 3) : 0;
+    a->my        = v ? rnd_range(1, epel ? 7 : 3) : 0;
+    a->denom     = rnd(8);
+    a->wx0       = edge ? -128 : rnd_range(-128, 127);
+    a->wx1       = edge ? 127 : rnd_range(-128, 127);
+    a->ox0       = edge ? 127 : rnd_range(-128, 127);
+    a->ox1       = edge ? -128 : rnd_range(-128, 127);
+
+    fill_u8(src0, sizeof(src0), edge);
+    fill_u8(dst0, sizeof(dst0), 0);
+    memcpy(dst1, dst0, sizeof(dst0));
+    fill_i16(src2, FF_ARRAY_ELEMS(src2), -8192, 24575, 0);
+    if (edge)
+        fill_i16(src2, FF_ARRAY_ELEMS(src2), -32768, 32767, 1);
+}
+
+#define MC_NAME(tab)                                                          \
+    snprintf(name, sizeof(name), #tab "[%d][%d][%d]", idx, v, h);             \
+    snprintf(args, sizeof(args), "%dx%d mx %d my %d strides %d/%d",           \
+             a.width, a.height, a.mx, a.my, (int)a.srcstride, (int)a.dststride)
+
+#define CHECK_MC(tab, epel, ref_call, opt_call, out0, out1)                   \
+    if (ref.tab[idx][v][h] != opt.tab[idx][v][h]) {                           \
+        for (it = 0; it < ITERATIONS; it++) {                                 \
+            mc_args(&a, idx, v, h, epel, it);                                 \
+            MC_NAME(tab);                                                     \
+            ref_call;                                                         \
+            opt_call;                                                         \
+            if (report(name, out0, out1, sizeof(out0), args))                 \
+                break;                                                        \
+        }                                                                     \
+        a.height    = a.width;                                                \
+        a.srcstride = SRC_STRIDE_MAX;                                         \
+        a.dststride = DST_STRIDE_MAX;                                         \
+        a.src       = src0 + 3 * a.srcstride + 4;                             \
+        MC_NAME(tab);                                                         \
+        BENCH(name, ref_call, opt_call);                                      \
+    }
+
+static void check_mc_filter(int epel)
+{
+    char name[64], args[64];
+    int idx, v, h, it;
+    MCArgs a;
+    int16_t *d0 = (int16_t *)dst0, *d1 = (int16_t *)dst1;
+
+#define PUT    a.src, a.srcstride, a.height, a.mx, a.my, a.width
+#define UNI    a.dststride, a.src, a.srcstride, a.height, a.mx, a.my, a.width
+#define BI     a.dststride, a.src, a.srcstride, src2, a.height, a.mx, a.my, a.width
+#define UNI_W  a.dststride, a.src, a.srcstride, a.height, a.denom, a.wx0, a.ox0, a.mx, a.my, a.width
+    for (idx = 0; idx < 10; idx++)
+    for (v = 0; v < 2; v++)
+    for (h = 0; h < 2; h++) {
+        if (!epel) {
+            CHECK_MC(put_hevc_qpel,      0, ref.put_hevc_qpel[idx][v][h](d0, PUT),
+                                             opt.put_hevc_qpel[idx][v][h](d1, PUT), dst0, dst1)
+            CHECK_MC(put_hevc_qpel_uni,  0, ref.put_hevc_qpel_uni[idx][v][h](dst0, UNI),
+                                             opt.put_hevc_qpel_uni[idx][v][h](dst1, UNI), dst0, dst1)
+            CHECK_MC(put_hevc_qpel_bi,   0, ref.put_hevc_qpel_bi[idx][v][h](dst0, BI),
+                                             opt.put_hevc_qpel_bi[idx][v][h](dst1, BI), dst0, dst1)
+            CHECK_MC(put_hevc_qpel_uni_w, 0, ref.put_hevc_qpel_uni_w[idx][v][h](dst0, UNI_W),
+                                             opt.put_hevc_qpel_uni_w[idx][v][h](dst1, UNI_W), dst0, dst1)
+            CHECK_MC(put_hevc_qpel_bi_w, 0,
+                     ref.put_hevc_qpel_bi_w[idx][v][h](dst0, a.dststride, a.src, a.srcstride, src2, a.height, a.denom,
+                                                       a.wx0, a.wx1, a.ox0, a.ox1, a.mx, a.my, a.width),
+                     opt.put_hevc_qpel_bi_w[idx][v][h](dst1, a.dststride, a.src, a.srcstride, src2, a.height, a.denom,
+                                                       a.wx0, a.wx1, a.ox0, a.ox1, a.mx, a.my, a.width), dst0, dst1)
+        } else {
+            CHECK_MC(put_hevc_epel,      1, ref.put_hevc_epel[idx][v][h](d0, PUT),
+                                             opt.put_hevc_epel[idx][v][h](d1, PUT), dst0, dst1)
+            CHECK_MC(put_hevc_epel_uni,  1, ref.put_hevc_epel_uni[idx][v][h](dst0, UNI),
+                                             opt.put_hevc_epel_uni[idx][v][h](dst1, UNI), dst0, dst1)
+            CHECK_MC(put_hevc_epel_bi,   1, ref.put_hevc_epel_bi[idx][v][h](dst0, BI),
+                                             opt.put_hevc_epel_bi[idx][v][h](dst1, BI), dst0, dst1)
+            CHECK_MC(put_hevc_epel_uni_w, 1, ref.put_hevc_epel_uni_w[idx][v][h](dst0, UNI_W),
+                                             opt.put_hevc_epel_uni_w[idx][v][h](dst1, UNI_W), dst0, dst1)
+            CHECK_MC(put_hevc_epel_bi_w, 1,
+                     ref.put_hevc_epel_bi_w[idx][v][h](dst0, a.dststride, a.src, a.srcstride, src2, a.height, a.denom,
+                                                       a.wx0, a.ox0, a.wx1, a.ox1, a.mx, a.my, a.width),
+                     opt.put_hevc_epel_bi_w[idx][v][h](dst1, a.dststride, a.src, a.srcstride, src2, a.height, a.denom,
+                                                       a.wx0, a.ox0, a.wx1, a.ox1, a.mx, a.my, a.width), dst0, dst1)
+        }
+    }
+#undef PUT
+#undef UNI
+#undef BI
+#undef UNI_W
+}
+
+/* 8 lines across an edge in the middle of a 16x16 area */
+static void check_deblock(void)
+{
+    char args[64];
+    int it, vert, chroma;
+
+    for (chroma = 0; chroma < 2; chroma++)
+    for (vert = 0; vert < 2; vert++) {
+        void (*ref_luma)(uint8_t *, ptrdiff_t, int, int32_t *, uint8_t *, uint8_t *);
+        void (*opt_luma)(uint8_t *, ptrdiff_t, int, int32_t *, uint8_t *, uint8_t *);
+        void (*ref_chroma)(uint8_t *, ptrdiff_t, int32_t *, uint8_t *, uint8_t *);
+        void (*opt_chroma)(uint8_t *, ptrdiff_t, int32_t *, uint8_t *, uint8_t *);
+        const char *name;
+        int32_t tc[2];
+        uint8_t no_p[2], no_q[2];
+        int beta;
+        ptrdiff_t stride = 16;
+
+        ref_luma   = vert ? ref.hevc_v_loop_filter_luma   : ref.hevc_h_loop_filter_luma;
+        opt_luma   = vert ? opt.hevc_v_loop_filter_luma   : opt.hevc_h_loop_filter_luma;
+        ref_chroma = vert ? ref.hevc_v_loop_filter_chroma : ref.hevc_h_loop_filter_chroma;
+        opt_chroma = vert ? opt.hevc_v_loop_filter_chroma : opt.hevc_h_loop_filter_chroma;
+        if (chroma ? ref_chroma == opt_chroma : ref_luma == opt_luma)
+            continue;
+        name = chroma ? (vert ? "hevc_v_loop_filter_chroma" : "hevc_h_loop_filter_chroma")
+                      : (vert ? "hevc_v_loop_filter_luma"   : "hevc_h_loop_filter_luma");
+
+        for (it = 0; it < ITERATIONS * 4; it++) {
+            static const int delta[4] = { 1, 3, 12, 255 };
+            uint8_t *pix0, *pix1;
+
+            stride  = rnd_range(16, DST_STRIDE_MAX);
+            pix0    = dst0 + 4 * stride + 4 + (vert ? 4 : 4 * stride);
+            pix1    = dst1 + 4 * stride + 4 + (vert ? 4 : 4 * stride);
+            beta    = it % 8 ? rnd_range(0, 64) : 64;
+            tc[0]   = it % 8 ? rnd_range(0, 24) : 24;
+            tc[1]   = it % 8 ? rnd_range(0, 24) : 0;
+            no_p[0] = !rnd(4);
+            no_p[1] = !rnd(4);
+            no_q[0] = !rnd(4);
+            no_q[1] = !rnd(4);
+            if (it % 3 == 0)
+                fill_u8(dst0, sizeof(dst0), 1);
+            else
+                fill_smooth(dst0, sizeof(dst0), delta[rnd(4)]);
+            memcpy(dst1, dst0, sizeof(dst0));
+            if (chroma) {
+                ref_chroma(pix0, stride, tc, no_p, no_q);
+                opt_chroma(pix1, stride, tc, no_p, no_q);
+            } else {
+                ref_luma(pix0, stride, beta, tc, no_p, no_q);
+                opt_luma(pix1, stride, beta, tc, no_p, no_q);
+            }
+            snprintf(args, sizeof(args), "stride %d beta %d tc %d/%d no_p %d/%d no_q %d/%d",
+                     (int)stride, beta, tc[0], tc[1], no_p[0], no_p[1], no_q[0], no_q[1]);
+            if (report(name, dst0, dst1, sizeof(dst0), args))
+                break;
+        }
+        beta  = 64;
+        tc[0] = tc[1] = 24;
+        no_p[0] = no_p[1] = no_q[0] = no_q[1] = 0;
+        fill_smooth(dst0, sizeof(dst0), 3);
+        memcpy(dst1, dst0, sizeof(dst0));
+        if (chroma)
+            BENCH(name, ref_chroma(dst0 + 8 * 16 + 8, 16, tc, no_p, no_q),
+                        opt_chroma(dst1 + 8 * 16 + 8, 16, tc, no_p, no_q));
+        else
+            BENCH(name, ref_luma(dst0 + 8 * 16 + 8, 16, beta, tc, no_p, no_q),
+                        opt_luma(dst1 + 8 * 16 + 8, 16, beta, tc, no_p, no_q));
+    }
+}
+
+static void check_sao(void)
+{
+    static const int bench_width[5] = { 8, 16, 32, 48, 64 };
+    char name[64], args[64];
+    int16_t offset[5];
+    int i, it;
+
+    for (i = 0; i < 5; i++) {
+        if (ref.sao_band_filter[i] != opt.sao_band_filter[i]) {
+            snprintf(name, sizeof(name), "sao_band_filter[%d]", i);
+            for (it = 0; it < ITERATIONS; it++) {
+                int width, height = rnd_range(1, MAX_PB_SIZE), left_class = rnd(32);
+                ptrdiff_t stride_dst, stride_src;
+                do
+                    width = rnd_range(1, MAX_PB_SIZE);
+                while (sao_tab[(FFALIGN(width, 8) >> 3) - 1] != i);
+                stride_dst = rnd_range(width, DST_STRIDE_MAX);
+                stride_src = rnd_range(width, SRC_STRIDE_MAX);
+                fill_i16(offset, 5, -7, 7, it % 3 == 0);
+                fill_u8(src0, sizeof(src0), it % 3 == 0);
+                fill_u8(dst0, sizeof(dst0), 0);
+                memcpy(dst1, dst0, sizeof(dst0));
+                ref.sao_band_filter[i](dst0, src0, stride_dst, stride_src, offset, left_class, width, height);
+                opt.sao_band_filter[i](dst1, src0, stride_dst, stride_src, offset, left_class, width, height);
+                snprintf(args, sizeof(args), "%dx%d class %d strides %d/%d",
+                         width, height, left_class, (int)stride_src, (int)stride_dst);
+                if (report(name, dst0, dst1, sizeof(dst0), args))
+                    break;
+            }
+            BENCH(name, ref.sao_band_filter[i](dst0, src0, MAX_PB_SIZE, MAX_PB_SIZE, offset, 4, bench_width[i], bench_width[i]),
+                        opt.sao_band_filter[i](dst1, src0, MAX_PB_SIZE, MAX_PB_SIZE, offset, 4, bench_width[i], bench_width[i]));
+        }
+
+        /* the source is the decoder's edge copy with a border of one line
+         * and AV_INPUT_BUFFER_PADDING_SIZE columns */
+        if (ref.sao_edge_filter[i] != opt.sao_edge_filter[i]) {
+            uint8_t *src = src0 + EDGE_STRIDE + AV_INPUT_BUFFER_PADDING_SIZE;
+            snprintf(name, sizeof(name), "sao_edge_filter[%d]", i);
+            for (it = 0; it < ITERATIONS; it++) {
+                int width, height = rnd_range(1, MAX_PB_SIZE), eo = rnd(4);
+                ptrdiff_t stride_dst;
+                do
+                    width = rnd_range(1, MAX_PB_SIZE);
+                while (sao_tab[(FFALIGN(width, 8) >> 3) - 1] != i);
+                stride_dst = rnd_range(width, DST_STRIDE_MAX);
+                fill_i16(offset, 5, -7, 7, it % 3 == 0);
+                offset[0] = 0;
+                fill_u8(src0, sizeof(src0), it % 3 == 0);
+                fill_u8(dst0, sizeof(dst0), 0);
+                memcpy(dst1, dst0, sizeof(dst0));
+                ref.sao_edge_filter[i](dst0, src, stride_dst, offset, eo, width, height);
+                opt.sao_edge_filter[i](dst1, src, stride_dst, offset, eo, width, height);
+                snprintf(args, sizeof(args), "%dx%d eo %d stride %d", width, height, eo, (int)stride_dst);
+                if (report(name, dst0, dst1, sizeof(dst0), args))
+                    break;
+            }
+            BENCH(name, ref.sao_edge_filter[i](dst0, src, MAX_PB_SIZE, offset, 0, bench_width[i], bench_width[i]),
+                        opt.sao_edge_filter[i](dst1, src, MAX_PB_SIZE, offset, 0, bench_width[i], bench_width[i]));
+        }
+    }
+}
+
+static void help(void)
+{
+    printf("hevcdsp [-t] [<seed>]\n"
+           "-t          speed test\n");
+}
+
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+int main(int argc, char **argv)
+{
+    int c;
+    unsigned seed = 1;
+
+    for (;;) {
+        c = getopt(argc, argv, "ht");
+        if (c == -1)
+            break;
+        switch (c) {
+        case 't':
+            speed = 1;
+            break;
+        default:
+        case 'h':
+            help();
+            return 0;
+        }
+    }
+    if (optind < argc)
+        seed = strtoul(argv[optind], NULL, 0);
+    av_em_lfg_init(&prng, seed);
+
+    av_em_force_cpu_flags(0);
+    em_hevc_dsp_init(&ref, 8);
+    av_em_force_cpu_flags(-1);
+    em_hevc_dsp_init(&opt, 8);
+
+    printf("ffmpeg HEVC DSP test, cpu flags 0x%x, seed %u\n", av_em_get_cpu_flags(), seed);
+
+    check_transform();
+    check_mc_filter(0);
+    check_mc_filter(1);
+    check_deblock();
+    check_sao();
+
+    printf("%d functions checked, %d failed\n", checked, failed);
+    return !!failed;
+}
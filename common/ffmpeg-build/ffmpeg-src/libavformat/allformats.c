@@ -128,6 +128,7 @@ void av_em_register_all(void)
     REGISTER_DEMUXER (FLIC,             flic);
     REGISTER_MUXDEMUX(FLV,              flv);
     REGISTER_DEMUXER (LIVE_FLV,         live_flv);
+    REGISTER_DEMUXER (LIVE_RTMP,        live_rtmp);
     REGISTER_DEMUXER (FOURXM,           fourxm);
     REGISTER_MUXER   (FRAMECRC,         framecrc);
     REGISTER_MUXER   (FRAMEHASH,        framehash);
@@ -2201,6 +2201,23 @@ int av_em_demuxer_open(AVEMFormatContext *ic);
  */
 int avformat_em_find_stream_info(AVEMFormatContext *ic, AVEMDictionary **options);
 
+/**
+ * Fill stream parameters from container headers only, without opening
+ * decoders. Packets are read until every stream has its codec id and the
+ * codec configuration carried in-band (e.g. FLV AVC/HEVC sequence header,
+ * AAC AudioSpecificConfig), and are buffered for av_em_read_frame().
+ *
+ * Meant for live sources whose headers are sufficient to start decoding.
+ * On AVERROR(EAGAIN) the buffered packets are kept and the caller may
+ * complete the parameters with avformat_em_find_stream_info().
+ *
+ * @param ic          media file handle
+ * @param max_wait_us give up after this many microseconds
+ * @return 0 if all streams are ready, AVERROR(EAGAIN) on timeout or when
+ *         probesize is exhausted, other AVERROR_xxx on error
+ */
+int avformat_em_find_stream_info_fast(AVEMFormatContext *ic, int64_t max_wait_us);
+
 /**
  * Find the programs which belong to a given stream.
  *
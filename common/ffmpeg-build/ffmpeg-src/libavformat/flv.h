@@ -28,6 +28,8 @@
 #ifndef AVFORMAT_FLV_H
 #define AVFORMAT_FLV_H
 
+#include "avformat.h"
+
 /* offsets for packed values */
 #define FLV_AUDIO_SAMPLESSIZE_OFFSET 1
 #define FLV_AUDIO_SAMPLERATE_OFFSET  2
@@ -109,6 +111,7 @@ enum {
     FLV_CODECID_H264    = 7,
     FLV_CODECID_REALH263= 8,
     FLV_CODECID_MPEG4   = 9,
+    FLV_CODECID_HEVC    = 12, ///< CDN extension, HEVCDecoderConfigurationRecord in the sequence header
 };
 
 enum {
@@ -135,4 +138,21 @@ typedef enum {
     AMF_DATA_TYPE_UNSUPPORTED = 0x0d,
 } AMFDataType;
 
+/**
+ * Codec mapping of the FLV audio and video tag headers, shared by the flv
+ * and live_rtmp demuxers. flags / flv_codecid are the first payload byte of
+ * the tag, masked where the name says so.
+ */
+int  ff_flv_same_audio_codec(AVEMCodecParameters *apar, int flags);
+void ff_flv_set_audio_codec(AVEMFormatContext *s, AVEMStream *astream,
+                            AVEMCodecParameters *apar, int flv_codecid);
+int  ff_flv_same_video_codec(AVEMCodecParameters *vpar, int flags);
+/**
+ * @param read read the VP6 extradata byte from s->pb
+ * @return number of codec header bytes following the flags byte, minus the
+ *         packet type byte for AVC/HEVC/MPEG-4
+ */
+int  ff_flv_set_video_codec(AVEMFormatContext *s, AVEMStream *vstream,
+                            int flv_codecid, int read);
+
 #endif /* AVFORMAT_FLV_H */
@@ -49,6 +49,7 @@ typedef struct FLVContext {
     int new_extradata_size[FLV_STREAM_TYPE_NB];
     int last_sample_rate;
     int last_channels;
+    int header_flags;     ///< FLV_HEADER_FLAG_* of the file header
     struct {
         int64_t dts;
         int64_t pos;
@@ -137,6 +138,11 @@ static AVEMStream *create_stream(AVEMFormatContext *s, int codec_type)
                            && s->streams[0]->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE
                            && s->streams[1]->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE))
         s->ctx_flags &= ~AVFMTCTX_NOHEADER;
+    /* the header announces this track only, no need to wait for another one */
+    if ((codec_type == AVMEDIA_TYPE_VIDEO || codec_type == AVMEDIA_TYPE_AUDIO) &&
+        (flv->header_flags & (FLV_HEADER_FLAG_HASVIDEO | FLV_HEADER_FLAG_HASAUDIO)) ==
+        (codec_type == AVMEDIA_TYPE_VIDEO ? FLV_HEADER_FLAG_HASVIDEO : FLV_HEADER_FLAG_HASAUDIO))
+        s->ctx_flags &= ~AVFMTCTX_NOHEADER;
 
     avpriv_em_set_pts_info(st, 32, 1, 1000); /* 32 bit pts in ms */
     flv->last_keyframe_stream_index = s->nb_streams - 1;
@@ -144,7 +150,7 @@ static AVEMStream *create_stream(AVEMFormatContext *s, int codec_type)
     return st;
 }
 
-static int flv_same_audio_codec(AVEMCodecParameters *apar, int flags)
+int ff_flv_same_audio_codec(AVEMCodecParameters *apar, int flags)
 {
     int bits_per_coded_sample = (flags & FLV_AUDIO_SAMPLESIZE_MASK) ? 16 : 8;
     int flv_codecid           = flags & FLV_AUDIO_CODECID_MASK;
@@ -195,8 +201,8 @@ static int flv_same_audio_codec(AVEMCodecParameters *apar, int flags)
     }
 }
 
-static void flv_set_audio_codec(AVEMFormatContext *s, AVEMStream *astream,
-                                AVEMCodecParameters *apar, int flv_codecid)
+void ff_flv_set_audio_codec(AVEMFormatContext *s, AVEMStream *astream,
+                            AVEMCodecParameters *apar, int flv_codecid)
 {
     switch (flv_codecid) {
     // no distinction between S16 and S8 PCM codec flags
@@ -255,7 +261,7 @@ static void flv_set_audio_codec(AVEMFormatContext *s, AVEMStream *astream,
     }
 }
 
-static int flv_same_video_codec(AVEMCodecParameters *vpar, int flags)
+int ff_flv_same_video_codec(AVEMCodecParameters *vpar, int flags)
 {
     int flv_codecid = flags & FLV_VIDEO_CODECID_MASK;
 
@@ -275,13 +281,15 @@ static int flv_same_video_codec(AVEMCodecParameters *vpar, int flags)
         return vpar->codec_id == AV_CODEC_ID_VP6A;
     case FLV_CODECID_H264:
         return vpar->codec_id == AV_CODEC_ID_H264;
+    case FLV_CODECID_HEVC:
+        return vpar->codec_id == AV_CODEC_ID_HEVC;
     default:
         return vpar->codec_tag == flv_codecid;
     }
 }
 
-static int flv_set_video_codec(AVEMFormatContext *s, AVEMStream *vstream,
-                               int flv_codecid, int read)
+int ff_flv_set_video_codec(AVEMFormatContext *s, AVEMStream *vstream,
+                           int flv_codecid, int read)
 {
     AVEMCodecParameters *par = vstream->codecpar;
     switch (flv_codecid) {
@@ -316,6 +324,10 @@ static int flv_set_video_codec(AVEMFormatContext *s, AVEMStream *vstream,
         par->codec_id = AV_CODEC_ID_H264;
         vstream->need_parsing = AVSTREAM_PARSE_HEADERS;
         return 3;     // not 4, reading packet type will consume one byte
+    case FLV_CODECID_HEVC:
+        par->codec_id = AV_CODEC_ID_HEVC;
+        vstream->need_parsing = AVSTREAM_PARSE_HEADERS;
+        return 3;
     case FLV_CODECID_MPEG4:
         par->codec_id = AV_CODEC_ID_MPEG4;
         return 3;
@@ -533,6 +545,9 @@ static int amf_parse_object(AVEMFormatContext *s, AVEMStream *astream,
                 else if (!strcmp(key, "audiodatarate") && apar &&
                          0 <= (int)(num_val * 1024.0))
                     apar->bit_rate = num_val * 1024.0;
+                else if (!strcmp(key, "framerate") && vstream &&
+                         num_val > 0 && num_val < 1000 && !vstream->avg_frame_rate.num)
+                    vstream->avg_frame_rate = av_em_d2q(num_val, 1001000);
                 else if (!strcmp(key, "datastream")) {
                     AVEMStream *st = create_stream(s, AVMEDIA_TYPE_SUBTITLE);
                     if (!st)
@@ -540,10 +555,10 @@ static int amf_parse_object(AVEMFormatContext *s, AVEMStream *astream,
                     st->codecpar->codec_id = AV_CODEC_ID_TEXT;
                 } else if (flv->trust_metadata) {
                     if (!strcmp(key, "videocodecid") && vpar) {
-                        flv_set_video_codec(s, vstream, num_val, 0);
+                        ff_flv_set_video_codec(s, vstream, num_val, 0);
                     } else if (!strcmp(key, "audiocodecid") && apar) {
                         int id = ((int)num_val) << FLV_AUDIO_CODECID_OFFSET;
-                        flv_set_audio_codec(s, astream, apar, id);
+                        ff_flv_set_audio_codec(s, astream, apar, id);
                     } else if (!strcmp(key, "audiosamplerate") && apar) {
                         apar->sample_rate = num_val;
                     } else if (!strcmp(key, "audiosamplesize") && apar) {
@@ -679,7 +694,7 @@ static int flv_read_header(AVEMFormatContext *s)
     int offset;
 
     avio_em_skip(s->pb, 4);
-    avio_em_r8(s->pb); // flags
+    flv->header_flags = avio_em_r8(s->pb);
 
     s->ctx_flags |= AVFMTCTX_NOHEADER;
 
@@ -992,11 +1007,11 @@ skip:
             st = s->streams[i];
             if (stream_type == FLV_STREAM_TYPE_AUDIO) {
                 if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
-                    (s->audio_codec_id || flv_same_audio_codec(st->codecpar, flags)))
+                    (s->audio_codec_id || ff_flv_same_audio_codec(st->codecpar, flags)))
                     break;
             } else if (stream_type == FLV_STREAM_TYPE_VIDEO) {
                 if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
-                    (s->video_codec_id || flv_same_video_codec(st->codecpar, flags)))
+                    (s->video_codec_id || ff_flv_same_video_codec(st->codecpar, flags)))
                     break;
             } else if (stream_type == FLV_STREAM_TYPE_DATA) {
                 if (st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE)
@@ -1015,8 +1030,11 @@ skip:
 
         if (s->pb->seekable &&
             ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY ||
-              stream_type == FLV_STREAM_TYPE_AUDIO))
+              stream_type == FLV_STREAM_TYPE_AUDIO)) {
+            /* every audio packet is indexed, keep a long file within max_index_size */
+            em_reduce_index(s, st->index);
             av_em_add_index_entry(st, pos, dts, size, 0, AVINDEX_KEYFRAME);
+        }
 
         if (  (st->discard >= AVDISCARD_NONKEY && !((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY || (stream_type == FLV_STREAM_TYPE_AUDIO)))
             ||(st->discard >= AVDISCARD_BIDIR  &&  ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_DISP_INTER && (stream_type == FLV_STREAM_TYPE_VIDEO)))
@@ -1076,7 +1094,7 @@ retry_duration:
             st->codecpar->bits_per_coded_sample = bits_per_coded_sample;
         }
         if (!st->codecpar->codec_id) {
-            flv_set_audio_codec(s, st, st->codecpar,
+            ff_flv_set_audio_codec(s, st, st->codecpar,
                                 flags & FLV_AUDIO_CODECID_MASK);
             flv->last_sample_rate =
             sample_rate           = st->codecpar->sample_rate;
@@ -1090,22 +1108,24 @@ retry_duration:
             }
             par->sample_rate = sample_rate;
             par->bits_per_coded_sample = bits_per_coded_sample;
-            flv_set_audio_codec(s, st, par, flags & FLV_AUDIO_CODECID_MASK);
+            ff_flv_set_audio_codec(s, st, par, flags & FLV_AUDIO_CODECID_MASK);
             sample_rate = par->sample_rate;
             avcodec_em_parameters_free(&par);
         }
     } else if (stream_type == FLV_STREAM_TYPE_VIDEO) {
-        size -= flv_set_video_codec(s, st, flags & FLV_VIDEO_CODECID_MASK, 1);
+        size -= ff_flv_set_video_codec(s, st, flags & FLV_VIDEO_CODECID_MASK, 1);
     } else if (stream_type == FLV_STREAM_TYPE_DATA) {
         st->codecpar->codec_id = AV_CODEC_ID_TEXT;
     }
 
     if (st->codecpar->codec_id == AV_CODEC_ID_AAC ||
         st->codecpar->codec_id == AV_CODEC_ID_H264 ||
+        st->codecpar->codec_id == AV_CODEC_ID_HEVC ||
         st->codecpar->codec_id == AV_CODEC_ID_MPEG4) {
         int type = avio_em_r8(s->pb);
         size--;
-        if (st->codecpar->codec_id == AV_CODEC_ID_H264 || st->codecpar->codec_id == AV_CODEC_ID_MPEG4) {
+        if (st->codecpar->codec_id == AV_CODEC_ID_H264 || st->codecpar->codec_id == AV_CODEC_ID_HEVC ||
+            st->codecpar->codec_id == AV_CODEC_ID_MPEG4) {
             // sign extension
             int32_t cts = (avio_em_rb24(s->pb) + 0xff800000) ^ 0xff800000;
             pts = dts + cts;
@@ -1121,7 +1141,7 @@ retry_duration:
             }
         }
         if (type == 0 && (!st->codecpar->extradata || st->codecpar->codec_id == AV_CODEC_ID_AAC ||
-            st->codecpar->codec_id == AV_CODEC_ID_H264)) {
+            st->codecpar->codec_id == AV_CODEC_ID_H264 || st->codecpar->codec_id == AV_CODEC_ID_HEVC)) {
             AVEMDictionaryEntry *t;
 
             if (st->codecpar->extradata) {
@@ -1138,13 +1158,16 @@ retry_duration:
             if (st->codecpar->codec_id == AV_CODEC_ID_AAC && t && !strcmp(t->value, "Omnia A/XE"))
                 st->codecpar->extradata_size = 2;
 
-            if (st->codecpar->codec_id == AV_CODEC_ID_AAC && 0) {
+            /* the tag header always claims 44.1kHz stereo for aac */
+            if (st->codecpar->codec_id == AV_CODEC_ID_AAC) {
                 MPEG4AudioConfig cfg;
 
                 if (avpriv_mpeg4audio_get_config(&cfg, st->codecpar->extradata,
                                                  st->codecpar->extradata_size * 8, 1) >= 0) {
-                st->codecpar->channels       = cfg.channels;
-                st->codecpar->channel_layout = 0;
+                if (cfg.channels > 0 && cfg.channels != st->codecpar->channels) {
+                    st->codecpar->channels       = cfg.channels;
+                    st->codecpar->channel_layout = 0;
+                }
                 if (cfg.ext_sample_rate)
                     st->codecpar->sample_rate = cfg.ext_sample_rate;
                 else
@@ -34,6 +34,7 @@
 #include "avformat.h"
 #include "http.h"
 #include "httpauth.h"
+#include "httppool.h"
 #include "internal.h"
 #include "network.h"
 #include "os_support.h"
@@ -47,6 +48,8 @@
  * path names). */
 #define BUFFER_SIZE   MAX_URL_SIZE
 #define MAX_REDIRECTS 8
+/* leftover body bytes read and dropped on close to keep a connection poolable */
+#define HTTP_POOL_DRAIN_MAX (64 * 1024)
 #define HTTP_SINGLE   1
 #define HTTP_MUTLI    2
 typedef enum {
@@ -123,6 +126,9 @@ typedef struct HTTPContext {
     AVApplicationContext *app_ctx;
     int dns_timeout;
     int dns_cache_count;
+    int keepalive_pool;
+    HTTPPoolConn *pool_conn;    ///< set when s->hd may go back to the keep-alive pool
+    char pool_key[1024];
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -165,6 +171,7 @@ static const AVOption options[] = {
     { "ijkapplication", "AVApplicationContext", OFFSET(app_ctx_intptr), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, .flags = D },
     { "dns_timeout" , "set timeout (in seconds) for dns valid time", OFFSET(dns_timeout), AV_OPT_TYPE_INT, { .i64 = 3000 }, 0, INT_MAX, .flags = D|E},
     { "dns_cache_count" , "set count for dns cache size",  OFFSET(dns_cache_count), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 10000, .flags = D|E},
+    { "keepalive_pool", "reuse idle connections of the process-wide keep-alive pool", OFFSET(keepalive_pool), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, D },
     { NULL }
 };
 
@@ -184,6 +191,60 @@ void em_http_init_auth_state(EMURLContext *dest, const EMURLContext *src)
            sizeof(HTTPAuthState));
 }
 
+static int http_pool_usable(EMURLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+
+    return s->keepalive_pool && !s->listen && !s->post_data &&
+           !(h->flags & AVIO_FLAG_WRITE);
+}
+
+/* open s->hd to lower_url, from the keep-alive pool when possible */
+static int http_open_lower(EMURLContext *h, const char *lower_url,
+                           AVEMDictionary **options, int *reused)
+{
+    HTTPContext *s = h->priv_data;
+    AVEMIOInterruptCB int_cb = h->interrupt_callback;
+    AVApplicationContext *app_ctx = s->app_ctx;
+    int err;
+
+    *reused = 0;
+    if (http_pool_usable(h)) {
+        s->hd = ff_http_pool_get(lower_url, &s->pool_conn,
+                                 &h->interrupt_callback, s->app_ctx);
+        if (s->hd) {
+            av_em_log(h, AV_LOG_DEBUG, "reusing pooled connection to %s\n", lower_url);
+            av_em_strlcpy(s->pool_key, lower_url, sizeof(s->pool_key));
+            *reused = 1;
+            return 0;
+        }
+        s->pool_conn = ff_http_pool_conn_alloc(&h->interrupt_callback, s->app_ctx,
+                                               &int_cb, &app_ctx);
+    }
+
+    av_em_dict_set_intptr(options, "ijkapplication", (uintptr_t)app_ctx, 0);
+    av_em_dict_set_int(options, "dns_timeout", s->dns_timeout, 0);
+    av_em_dict_set_int(options, "dns_cache_count", s->dns_cache_count, 0);
+    err = ffurl_em_open_whitelist(&s->hd, lower_url, AVIO_FLAG_READ_WRITE,
+                               &int_cb, options,
+                               h->protocol_whitelist, h->protocol_blacklist, h);
+    if (err < 0) {
+        ff_http_pool_conn_free(&s->pool_conn);
+        return err;
+    }
+    if (s->pool_conn) {
+        ff_http_pool_count_fresh();
+        av_em_strlcpy(s->pool_key, lower_url, sizeof(s->pool_key));
+    }
+    return 0;
+}
+
+static void http_close_lower(HTTPContext *s)
+{
+    ffurl_em_closep(&s->hd);
+    ff_http_pool_conn_free(&s->pool_conn);
+}
+
 static int http_open_cnx_internal(EMURLContext *h, AVEMDictionary **options)
 {
     const char *path, *proxy_path, *lower_proto = "tcp", *local_path;
@@ -191,7 +252,7 @@ static int http_open_cnx_internal(EMURLContext *h, AVEMDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err, location_changed = 0;
+    int port, use_proxy, err, location_changed = 0, reused = 0;
     char prev_location[4096];
     HTTPContext *s = h->priv_data;
 
@@ -233,12 +294,7 @@ static int http_open_cnx_internal(EMURLContext *h, AVEMDictionary **options)
     em_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
     if (!s->hd) {
-        av_em_dict_set_intptr(options, "ijkapplication", (uintptr_t)s->app_ctx, 0);
-        av_em_dict_set_int(options, "dns_timeout", s->dns_timeout, 0);
-        av_em_dict_set_int(options, "dns_cache_count", s->dns_cache_count, 0);
-        err = ffurl_em_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                                   &h->interrupt_callback, options,
-                                   h->protocol_whitelist, h->protocol_blacklist, h);
+        err = http_open_lower(h, buf, options, &reused);
         if (err < 0)
             return err;
     }
@@ -246,6 +302,15 @@ static int http_open_cnx_internal(EMURLContext *h, AVEMDictionary **options)
     av_em_strlcpy(prev_location, s->location, sizeof(prev_location));
     err = http_connect(h, path, local_path, hoststr,
                        auth, proxyauth, &location_changed);
+    if (err < 0 && reused) {
+        /* the server may have dropped the idle connection meanwhile */
+        http_close_lower(s);
+        err = http_open_lower(h, buf, options, &reused);
+        if (err < 0)
+            return err;
+        err = http_connect(h, path, local_path, hoststr,
+                           auth, proxyauth, &location_changed);
+    }
     if (err < 0)
         return err;
 
@@ -272,7 +337,7 @@ redo:
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
             s->auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_em_closep(&s->hd);
+            http_close_lower(s);
             goto redo;
         } else
             goto fail;
@@ -280,7 +345,7 @@ redo:
     if (s->http_code == 407) {
         if ((cur_proxy_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
             s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_em_closep(&s->hd);
+            http_close_lower(s);
             goto redo;
         } else
             goto fail;
@@ -289,7 +354,7 @@ redo:
          s->http_code == 303 || s->http_code == 307) &&
         location_changed == 1) {
         /* url moved, get next */
-        ffurl_em_closep(&s->hd);
+        http_close_lower(s);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
         /* Restart the authentication process with the new target, which
@@ -303,7 +368,7 @@ redo:
 
 fail:
     if (s->hd)
-        ffurl_em_closep(&s->hd);
+        http_close_lower(s);
     if (location_changed < 0)
         return location_changed;
     return em_http_averror(s->http_code, AVERROR(EIO));
@@ -1081,7 +1146,7 @@ static int http_connect(EMURLContext *h, const char *path, const char *local_pat
                            "Expect: 100-continue\r\n");
 
     if (!has_header(s->headers, "\r\nConnection: ")) {
-        if (s->multiple_requests)
+        if (s->multiple_requests || s->pool_conn)
             len += av_em_strlcpy(headers + len, "Connection: keep-alive\r\n",
                               sizeof(headers) - len);
         else
@@ -1460,6 +1525,42 @@ static int http_shutdown(EMURLContext *h, int flags)
     return ret;
 }
 
+/* whether s->hd sits right behind a fully read response */
+static int http_response_done(HTTPContext *s)
+{
+    int64_t target_end = s->end_off ? s->end_off : s->filesize;
+
+    if (!s->pool_conn || s->willclose || s->chunksize >= 0 ||
+        s->http_code < 200 || s->http_code >= 300 || s->buf_ptr != s->buf_end)
+        return 0;
+#if CONFIG_ZLIB
+    if (s->compressed)
+        return 0;
+#endif
+    return target_end >= 0 && s->off >= target_end;
+}
+
+/* hand s->hd back to the keep-alive pool if it can serve another request */
+static void http_release_lower(EMURLContext *h, int drain)
+{
+    HTTPContext *s = h->priv_data;
+    int64_t target_end = s->end_off ? s->end_off : s->filesize;
+    uint8_t discard[4096];
+
+    if (drain && s->pool_conn && !s->willclose && s->chunksize < 0 &&
+        target_end >= 0 && target_end - s->off <= HTTP_POOL_DRAIN_MAX) {
+        while (s->off < target_end || s->buf_ptr != s->buf_end) {
+            if (http_buf_read(h, discard, sizeof(discard)) <= 0)
+                break;
+        }
+    }
+
+    if (http_response_done(s))
+        ff_http_pool_put(s->pool_key, &s->hd, &s->pool_conn);
+    else
+        http_close_lower(s);
+}
+
 static int http_close(EMURLContext *h)
 {
     int ret = 0;
@@ -1475,7 +1576,7 @@ static int http_close(EMURLContext *h)
         ret = http_shutdown(h, h->flags);
 
     if (s->hd)
-        ffurl_em_closep(&s->hd);
+        http_release_lower(h, 1);
     av_em_dict_free(&s->chained_options);
     return ret;
 }
@@ -1484,9 +1585,10 @@ static int64_t http_seek_internal(EMURLContext *h, int64_t off, int whence, int
 {
     HTTPContext *s = h->priv_data;
     EMURLContext *old_hd = s->hd;
+    HTTPPoolConn *old_conn = s->pool_conn;
     int64_t old_off = s->off;
     uint8_t old_buf[BUFFER_SIZE];
-    int old_buf_size, ret;
+    int old_buf_size, old_done, ret;
     AVEMDictionary *options = NULL;
 
     if (whence == AVSEEK_SIZE)
@@ -1506,15 +1608,25 @@ static int64_t http_seek_internal(EMURLContext *h, int64_t off, int whence, int
         return AVERROR(EINVAL);
     if (off < 0)
         return AVERROR(EINVAL);
+    old_done = s->hd && http_response_done(s);
     s->off = off;
 
     if (s->off && h->is_streamed)
         return AVERROR(ENOSYS);
 
+    /* a fully read response leaves nothing to fall back on, let the new
+     * request pick the connection up from the keep-alive pool instead */
+    if (old_done) {
+        ff_http_pool_put(s->pool_key, &s->hd, &s->pool_conn);
+        old_hd   = NULL;
+        old_conn = NULL;
+    }
+
     /* we save the old context in case the seek fails */
     old_buf_size = s->buf_end - s->buf_ptr;
     memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
+    s->hd        = NULL;
+    s->pool_conn = NULL;
 
     /* if it fails, continue on old connection */
     av_em_application_will_http_seek(s->app_ctx, (void*)h, s->location, off);
@@ -1524,13 +1636,15 @@ static int64_t http_seek_internal(EMURLContext *h, int64_t off, int whence, int
         memcpy(s->buffer, old_buf, old_buf_size);
         s->buf_ptr = s->buffer;
         s->buf_end = s->buffer + old_buf_size;
-        s->hd      = old_hd;
-        s->off     = old_off;
+        s->hd        = old_hd;
+        s->pool_conn = old_conn;
+        s->off       = old_off;
         return ret;
     }
     av_em_application_did_http_seek(s->app_ctx, (void*)h, s->location, off, ret, s->http_code);
     av_em_dict_free(&options);
     ffurl_em_close(old_hd);
+    ff_http_pool_conn_free(&old_conn);
     return off;
 }
 
@@ -0,0 +1,313 @@
+/*
+ * Process-wide pool of idle HTTP keep-alive connections
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+
+#include "avio.h"
+#include "httppool.h"
+#include "network.h"
+#include "os_support.h"
+#if HAVE_POLL_H
+#include <poll.h>
+#endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#define HTTP_POOL_MAX_PER_HOST  4
+#define HTTP_POOL_MAX_IDLE      16
+/* well below the keep-alive timeout of common servers (nginx: 75s) */
+#define HTTP_POOL_TTL_US        (15 * 1000000LL)
+
+struct HTTPPoolConn {
+    AVEMIOInterruptCB       int_cb;     ///< current owner
+    AVApplicationContext   *app_ctx;    ///< current owner
+    AVApplicationContext    app_proxy;  ///< handed to the lower protocols
+
+    /* only valid while idle in the pool */
+    EMURLContext           *hd;
+    char                   *key;
+    int64_t                 idle_since;
+    struct HTTPPoolConn    *next;
+};
+
+#if HAVE_PTHREADS
+static pthread_mutex_t  pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static HTTPPoolConn    *pool_idle;
+static AVIOHTTPPoolStat pool_stat;
+#endif
+
+static int pool_conn_interrupt(void *opaque)
+{
+    HTTPPoolConn *conn = opaque;
+    return em_check_interrupt(&conn->int_cb);
+}
+
+static int pool_conn_on_app_event(AVApplicationContext *h, int event_type, void *obj, size_t size)
+{
+    HTTPPoolConn *conn = h->opaque;
+    AVApplicationContext *app_ctx = conn->app_ctx;
+
+    if (app_ctx && app_ctx->func_on_app_event)
+        return app_ctx->func_on_app_event(app_ctx, event_type, obj, size);
+    return 0;
+}
+
+static void pool_conn_bind(HTTPPoolConn *conn, const AVEMIOInterruptCB *int_cb,
+                           AVApplicationContext *app_ctx)
+{
+    if (int_cb)
+        conn->int_cb = *int_cb;
+    else
+        memset(&conn->int_cb, 0, sizeof(conn->int_cb));
+    conn->app_ctx = app_ctx;
+}
+
+/* an idle keep-alive socket has nothing to say: readable means EOF or junk */
+static int pool_conn_alive(EMURLContext *hd)
+{
+#if HAVE_POLL_H
+    struct pollfd p;
+    int fd = ffurl_em_get_file_handle(hd);
+
+    if (fd < 0)
+        return 0;
+    p.fd      = fd;
+    p.events  = POLLIN;
+    p.revents = 0;
+    return poll(&p, 1, 0) == 0;
+#else
+    return 0;
+#endif
+}
+
+static void pool_conn_close(HTTPPoolConn *conn)
+{
+    /* nobody can interrupt a parked connection, don't let a stale owner try */
+    pool_conn_bind(conn, NULL, NULL);
+    ffurl_em_closep(&conn->hd);
+    ff_http_pool_conn_free(&conn);
+}
+
+HTTPPoolConn *ff_http_pool_conn_alloc(const AVEMIOInterruptCB *int_cb,
+                                      AVApplicationContext *app_ctx,
+                                      AVEMIOInterruptCB *lower_int_cb,
+                                      AVApplicationContext **lower_app_ctx)
+{
+    HTTPPoolConn *conn = av_em_mallocz(sizeof(*conn));
+    if (!conn)
+        return NULL;
+
+    pool_conn_bind(conn, int_cb, app_ctx);
+    conn->app_proxy.opaque            = conn;
+    conn->app_proxy.func_on_app_event = pool_conn_on_app_event;
+
+    lower_int_cb->callback = pool_conn_interrupt;
+    lower_int_cb->opaque   = conn;
+    *lower_app_ctx         = &conn->app_proxy;
+    return conn;
+}
+
+void ff_http_pool_conn_free(HTTPPoolConn **pconn)
+{
+    HTTPPoolConn *conn = *pconn;
+
+    if (!conn)
+        return;
+    av_em_freep(&conn->key);
+    av_em_freep(pconn);
+}
+
+#if HAVE_PTHREADS
+/* unlink expired connections, the caller closes them outside the lock */
+static HTTPPoolConn *pool_collect_expired_l(int64_t now)
+{
+    HTTPPoolConn *expired = NULL;
+    HTTPPoolConn **p_conn, *conn;
+
+    p_conn = &pool_idle;
+    while ((conn = *p_conn)) {
+        if (now - conn->idle_since >= HTTP_POOL_TTL_US) {
+            *p_conn = conn->next;
+            conn->next = expired;
+            expired = conn;
+            pool_stat.idle--;
+            pool_stat.expired++;
+        } else {
+            p_conn = &conn->next;
+        }
+    }
+    return expired;
+}
+
+static void pool_close_list(HTTPPoolConn *conn)
+{
+    HTTPPoolConn *next;
+
+    for (; conn; conn = next) {
+        next = conn->next;
+        pool_conn_close(conn);
+    }
+}
+#endif
+
+EMURLContext *ff_http_pool_get(const char *key, HTTPPoolConn **pconn,
+                               const AVEMIOInterruptCB *int_cb,
+                               AVApplicationContext *app_ctx)
+{
+#if HAVE_PTHREADS
+    HTTPPoolConn *expired, *dead = NULL;
+    HTTPPoolConn **p_conn, *conn;
+    EMURLContext *hd = NULL;
+
+    pthread_mutex_lock(&pool_mutex);
+    expired = pool_collect_expired_l(av_em_gettime_relative());
+    /* most recently parked first, it is the least likely to be closed */
+    p_conn = &pool_idle;
+    while ((conn = *p_conn)) {
+        if (strcmp(conn->key, key)) {
+            p_conn = &conn->next;
+            continue;
+        }
+        *p_conn = conn->next;
+        pool_stat.idle--;
+        if (pool_conn_alive(conn->hd)) {
+            pool_stat.reused++;
+            break;
+        }
+        pool_stat.expired++;
+        conn->next = dead;
+        dead = conn;
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    pool_close_list(expired);
+    pool_close_list(dead);
+
+    if (conn) {
+        hd = conn->hd;
+        conn->hd   = NULL;
+        conn->next = NULL;
+        av_em_freep(&conn->key);
+        pool_conn_bind(conn, int_cb, app_ctx);
+        *pconn = conn;
+    }
+    return hd;
+#else
+    return NULL;
+#endif
+}
+
+void ff_http_pool_put(const char *key, EMURLContext **phd, HTTPPoolConn **pconn)
+{
+#if HAVE_PTHREADS
+    HTTPPoolConn *conn = *pconn;
+    HTTPPoolConn *expired, *dropped = NULL;
+    HTTPPoolConn **p_conn, *c;
+    int64_t now = av_em_gettime_relative();
+    int nb_host = 0;
+
+    *pconn = NULL;
+    if (!conn) {
+        ffurl_em_closep(phd);
+        return;
+    }
+    conn->hd = *phd;
+    *phd = NULL;
+    pool_conn_bind(conn, NULL, NULL);
+
+    if (!conn->hd || !pool_conn_alive(conn->hd) ||
+        !(conn->key = av_em_strdup(key))) {
+        pool_conn_close(conn);
+        return;
+    }
+    conn->idle_since = now;
+
+    pthread_mutex_lock(&pool_mutex);
+    expired = pool_collect_expired_l(now);
+    conn->next = pool_idle;
+    pool_idle = conn;
+    pool_stat.idle++;
+
+    /* the list is newest first, drop the oldest beyond either cap */
+    for (p_conn = &pool_idle; (c = *p_conn); ) {
+        if (!strcmp(c->key, key))
+            nb_host++;
+        if ((nb_host > HTTP_POOL_MAX_PER_HOST && !strcmp(c->key, key)) ||
+            (pool_stat.idle > HTTP_POOL_MAX_IDLE && !c->next)) {
+            *p_conn = c->next;
+            c->next = dropped;
+            dropped = c;
+            pool_stat.idle--;
+            pool_stat.expired++;
+        } else {
+            p_conn = &c->next;
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    pool_close_list(expired);
+    pool_close_list(dropped);
+#else
+    ffurl_em_closep(phd);
+    ff_http_pool_conn_free(pconn);
+#endif
+}
+
+void ff_http_pool_count_fresh(void)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&pool_mutex);
+    pool_stat.fresh++;
+    pthread_mutex_unlock(&pool_mutex);
+#endif
+}
+
+void avio_em_http_pool_get_stat(AVIOHTTPPoolStat *stat)
+{
+    if (!stat)
+        return;
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&pool_mutex);
+    *stat = pool_stat;
+    pthread_mutex_unlock(&pool_mutex);
+#else
+    memset(stat, 0, sizeof(*stat));
+#endif
+}
+
+void avio_em_http_pool_flush(void)
+{
+#if HAVE_PTHREADS
+    HTTPPoolConn *idle;
+
+    pthread_mutex_lock(&pool_mutex);
+    idle = pool_idle;
+    pool_idle = NULL;
+    pool_stat.idle = 0;
+    pthread_mutex_unlock(&pool_mutex);
+
+    pool_close_list(idle);
+#endif
+}
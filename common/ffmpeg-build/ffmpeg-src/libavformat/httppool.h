@@ -0,0 +1,75 @@
+/*
+ * Process-wide pool of idle HTTP keep-alive connections
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_HTTPPOOL_H
+#define AVFORMAT_HTTPPOOL_H
+
+#include "libavutil/application.h"
+#include "url.h"
+
+/*
+ * Connections are keyed by the lower protocol URL (tcp://host:port,
+ * tls://host:port, ...), so proxies and TLS never mix with plain sockets.
+ *
+ * A pooled connection outlives the HTTP context that opened it, while the
+ * lower protocols keep the interrupt callback and application context they
+ * were opened with. Every pooled connection is therefore opened through a
+ * binding: the lower layers see a forwarding callback and application
+ * context, and the binding is pointed at the current owner on each reuse.
+ */
+typedef struct HTTPPoolConn HTTPPoolConn;
+
+/**
+ * Allocate the binding for a connection about to be opened and fill in the
+ * interrupt callback and application context to open the lower protocol with.
+ */
+HTTPPoolConn *ff_http_pool_conn_alloc(const AVEMIOInterruptCB *int_cb,
+                                      AVApplicationContext *app_ctx,
+                                      AVEMIOInterruptCB *lower_int_cb,
+                                      AVApplicationContext **lower_app_ctx);
+
+/**
+ * Free a binding. The connection opened through it must be closed first,
+ * closing may still call back into the binding.
+ */
+void ff_http_pool_conn_free(HTTPPoolConn **pconn);
+
+/**
+ * Take a healthy idle connection for key out of the pool and bind it to
+ * the new owner.
+ *
+ * @return the connection, *pconn is set to its binding, or NULL
+ */
+EMURLContext *ff_http_pool_get(const char *key, HTTPPoolConn **pconn,
+                               const AVEMIOInterruptCB *int_cb,
+                               AVApplicationContext *app_ctx);
+
+/**
+ * Park a connection whose last response was fully read. The pool takes
+ * over *phd and *pconn in any case and closes them if it cannot keep them.
+ */
+void ff_http_pool_put(const char *key, EMURLContext **phd, HTTPPoolConn **pconn);
+
+/**
+ * Account a request that could not be served from the pool.
+ */
+void ff_http_pool_count_fresh(void);
+
+#endif /* AVFORMAT_HTTPPOOL_H */
@@ -317,6 +317,15 @@ int em_add_index_entry(AVEMIndexEntry **index_entries,
 
 void em_configure_buffers_for_index(AVEMFormatContext *s, int64_t time_tolerance);
 
+/**
+ * The two halves of em_configure_buffers_for_index(), for demuxers that do
+ * not keep their whole index in index_entries: whether the protocol gets
+ * its buffers configured at all, and applying the largest position spread
+ * between streams and the largest entry size found.
+ */
+int em_buffers_configurable(AVEMFormatContext *s);
+void em_configure_buffers_for_spread(AVEMFormatContext *s, int64_t pos_delta, int64_t skip);
+
 /**
  * Add a new chapter.
  *
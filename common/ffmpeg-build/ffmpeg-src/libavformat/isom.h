@@ -115,6 +115,30 @@ typedef struct MOVFragmentIndex {
     MOVFragmentIndexItem *items;
 } MOVFragmentIndex;
 
+/* state of the sample table walk at the first sample of an index window */
+typedef struct MOVIndexCursor {
+    int64_t offset;
+    int64_t dts;
+    int64_t last_dts;
+    int64_t dts_correction;
+    unsigned int sample;
+    unsigned int chunk;
+    unsigned int chunk_sample;    ///< samples of the chunk already walked
+    unsigned int stsc_index;
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    unsigned int stss_index;
+    unsigned int stps_index;
+    unsigned int rap_group_index;
+    unsigned int rap_group_sample;
+    unsigned int distance;
+} MOVIndexCursor;
+
+typedef struct MOVIndexKey {
+    int64_t timestamp;
+    unsigned int sample;
+} MOVIndexKey;
+
 typedef struct MOVStreamContext {
     AVEMIOContext *pb;
     int pb_is_copied;
@@ -166,6 +190,14 @@ typedef struct MOVStreamContext {
     unsigned int rap_group_count;
     MOVSbgp *rap_group;
 
+    MOVIndexCursor *index_cursors;  ///< compact index, index_entries is one window of it
+    unsigned int index_windows;
+    unsigned int index_count;       ///< samples in the compact index
+    int index_first;                ///< sample of index_entries[0]
+    MOVIndexKey *index_keys;        ///< NULL if all samples or none are keyframes
+    unsigned int index_keys_count;
+    int split_pb;                   ///< to get its own pb on its first packet, see split_interleave
+
     int nb_frames_for_fps;
     int64_t duration_for_fps;
 
@@ -231,6 +263,15 @@ typedef struct MOVContext {
     uint8_t *decryption_key;
     int decryption_key_len;
     int enable_drefs;
+    int compact_index;      ///< keep the sample tables, expand them a window at a time
+    int moov_prefetch;      ///< fetch a moov after mdat over a second connection
+    int moov_cache;         ///< keep such moov atoms per url for the next open
+    int moov_prefetched;
+    uint8_t *head_buf;      ///< start of mdat, read while the moov was fetched
+    int64_t head_pos;
+    int head_size;
+    int split_interleave;   ///< tracks further apart than this are read over a pb each
+    int split_tracks;
 } MOVContext;
 
 int em_mp4_read_descr_len(AVEMIOContext *pb);
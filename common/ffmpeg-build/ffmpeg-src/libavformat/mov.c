@@ -27,6 +27,7 @@
 #include <limits.h>
 #include <stdint.h>
 
+#include "libavutil/atomic.h"
 #include "libavutil/attributes.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/internal.h"
@@ -59,6 +60,10 @@
 
 #include "qtpalette.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 /* those functions parse an atom */
 /* links atom IDs to parse functions */
 typedef struct MOVParseTableEntry {
@@ -952,12 +957,323 @@ static int mov_read_pasp(MOVContext *c, AVEMIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+#define MOV_PREFETCH_MAX_TAIL       (16 << 20)
+#define MOV_PREFETCH_MAX_HEAD       (2 << 20)
+#define MOV_PREFETCH_CHUNK          (64 << 10)
+#define MOV_MOOV_CACHE_ENTRIES      8
+#define MOV_MOOV_CACHE_MAX_BYTES    (32 << 20)
+
+typedef struct MOVMoovCacheEntry {
+    char    *url;
+    int64_t  file_size;
+    int64_t  tail_pos;      ///< end of the mdat the moov follows
+    uint8_t *data;          ///< the whole moov atom
+    int      size;
+    int64_t  last_used;
+} MOVMoovCacheEntry;
+
+typedef struct MOVTailFetch {
+    AVEMFormatContext  *fc;
+    char               *url;
+    AVEMDictionary     *opts;
+    uint8_t            *data;
+    int                 size;
+    int                 ret;
+    volatile int        done;
+} MOVTailFetch;
+
+#if HAVE_PTHREADS
+static pthread_mutex_t      moov_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static MOVMoovCacheEntry    moov_cache[MOV_MOOV_CACHE_ENTRIES];
+static int64_t              moov_cache_clock;
+
+/* a copy of the cached moov, or NULL */
+static uint8_t *mov_moov_cache_get(const char *url, int64_t file_size, int64_t tail_pos, int *size)
+{
+    uint8_t *data = NULL;
+    int i;
+
+    pthread_mutex_lock(&moov_cache_mutex);
+    for (i = 0; i < MOV_MOOV_CACHE_ENTRIES; i++) {
+        MOVMoovCacheEntry *e = &moov_cache[i];
+        if (e->url && e->file_size == file_size && e->tail_pos == tail_pos && !strcmp(e->url, url)) {
+            data = av_em_memdup(e->data, e->size);
+            if (data) {
+                *size = e->size;
+                e->last_used = ++moov_cache_clock;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&moov_cache_mutex);
+    return data;
+}
+
+static void mov_moov_cache_put(const char *url, int64_t file_size, int64_t tail_pos, const uint8_t *data, int size)
+{
+    MOVMoovCacheEntry *e;
+    int64_t total = size;
+    int i;
+
+    if (size > MOV_MOOV_CACHE_MAX_BYTES)
+        return;
+
+    pthread_mutex_lock(&moov_cache_mutex);
+    for (i = 0; i < MOV_MOOV_CACHE_ENTRIES; i++)
+        total += moov_cache[i].size;
+    /* evict the least recently used until the new one fits */
+    for (;;) {
+        MOVMoovCacheEntry *lru = NULL;
+        e = NULL;
+        for (i = 0; i < MOV_MOOV_CACHE_ENTRIES; i++) {
+            if (!moov_cache[i].url) {
+                if (!e)
+                    e = &moov_cache[i];
+            } else if (!lru || moov_cache[i].last_used < lru->last_used) {
+                lru = &moov_cache[i];
+            }
+        }
+        if ((e && total <= MOV_MOOV_CACHE_MAX_BYTES) || !lru)
+            break;
+        total -= lru->size;
+        av_em_freep(&lru->url);
+        av_em_freep(&lru->data);
+        lru->size = 0;
+    }
+    if (e) {
+        e->url  = av_em_strdup(url);
+        e->data = av_em_memdup(data, size);
+        if (!e->url || !e->data) {
+            av_em_freep(&e->url);
+            av_em_freep(&e->data);
+        } else {
+            e->file_size = file_size;
+            e->tail_pos  = tail_pos;
+            e->size      = size;
+            e->last_used = ++moov_cache_clock;
+        }
+    }
+    pthread_mutex_unlock(&moov_cache_mutex);
+}
+#else
+static uint8_t *mov_moov_cache_get(const char *url, int64_t file_size, int64_t tail_pos, int *size)
+{
+    return NULL;
+}
+
+static void mov_moov_cache_put(const char *url, int64_t file_size, int64_t tail_pos, const uint8_t *data, int size)
+{
+}
+#endif
+
+/* finds the moov among the root atoms buf starts with */
+static int mov_find_moov(const uint8_t *buf, int size, int *moov_offset, int *moov_size)
+{
+    int64_t offset = 0;
+
+    while (offset + 8 <= size) {
+        int64_t atom_size = AV_RB32(buf + offset);
+        uint32_t type     = AV_RL32(buf + offset + 4);
+
+        if (atom_size == 1) {
+            if (offset + 16 > size)
+                break;
+            atom_size = AV_RB64(buf + offset + 8);
+        } else if (atom_size == 0) {
+            atom_size = size - offset;
+        }
+        if (atom_size < 8 || atom_size > size - offset)
+            break;
+        if (type == MKTAG('m','o','o','v')) {
+            *moov_offset = offset;
+            *moov_size   = atom_size;
+            return 1;
+        }
+        offset += atom_size;
+    }
+    return 0;
+}
+
+static int mov_read_moov_buffer(MOVContext *c, uint8_t *data, int size)
+{
+    AVEMIOContext ctx;
+    MOVAtom atom = { AV_RL32("root") };
+
+    if (emio_init_context(&ctx, data, size, 0, NULL, NULL, NULL, NULL) != 0)
+        return AVERROR(ENOMEM);
+    ctx.seekable = AVIO_SEEKABLE_NORMAL;
+    atom.size = size;
+    return mov_read_default(c, &ctx, atom);
+}
+
+static void *mov_tail_fetch(void *arg)
+{
+    MOVTailFetch *fetch = arg;
+    AVEMIOContext *pb = NULL;
+
+    fetch->ret = fetch->fc->io_open(fetch->fc, &pb, fetch->url, AVIO_FLAG_READ, &fetch->opts);
+    if (fetch->ret >= 0) {
+        fetch->ret = emio_read_size(pb, fetch->data, fetch->size);
+        em_format_io_close(fetch->fc, &pb);
+    }
+    avpriv_em_atomic_int_set(&fetch->done, 1);
+    return NULL;
+}
+
+/* reads on into mdat until the tail has arrived, mov_read_packet serves it */
+static void mov_read_head(MOVContext *c, AVEMIOContext *pb, int64_t max_size, volatile int *done)
+{
+    max_size = FFMIN(max_size, MOV_PREFETCH_MAX_HEAD);
+    c->head_buf = av_em_alloc(max_size);
+    if (!c->head_buf)
+        return;
+    c->head_pos = avio_em_tell(pb);
+    while (c->head_size < max_size && !avpriv_em_atomic_int_get(done)) {
+        int ret = avio_em_read(pb, c->head_buf + c->head_size,
+                               FFMIN(MOV_PREFETCH_CHUNK, max_size - c->head_size));
+        if (ret <= 0)
+            break;
+        c->head_size += ret;
+    }
+    if (!c->head_size)
+        av_em_freep(&c->head_buf);
+}
+
+/* the url pb ended up on after redirects, and the http options it was opened with */
+static int mov_get_io_source(MOVContext *c, AVEMIOContext *pb, char **url, AVEMDictionary **opts)
+{
+    /* the application context keeps the extra connection visible to the player's io events */
+    static const char *avio_opts[] = {
+        "headers", "http_proxy", "user_agent", "user-agent", "cookies",
+        "reconnect", "reconnect_at_eof", "reconnect_streamed", "reconnect_delay_max",
+        "rw_timeout", "dns_timeout", "dns_cache_count", "ijkapplication", NULL };
+    const char **opt;
+    AVEMDictionaryEntry *e;
+    uint8_t *buf;
+
+    if (av_em_opt_get(pb, "location", AV_OPT_SEARCH_CHILDREN, (uint8_t **)url) < 0 ||
+        !*url || !**url) {
+        av_em_freep(url);
+        *url = av_em_strdup(c->fc->filename);
+    }
+    for (opt = avio_opts; *opt; opt++) {
+        if (av_em_opt_get(pb, *opt, AV_OPT_SEARCH_CHILDREN | AV_OPT_ALLOW_NULL, &buf) >= 0 && buf)
+            av_em_dict_set(opts, *opt, buf, AV_DICT_DONT_STRDUP_VAL);
+    }
+    /* the socket timeout of the protocol below is not readable from here */
+    if ((e = av_em_dict_get(*opts, "rw_timeout", NULL, 0)) && strtoll(e->value, NULL, 10) > 0)
+        av_em_dict_set(opts, "timeout", e->value, 0);
+    return *url ? 0 : AVERROR(ENOMEM);
+}
+
+/*
+ * The moov of a file which is not faststart sits after mdat. Rather than
+ * seeking over mdat and back, which costs two reconnects over http before
+ * the first packet, the tail of the file is fetched over a second
+ * connection while this one reads on into mdat.
+ */
+static int mov_prefetch_moov(MOVContext *c, AVEMIOContext *pb, MOVAtom atom)
+{
+    AVEMFormatContext *fc = c->fc;
+    MOVTailFetch fetch = { 0 };
+    int64_t file_size = avio_em_size(pb);
+    int64_t tail_pos  = avio_em_tell(pb) + atom.size;
+    uint8_t *moov;
+    int moov_offset, moov_size, ret = 0;
+#if HAVE_PTHREADS
+    pthread_t thread;
+#endif
+
+    if (!pb->seekable || !av_em_stristart(fc->filename, "http", NULL) ||
+        file_size <= tail_pos || file_size - tail_pos > MOV_PREFETCH_MAX_TAIL)
+        return 0;
+
+    if (c->moov_cache && (moov = mov_moov_cache_get(fc->filename, file_size, tail_pos, &moov_size))) {
+        ret = mov_read_moov_buffer(c, moov, moov_size);
+        av_em_free(moov);
+        if (ret >= 0 && c->found_moov) {
+            av_em_log(fc, AV_LOG_INFO, "moov at %"PRId64" taken from cache\n", tail_pos);
+            c->moov_prefetched = 1;
+        }
+        return ret;
+    }
+
+    fetch.fc   = fc;
+    fetch.size = file_size - tail_pos;
+    fetch.data = av_em_alloc(fetch.size);
+    if (!fetch.data)
+        return 0;
+    if (mov_get_io_source(c, pb, &fetch.url, &fetch.opts) < 0)
+        goto end;
+    av_em_dict_set_int(&fetch.opts, "offset", tail_pos, 0);
+    av_em_dict_set_int(&fetch.opts, "end_offset", file_size, 0);
+
+#if HAVE_PTHREADS
+    if (!pthread_create(&thread, NULL, mov_tail_fetch, &fetch)) {
+        mov_read_head(c, pb, atom.size, &fetch.done);
+        pthread_join(thread, NULL);
+    } else
+#endif
+        mov_tail_fetch(&fetch);
+
+    if (fetch.ret < 0 || !mov_find_moov(fetch.data, fetch.size, &moov_offset, &moov_size)) {
+        av_em_log(fc, AV_LOG_WARNING, "no moov fetched at %"PRId64", seeking for it\n", tail_pos);
+        goto end;
+    }
+    moov = fetch.data + moov_offset;
+    ret = mov_read_moov_buffer(c, moov, moov_size);
+    if (ret >= 0 && c->found_moov) {
+        av_em_log(fc, AV_LOG_INFO, "moov at %"PRId64" fetched, %d bytes of mdat read meanwhile\n",
+                  tail_pos + moov_offset, c->head_size);
+        c->moov_prefetched = 1;
+        if (c->moov_cache)
+            mov_moov_cache_put(fc->filename, file_size, tail_pos, moov, moov_size);
+    }
+end:
+    av_em_free(fetch.data);
+    av_em_free(fetch.url);
+    av_em_dict_free(&fetch.opts);
+    return ret;
+}
+
+/* serves a sample from the start of mdat read by mov_read_head, 0 if it is not there */
+static int mov_get_head_packet(MOVContext *mov, MOVStreamContext *sc, AVEMPacket *pkt, AVEMIndexEntry *sample)
+{
+    int64_t head_end = mov->head_pos + mov->head_size;
+    int size = sample->size, len, ret;
+
+    if (!mov->head_buf || sc->pb != mov->fc->pb)
+        return 0;
+    if (sample->pos >= head_end + MOV_PREFETCH_MAX_HEAD) {
+        /* well past it, only a seek back would need it again */
+        av_em_freep(&mov->head_buf);
+        return 0;
+    }
+    if (sample->pos < mov->head_pos || sample->pos >= head_end || size <= 0)
+        return 0;
+
+    if ((ret = av_em_new_packet(pkt, size)) < 0)
+        return ret;
+    len = FFMIN(size, head_end - sample->pos);
+    memcpy(pkt->data, mov->head_buf + (sample->pos - mov->head_pos), len);
+    if (len < size) {
+        if (avio_em_seek(sc->pb, head_end, SEEK_SET) != head_end ||
+            (ret = emio_read_size(sc->pb, pkt->data + len, size - len)) < 0) {
+            av_em_packet_unref(pkt);
+            return AVERROR_INVALIDDATA;
+        }
+    }
+    return size;
+}
+
 /* this atom contains actual media data */
 static int mov_read_mdat(MOVContext *c, AVEMIOContext *pb, MOVAtom atom)
 {
     if (atom.size == 0) /* wrong one (MP4) */
         return 0;
     c->found_mdat=1;
+    if (c->moov_prefetch && !c->found_moov && c->atom_depth == 1)
+        return mov_prefetch_moov(c, pb, atom);
     return 0; /* now go for moov */
 }
 
@@ -2711,16 +3027,400 @@ static int mov_read_sbgp(MOVContext *c, AVEMIOContext *pb, MOVAtom atom)
     return pb->eof_reached ? AVERROR_EOF : 0;
 }
 
+#define MOV_INDEX_WINDOW    1024
+
+/*
+ * Walks the sample tables from cursor on, writing up to nb_entries index
+ * entries, and returns how many were written. The cursor is left on the
+ * next sample, a copy of it resumes the walk from there.
+ */
+static int mov_index_expand(MOVContext *mov, AVEMStream *st, MOVIndexCursor *cur,
+                            AVEMIndexEntry *entries, unsigned int nb_entries, uint64_t *stream_size)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int rap_group_present = sc->rap_group_count && sc->rap_group;
+    int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+    unsigned int sample_size;
+    unsigned int n = 0;
+
+    while (n < nb_entries && cur->chunk < sc->chunk_count) {
+        int keyframe = 0;
+
+        if (!cur->chunk_sample) {
+            int64_t next_offset = cur->chunk + 1 < sc->chunk_count ? sc->chunk_offsets[cur->chunk + 1] : INT64_MAX;
+            cur->offset = sc->chunk_offsets[cur->chunk];
+            while (cur->stsc_index + 1 < sc->stsc_count &&
+                cur->chunk + 1 == sc->stsc_data[cur->stsc_index + 1].first)
+                cur->stsc_index++;
+
+            if (next_offset > cur->offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
+                sc->stsc_data[cur->stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - cur->offset) {
+                av_em_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
+                sc->stsz_sample_size = sc->sample_size;
+            }
+            if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
+                av_em_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
+                sc->stsz_sample_size = sc->sample_size;
+            }
+        }
+        if (cur->chunk_sample >= sc->stsc_data[cur->stsc_index].count) {
+            cur->chunk++;
+            cur->chunk_sample = 0;
+            continue;
+        }
+
+        if (cur->sample >= sc->sample_count) {
+            av_em_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+            cur->chunk = sc->chunk_count;
+            break;
+        }
+
+        if (!sc->keyframe_absent && (!sc->keyframe_count || cur->sample+key_off == sc->keyframes[cur->stss_index])) {
+            keyframe = 1;
+            if (cur->stss_index + 1 < sc->keyframe_count)
+                cur->stss_index++;
+        } else if (sc->stps_count && cur->sample+key_off == sc->stps_data[cur->stps_index]) {
+            keyframe = 1;
+            if (cur->stps_index + 1 < sc->stps_count)
+                cur->stps_index++;
+        }
+        if (rap_group_present && cur->rap_group_index < sc->rap_group_count) {
+            if (sc->rap_group[cur->rap_group_index].index > 0)
+                keyframe = 1;
+            if (++cur->rap_group_sample == sc->rap_group[cur->rap_group_index].count) {
+                cur->rap_group_sample = 0;
+                cur->rap_group_index++;
+            }
+        }
+        if (sc->keyframe_absent
+            && !sc->stps_count
+            && !rap_group_present
+            && (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || (cur->chunk == 0 && cur->chunk_sample == 0)))
+             keyframe = 1;
+        if (keyframe)
+            cur->distance = 0;
+        sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[cur->sample];
+        if (sc->pseudo_stream_id == -1 ||
+           sc->stsc_data[cur->stsc_index].id - 1 == sc->pseudo_stream_id) {
+            AVEMIndexEntry *e = &entries[n++];
+            e->pos = cur->offset;
+            e->timestamp = cur->dts;
+            e->size = sample_size;
+            e->min_distance = cur->distance;
+            e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
+            av_em_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %d, offset %"PRIx64", dts %"PRId64", "
+                    "size %d, distance %d, keyframe %d\n", st->index, cur->sample,
+                    cur->offset, cur->dts, sample_size, cur->distance, keyframe);
+        }
+
+        cur->offset += sample_size;
+        if (stream_size)
+            *stream_size += sample_size;
+
+        /* A negative sample duration is invalid based on the spec,
+         * but some samples need it to correct the DTS. */
+        if (sc->stts_data[cur->stts_index].duration < 0) {
+            av_em_log(mov->fc, AV_LOG_WARNING,
+                   "Invalid SampleDelta %d in STTS, at %d st:%d\n",
+                   sc->stts_data[cur->stts_index].duration, cur->stts_index,
+                   st->index);
+            cur->dts_correction += sc->stts_data[cur->stts_index].duration - 1;
+            sc->stts_data[cur->stts_index].duration = 1;
+        }
+        cur->dts += sc->stts_data[cur->stts_index].duration;
+        if (!cur->dts_correction || cur->dts + cur->dts_correction > cur->last_dts) {
+            cur->dts += cur->dts_correction;
+            cur->dts_correction = 0;
+        } else {
+            /* Avoid creating non-monotonous DTS */
+            cur->dts_correction += cur->dts - cur->last_dts - 1;
+            cur->dts = cur->last_dts + 1;
+        }
+        cur->last_dts = cur->dts;
+        cur->distance++;
+        cur->stts_sample++;
+        cur->sample++;
+        cur->chunk_sample++;
+        if (cur->stts_index + 1 < sc->stts_count && cur->stts_sample == sc->stts_data[cur->stts_index].count) {
+            cur->stts_sample = 0;
+            cur->stts_index++;
+        }
+    }
+    return n;
+}
+
+/*
+ * A compact index walks the tables once at open, keeping the walk state
+ * every MOV_INDEX_WINDOW samples and the keyframes. index_entries then
+ * holds a single window, which mov_index_get() moves on demand. Tables the
+ * walk rewrites on the way are left to the full index.
+ */
+static int mov_index_can_compact(MOVContext *mov, AVEMStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int i;
+
+    if (!mov->compact_index || sc->sample_count < 2 * MOV_INDEX_WINDOW ||
+        sc->stsz_sample_size || !sc->sample_sizes ||
+        (st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO && st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO))
+        return 0;
+    /* one entry per sample */
+    for (i = 0; i < sc->stsc_count && sc->pseudo_stream_id != -1; i++) {
+        if (sc->stsc_data[i].id - 1 != sc->pseudo_stream_id)
+            return 0;
+    }
+    for (i = 0; i < sc->stts_count; i++) {
+        if (sc->stts_data[i].duration < 0)
+            return 0;
+    }
+    return 1;
+}
+
+static void mov_index_load(MOVContext *mov, AVEMStream *st, unsigned int window)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVIndexCursor cursor;
+
+    if (window >= sc->index_windows)
+        return;
+    cursor = sc->index_cursors[window];
+    st->nb_index_entries = mov_index_expand(mov, st, &cursor, st->index_entries, MOV_INDEX_WINDOW, NULL);
+    sc->index_first = window * MOV_INDEX_WINDOW;
+}
+
+static void mov_index_free_compact(AVEMStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    av_em_freep(&sc->index_cursors);
+    av_em_freep(&sc->index_keys);
+    sc->index_windows    = 0;
+    sc->index_count      = 0;
+    sc->index_first      = 0;
+    sc->index_keys_count = 0;
+}
+
+static int mov_index_build_compact(MOVContext *mov, AVEMStream *st, MOVIndexCursor *cursor)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int windows = (sc->sample_count + MOV_INDEX_WINDOW - 1) / MOV_INDEX_WINDOW;
+    unsigned int keys_allocated = 0;
+    uint64_t stream_size = 0;
+    int i, n;
+
+    sc->index_cursors = av_em_malloc_array(windows, sizeof(*sc->index_cursors));
+    st->index_entries = av_em_malloc_array(MOV_INDEX_WINDOW, sizeof(*st->index_entries));
+    if (!sc->index_cursors || !st->index_entries)
+        goto fail;
+    st->index_entries_allocated_size = MOV_INDEX_WINDOW * sizeof(*st->index_entries);
+
+    while (sc->index_windows < windows) {
+        sc->index_cursors[sc->index_windows] = *cursor;
+        n = mov_index_expand(mov, st, cursor, st->index_entries, MOV_INDEX_WINDOW, &stream_size);
+        if (n <= 0)
+            break;
+        for (i = 0; i < n; i++) {
+            MOVIndexKey *key;
+
+            if (!(st->index_entries[i].flags & AVINDEX_KEYFRAME))
+                continue;
+            if (sc->index_keys_count >= keys_allocated) {
+                keys_allocated = FFMAX(2 * keys_allocated, 64);
+                if (av_em_reallocp_array(&sc->index_keys, keys_allocated, sizeof(*sc->index_keys)) < 0)
+                    goto fail;
+            }
+            key = &sc->index_keys[sc->index_keys_count++];
+            key->timestamp = st->index_entries[i].timestamp;
+            key->sample    = sc->index_count + i;
+        }
+        sc->index_windows++;
+        sc->index_count += n;
+        if (n < MOV_INDEX_WINDOW)
+            break;
+    }
+    if (!sc->index_count)
+        goto fail;
+    /* seeks then search the windows themselves */
+    if (!sc->index_keys_count || sc->index_keys_count == sc->index_count) {
+        av_em_freep(&sc->index_keys);
+        sc->index_keys_count = 0;
+    } else {
+        av_em_reallocp_array(&sc->index_keys, sc->index_keys_count, sizeof(*sc->index_keys));
+    }
+
+    if (st->duration > 0)
+        st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
+
+    mov_index_load(mov, st, 0);
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        for (i = 0; i < st->nb_index_entries && i + 1 < 100; i++)
+            em_rfps_add_frame(mov->fc, st, st->index_entries[i].timestamp);
+    }
+    av_em_log(mov->fc, AV_LOG_DEBUG, "stream %d: compact index of %u samples, %u keyframes, %u windows\n",
+              st->index, sc->index_count, sc->index_keys_count, sc->index_windows);
+    return 0;
+
+fail:
+    mov_index_free_compact(st);
+    av_em_freep(&st->index_entries);
+    st->index_entries_allocated_size = 0;
+    st->nb_index_entries = 0;
+    return AVERROR(ENOMEM);
+}
+
+/* turns a compact index into a full one, for code appending to it */
+static int mov_index_expand_all(MOVContext *mov, AVEMStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVEMIndexEntry *entries;
+    MOVIndexCursor cursor;
+
+    if (!sc->index_cursors)
+        return 0;
+
+    entries = av_em_malloc_array(sc->index_count, sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    cursor = sc->index_cursors[0];
+    av_em_free(st->index_entries);
+    st->index_entries = entries;
+    st->index_entries_allocated_size = sc->index_count * sizeof(*entries);
+    st->nb_index_entries = mov_index_expand(mov, st, &cursor, entries, sc->index_count, NULL);
+    mov_index_free_compact(st);
+    return 0;
+}
+
+/* the entry of sample n, moving the window of a compact index there, NULL past the end */
+static AVEMIndexEntry *mov_index_get(MOVContext *mov, AVEMStream *st, int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (sc->index_cursors) {
+        if (n < 0 || n >= sc->index_count)
+            return NULL;
+        if (n < sc->index_first || n >= sc->index_first + st->nb_index_entries)
+            mov_index_load(mov, st, n / MOV_INDEX_WINDOW);
+        n -= sc->index_first;
+    }
+    return n >= 0 && n < st->nb_index_entries ? &st->index_entries[n] : NULL;
+}
+
+/* em_configure_buffers_for_index() over all samples, walking compact indexes window by window */
+static void mov_configure_buffers(MOVContext *mov, int64_t time_tolerance)
+{
+    AVEMFormatContext *s = mov->fc;
+    int64_t pos_delta = 0;
+    int64_t skip = 0;
+    int ist1, ist2;
+
+    if (!em_buffers_configurable(s))
+        return;
+
+    for (ist1 = 0; ist1 < s->nb_streams; ist1++) {
+        AVEMStream *st1 = s->streams[ist1];
+        for (ist2 = 0; ist2 < s->nb_streams; ist2++) {
+            AVEMStream *st2 = s->streams[ist2];
+            AVEMIndexEntry *e1, *e2;
+            int i1, i2;
+
+            if (ist1 == ist2)
+                continue;
+
+            for (i1 = i2 = 0; (e1 = mov_index_get(mov, st1, i1)); i1++) {
+                int64_t e1_pts = av_em_rescale_q(e1->timestamp, st1->time_base, AV_TIME_BASE_Q);
+
+                skip = FFMAX(skip, e1->size);
+                for (; (e2 = mov_index_get(mov, st2, i2)); i2++) {
+                    int64_t e2_pts = av_em_rescale_q(e2->timestamp, st2->time_base, AV_TIME_BASE_Q);
+                    if (e2_pts - e1_pts < time_tolerance)
+                        continue;
+                    pos_delta = FFMAX(pos_delta, e1->pos - e2->pos);
+                    break;
+                }
+            }
+        }
+    }
+    /* reading starts at the first window */
+    for (ist1 = 0; ist1 < s->nb_streams; ist1++)
+        mov_index_get(mov, s->streams[ist1], 0);
+
+    em_configure_buffers_for_spread(s, pos_delta, skip);
+}
+
+/* the dts of sample n without moving the window, the stream duration past the end */
+static int64_t mov_index_get_dts(AVEMStream *st, int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (sc->index_cursors) {
+        if (n >= sc->index_count)
+            return st->duration;
+        if (n < sc->index_first || n >= sc->index_first + st->nb_index_entries) {
+            if (n % MOV_INDEX_WINDOW)
+                return st->duration;
+            return sc->index_cursors[n / MOV_INDEX_WINDOW].dts;
+        }
+        n -= sc->index_first;
+    }
+    return n < st->nb_index_entries ? st->index_entries[n].timestamp : st->duration;
+}
+
+/* av_em_index_search_timestamp() over all samples, as a sample number */
+static int mov_index_search(MOVContext *mov, AVEMStream *st, int64_t timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int lo, hi, index;
+
+    if (!sc->index_cursors)
+        return av_em_index_search_timestamp(st, timestamp, flags);
+
+    if (sc->index_keys && !(flags & AVSEEK_FLAG_ANY)) {
+        /* keyframes up to timestamp */
+        lo = 0;
+        hi = sc->index_keys_count;
+        while (lo < hi) {
+            int m = (lo + hi) >> 1;
+            if (sc->index_keys[m].timestamp <= timestamp)
+                lo = m + 1;
+            else
+                hi = m;
+        }
+        if (flags & AVSEEK_FLAG_BACKWARD)
+            index = lo - 1;
+        else
+            index = lo > 0 && sc->index_keys[lo - 1].timestamp == timestamp ? lo - 1 : lo;
+        if (index < 0 || index >= sc->index_keys_count)
+            return -1;
+        return sc->index_keys[index].sample;
+    }
+
+    /* the last window starting at or before timestamp */
+    lo = 0;
+    hi = sc->index_windows;
+    while (lo < hi) {
+        int m = (lo + hi) >> 1;
+        if (sc->index_cursors[m].dts <= timestamp)
+            lo = m + 1;
+        else
+            hi = m;
+    }
+    lo = FFMAX(lo - 1, 0);
+    mov_index_load(mov, st, lo);
+    index = av_em_index_search_timestamp(st, timestamp, flags);
+    if (index >= 0)
+        return sc->index_first + index;
+    if (!(flags & AVSEEK_FLAG_BACKWARD) && lo + 1 < sc->index_windows)
+        return (lo + 1) * MOV_INDEX_WINDOW;
+    return -1;
+}
+
 static void mov_build_index(MOVContext *mov, AVEMStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
     int64_t current_offset;
     int64_t current_dts = 0;
-    unsigned int stts_index = 0;
     unsigned int stsc_index = 0;
-    unsigned int stss_index = 0;
-    unsigned int stps_index = 0;
-    unsigned int i, j;
+    unsigned int i;
     uint64_t stream_size = 0;
 
     if (sc->elst_count) {
@@ -2766,22 +3466,20 @@ static void mov_build_index(MOVContext *mov, AVEMStream *st)
     /* only use old uncompressed audio chunk demuxing when stts specifies it */
     if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
           sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
-        unsigned int current_sample = 0;
-        unsigned int stts_sample = 0;
-        unsigned int sample_size;
-        unsigned int distance = 0;
-        unsigned int rap_group_index = 0;
-        unsigned int rap_group_sample = 0;
-        int64_t last_dts = 0;
-        int64_t dts_correction = 0;
-        int rap_group_present = sc->rap_group_count && sc->rap_group;
-        int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
-
-        current_dts -= sc->dts_shift;
-        last_dts     = current_dts;
+        MOVIndexCursor cursor = { 0 };
+        MOVIndexCursor start;
+        int nb_entries;
+
+        cursor.dts      = current_dts - sc->dts_shift;
+        cursor.last_dts = cursor.dts;
 
         if (!sc->sample_count || st->nb_index_entries)
             return;
+
+        start = cursor;
+        if (mov_index_can_compact(mov, st) && mov_index_build_compact(mov, st, &start) >= 0)
+            return;
+
         if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
             return;
         if (av_em_reallocp_array(&st->index_entries,
@@ -2792,101 +3490,11 @@ static void mov_build_index(MOVContext *mov, AVEMStream *st)
         }
         st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
 
-        for (i = 0; i < sc->chunk_count; i++) {
-            int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
-            current_offset = sc->chunk_offsets[i];
-            while (stsc_index + 1 < sc->stsc_count &&
-                i + 1 == sc->stsc_data[stsc_index + 1].first)
-                stsc_index++;
-
-            if (next_offset > current_offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
-                sc->stsc_data[stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - current_offset) {
-                av_em_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
-            if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
-                av_em_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
-
-            for (j = 0; j < sc->stsc_data[stsc_index].count; j++) {
-                int keyframe = 0;
-                if (current_sample >= sc->sample_count) {
-                    av_em_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
-                    return;
-                }
-
-                if (!sc->keyframe_absent && (!sc->keyframe_count || current_sample+key_off == sc->keyframes[stss_index])) {
-                    keyframe = 1;
-                    if (stss_index + 1 < sc->keyframe_count)
-                        stss_index++;
-                } else if (sc->stps_count && current_sample+key_off == sc->stps_data[stps_index]) {
-                    keyframe = 1;
-                    if (stps_index + 1 < sc->stps_count)
-                        stps_index++;
-                }
-                if (rap_group_present && rap_group_index < sc->rap_group_count) {
-                    if (sc->rap_group[rap_group_index].index > 0)
-                        keyframe = 1;
-                    if (++rap_group_sample == sc->rap_group[rap_group_index].count) {
-                        rap_group_sample = 0;
-                        rap_group_index++;
-                    }
-                }
-                if (sc->keyframe_absent
-                    && !sc->stps_count
-                    && !rap_group_present
-                    && (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || (i==0 && j==0)))
-                     keyframe = 1;
-                if (keyframe)
-                    distance = 0;
-                sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[current_sample];
-                if (sc->pseudo_stream_id == -1 ||
-                   sc->stsc_data[stsc_index].id - 1 == sc->pseudo_stream_id) {
-                    AVEMIndexEntry *e = &st->index_entries[st->nb_index_entries++];
-                    e->pos = current_offset;
-                    e->timestamp = current_dts;
-                    e->size = sample_size;
-                    e->min_distance = distance;
-                    e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
-                    av_em_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %d, offset %"PRIx64", dts %"PRId64", "
-                            "size %d, distance %d, keyframe %d\n", st->index, current_sample,
-                            current_offset, current_dts, sample_size, distance, keyframe);
-                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries < 100)
-                        em_rfps_add_frame(mov->fc, st, current_dts);
-                }
-
-                current_offset += sample_size;
-                stream_size += sample_size;
-
-                /* A negative sample duration is invalid based on the spec,
-                 * but some samples need it to correct the DTS. */
-                if (sc->stts_data[stts_index].duration < 0) {
-                    av_em_log(mov->fc, AV_LOG_WARNING,
-                           "Invalid SampleDelta %d in STTS, at %d st:%d\n",
-                           sc->stts_data[stts_index].duration, stts_index,
-                           st->index);
-                    dts_correction += sc->stts_data[stts_index].duration - 1;
-                    sc->stts_data[stts_index].duration = 1;
-                }
-                current_dts += sc->stts_data[stts_index].duration;
-                if (!dts_correction || current_dts + dts_correction > last_dts) {
-                    current_dts += dts_correction;
-                    dts_correction = 0;
-                } else {
-                    /* Avoid creating non-monotonous DTS */
-                    dts_correction += current_dts - last_dts - 1;
-                    current_dts = last_dts + 1;
-                }
-                last_dts = current_dts;
-                distance++;
-                stts_sample++;
-                current_sample++;
-                if (stts_index + 1 < sc->stts_count && stts_sample == sc->stts_data[stts_index].count) {
-                    stts_sample = 0;
-                    stts_index++;
-                }
-            }
+        nb_entries = mov_index_expand(mov, st, &cursor, st->index_entries, sc->sample_count, &stream_size);
+        for (i = 0; i < nb_entries; i++) {
+            st->nb_index_entries++;
+            if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries < 100)
+                em_rfps_add_frame(mov->fc, st, st->index_entries[i].timestamp);
         }
         if (st->duration > 0)
             st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
@@ -3201,15 +3809,17 @@ static int mov_read_trak(MOVContext *c, AVEMIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             st->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_em_freep(&sc->chunk_offsets);
-    av_em_freep(&sc->stsc_data);
-    av_em_freep(&sc->sample_sizes);
-    av_em_freep(&sc->keyframes);
-    av_em_freep(&sc->stts_data);
-    av_em_freep(&sc->stps_data);
+    /* Do not need those anymore, unless a compact index expands them later. */
     av_em_freep(&sc->elst_data);
-    av_em_freep(&sc->rap_group);
+    if (!sc->index_cursors) {
+        av_em_freep(&sc->chunk_offsets);
+        av_em_freep(&sc->stsc_data);
+        av_em_freep(&sc->sample_sizes);
+        av_em_freep(&sc->keyframes);
+        av_em_freep(&sc->stts_data);
+        av_em_freep(&sc->stps_data);
+        av_em_freep(&sc->rap_group);
+    }
 
     return 0;
 }
@@ -3613,6 +4223,8 @@ static int mov_read_trun(MOVContext *c, AVEMIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    if ((err = mov_index_expand_all(c, st)) < 0)
+        return err;
     avio_em_r8(pb); /* version */
     flags = avio_em_rb24(pb);
     entries = avio_em_rb32(pb);
@@ -4477,7 +5089,7 @@ static int mov_read_default(MOVContext *c, AVEMIOContext *pb, MOVAtom atom)
             }
             if (c->found_moov && c->found_mdat &&
                 ((!pb->seekable || c->fc->flags & AVFMT_FLAG_IGNIDX || c->fragment_index_complete) ||
-                 start_pos + a.size == avio_em_size(pb))) {
+                 c->moov_prefetched || start_pos + a.size == avio_em_size(pb))) {
                 if (!pb->seekable || c->fc->flags & AVFMT_FLAG_IGNIDX || c->fragment_index_complete)
                     c->next_root_atom = start_pos + a.size;
                 c->atom_depth --;
@@ -4737,6 +5349,8 @@ static int mov_read_close(AVEMFormatContext *s)
         av_em_freep(&sc->stps_data);
         av_em_freep(&sc->elst_data);
         av_em_freep(&sc->rap_group);
+        av_em_freep(&sc->index_cursors);
+        av_em_freep(&sc->index_keys);
         av_em_freep(&sc->display_matrix);
 
         av_em_freep(&sc->cenc.auxiliary_info);
@@ -4767,6 +5381,7 @@ static int mov_read_close(AVEMFormatContext *s)
     av_em_freep(&mov->fragment_index_data);
 
     av_em_freep(&mov->aes_decrypt);
+    av_em_freep(&mov->head_buf);
 
     return 0;
 }
@@ -4911,6 +5526,93 @@ fail:
     return ret;
 }
 
+#define MOV_SPLIT_PROBES        32
+#define MOV_SPLIT_SHORT_SEEK    (256 << 10)
+
+/*
+ * Tracks whose samples of the same time lie far apart in the file, at
+ * worst one after the other, make a single connection jump back and forth
+ * between them, each jump a reconnect over http. Past split_interleave
+ * bytes every track but the first gets a connection of its own, opened on
+ * its first packet, and packets are taken from the tracks in dts order.
+ */
+static void mov_check_interleave(AVEMFormatContext *s)
+{
+    MOVContext *mov = s->priv_data;
+    int64_t distance = 0;
+    int i, k, nb_tracks = 0;
+
+    if (mov->split_interleave <= 0 || !s->pb->seekable || s->duration <= 0 ||
+        mov->fragment_index_count || mov->dv_demux)
+        return;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        MOVStreamContext *sc = s->streams[i]->priv_data;
+        if (sc->pb == s->pb && mov_index_get(mov, s->streams[i], 0))
+            nb_tracks++;
+    }
+    if (nb_tracks < 2)
+        return;
+
+    for (k = 0; k < MOV_SPLIT_PROBES; k++) {
+        int64_t min_pos = INT64_MAX, max_pos = INT64_MIN;
+        int64_t t = av_em_rescale(s->duration, k, MOV_SPLIT_PROBES);
+
+        for (i = 0; i < s->nb_streams; i++) {
+            AVEMStream *st = s->streams[i];
+            MOVStreamContext *sc = st->priv_data;
+            AVEMIndexEntry *e;
+            int sample;
+
+            if (sc->pb != s->pb)
+                continue;
+            sample = mov_index_search(mov, st, av_em_rescale_q(t, AV_TIME_BASE_Q, st->time_base),
+                                      AVSEEK_FLAG_ANY | AVSEEK_FLAG_BACKWARD);
+            if (!(e = mov_index_get(mov, st, FFMAX(sample, 0))))
+                continue;
+            min_pos = FFMIN(min_pos, e->pos);
+            max_pos = FFMAX(max_pos, e->pos);
+        }
+        if (max_pos > min_pos)
+            distance = FFMAX(distance, max_pos - min_pos);
+    }
+    if (distance <= mov->split_interleave)
+        return;
+
+    av_em_log(s, AV_LOG_INFO, "tracks up to %"PRId64" bytes apart, reading each over its own connection\n", distance);
+    mov->split_tracks = 1;
+    for (i = 0, k = 0; i < s->nb_streams; i++) {
+        MOVStreamContext *sc = s->streams[i]->priv_data;
+        if (sc->pb == s->pb && mov_index_get(mov, s->streams[i], 0) && k++)
+            sc->split_pb = 1;
+    }
+}
+
+static void mov_open_track_pb(AVEMFormatContext *s, MOVStreamContext *sc, int64_t pos)
+{
+    MOVContext *mov = s->priv_data;
+    AVEMDictionary *opts = NULL;
+    AVEMIOContext *pb = NULL;
+    char *url = NULL;
+    int ret;
+
+    sc->split_pb = 0;
+    if ((ret = mov_get_io_source(mov, s->pb, &url, &opts)) >= 0) {
+        av_em_dict_set_int(&opts, "offset", pos, 0);
+        ret = s->io_open(s, &pb, url, AVIO_FLAG_READ, &opts);
+    }
+    av_em_free(url);
+    av_em_dict_free(&opts);
+    if (ret < 0) {
+        av_em_log(s, AV_LOG_WARNING, "stream %d: cannot open its own connection, sharing the main one\n", sc->ffindex);
+        return;
+    }
+    /* step over the other tracks' chunks rather than reconnect */
+    pb->short_seek_threshold = FFMAX(pb->short_seek_threshold, MOV_SPLIT_SHORT_SEEK);
+    sc->pb = pb;
+    sc->pb_is_copied = 0;
+}
+
 static int mov_read_header(AVEMFormatContext *s)
 {
     MOVContext *mov = s->priv_data;
@@ -5069,7 +5771,8 @@ static int mov_read_header(AVEMFormatContext *s)
             break;
         }
     }
-    em_configure_buffers_for_index(s, AV_TIME_BASE);
+    mov_configure_buffers(mov, AV_TIME_BASE);
+    mov_check_interleave(s);
 
     return 0;
 }
@@ -5084,11 +5787,30 @@ static AVEMIndexEntry *mov_find_next_sample(AVEMFormatContext *s, AVEMStream **s
     int64_t best_dts = INT64_MAX;
     int i;
     int64_t pos = avio_em_tell(s->pb);
+
+    if (((MOVContext *)s->priv_data)->split_tracks) {
+        /* each track reads over its own connection, merge them in dts order */
+        for (i = 0; i < s->nb_streams; i++) {
+            AVEMStream *avst = s->streams[i];
+            MOVStreamContext *msc = avst->priv_data;
+            AVEMIndexEntry *current_sample;
+            if (msc->pb && (current_sample = mov_index_get(s->priv_data, avst, msc->current_sample))) {
+                int64_t dts = av_em_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
+                if (!sample || dts < best_dts) {
+                    sample = current_sample;
+                    best_dts = dts;
+                    *st = avst;
+                }
+            }
+        }
+        return sample;
+    }
+
     for (i = 0; i < s->nb_streams; i++) {
         AVEMStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVEMIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        AVEMIndexEntry *current_sample;
+        if (msc->pb && (current_sample = mov_index_get(s->priv_data, avst, msc->current_sample))) {
             int64_t dts = av_em_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_em_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!best_dts_sample || (!s->pb->seekable && current_sample->pos < best_dts_sample->pos) ||
@@ -5204,14 +5926,19 @@ static int mov_read_packet(AVEMFormatContext *s, AVEMPacket *pkt)
     }
 
     if (st->discard != AVDISCARD_ALL) {
-        int64_t ret64 = avio_em_seek(sc->pb, sample->pos, SEEK_SET);
-        if (ret64 != sample->pos) {
-            av_em_log(mov->fc, AV_LOG_ERROR, "stream %d, offset 0x%"PRIx64": partial file\n",
-                   sc->ffindex, sample->pos);
-            sc->current_sample -= should_retry(sc->pb, ret64);
-            return AVERROR_INVALIDDATA;
+        if (sc->split_pb)
+            mov_open_track_pb(s, sc, sample->pos);
+        ret = mov_get_head_packet(mov, sc, pkt, sample);
+        if (!ret) {
+            int64_t ret64 = avio_em_seek(sc->pb, sample->pos, SEEK_SET);
+            if (ret64 != sample->pos) {
+                av_em_log(mov->fc, AV_LOG_ERROR, "stream %d, offset 0x%"PRIx64": partial file\n",
+                       sc->ffindex, sample->pos);
+                sc->current_sample -= should_retry(sc->pb, ret64);
+                return AVERROR_INVALIDDATA;
+            }
+            ret = av_em_get_packet(sc->pb, pkt, sample->size);
         }
-        ret = av_em_get_packet(sc->pb, pkt, sample->size);
         if (ret < 0) {
             sc->current_sample -= should_retry(sc->pb, ret);
             return ret;
@@ -5253,8 +5980,7 @@ static int mov_read_packet(AVEMFormatContext *s, AVEMPacket *pkt)
         if (sc->wrong_dts)
             pkt->dts = AV_NOPTS_VALUE;
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = mov_index_get_dts(st, sc->current_sample);
         pkt->duration = next_dts - pkt->dts;
         pkt->pts = pkt->dts;
     }
@@ -5304,6 +6030,7 @@ static int mov_seek_fragment(AVEMFormatContext *s, AVEMStream *st, int64_t times
 static int mov_seek_stream(AVEMFormatContext *s, AVEMStream *st, int64_t timestamp, int flags)
 {
     MOVStreamContext *sc = st->priv_data;
+    AVEMIndexEntry *first;
     int sample, time_sample;
     int i;
 
@@ -5311,9 +6038,9 @@ static int mov_seek_stream(AVEMFormatContext *s, AVEMStream *st, int64_t timesta
     if (ret < 0)
         return ret;
 
-    sample = av_em_index_search_timestamp(st, timestamp, flags);
+    sample = mov_index_search(s->priv_data, st, timestamp, flags);
     av_em_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+    if (sample < 0 && (first = mov_index_get(s->priv_data, st, 0)) && timestamp < first->timestamp)
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -5358,7 +6085,12 @@ static int mov_read_seek(AVEMFormatContext *s, int stream_index, int64_t sample_
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = st->index_entries[sample].timestamp;
+        AVEMIndexEntry *e = mov_index_get(mc, st, sample);
+        int64_t seek_timestamp;
+
+        if (!e)
+            return AVERROR_INVALIDDATA;
+        seek_timestamp = e->timestamp;
 
         for (i = 0; i < s->nb_streams; i++) {
             int64_t timestamp;
@@ -5432,6 +6164,14 @@ static const AVOption mov_options[] = {
     { "decryption_key", "The media decryption key (hex)", OFFSET(decryption_key), AV_OPT_TYPE_BINARY, .flags = AV_OPT_FLAG_DECODING_PARAM },
     { "enable_drefs", "Enable external track support.", OFFSET(enable_drefs), AV_OPT_TYPE_BOOL,
         {.i64 = 0}, 0, 1, FLAGS },
+    { "compact_index", "Keep the sample tables and expand them on demand rather than indexing every sample at open", OFFSET(compact_index), AV_OPT_TYPE_BOOL,
+        {.i64 = 0}, 0, 1, FLAGS },
+    { "split_interleave", "Read each track over its own connection when tracks lie further apart than this in the file, 0 to never", OFFSET(split_interleave), AV_OPT_TYPE_INT,
+        {.i64 = 0}, 0, INT_MAX, FLAGS },
+    { "moov_prefetch", "Fetch a moov after mdat over a second connection while reading mdat", OFFSET(moov_prefetch), AV_OPT_TYPE_BOOL,
+        {.i64 = 0}, 0, 1, FLAGS },
+    { "moov_cache", "Keep prefetched moov atoms per url for the next open", OFFSET(moov_cache), AV_OPT_TYPE_BOOL,
+        {.i64 = 0}, 0, 1, FLAGS },
 
     { NULL },
 };
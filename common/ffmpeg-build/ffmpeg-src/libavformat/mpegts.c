@@ -44,6 +44,9 @@
 
 #define MAX_PES_PAYLOAD 200 * 1024
 
+/* PES buffers come from pools of power of two sizes up to MAX_PES_PAYLOAD */
+#define PES_POOLS 18
+
 #define MAX_MP4_DESCR_COUNT 16
 
 #define MOD_UNLIKELY(modulus, dividend, divisor, prev_dividend)                \
@@ -159,6 +162,8 @@ struct MpegTSContext {
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
+
+    AVBufferPool *pools[PES_POOLS];
 };
 
 #define MPEGTS_OPTIONS \
@@ -240,6 +245,7 @@ typedef struct PESContext {
     int64_t ts_packet_pos; /**< position of first TS packet of this PES packet */
     uint8_t header[MAX_PES_HEADER_SIZE];
     AVEMBufferRef *buffer;
+    int size_hint; /**< running average payload size of unbounded PES packets */
     SLConfigDescr sl;
 } PESContext;
 
@@ -863,6 +869,42 @@ static int mpegts_set_stream_info(AVEMStream *st, PESContext *pes,
     return 0;
 }
 
+static AVEMBufferRef *pes_buffer_get(MpegTSContext *ts, int size)
+{
+    int index = av_log2(FFMIN(size, MAX_PES_PAYLOAD) + AV_INPUT_BUFFER_PADDING_SIZE);
+
+    if (!ts->pools[index]) {
+        int pool_size = FFMIN(MAX_PES_PAYLOAD + AV_INPUT_BUFFER_PADDING_SIZE, 2 << index);
+        ts->pools[index] = av_em_buffer_pool_init(pool_size, av_em_buffer_alloc);
+        if (!ts->pools[index])
+            return NULL;
+    }
+    return av_em_buffer_pool_get(ts->pools[index]);
+}
+
+/* a PES of unknown size starts a little over the average size and grows as needed */
+static AVEMBufferRef *pes_buffer_alloc(PESContext *pes)
+{
+    if (pes->total_size != MAX_PES_PAYLOAD)
+        return pes_buffer_get(pes->ts, pes->total_size);
+    return pes_buffer_get(pes->ts, FFMAX(pes->size_hint + pes->size_hint / 2, TS_PACKET_SIZE));
+}
+
+static int pes_buffer_grow(PESContext *pes, int size)
+{
+    AVEMBufferRef *buffer;
+
+    if (size <= pes->buffer->size - AV_INPUT_BUFFER_PADDING_SIZE)
+        return 0;
+    buffer = pes_buffer_get(pes->ts, FFMIN(2 * size, pes->total_size));
+    if (!buffer)
+        return AVERROR(ENOMEM);
+    memcpy(buffer->data, pes->buffer->data, pes->data_index);
+    av_em_buffer_unref(&pes->buffer);
+    pes->buffer = buffer;
+    return 0;
+}
+
 static void reset_pes_packet_state(PESContext *pes)
 {
     pes->pts        = AV_NOPTS_VALUE;
@@ -901,6 +943,8 @@ static int new_pes_packet(PESContext *pes, AVEMPacket *pkt)
     pkt->pos   = pes->ts_packet_pos;
     pkt->flags = pes->flags;
 
+    if (pes->total_size == MAX_PES_PAYLOAD)
+        pes->size_hint = pes->size_hint ? (pes->size_hint * 7 + pes->data_index) / 8 : pes->data_index;
     pes->buffer = NULL;
     reset_pes_packet_state(pes);
 
@@ -1062,8 +1106,7 @@ static int mpegts_push_data(MpegTSFilter *filter,
                         pes->total_size = MAX_PES_PAYLOAD;
 
                     /* allocate pes buffer */
-                    pes->buffer = av_em_buffer_alloc(pes->total_size +
-                                                  AV_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = pes_buffer_alloc(pes);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
 
@@ -1223,8 +1266,7 @@ skip:
                     if (ret < 0)
                         return ret;
                     pes->total_size = MAX_PES_PAYLOAD;
-                    pes->buffer = av_em_buffer_alloc(pes->total_size +
-                                                  AV_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = pes_buffer_alloc(pes);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
                     ts->stop_parse = 1;
@@ -1234,6 +1276,8 @@ skip:
                     // not sure if this is legal in ts but see issue #2392
                     buf_size = pes->total_size;
                 }
+                if ((ret = pes_buffer_grow(pes, pes->data_index + buf_size)) < 0)
+                    return ret;
                 memcpy(pes->buffer->data + pes->data_index, p, buf_size);
                 pes->data_index += buf_size;
                 /* emit complete packets with known packet size
@@ -2747,6 +2791,9 @@ static void mpegts_free(MpegTSContext *ts)
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
             mpegts_close_filter(ts, ts->pids[i]);
+
+    for (i = 0; i < PES_POOLS; i++)
+        av_em_buffer_pool_uninit(&ts->pools[i]);
 }
 
 static int mpegts_read_close(AVEMFormatContext *s)
@@ -50,6 +50,27 @@ void em_tls_deinit(void)
 #endif
 }
 
+static AVIOTLSStat tls_stat;
+
+void em_tls_stat_update(int64_t handshake_us, int resumed)
+{
+    avpriv_em_lock_avformat();
+    tls_stat.handshakes++;
+    tls_stat.handshake_us += handshake_us;
+    if (resumed)
+        tls_stat.resumed++;
+    avpriv_em_unlock_avformat();
+}
+
+void avio_em_tls_get_stat(AVIOTLSStat *stat)
+{
+    if (!stat)
+        return;
+    avpriv_em_lock_avformat();
+    *stat = tls_stat;
+    avpriv_em_unlock_avformat();
+}
+
 int em_network_inited_globally;
 
 int em_network_init(void)
@@ -80,6 +80,8 @@ void em_network_close(void);
 
 int em_tls_init(void);
 void em_tls_deinit(void);
+/* account one completed client handshake in avio_em_tls_get_stat() */
+void em_tls_stat_update(int64_t handshake_us, int resumed);
 
 int em_network_wait_fd(int fd, int write);
 
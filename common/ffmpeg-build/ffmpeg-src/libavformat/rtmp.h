@@ -23,6 +23,7 @@
 #define AVFORMAT_RTMP_H
 
 #include "avformat.h"
+#include "rtmppkt.h"
 
 #define RTMP_DEFAULT_PORT 1935
 #define RTMPS_DEFAULT_PORT 443
@@ -65,4 +66,21 @@ int ff_rtmp_calc_digest(const uint8_t *src, int len, int gap,
 int ff_rtmp_calc_digest_pos(const uint8_t *buf, int off, int mod_val,
                             int add_val);
 
+/**
+ * Read the next audio, video or data message of a stream opened for
+ * playback with the rtmp_direct option. Control messages are handled
+ * internally as for an FLV byte stream read.
+ *
+ * @param h   RTMP protocol context
+ * @param pkt filled with the message, its payload is owned by pkt->buf;
+ *            release it with ff_em_rtmp_packet_destroy()
+ * @return 0 on success, negative AVERROR code otherwise
+ */
+int ff_em_rtmp_read_message(EMURLContext *h, RTMPPacket *pkt);
+
+/**
+ * @return stream duration in seconds as reported by the server, 0 if unknown
+ */
+double ff_em_rtmp_get_duration(EMURLContext *h);
+
 #endif /* AVFORMAT_RTMP_H */
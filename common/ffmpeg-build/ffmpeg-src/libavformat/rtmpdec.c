@@ -0,0 +1,592 @@
+/*
+ * live RTMP demuxer
+ *
+ * Reads audio, video and data messages straight from the RTMP protocol
+ * instead of parsing the FLV byte stream rtmpproto rebuilds from them.
+ * Message payloads live in pooled, refcounted buffers. A payload which
+ * fills at least half of its buffer is handed out as packet data without
+ * a copy, smaller ones are copied so that queued packets do not keep
+ * whole pool buffers alive.
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/dict.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/opt.h"
+#include "libavcodec/bytestream.h"
+#include "libavcodec/mpeg4audio.h"
+#include "avformat.h"
+#include "internal.h"
+#include "flv.h"
+#include "rtmp.h"
+#include "rtmppkt.h"
+#include "url.h"
+
+typedef struct RTMPDemuxContext {
+    const AVEMClass *class;
+    EMURLContext *rtmp;
+
+    /* forwarded to the protocol */
+    int64_t rw_timeout;
+    int use_ijktcphook;
+    char *app_ctx_intptr;
+    int client_buffer_time;
+    int live;
+
+    /* aggregate message being split into its FLV tags */
+    RTMPPacket agg;
+    int agg_off;
+    uint32_t agg_ts_base;
+
+    int received_metadata;
+    int meta_has_audio;
+    int meta_has_video;
+    int meta_width;
+    int meta_height;
+    double meta_framerate;
+
+    uint8_t *new_extradata[FLV_STREAM_TYPE_NB];
+    int new_extradata_size[FLV_STREAM_TYPE_NB];
+    int last_sample_rate;
+    int last_channels;
+    int wrong_dts;
+} RTMPDemuxContext;
+
+static void update_header_flag(AVEMFormatContext *s)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+    int i, has_audio = 0, has_video = 0;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
+            has_audio = 1;
+        else if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+            has_video = 1;
+    }
+
+    /* same rule as flvdec, unless onMetaData told which streams to expect */
+    if ((has_audio && has_video) ||
+        (rt->received_metadata && (has_audio || has_video) &&
+         (has_audio || !rt->meta_has_audio) &&
+         (has_video || !rt->meta_has_video)))
+        s->ctx_flags &= ~AVFMTCTX_NOHEADER;
+}
+
+static AVEMStream *create_stream(AVEMFormatContext *s, int codec_type)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+    AVEMStream *st = avformat_em_new_stream(s, NULL);
+    if (!st)
+        return NULL;
+    st->codecpar->codec_type = codec_type;
+    if (codec_type == AVMEDIA_TYPE_VIDEO) {
+        st->codecpar->width  = rt->meta_width;
+        st->codecpar->height = rt->meta_height;
+        if (rt->meta_framerate > 0 && rt->meta_framerate < 1000)
+            st->avg_frame_rate = av_em_d2q(rt->meta_framerate, 1001000);
+    }
+
+    avpriv_em_set_pts_info(st, 32, 1, 1000); /* 32 bit pts in ms */
+    update_header_flag(s);
+    return st;
+}
+
+static void parse_metadata_number(AVEMFormatContext *s, const char *key, double num_val)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+    char str_val[32];
+    int i;
+
+    if (!strcmp(key, "duration")) {
+        if (num_val > 0)
+            s->duration = num_val * AV_TIME_BASE;
+    } else if (!strcmp(key, "width")) {
+        rt->meta_width = num_val;
+    } else if (!strcmp(key, "height")) {
+        rt->meta_height = num_val;
+    } else if (!strcmp(key, "framerate")) {
+        rt->meta_framerate = num_val;
+    } else if (!strcmp(key, "videocodecid")) {
+        rt->meta_has_video = 1;
+    } else if (!strcmp(key, "audiocodecid")) {
+        rt->meta_has_audio = 1;
+    }
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVEMStream *st = s->streams[i];
+        if (st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
+            continue;
+        if (!strcmp(key, "width") && !st->codecpar->width)
+            st->codecpar->width = num_val;
+        else if (!strcmp(key, "height") && !st->codecpar->height)
+            st->codecpar->height = num_val;
+        else if (!strcmp(key, "framerate") && num_val > 0 && num_val < 1000 &&
+                 !st->avg_frame_rate.num)
+            st->avg_frame_rate = av_em_d2q(num_val, 1001000);
+    }
+
+    snprintf(str_val, sizeof(str_val), "%.f", num_val);
+    av_em_dict_set(&s->metadata, key, str_val, 0);
+}
+
+static int parse_notify(AVEMFormatContext *s, const uint8_t *data, int size)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+    GetByteContext gbc;
+    char name[64], key[256], str_val[256];
+    double num_val;
+    int len, type;
+
+    bytestream2_init(&gbc, data, size);
+    if (ff_amf_read_string(&gbc, name, sizeof(name), &len))
+        return 0;
+    if (!strcmp(name, "@setDataFrame") &&
+        ff_amf_read_string(&gbc, name, sizeof(name), &len))
+        return 0;
+    if (strcmp(name, "onMetaData"))
+        return 0;
+
+    type = bytestream2_get_byte(&gbc);
+    if (type == AMF_DATA_TYPE_MIXEDARRAY)
+        bytestream2_skip(&gbc, 4); // max array index
+    else if (type != AMF_DATA_TYPE_OBJECT)
+        return 0;
+
+    rt->received_metadata = 1;
+    while (bytestream2_get_bytes_left(&gbc) > 3) {
+        if (ff_amf_get_string(&gbc, key, sizeof(key), &len) < 0 || !len)
+            break;
+
+        type = bytestream2_peek_byte(&gbc);
+        if (type == AMF_DATA_TYPE_NUMBER) {
+            if (ff_amf_read_number(&gbc, &num_val) < 0)
+                break;
+            parse_metadata_number(s, key, num_val);
+        } else if (type == AMF_DATA_TYPE_STRING &&
+                   bytestream2_get_bytes_left(&gbc) >= 3 &&
+                   AV_RB16(gbc.buffer + 1) < sizeof(str_val)) {
+            if (ff_amf_read_string(&gbc, str_val, sizeof(str_val), &len) < 0)
+                break;
+            av_em_dict_set(&s->metadata, key, str_val, 0);
+        } else {
+            len = ff_amf_tag_size(gbc.buffer, gbc.buffer_end);
+            if (len < 0)
+                break;
+            bytestream2_skip(&gbc, len);
+        }
+    }
+
+    update_header_flag(s);
+    return 0;
+}
+
+static AVEMStream *find_stream(AVEMFormatContext *s, int stream_type, int flags)
+{
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVEMStream *st = s->streams[i];
+        if (stream_type == FLV_STREAM_TYPE_AUDIO) {
+            if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+                (s->audio_codec_id || ff_flv_same_audio_codec(st->codecpar, flags)))
+                return st;
+        } else {
+            if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+                (s->video_codec_id || ff_flv_same_video_codec(st->codecpar, flags)))
+                return st;
+        }
+    }
+
+    return create_stream(s, stream_type == FLV_STREAM_TYPE_AUDIO ?
+                            AVMEDIA_TYPE_AUDIO : AVMEDIA_TYPE_VIDEO);
+}
+
+static int set_extradata(RTMPDemuxContext *rt, AVEMStream *st, int stream_type,
+                         const uint8_t *data, int size)
+{
+    uint8_t **dst;
+    int *dst_size;
+
+    if (st->codecpar->extradata) {
+        /* sent on with the next packet, as flvdec does */
+        dst      = &rt->new_extradata[stream_type];
+        dst_size = &rt->new_extradata_size[stream_type];
+    } else {
+        dst      = &st->codecpar->extradata;
+        dst_size = &st->codecpar->extradata_size;
+    }
+
+    av_em_freep(dst);
+    *dst_size = 0;
+    *dst = av_em_mallocz(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!*dst)
+        return AVERROR(ENOMEM);
+    memcpy(*dst, data, size);
+    *dst_size = size;
+
+    /* the tag header always claims 44.1kHz stereo for aac */
+    if (dst == &st->codecpar->extradata && st->codecpar->codec_id == AV_CODEC_ID_AAC) {
+        MPEG4AudioConfig cfg;
+
+        if (avpriv_mpeg4audio_get_config(&cfg, data, size * 8, 1) >= 0) {
+            if (cfg.channels > 0 && cfg.channels != st->codecpar->channels) {
+                st->codecpar->channels       = cfg.channels;
+                st->codecpar->channel_layout = 0;
+            }
+            st->codecpar->sample_rate = cfg.ext_sample_rate ? cfg.ext_sample_rate : cfg.sample_rate;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Turn the body of one FLV audio or video tag into a packet.
+ *
+ * @param buf  reference backing data, taken over by pkt when the tag
+ *             ends the buffer and fills at least half of it
+ * @return 0 if pkt was filled, FFERROR_REDO if the tag was consumed
+ */
+static int tag_packet(AVEMFormatContext *s, AVEMPacket *pkt, int type, int64_t dts,
+                      AVEMBufferRef *buf, const uint8_t *data, int size,
+                      const uint8_t *data_end)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+    AVEMStream *st;
+    int stream_type, flags, ret;
+    int64_t pts = AV_NOPTS_VALUE;
+    int av_uninit(channels);
+    int av_uninit(sample_rate);
+
+    if (size < 1)
+        return FFERROR_REDO;
+
+    stream_type = type == RTMP_PT_AUDIO ? FLV_STREAM_TYPE_AUDIO : FLV_STREAM_TYPE_VIDEO;
+    flags = *data++;
+    size--;
+    if (stream_type == FLV_STREAM_TYPE_VIDEO &&
+        (flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_VIDEO_INFO_CMD)
+        return FFERROR_REDO;
+    if (!size)
+        return FFERROR_REDO;
+
+    st = find_stream(s, stream_type, flags);
+    if (!st)
+        return AVERROR(ENOMEM);
+
+    if (  (st->discard >= AVDISCARD_NONKEY && !((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY || (stream_type == FLV_STREAM_TYPE_AUDIO)))
+        ||(st->discard >= AVDISCARD_BIDIR  &&  ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_DISP_INTER && (stream_type == FLV_STREAM_TYPE_VIDEO)))
+        || st->discard >= AVDISCARD_ALL)
+        return FFERROR_REDO;
+
+    if (stream_type == FLV_STREAM_TYPE_AUDIO) {
+        int bits_per_coded_sample;
+        channels = (flags & FLV_AUDIO_CHANNEL_MASK) == FLV_STEREO ? 2 : 1;
+        sample_rate = 44100 << ((flags & FLV_AUDIO_SAMPLERATE_MASK) >>
+                                FLV_AUDIO_SAMPLERATE_OFFSET) >> 3;
+        bits_per_coded_sample = (flags & FLV_AUDIO_SAMPLESIZE_MASK) ? 16 : 8;
+        if (!st->codecpar->channels || !st->codecpar->sample_rate ||
+            !st->codecpar->bits_per_coded_sample) {
+            st->codecpar->channels              = channels;
+            st->codecpar->channel_layout        = channels == 1
+                                               ? AV_CH_LAYOUT_MONO
+                                               : AV_CH_LAYOUT_STEREO;
+            st->codecpar->sample_rate           = sample_rate;
+            st->codecpar->bits_per_coded_sample = bits_per_coded_sample;
+        }
+        if (!st->codecpar->codec_id) {
+            ff_flv_set_audio_codec(s, st, st->codecpar,
+                                   flags & FLV_AUDIO_CODECID_MASK);
+            rt->last_sample_rate =
+            sample_rate          = st->codecpar->sample_rate;
+            rt->last_channels    =
+            channels             = st->codecpar->channels;
+        } else {
+            AVEMCodecParameters *par = avcodec_em_parameters_alloc();
+            if (!par)
+                return AVERROR(ENOMEM);
+            par->sample_rate = sample_rate;
+            par->bits_per_coded_sample = bits_per_coded_sample;
+            ff_flv_set_audio_codec(s, st, par, flags & FLV_AUDIO_CODECID_MASK);
+            sample_rate = par->sample_rate;
+            avcodec_em_parameters_free(&par);
+        }
+    } else if (ff_flv_set_video_codec(s, st, flags & FLV_VIDEO_CODECID_MASK, 0) == 1) {
+        /* VP6 carries its crop byte in front of every frame */
+        if (st->codecpar->extradata_size != 1)
+            em_alloc_extradata(st->codecpar, 1);
+        if (st->codecpar->extradata)
+            st->codecpar->extradata[0] = *data;
+        data++;
+        size--;
+    }
+
+    if (st->codecpar->codec_id == AV_CODEC_ID_AAC ||
+        st->codecpar->codec_id == AV_CODEC_ID_H264 ||
+        st->codecpar->codec_id == AV_CODEC_ID_HEVC ||
+        st->codecpar->codec_id == AV_CODEC_ID_MPEG4) {
+        int packet_type;
+
+        if (size < 1)
+            return FFERROR_REDO;
+        packet_type = *data++;
+        size--;
+        if (st->codecpar->codec_id != AV_CODEC_ID_AAC) {
+            int32_t cts;
+            if (size < 3)
+                return FFERROR_REDO;
+            // sign extension
+            cts = (AV_RB24(data) + 0xff800000) ^ 0xff800000;
+            data += 3;
+            size -= 3;
+            pts = dts + cts;
+            if (cts < 0) { // dts might be wrong
+                if (!rt->wrong_dts)
+                    av_em_log(s, AV_LOG_WARNING,
+                        "Negative cts, previous timestamps might be wrong.\n");
+                rt->wrong_dts = 1;
+            } else if (FFABS(dts - pts) > 1000*60*15) {
+                av_em_log(s, AV_LOG_WARNING,
+                       "invalid timestamps %"PRId64" %"PRId64"\n", dts, pts);
+                dts = pts = AV_NOPTS_VALUE;
+            }
+        }
+        if (packet_type == 0 && (!st->codecpar->extradata || st->codecpar->codec_id == AV_CODEC_ID_AAC ||
+            st->codecpar->codec_id == AV_CODEC_ID_H264 || st->codecpar->codec_id == AV_CODEC_ID_HEVC)) {
+            if ((ret = set_extradata(rt, st, stream_type, data, size)) < 0)
+                return ret;
+            return FFERROR_REDO;
+        }
+    }
+
+    /* skip empty data packets */
+    if (size <= 0)
+        return FFERROR_REDO;
+
+    if (data + size == data_end && size >= buf->size / 2) {
+        /* the message buffer is padded, hand it out as it is */
+        pkt->buf = av_em_buffer_ref(buf);
+        if (!pkt->buf)
+            return AVERROR(ENOMEM);
+        pkt->data = (uint8_t *)data;
+        pkt->size = size;
+    } else {
+        if ((ret = av_em_new_packet(pkt, size)) < 0)
+            return ret;
+        memcpy(pkt->data, data, size);
+    }
+    pkt->dts          = dts;
+    pkt->pts          = pts == AV_NOPTS_VALUE ? dts : pts;
+    pkt->stream_index = st->index;
+
+    if (rt->new_extradata[stream_type]) {
+        uint8_t *side = av_em_packet_new_side_data(pkt, AV_PKT_DATA_NEW_EXTRADATA,
+                                                   rt->new_extradata_size[stream_type]);
+        if (side) {
+            memcpy(side, rt->new_extradata[stream_type],
+                   rt->new_extradata_size[stream_type]);
+            av_em_freep(&rt->new_extradata[stream_type]);
+            rt->new_extradata_size[stream_type] = 0;
+        }
+    }
+    if (stream_type == FLV_STREAM_TYPE_AUDIO &&
+                    (sample_rate != rt->last_sample_rate ||
+                     channels    != rt->last_channels)) {
+        rt->last_sample_rate = sample_rate;
+        rt->last_channels    = channels;
+        em_add_param_change(pkt, channels, 0, sample_rate, 0, 0);
+    }
+
+    if (stream_type == FLV_STREAM_TYPE_AUDIO ||
+        (flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY)
+        pkt->flags |= AV_PKT_FLAG_KEY;
+
+    return 0;
+}
+
+/* next FLV tag of an aggregate message, the message is released at its end */
+static int aggregate_packet(AVEMFormatContext *s, AVEMPacket *pkt)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+    const uint8_t *p   = rt->agg.data + rt->agg_off;
+    const uint8_t *end = rt->agg.data + rt->agg.size;
+    int type, size, ret;
+    uint32_t ts;
+
+    /* tag header, body and previous tag size */
+    if (end - p < 11 + 4) {
+        ff_em_rtmp_packet_destroy(&rt->agg);
+        return FFERROR_REDO;
+    }
+    type = p[0];
+    size = AV_RB24(p + 1);
+    ts   = AV_RB24(p + 4) | (uint32_t)p[7] << 24;
+    if (size > end - p - 11 - 4) {
+        av_em_log(s, AV_LOG_WARNING, "Incomplete flv packets in RTMP_PT_METADATA packet\n");
+        ff_em_rtmp_packet_destroy(&rt->agg);
+        return FFERROR_REDO;
+    }
+    if (!rt->agg_off)
+        rt->agg_ts_base = ts;
+    rt->agg_off += 11 + size + 4;
+
+    ts = rt->agg.timestamp + ts - rt->agg_ts_base;
+    if (type == RTMP_PT_AUDIO || type == RTMP_PT_VIDEO)
+        ret = tag_packet(s, pkt, type, ts, rt->agg.buf, p + 11, size, end);
+    else if (type == RTMP_PT_NOTIFY)
+        ret = parse_notify(s, p + 11, size) < 0 ? AVERROR_INVALIDDATA : FFERROR_REDO;
+    else
+        ret = FFERROR_REDO;
+
+    if (rt->agg_off >= rt->agg.size)
+        ff_em_rtmp_packet_destroy(&rt->agg);
+    return ret;
+}
+
+static int rtmp_read_packet(AVEMFormatContext *s, AVEMPacket *pkt)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+    RTMPPacket msg;
+    int ret;
+
+    if (rt->agg.data)
+        return aggregate_packet(s, pkt);
+
+    if ((ret = ff_em_rtmp_read_message(rt->rtmp, &msg)) < 0)
+        return ret;
+
+    switch (msg.type) {
+    case RTMP_PT_AUDIO:
+    case RTMP_PT_VIDEO:
+        ret = tag_packet(s, pkt, msg.type, msg.timestamp, msg.buf,
+                         msg.data, msg.size, msg.data + msg.size);
+        break;
+    case RTMP_PT_NOTIFY:
+        ret = parse_notify(s, msg.data, msg.size);
+        ret = ret < 0 ? ret : FFERROR_REDO;
+        break;
+    case RTMP_PT_METADATA:
+        rt->agg     = msg;
+        rt->agg_off = 0;
+        return FFERROR_REDO;
+    default:
+        ret = FFERROR_REDO;
+        break;
+    }
+
+    ff_em_rtmp_packet_destroy(&msg);
+    return ret;
+}
+
+static int rtmp_read_header(AVEMFormatContext *s)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+    AVEMDictionary *opts = NULL;
+    double duration;
+    int ret;
+
+    av_em_dict_set(&opts, "rtmp_direct", "1", 0);
+    av_em_dict_set_int(&opts, "rtmp_buffer", rt->client_buffer_time, 0);
+    av_em_dict_set_int(&opts, "rtmp_live", rt->live, 0);
+    av_em_dict_set_int(&opts, "use_ijktcphook", rt->use_ijktcphook, 0);
+    if (rt->rw_timeout > 0)
+        av_em_dict_set_int(&opts, "rw_timeout", rt->rw_timeout, 0);
+    if (rt->app_ctx_intptr)
+        av_em_dict_set(&opts, "ijkapplication", rt->app_ctx_intptr, 0);
+
+    ret = ffurl_em_open_whitelist(&rt->rtmp, s->filename, AVIO_FLAG_READ,
+                                  &s->interrupt_callback, &opts,
+                                  s->protocol_whitelist, s->protocol_blacklist, NULL);
+    av_em_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    s->ctx_flags |= AVFMTCTX_NOHEADER;
+    s->start_time = 0;
+
+    duration = ff_em_rtmp_get_duration(rt->rtmp);
+    if (duration > 0)
+        s->duration = duration * AV_TIME_BASE;
+
+    return 0;
+}
+
+static int rtmp_read_close(AVEMFormatContext *s)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+    int i;
+
+    for (i = 0; i < FLV_STREAM_TYPE_NB; i++)
+        av_em_freep(&rt->new_extradata[i]);
+    ff_em_rtmp_packet_destroy(&rt->agg);
+    ffurl_em_closep(&rt->rtmp);
+    return 0;
+}
+
+static int rtmp_read_play(AVEMFormatContext *s)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+
+    if (!rt->rtmp->prot->url_read_pause)
+        return AVERROR(ENOSYS);
+    return rt->rtmp->prot->url_read_pause(rt->rtmp, 0);
+}
+
+static int rtmp_read_pause(AVEMFormatContext *s)
+{
+    RTMPDemuxContext *rt = s->priv_data;
+
+    if (!rt->rtmp->prot->url_read_pause)
+        return AVERROR(ENOSYS);
+    return rt->rtmp->prot->url_read_pause(rt->rtmp, 1);
+}
+
+#define OFFSET(x) offsetof(RTMPDemuxContext, x)
+#define DEC AV_OPT_FLAG_DECODING_PARAM
+static const AVOption options[] = {
+    { "rw_timeout", "Timeout for IO operations (in microseconds)", OFFSET(rw_timeout), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, DEC },
+    { "use_ijktcphook", "use ijk tcp hook read rtmp packets", OFFSET(use_ijktcphook), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, DEC },
+    { "ijkapplication", "AVApplicationContext", OFFSET(app_ctx_intptr), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, DEC },
+    { "rtmp_buffer", "Set buffer time in milliseconds. The default is 3000.", OFFSET(client_buffer_time), AV_OPT_TYPE_INT, { .i64 = 3000 }, 0, INT_MAX, DEC },
+    { "rtmp_live", "Specify that the media is a live stream.", OFFSET(live), AV_OPT_TYPE_INT, { .i64 = -2 }, INT_MIN, INT_MAX, DEC, "rtmp_live" },
+    { "any", "both", 0, AV_OPT_TYPE_CONST, { .i64 = -2 }, 0, 0, DEC, "rtmp_live" },
+    { "live", "live stream", 0, AV_OPT_TYPE_CONST, { .i64 = -1 }, 0, 0, DEC, "rtmp_live" },
+    { "recorded", "recorded stream", 0, AV_OPT_TYPE_CONST, { .i64 = 0 }, 0, 0, DEC, "rtmp_live" },
+    { NULL }
+};
+
+static const AVEMClass live_rtmp_class = {
+    .class_name = "live_rtmpdec",
+    .item_name  = av_em_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+AVEMInputFormat em_live_rtmp_demuxer = {
+    .name           = "live_rtmp",
+    .long_name      = NULL_IF_CONFIG_SMALL("live RTMP, without the FLV round trip"),
+    .priv_data_size = sizeof(RTMPDemuxContext),
+    .read_header    = rtmp_read_header,
+    .read_packet    = rtmp_read_packet,
+    .read_close     = rtmp_read_close,
+    .read_play      = rtmp_read_play,
+    .read_pause     = rtmp_read_pause,
+    .priv_class     = &live_rtmp_class,
+    .flags          = AVFMT_NOFILE | AVFMT_TS_DISCONT,
+};
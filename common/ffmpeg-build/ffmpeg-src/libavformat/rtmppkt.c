@@ -156,6 +156,10 @@ int ff_rtmp_check_alloc_array(RTMPPacket **prev_pkt, int *nb_prev_pkt,
     return 0;
 }
 
+static int rtmp_packet_read_internal(EMURLContext *h, RTMPPacket *p, int chunk_size,
+                                     RTMPPacket **prev_pkt, int *nb_prev_pkt,
+                                     uint8_t hdr, RTMPPacketPool *pool);
+
 int ff_rtmp_packet_read(EMURLContext *h, RTMPPacket *p,
                         int chunk_size, RTMPPacket **prev_pkt, int *nb_prev_pkt)
 {
@@ -164,13 +168,71 @@ int ff_rtmp_packet_read(EMURLContext *h, RTMPPacket *p,
     if (ffurl_em_read(h, &hdr, 1) != 1)
         return AVERROR(EIO);
 
-    return ff_rtmp_packet_read_internal(h, p, chunk_size, prev_pkt,
-                                        nb_prev_pkt, hdr);
+    return rtmp_packet_read_internal(h, p, chunk_size, prev_pkt,
+                                     nb_prev_pkt, hdr, NULL);
+}
+
+int ff_rtmp_packet_read_pooled(EMURLContext *h, RTMPPacket *p,
+                               int chunk_size, RTMPPacket **prev_pkt,
+                               int *nb_prev_pkt, RTMPPacketPool *pool)
+{
+    uint8_t hdr;
+
+    if (ffurl_em_read(h, &hdr, 1) != 1)
+        return AVERROR(EIO);
+
+    return rtmp_packet_read_internal(h, p, chunk_size, prev_pkt,
+                                     nb_prev_pkt, hdr, pool);
+}
+
+int ff_rtmp_packet_pool_init(RTMPPacketPool *pool)
+{
+    pool->small = av_em_buffer_pool_init(RTMP_POOL_SMALL_SIZE + AV_INPUT_BUFFER_PADDING_SIZE,
+                                         av_em_buffer_alloc);
+    pool->large = av_em_buffer_pool_init(RTMP_POOL_LARGE_SIZE + AV_INPUT_BUFFER_PADDING_SIZE,
+                                         av_em_buffer_alloc);
+    if (!pool->small || !pool->large) {
+        ff_rtmp_packet_pool_uninit(pool);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+void ff_rtmp_packet_pool_uninit(RTMPPacketPool *pool)
+{
+    av_em_buffer_pool_uninit(&pool->small);
+    av_em_buffer_pool_uninit(&pool->large);
+}
+
+static int rtmp_packet_create_pooled(RTMPPacket *pkt, RTMPPacketPool *pool,
+                                     int channel_id, RTMPPacketType type,
+                                     int timestamp, int size)
+{
+    if (size <= RTMP_POOL_SMALL_SIZE)
+        pkt->buf = av_em_buffer_pool_get(pool->small);
+    else if (size <= RTMP_POOL_LARGE_SIZE)
+        pkt->buf = av_em_buffer_pool_get(pool->large);
+    else
+        pkt->buf = av_em_buffer_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!pkt->buf)
+        return AVERROR(ENOMEM);
+    pkt->data = pkt->buf->data;
+    memset(pkt->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    pkt->size       = size;
+    pkt->channel_id = channel_id;
+    pkt->type       = type;
+    pkt->timestamp  = timestamp;
+    pkt->extra      = 0;
+    pkt->ts_field   = 0;
+
+    return 0;
 }
 
 static int rtmp_packet_read_one_chunk(EMURLContext *h, RTMPPacket *p,
                                       int chunk_size, RTMPPacket **prev_pkt_ptr,
-                                      int *nb_prev_pkt, uint8_t hdr)
+                                      int *nb_prev_pkt, uint8_t hdr,
+                                      RTMPPacketPool *pool)
 {
 
     uint8_t buf[16];
@@ -236,8 +298,13 @@ static int rtmp_packet_read_one_chunk(EMURLContext *h, RTMPPacket *p,
         timestamp += prev_pkt[channel_id].timestamp;
 
     if (!prev_pkt[channel_id].read) {
-        if ((ret = ff_em_rtmp_packet_create(p, channel_id, type, timestamp,
-                                         size)) < 0)
+        if (pool)
+            ret = rtmp_packet_create_pooled(p, pool, channel_id, type,
+                                            timestamp, size);
+        else
+            ret = ff_em_rtmp_packet_create(p, channel_id, type, timestamp,
+                                           size);
+        if (ret < 0)
             return ret;
         p->read = written;
         p->offset = 0;
@@ -255,7 +322,9 @@ static int rtmp_packet_read_one_chunk(EMURLContext *h, RTMPPacket *p,
         p->offset        = prev->offset;
         p->read          = prev->read + written;
         p->timestamp     = prev->timestamp;
+        p->buf           = prev->buf;
         prev->data       = NULL;
+        prev->buf        = NULL;
     }
     p->extra = extra;
     // save history
@@ -277,9 +346,11 @@ static int rtmp_packet_read_one_chunk(EMURLContext *h, RTMPPacket *p,
     if (size > 0) {
        RTMPPacket *prev = &prev_pkt[channel_id];
        prev->data = p->data;
+       prev->buf  = p->buf;
        prev->read = p->read;
        prev->offset = p->offset;
        p->data      = NULL;
+       p->buf       = NULL;
        return AVERROR(EAGAIN);
     }
 
@@ -287,13 +358,13 @@ static int rtmp_packet_read_one_chunk(EMURLContext *h, RTMPPacket *p,
     return p->read;
 }
 
-int ff_rtmp_packet_read_internal(EMURLContext *h, RTMPPacket *p, int chunk_size,
-                                 RTMPPacket **prev_pkt, int *nb_prev_pkt,
-                                 uint8_t hdr)
+static int rtmp_packet_read_internal(EMURLContext *h, RTMPPacket *p, int chunk_size,
+                                     RTMPPacket **prev_pkt, int *nb_prev_pkt,
+                                     uint8_t hdr, RTMPPacketPool *pool)
 {
     while (1) {
         int ret = rtmp_packet_read_one_chunk(h, p, chunk_size, prev_pkt,
-                                             nb_prev_pkt, hdr);
+                                             nb_prev_pkt, hdr, pool);
         if (ret > 0 || ret != AVERROR(EAGAIN))
             return ret;
 
@@ -302,6 +373,14 @@ int ff_rtmp_packet_read_internal(EMURLContext *h, RTMPPacket *p, int chunk_size,
     }
 }
 
+int ff_rtmp_packet_read_internal(EMURLContext *h, RTMPPacket *p, int chunk_size,
+                                 RTMPPacket **prev_pkt, int *nb_prev_pkt,
+                                 uint8_t hdr)
+{
+    return rtmp_packet_read_internal(h, p, chunk_size, prev_pkt, nb_prev_pkt,
+                                     hdr, NULL);
+}
+
 int ff_rtmp_packet_write(EMURLContext *h, RTMPPacket *pkt,
                          int chunk_size, RTMPPacket **prev_pkt_ptr,
                          int *nb_prev_pkt)
@@ -402,6 +481,7 @@ int ff_rtmp_packet_write(EMURLContext *h, RTMPPacket *pkt,
 int ff_em_rtmp_packet_create(RTMPPacket *pkt, int channel_id, RTMPPacketType type,
                           int timestamp, int size)
 {
+    pkt->buf = NULL;
     if (size) {
         pkt->data = av_em_realloc(NULL, size);
         if (!pkt->data)
@@ -421,7 +501,12 @@ void ff_em_rtmp_packet_destroy(RTMPPacket *pkt)
 {
     if (!pkt)
         return;
-    av_em_freep(&pkt->data);
+    if (pkt->buf) {
+        av_em_buffer_unref(&pkt->buf);
+        pkt->data = NULL;
+    } else {
+        av_em_freep(&pkt->data);
+    }
     pkt->size = 0;
 }
 
@@ -84,8 +84,27 @@ typedef struct RTMPPacket {
     int            size;       ///< packet payload size
     int            offset;     ///< amount of data read so far
     int            read;       ///< amount read, including headers
+    AVEMBufferRef  *buf;       ///< owns data when it was read into a pooled buffer, NULL otherwise
 } RTMPPacket;
 
+/** payload size limits of the incoming message buffer pools */
+#define RTMP_POOL_SMALL_SIZE  4096
+#define RTMP_POOL_LARGE_SIZE  (256 * 1024)
+
+/**
+ * Buffer pools for incoming message payloads. Payloads are read into
+ * refcounted, padded buffers that a demuxer can hand out as packet data
+ * without copying when the payload fills most of the buffer. Messages
+ * larger than RTMP_POOL_LARGE_SIZE get a buffer of their own.
+ */
+typedef struct RTMPPacketPool {
+    AVBufferPool   *small;     ///< audio and data messages
+    AVBufferPool   *large;     ///< video messages
+} RTMPPacketPool;
+
+int  ff_rtmp_packet_pool_init(RTMPPacketPool *pool);
+void ff_rtmp_packet_pool_uninit(RTMPPacketPool *pool);
+
 /**
  * Create new RTMP packet with given attributes.
  *
@@ -136,6 +155,17 @@ int ff_rtmp_packet_read_internal(EMURLContext *h, RTMPPacket *p, int chunk_size,
                                  RTMPPacket **prev_pkt, int *nb_prev_pkt,
                                  uint8_t c);
 
+/**
+ * Read RTMP packet sent by the server, allocating the payload from pool.
+ * On success p->buf holds a reference to the payload, and the bytes past
+ * p->size are AV_INPUT_BUFFER_PADDING_SIZE zeroes.
+ *
+ * @see ff_rtmp_packet_read
+ */
+int ff_rtmp_packet_read_pooled(EMURLContext *h, RTMPPacket *p,
+                               int chunk_size, RTMPPacket **prev_pkt,
+                               int *nb_prev_pkt, RTMPPacketPool *pool);
+
 /**
  * Send RTMP packet to the server.
  *
@@ -133,6 +133,9 @@ typedef struct EMRTMPContext {
     int           do_reconnect;
     int           auth_tried;
     int	          use_ijktcphook;
+    int           direct;                     ///< hand media messages to the live_rtmp demuxer instead of serializing them to FLV
+    RTMPPacketPool pool;                      ///< payload buffers of incoming messages in direct mode
+    RTMPPacket    *direct_pkt;                ///< where get_packet() stores the next media message in direct mode
     //ADD by Eastmoney,chenhd
     char *        app_ctx_intptr;
     AVApplicationContext *app_ctx;
@@ -2409,9 +2412,10 @@ static int get_packet(EMURLContext *s, int for_header)
 
     for (;;) {
         RTMPPacket rpkt = { 0 };
-        if ((ret = ff_rtmp_packet_read(rt->stream, &rpkt,
-                                       rt->in_chunk_size, &rt->prev_pkt[0],
-                                       &rt->nb_prev_pkt[0])) <= 0) {
+        if ((ret = ff_rtmp_packet_read_pooled(rt->stream, &rpkt,
+                                              rt->in_chunk_size, &rt->prev_pkt[0],
+                                              &rt->nb_prev_pkt[0],
+                                              rt->direct ? &rt->pool : NULL)) <= 0) {
             if (ret == 0) {
                 return AVERROR(EAGAIN);
             } else {
@@ -2465,6 +2469,13 @@ static int get_packet(EMURLContext *s, int for_header)
             ff_em_rtmp_packet_destroy(&rpkt);
             continue;
         }
+        if (rt->direct_pkt &&
+            (rpkt.type == RTMP_PT_VIDEO  || rpkt.type == RTMP_PT_AUDIO ||
+             rpkt.type == RTMP_PT_NOTIFY || rpkt.type == RTMP_PT_METADATA)) {
+            // the demuxer takes the payload reference as it is
+            *rt->direct_pkt = rpkt;
+            return 0;
+        }
         if (rpkt.type == RTMP_PT_VIDEO || rpkt.type == RTMP_PT_AUDIO) {
             ret = append_flv_data(rt, &rpkt, 0);
             ff_em_rtmp_packet_destroy(&rpkt);
@@ -2502,6 +2513,8 @@ static int rtmp_close(EMURLContext *h)
         av_em_freep(&rt->prev_pkt[i]);
     }
 
+    ff_rtmp_packet_pool_uninit(&rt->pool);
+
     free_tracked_methods(rt);
     av_em_freep(&rt->flv_data);
     ffurl_em_close(rt->stream);
@@ -2809,6 +2822,16 @@ reconnect:
     rt->server_bw = 2500000;
     rt->duration = 0;
 
+    if (rt->direct) {
+        if (!rt->is_input || rt->listen) {
+            av_em_log(s, AV_LOG_ERROR, "rtmp_direct is only available for playback\n");
+            ret = AVERROR(EINVAL);
+            goto fail;
+        }
+        if (!rt->pool.small && (ret = ff_rtmp_packet_pool_init(&rt->pool)) < 0)
+            goto fail;
+    }
+
     av_em_log(s, AV_LOG_DEBUG, "Proto = %s, path = %s, app = %s, fname = %s\n",
            proto, path, rt->app, rt->playpath);
     if (!rt->listen) {
@@ -2838,7 +2861,10 @@ reconnect:
         goto reconnect;
     }
 
-    if (rt->is_input) {
+    if (rt->is_input && rt->direct) {
+        // the live_rtmp demuxer reads messages itself, starting with the
+        // first one after the play command succeeded
+    } else if (rt->is_input) {
         // generate FLV header for demuxer
         rt->flv_size = 13;
         if ((ret = av_em_reallocp(&rt->flv_data, rt->flv_size)) < 0)
@@ -2896,6 +2922,9 @@ static int rtmp_read(EMURLContext *s, uint8_t *buf, int size)
     int orig_size = size;
     int ret;
 
+    if (rt->direct)
+        return AVERROR(EINVAL);
+
     while (size > 0) {
         int data_left = rt->flv_size - rt->flv_off;
 
@@ -2917,6 +2946,29 @@ static int rtmp_read(EMURLContext *s, uint8_t *buf, int size)
     return orig_size;
 }
 
+int ff_em_rtmp_read_message(EMURLContext *h, RTMPPacket *pkt)
+{
+    EMRTMPContext *rt = h->priv_data;
+    int ret;
+
+    if (!rt->direct)
+        return AVERROR(EINVAL);
+
+    memset(pkt, 0, sizeof(*pkt));
+    rt->direct_pkt = pkt;
+    ret = get_packet(h, 0);
+    rt->direct_pkt = NULL;
+    if (ret < 0)
+        return ret;
+    return pkt->data ? 0 : AVERROR(EAGAIN);
+}
+
+double ff_em_rtmp_get_duration(EMURLContext *h)
+{
+    EMRTMPContext *rt = h->priv_data;
+    return rt->duration;
+}
+
 static int64_t rtmp_seek(EMURLContext *s, int stream_index, int64_t timestamp,
                          int flags)
 {
@@ -3118,6 +3170,7 @@ static const AVOption rtmp_options[] = {
     {"listen",      "Listen for incoming rtmp connections", OFFSET(listen), AV_OPT_TYPE_INT, {.i64 = 0}, INT_MIN, INT_MAX, DEC, "rtmp_listen" },
     {"timeout", "Maximum timeout (in seconds) to wait for incoming connections. -1 is infinite. Implies -rtmp_listen 1",  OFFSET(listen_timeout), AV_OPT_TYPE_INT, {.i64 = -1}, INT_MIN, INT_MAX, DEC, "rtmp_listen" },
     {"use_ijktcphook", "use ijk tcp hook read rtmp packets", OFFSET(use_ijktcphook), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC},
+    {"rtmp_direct", "Hand media messages to the live_rtmp demuxer instead of an FLV byte stream", OFFSET(direct), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC},
     { "ijkapplication", "AVApplicationContext", OFFSET(app_ctx_intptr), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, .flags = DEC },
 	{ NULL },
 };
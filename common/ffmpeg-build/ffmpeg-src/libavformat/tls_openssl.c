@@ -31,20 +31,35 @@
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 #include <openssl/bio.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
+#define TLS_SESSION_CACHE_SIZE 32
+
 static int openssl_init;
 
 typedef struct TLSContext {
     const AVEMClass *class;
     TLSShared tls_shared;
-    SSL_CTX *ctx;
+    SSL_CTX *ctx;               ///< own context, NULL when using tls_client_ctx
     SSL *ssl;
 } TLSContext;
 
+/* client sessions by peer, handed back to SSL_set_session() on the next
+ * connection so the handshake is abbreviated */
+typedef struct TLSSessionEntry {
+    char         key[256];
+    SSL_SESSION *session;
+    int64_t      last_used;
+} TLSSessionEntry;
+
+/* both protected by the avformat lock */
+static SSL_CTX        *tls_client_ctx;
+static TLSSessionEntry tls_sessions[TLS_SESSION_CACHE_SIZE];
+
 #if HAVE_THREADS
 #include <openssl/crypto.h>
 pthread_mutex_t *openssl_mutexes;
@@ -117,6 +132,103 @@ static int print_tls_error(EMURLContext *h, int ret)
     return AVERROR(EIO);
 }
 
+static SSL_CTX *tls_ctx_new(int listen)
+{
+    SSL_CTX *ctx;
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+    ctx = SSL_CTX_new(listen ? TLS_server_method() : TLS_client_method());
+    if (ctx)
+        SSL_CTX_set_min_proto_version(ctx, TLS1_VERSION);
+#else
+    /* negotiates the highest version both sides support, TLS 1.2 with 1.0.2 */
+    ctx = SSL_CTX_new(listen ? SSLv23_server_method() : SSLv23_client_method());
+    if (ctx)
+        SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
+#endif
+    return ctx;
+}
+
+/* one context for all plain client connections, they only differ per SSL */
+static SSL_CTX *tls_get_client_ctx(void)
+{
+    SSL_CTX *ctx;
+
+    avpriv_em_lock_avformat();
+    if (!tls_client_ctx) {
+        tls_client_ctx = tls_ctx_new(0);
+        /* sessions are kept per peer in tls_sessions instead */
+        if (tls_client_ctx)
+            SSL_CTX_set_session_cache_mode(tls_client_ctx, SSL_SESS_CACHE_CLIENT |
+                                                           SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    }
+    ctx = tls_client_ctx;
+    avpriv_em_unlock_avformat();
+    return ctx;
+}
+
+static TLSSessionEntry *tls_session_find_l(const char *key)
+{
+    int i;
+
+    for (i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+        if (tls_sessions[i].session && !strcmp(tls_sessions[i].key, key))
+            return &tls_sessions[i];
+    }
+    return NULL;
+}
+
+static void tls_session_apply(SSL *ssl, const char *key)
+{
+    TLSSessionEntry *entry;
+    SSL_SESSION *session;
+
+    avpriv_em_lock_avformat();
+    entry = tls_session_find_l(key);
+    if (entry) {
+        session = entry->session;
+        if (time(NULL) >= SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session)) {
+            SSL_SESSION_free(session);
+            entry->session = NULL;
+        } else {
+            /* takes its own reference */
+            SSL_set_session(ssl, session);
+            entry->last_used = av_em_gettime_relative();
+        }
+    }
+    avpriv_em_unlock_avformat();
+}
+
+static void tls_session_store(SSL *ssl, const char *key)
+{
+    SSL_SESSION *session = SSL_get1_session(ssl);
+    SSL_SESSION *old = NULL;
+    TLSSessionEntry *entry;
+    int i;
+
+    if (!session)
+        return;
+
+    avpriv_em_lock_avformat();
+    entry = tls_session_find_l(key);
+    if (!entry) {
+        /* an empty slot, or else the least recently used one */
+        entry = &tls_sessions[0];
+        for (i = 0; i < TLS_SESSION_CACHE_SIZE && entry->session; i++) {
+            if (!tls_sessions[i].session || tls_sessions[i].last_used < entry->last_used)
+                entry = &tls_sessions[i];
+        }
+        av_em_strlcpy(entry->key, key, sizeof(entry->key));
+    }
+    old = entry->session;
+    entry->session   = session;
+    entry->last_used = av_em_gettime_relative();
+    avpriv_em_unlock_avformat();
+
+    if (old)
+        SSL_SESSION_free(old);
+}
+
 static int tls_close(EMURLContext *h)
 {
     TLSContext *c = h->priv_data;
@@ -199,8 +311,11 @@ static int tls_open(EMURLContext *h, const char *uri, int flags, AVEMDictionary
 {
     TLSContext *p = h->priv_data;
     TLSShared *c = &p->tls_shared;
+    SSL_CTX *ctx;
     BIO *bio;
-    int ret;
+    char session_key[256] = "";
+    int64_t start;
+    int port, ret;
 
     if ((ret = ff_openssl_init()) < 0)
         return ret;
@@ -208,8 +323,14 @@ static int tls_open(EMURLContext *h, const char *uri, int flags, AVEMDictionary
     if ((ret = em_tls_open_underlying(c, h, uri, options)) < 0)
         goto fail;
 
-    p->ctx = SSL_CTX_new(c->listen ? TLSv1_server_method() : TLSv1_client_method());
-    if (!p->ctx) {
+    /* custom certificates need a context of their own */
+    if (!c->listen && !c->ca_file && !c->cert_file && !c->key_file) {
+        ctx = tls_get_client_ctx();
+    } else {
+        p->ctx = tls_ctx_new(c->listen);
+        ctx = p->ctx;
+    }
+    if (!ctx) {
         av_em_log(h, AV_LOG_ERROR, "%s\n", ERR_error_string(ERR_get_error(), NULL));
         ret = AVERROR(EIO);
         goto fail;
@@ -230,22 +351,39 @@ static int tls_open(EMURLContext *h, const char *uri, int flags, AVEMDictionary
         ret = AVERROR(EIO);
         goto fail;
     }
-    // Note, this doesn't check that the peer certificate actually matches
-    // the requested hostname.
-    if (c->verify)
-        SSL_CTX_set_verify(p->ctx, SSL_VERIFY_PEER|SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
-    p->ssl = SSL_new(p->ctx);
+    p->ssl = SSL_new(ctx);
     if (!p->ssl) {
         av_em_log(h, AV_LOG_ERROR, "%s\n", ERR_error_string(ERR_get_error(), NULL));
         ret = AVERROR(EIO);
         goto fail;
     }
+    // Note, this doesn't check that the peer certificate actually matches
+    // the requested hostname.
+    if (c->verify)
+        SSL_set_verify(p->ssl, SSL_VERIFY_PEER|SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
     bio = BIO_new(&url_bio_method);
     bio->ptr = c->tcp;
     SSL_set_bio(p->ssl, bio, bio);
-    if (!c->listen && !c->numerichost)
-        SSL_set_tlsext_host_name(p->ssl, c->host);
+    if (!c->listen) {
+        av_em_url_split(NULL, 0, NULL, 0, NULL, 0, &port, NULL, 0, uri);
+        /* a session verified against one trust setting must not resume under
+         * another, a truncated key could collide so it is not cached at all */
+        if (snprintf(session_key, sizeof(session_key), "%s:%d/%s/%d/%s/%s",
+                     c->underlying_host, port, c->host ? c->host : "", c->verify,
+                     c->ca_file ? c->ca_file : "", c->cert_file ? c->cert_file : "") >= sizeof(session_key))
+            session_key[0] = '\0';
+        if (session_key[0])
+            tls_session_apply(p->ssl, session_key);
+        if (!c->numerichost)
+            SSL_set_tlsext_host_name(p->ssl, c->host);
+    }
+    start = av_em_gettime_relative();
     ret = c->listen ? SSL_accept(p->ssl) : SSL_connect(p->ssl);
+    if (ret == 1 && !c->listen) {
+        em_tls_stat_update(av_em_gettime_relative() - start, SSL_session_reused(p->ssl));
+        if (session_key[0])
+            tls_session_store(p->ssl, session_key);
+    }
     if (ret == 0) {
         av_em_log(h, AV_LOG_ERROR, "Unable to negotiate TLS/SSL session\n");
         ret = AVERROR(EIO);
@@ -283,6 +421,12 @@ static int tls_write(EMURLContext *h, const uint8_t *buf, int size)
     return print_tls_error(h, ret);
 }
 
+static int tls_get_file_handle(EMURLContext *h)
+{
+    TLSContext *c = h->priv_data;
+    return ffurl_em_get_file_handle(c->tls_shared.tcp);
+}
+
 static const AVOption options[] = {
     TLS_COMMON_OPTIONS(TLSContext, tls_shared),
     { NULL }
@@ -301,6 +445,7 @@ const EMURLProtocol em_tls_openssl_protocol = {
     .url_read       = tls_read,
     .url_write      = tls_write,
     .url_close      = tls_close,
+    .url_get_file_handle = tls_get_file_handle,
     .priv_data_size = sizeof(TLSContext),
     .flags          = URL_PROTOCOL_FLAG_NETWORK,
     .priv_data_class = &tls_class,
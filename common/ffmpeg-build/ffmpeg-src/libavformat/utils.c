@@ -2014,11 +2014,8 @@ int em_index_search_timestamp_nocheck(const AVEMIndexEntry *entries, int nb_entr
 }
 
 
-void em_configure_buffers_for_index(AVEMFormatContext *s, int64_t time_tolerance)
+int em_buffers_configurable(AVEMFormatContext *s)
 {
-    int ist1, ist2;
-    int64_t pos_delta = 0;
-    int64_t skip = 0;
     //We could use EMURLProtocol flags here but as many user applications do not use EMURLProtocols this would be unreliable
     const char *proto = avio_em_find_protocol_name(s->filename);
 
@@ -2029,7 +2026,31 @@ void em_configure_buffers_for_index(AVEMFormatContext *s, int64_t time_tolerance
                "optimally without knowing the protocol\n");
     }
 
-    if (proto && !(strcmp(proto, "file") && strcmp(proto, "pipe") && strcmp(proto, "cache")))
+    return !(proto && !(strcmp(proto, "file") && strcmp(proto, "pipe") && strcmp(proto, "cache")));
+}
+
+void em_configure_buffers_for_spread(AVEMFormatContext *s, int64_t pos_delta, int64_t skip)
+{
+    pos_delta *= 2;
+    /* XXX This could be adjusted depending on protocol*/
+    if (s->pb->buffer_size < pos_delta && pos_delta < (1<<24)) {
+        av_em_log(s, AV_LOG_VERBOSE, "Reconfiguring buffers to size %"PRId64"\n", pos_delta);
+        emio_set_buf_size(s->pb, pos_delta);
+        s->pb->short_seek_threshold = FFMAX(s->pb->short_seek_threshold, pos_delta/2);
+    }
+
+    if (skip < (1<<23)) {
+        s->pb->short_seek_threshold = FFMAX(s->pb->short_seek_threshold, skip);
+    }
+}
+
+void em_configure_buffers_for_index(AVEMFormatContext *s, int64_t time_tolerance)
+{
+    int ist1, ist2;
+    int64_t pos_delta = 0;
+    int64_t skip = 0;
+
+    if (!em_buffers_configurable(s))
         return;
 
     for (ist1 = 0; ist1 < s->nb_streams; ist1++) {
@@ -2058,17 +2079,7 @@ void em_configure_buffers_for_index(AVEMFormatContext *s, int64_t time_tolerance
         }
     }
 
-    pos_delta *= 2;
-    /* XXX This could be adjusted depending on protocol*/
-    if (s->pb->buffer_size < pos_delta && pos_delta < (1<<24)) {
-        av_em_log(s, AV_LOG_VERBOSE, "Reconfiguring buffers to size %"PRId64"\n", pos_delta);
-        emio_set_buf_size(s->pb, pos_delta);
-        s->pb->short_seek_threshold = FFMAX(s->pb->short_seek_threshold, pos_delta/2);
-    }
-
-    if (skip < (1<<23)) {
-        s->pb->short_seek_threshold = FFMAX(s->pb->short_seek_threshold, skip);
-    }
+    em_configure_buffers_for_spread(s, pos_delta, skip);
 }
 
 int av_em_index_search_timestamp(AVEMStream *st, int64_t wanted_timestamp, int flags)
@@ -3974,6 +3985,78 @@ find_stream_info_err:
     return ret;
 }
 
+static int fast_stream_info_ready(AVEMStream *st)
+{
+    AVEMCodecParameters *par = st->codecpar;
+
+    switch (par->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (par->codec_id == AV_CODEC_ID_NONE)
+            return 0;
+        if (par->codec_id == AV_CODEC_ID_H264 ||
+            par->codec_id == AV_CODEC_ID_HEVC ||
+            par->codec_id == AV_CODEC_ID_MPEG4)
+            return par->extradata_size > 0;
+        return 1;
+    case AVMEDIA_TYPE_AUDIO:
+        if (par->codec_id == AV_CODEC_ID_NONE)
+            return 0;
+        /* the demuxer takes sample rate and channels from the AudioSpecificConfig */
+        if (par->codec_id == AV_CODEC_ID_AAC && par->extradata_size < 2)
+            return 0;
+        return par->sample_rate > 0 && par->channels > 0;
+    default:
+        return 1;
+    }
+}
+
+int avformat_em_find_stream_info_fast(AVEMFormatContext *ic, int64_t max_wait_us)
+{
+    int i, ready, ret = 0;
+    AVEMPacket pkt1;
+    int64_t read_size = 0;
+    int64_t start_time = av_em_gettime_relative();
+
+    for (;;) {
+        if (em_check_interrupt(&ic->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+
+        ready = ic->nb_streams > 0 && !(ic->ctx_flags & AVFMTCTX_NOHEADER);
+        for (i = 0; ready && i < ic->nb_streams; i++)
+            ready = fast_stream_info_ready(ic->streams[i]);
+        if (ready)
+            break;
+
+        if (av_em_gettime_relative() - start_time > max_wait_us ||
+            (ic->probesize > 0 && read_size >= ic->probesize)) {
+            ret = AVERROR(EAGAIN);
+            break;
+        }
+
+        /* new streams and sequence headers are picked up while reading,
+         * every packet is kept for av_em_read_frame() */
+        ret = read_frame_internal(ic, &pkt1);
+        if (ret == AVERROR(EAGAIN)) {
+            ret = 0;
+            continue;
+        }
+        if (ret < 0)
+            break;
+
+        read_size += pkt1.size;
+        ret = add_to_pktbuf(&ic->internal->packet_buffer, &pkt1,
+                            &ic->internal->packet_buffer_end, 0);
+        if (ret < 0)
+            break;
+    }
+
+    av_em_log(ic, AV_LOG_DEBUG, "fast stream info ret:%d streams:%d bytes:%"PRId64" time:%"PRId64"us\n",
+              ret, ic->nb_streams, read_size, av_em_gettime_relative() - start_time);
+    return ret;
+}
+
 AVEMProgram *av_em_find_program_from_stream(AVEMFormatContext *ic, AVEMProgram *last, int s)
 {
     int i, j;
@@ -0,0 +1,57 @@
+/*
+ * This file is part of libswresample.
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/aarch64/cpu.h"
+#include "libswresample/swresample_internal.h"
+
+mix_1_1_func_type ff_mix_1_1_a_float_neon;
+mix_2_1_func_type ff_mix_2_1_a_float_neon;
+mix_any_func_type ff_mix6to2_float_neon;
+
+av_cold int em_swri_rematrix_init_aarch64(struct SwrContext *s){
+    int cpu_flags = av_em_get_cpu_flags();
+    int nb_in  = av_em_get_channel_layout_nb_channels(s->in_ch_layout);
+    int nb_out = av_em_get_channel_layout_nb_channels(s->out_ch_layout);
+    int num    = nb_in * nb_out;
+
+    s->mix_1_1_simd = NULL;
+    s->mix_2_1_simd = NULL;
+
+    if (!have_neon(cpu_flags))
+        return 0;
+
+    if (s->midbuf.fmt == AV_SAMPLE_FMT_FLTP) {
+        s->mix_1_1_simd = ff_mix_1_1_a_float_neon;
+        s->mix_2_1_simd = ff_mix_2_1_a_float_neon;
+        /* the only float mix_any_f for 6 input channels is the 5.1 downmix */
+        if (s->mix_any_f && nb_in == 6 && nb_out == 2)
+            s->mix_any_f = ff_mix6to2_float_neon;
+
+        s->native_simd_matrix = av_em_mallocz_array(num, sizeof(float));
+        s->native_simd_one = av_em_mallocz(sizeof(float));
+        if (!s->native_simd_matrix || !s->native_simd_one)
+            return AVERROR(ENOMEM);
+        memcpy(s->native_simd_matrix, s->native_matrix, num * sizeof(float));
+        memcpy(s->native_simd_one, s->native_one, sizeof(float));
+    }
+
+    return 0;
+}
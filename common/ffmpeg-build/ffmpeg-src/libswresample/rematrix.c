@@ -449,6 +449,8 @@ av_cold int em_swri_rematrix_init(SwrContext *s){
 
     if(HAVE_YASM && HAVE_MMX)
         return em_swri_rematrix_init_x86(s);
+    if(ARCH_AARCH64)
+        return em_swri_rematrix_init_aarch64(s);
 
     return 0;
 }
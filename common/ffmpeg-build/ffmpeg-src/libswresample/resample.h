@@ -61,5 +61,6 @@ typedef struct ResampleContext {
 void em_swri_resample_dsp_init(ResampleContext *c);
 void em_swri_resample_dsp_x86_init(ResampleContext *c);
 void em_swri_resample_dsp_arm_init(ResampleContext *c);
+void em_swri_resample_dsp_aarch64_init(ResampleContext *c);
 
 #endif /* SWRESAMPLE_RESAMPLE_H */
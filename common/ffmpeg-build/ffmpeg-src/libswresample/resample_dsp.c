@@ -66,4 +66,5 @@ void em_swri_resample_dsp_init(ResampleContext *c)
 
     if (ARCH_X86) em_swri_resample_dsp_x86_init(c);
     else if (ARCH_ARM) em_swri_resample_dsp_arm_init(c);
+    else if (ARCH_AARCH64) em_swri_resample_dsp_aarch64_init(c);
 }
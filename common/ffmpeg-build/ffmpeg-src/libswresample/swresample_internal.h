@@ -198,6 +198,7 @@ int em_swri_rematrix_init(SwrContext *s);
 void em_swri_rematrix_free(SwrContext *s);
 int em_swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy);
 int em_swri_rematrix_init_x86(struct SwrContext *s);
+int em_swri_rematrix_init_aarch64(struct SwrContext *s);
 
 av_warn_unused_result
 int em_swri_get_dither(SwrContext *s, void *dst, int len, unsigned seed, enum AVSampleFormat noise_fmt);
@@ -0,0 +1,250 @@
+/*
+ * This file is part of libswresample
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Rematrix and resample kernels of the CPU specific init against the C
+ * code: every case is converted twice, with the CPU flags forced to 0 and
+ * with the detected ones, fed in the same random chunk sizes.
+ */
+
+#include "config.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+
+#include "libswresample/swresample.h"
+#include "libswresample/swresample_internal.h"
+#include "libswresample/resample.h"
+
+#define MAX_CHANNELS 6
+#define MAX_CHUNK    1024
+
+typedef struct TestCase {
+    const char *name;
+    int64_t in_layout, out_layout;
+    enum AVSampleFormat fmt;
+    int in_rate, out_rate;
+    int filter_size;
+    const double *matrix;   ///< out x in, NULL for the default downmix
+    double tolerance;       ///< 0 for bit-exact
+} TestCase;
+
+/* out0 = 0.7 L goes through mix_1_1, out1 = 0.3 L + 0.5 R through mix_2_1 */
+static const double stereo_matrix[] = { 0.7, 0.0, 0.3, 0.5 };
+
+/* The float kernels keep the C order of products and sums, only the C
+ * compiler may contract them into fused multiply-adds. The float
+ * resampler sums its lanes in a different order than C. */
+static const TestCase cases[] = {
+    { "mix_1_1 + mix_2_1 flt",           AV_CH_LAYOUT_STEREO,  AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLTP, 48000, 48000, 32, stereo_matrix, 1e-6 },
+    { "mix6to2 flt",                     AV_CH_LAYOUT_5POINT1, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLTP, 48000, 48000, 32, NULL,          1e-6 },
+    { "resample flt 44100->48000",       AV_CH_LAYOUT_MONO,    AV_CH_LAYOUT_MONO,   AV_SAMPLE_FMT_FLTP, 44100, 48000, 32, NULL,          1e-5 },
+    { "resample flt 48000->44100 f6",    AV_CH_LAYOUT_MONO,    AV_CH_LAYOUT_MONO,   AV_SAMPLE_FMT_FLTP, 48000, 44100,  6, NULL,          1e-5 },
+    { "resample flt 22050->44100 f16",   AV_CH_LAYOUT_STEREO,  AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLTP, 22050, 44100, 16, NULL,          1e-5 },
+    { "resample s16 44100->48000",       AV_CH_LAYOUT_MONO,    AV_CH_LAYOUT_MONO,   AV_SAMPLE_FMT_S16P, 44100, 48000, 32, NULL,          0    },
+    { "resample s16 48000->44100 f6",    AV_CH_LAYOUT_MONO,    AV_CH_LAYOUT_MONO,   AV_SAMPLE_FMT_S16P, 48000, 44100,  6, NULL,          0    },
+    { "resample s16 8000->44100 f16",    AV_CH_LAYOUT_STEREO,  AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16P,  8000, 44100, 16, NULL,          0    },
+};
+
+typedef struct Output {
+    uint8_t *data[MAX_CHANNELS];
+    int nb_samples;
+    double seconds;
+    void *mix_1_1, *mix_2_1, *mix_any, *resample;
+} Output;
+
+static AVLFG prng;
+static int speed;
+
+/* random samples, every fourth block of MAX_CHUNK at full scale */
+static void fill_input(uint8_t **in, int channels, enum AVSampleFormat fmt, int nb_samples)
+{
+    int ch, i;
+
+    for (ch = 0; ch < channels; ch++)
+        for (i = 0; i < nb_samples; i++) {
+            int edge = (i / MAX_CHUNK) % 4 == 3;
+            unsigned r = av_lfg_get(&prng);
+            if (fmt == AV_SAMPLE_FMT_FLTP)
+                ((float *)in[ch])[i] = edge ? (r & 1 ? 1.0f : -1.0f) : r / (float)UINT_MAX * 2 - 1;
+            else
+                ((int16_t *)in[ch])[i] = edge ? (r & 1 ? 32767 : -32768) : (int16_t)r;
+        }
+}
+
+static int convert(const TestCase *t, int cpu_flags, uint8_t **in, int nb_in, Output *out)
+{
+    int in_ch  = av_em_get_channel_layout_nb_channels(t->in_layout);
+    int out_ch = av_em_get_channel_layout_nb_channels(t->out_layout);
+    int bps    = av_em_get_bytes_per_sample(t->fmt);
+    int max_out = av_em_rescale_rnd(nb_in, t->out_rate, t->in_rate, AV_ROUND_UP) + 2 * MAX_CHUNK;
+    struct SwrContext *s;
+    int64_t t0;
+    int ch, pos = 0, ret;
+
+    av_em_force_cpu_flags(cpu_flags);
+    s = em_swr_alloc_set_opts(NULL, t->out_layout, t->fmt, t->out_rate,
+                              t->in_layout, t->fmt, t->in_rate, 0, NULL);
+    if (!s)
+        return AVERROR(ENOMEM);
+    av_em_opt_set_int(s, "filter_size", t->filter_size, 0);
+    av_em_opt_set_sample_fmt(s, "internal_sample_fmt", t->fmt, 0);
+    if (t->matrix)
+        em_swr_set_matrix(s, t->matrix, in_ch);
+    if ((ret = em_swr_init(s)) < 0)
+        goto end;
+
+    out->mix_1_1  = s->mix_1_1_simd;
+    out->mix_2_1  = s->mix_2_1_simd;
+    out->mix_any  = s->mix_any_f;
+    out->resample = s->resample ? s->resample->dsp.resample : NULL;
+
+    for (ch = 0; ch < out_ch; ch++) {
+        out->data[ch] = av_em_mallocz(max_out * bps);
+        if (!out->data[ch]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+    out->nb_samples = 0;
+
+    /* the same chunk sizes for both runs */
+    av_em_lfg_init(&prng, 0x5eed);
+    t0 = av_em_gettime_relative();
+    while (pos <= nb_in) {
+        const uint8_t *src[MAX_CHANNELS];
+        uint8_t *dst[MAX_CHANNELS];
+        int chunk = FFMIN(1 + av_lfg_get(&prng) % MAX_CHUNK, nb_in - pos);
+
+        for (ch = 0; ch < in_ch; ch++)
+            src[ch] = in[ch] + pos * bps;
+        for (ch = 0; ch < out_ch; ch++)
+            dst[ch] = out->data[ch] + out->nb_samples * bps;
+        ret = em_swr_convert(s, dst, max_out - out->nb_samples,
+                             chunk ? src : NULL, chunk);
+        if (ret < 0)
+            goto end;
+        out->nb_samples += ret;
+        if (!chunk)
+            break;
+        pos += chunk;
+    }
+    out->seconds = (av_em_gettime_relative() - t0) / 1000000.0;
+    ret = 0;
+end:
+    em_swr_free(&s);
+    return ret;
+}
+
+static double max_diff(const Output *a, const Output *b, int channels, enum AVSampleFormat fmt)
+{
+    double diff = 0;
+    int ch, i;
+
+    for (ch = 0; ch < channels; ch++)
+        for (i = 0; i < a->nb_samples; i++) {
+            if (fmt == AV_SAMPLE_FMT_FLTP)
+                diff = FFMAX(diff, fabs(((float *)a->data[ch])[i] - ((float *)b->data[ch])[i]));
+            else
+                diff = FFMAX(diff, abs(((int16_t *)a->data[ch])[i] - ((int16_t *)b->data[ch])[i]));
+        }
+    return diff;
+}
+
+static int run_case(const TestCase *t, int seconds)
+{
+    uint8_t *in[MAX_CHANNELS] = { NULL };
+    Output ref = { { NULL } }, opt = { { NULL } };
+    int in_ch  = av_em_get_channel_layout_nb_channels(t->in_layout);
+    int out_ch = av_em_get_channel_layout_nb_channels(t->out_layout);
+    int nb_in  = seconds * t->in_rate;
+    int ch, err = 1;
+    char simd[64] = "";
+    double diff;
+
+    for (ch = 0; ch < in_ch; ch++)
+        if (!(in[ch] = av_em_alloc(nb_in * av_em_get_bytes_per_sample(t->fmt))))
+            goto end;
+    av_em_lfg_init(&prng, 1);
+    fill_input(in, in_ch, t->fmt, nb_in);
+
+    if (convert(t, 0, in, nb_in, &ref) < 0 || convert(t, -1, in, nb_in, &opt) < 0) {
+        printf("%s: init failed\n", t->name);
+        goto end;
+    }
+
+    if (opt.mix_1_1  != ref.mix_1_1)  strcat(simd, " mix_1_1");
+    if (opt.mix_2_1  != ref.mix_2_1)  strcat(simd, " mix_2_1");
+    if (opt.mix_any  != ref.mix_any)  strcat(simd, " mix_any");
+    if (opt.resample != ref.resample) strcat(simd, " resample");
+
+    if (opt.nb_samples != ref.nb_samples) {
+        printf("%s: %d samples instead of %d\n", t->name, opt.nb_samples, ref.nb_samples);
+        goto end;
+    }
+    diff = max_diff(&ref, &opt, out_ch, t->fmt);
+    err  = diff > t->tolerance;
+    printf("%-32s %s, max diff %g%s [simd:%s]\n", t->name, err ? "FAIL" : "ok",
+           diff, t->tolerance ? "" : " (bit-exact required)", *simd ? simd : " none");
+    if (speed)
+        printf("%-32s C %7.1f ms  opt %7.1f ms  %5.2fx for %d s of audio\n", "",
+               ref.seconds * 1000, opt.seconds * 1000, ref.seconds / FFMAX(opt.seconds, 1e-6), seconds);
+end:
+    for (ch = 0; ch < MAX_CHANNELS; ch++) {
+        av_em_freep(&in[ch]);
+        av_em_freep(&ref.data[ch]);
+        av_em_freep(&opt.data[ch]);
+    }
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    int i, err = 0;
+
+    if (argc > 1 && !strcmp(argv[1], "-t"))
+        speed = 1;
+    else if (argc > 1) {
+        printf("dsp [-t]\n"
+               "-t          speed test\n");
+        return 0;
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(cases); i++)
+        err |= run_case(&cases[i], speed ? 20 : 2);
+
+    if (err)
+        printf("Error: %d.\n", err);
+    return !!err;
+}
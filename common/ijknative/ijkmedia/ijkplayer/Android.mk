@@ -26,6 +26,8 @@ ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
 LOCAL_CFLAGS += -mfloat-abi=soft
 endif
 LOCAL_CFLAGS += -std=c99
+# record playback trace events, see ijktrace.h
+#LOCAL_CFLAGS += -DIJK_TRACE_ENABLED=1
 #LOCAL_LDLIBS += -llog -landroid
 
 LOCAL_C_INCLUDES += $(LOCAL_PATH)
@@ -41,6 +43,16 @@ LOCAL_SRC_FILES += ijkmeta.c
 LOCAL_SRC_FILES += ijkplayer.c
 LOCAL_SRC_FILES += ijkutil.c
 LOCAL_SRC_FILES += ijksonic.c
+LOCAL_SRC_FILES += ijktimeshift.c
+LOCAL_SRC_FILES += ijkmemgov.c
+LOCAL_SRC_FILES += ijktimestretch.c
+LOCAL_SRC_FILES += ijkthroughput.c
+LOCAL_SRC_FILES += ijkbufpolicy.c
+LOCAL_SRC_FILES += ijkdecshed.c
+LOCAL_SRC_FILES += ijktrace.c
+LOCAL_SRC_FILES += ijkthumbnail.c
+LOCAL_SRC_FILES += ijksharedsrc.c
+LOCAL_SRC_FILES += ijkpacing.c
 
 
 LOCAL_SRC_FILES += pipeline/ffpipeline_ffplay.c
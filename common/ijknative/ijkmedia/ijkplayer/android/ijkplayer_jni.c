@@ -342,6 +342,36 @@ LABEL_RETURN:
     emmp_dec_ref_p(&mp);
 }
 
+static jint
+IjkMediaPlayer_timeshiftGoLive(JNIEnv *env, jobject thiz)
+{
+    MPTRACE("%s\n", __func__);
+    jint retval = -1;
+    EMMediaPlayer *mp = jni_get_media_player(env, thiz);
+    JNI_CHECK_GOTO(mp, env, "java/lang/IllegalStateException", "mpjni: timeshiftGoLive: null mp", LABEL_RETURN);
+
+    retval = emmp_timeshift_go_live(mp);
+
+LABEL_RETURN:
+    emmp_dec_ref_p(&mp);
+    return retval;
+}
+
+static jint
+IjkMediaPlayer_detachSharedSource(JNIEnv *env, jobject thiz)
+{
+    MPTRACE("%s\n", __func__);
+    jint retval = -1;
+    EMMediaPlayer *mp = jni_get_media_player(env, thiz);
+    JNI_CHECK_GOTO(mp, env, "java/lang/IllegalStateException", "mpjni: detachSharedSource: null mp", LABEL_RETURN);
+
+    retval = emmp_detach_shared_source(mp);
+
+LABEL_RETURN:
+    emmp_dec_ref_p(&mp);
+    return retval;
+}
+
 static jboolean
 IjkMediaPlayer_isPlaying(JNIEnv *env, jobject thiz)
 {
@@ -561,6 +591,34 @@ LABEL_RETURN:
     return value;
 }
 
+static IjkThumbnailParams
+jni_thumbnail_params(jint count, jint width, jint height, jint columns)
+{
+    IjkThumbnailParams params = {0};
+
+    params.count   = count;
+    params.width   = width;
+    params.height  = height;
+    params.columns = columns > 0 ? columns : 1;
+    return params;
+}
+
+/* the thumbnailer is handed to java as a handle, so that another thread can abort it */
+static jlong
+IjkMediaPlayer_createThumbnailer(JNIEnv *env, jobject thiz, jint count, jint width, jint height, jint columns)
+{
+    IjkThumbnailParams params = jni_thumbnail_params(count, width, height, columns);
+    IjkThumbnailer *thumbnailer = NULL;
+    EMMediaPlayer *mp = jni_get_media_player(env, thiz);
+    JNI_CHECK_GOTO(mp, env, "java/lang/IllegalStateException", "mpjni: createThumbnailer: null mp", LABEL_RETURN);
+
+    thumbnailer = emmp_create_thumbnailer(mp, &params);
+
+LABEL_RETURN:
+    emmp_dec_ref_p(&mp);
+    return (jlong)(intptr_t)thumbnailer;
+}
+
 static void
 ijkMediaPlayer_setPropertyLong(JNIEnv *env, jobject thiz, jint id, jlong value)
 {
@@ -935,6 +993,56 @@ inject_callback(void *opaque, int what, void *data, size_t data_size)
             ret = 0;
             break;
         }
+        case IJK_PACING_INJECT_SNAPSHOT: {
+            IjkPacingSnapshot *real_data = (IjkPacingSnapshot *)data;
+            char key[32];
+            int i;
+            if (data_size != sizeof(IjkPacingSnapshot))
+                goto fail;
+            jbundle = J4AC_Bundle__Bundle__catchAll(env);
+            if (!jbundle) {
+                ALOGE("%s: J4AC_Bundle__Bundle__catchAll failed for case %d\n", __func__, what);
+                goto fail;
+            }
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "frames", real_data->frames);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "error_avg_us", real_data->error_avg_us);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "error_max_us", real_data->error_max_us);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "interval_avg_us", real_data->interval_avg_us);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "interval_jitter_us", real_data->interval_jitter_us);
+            for (i = 0; i < IJK_PACING_INTERVAL_BUCKETS; i++) {
+                snprintf(key, sizeof(key), "interval_hist_%d", i);
+                J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, key, real_data->interval_hist[i]);
+            }
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "skips_late", real_data->skips[IJK_PACING_SKIP_LATE]);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "skips_early", real_data->skips[IJK_PACING_SKIP_EARLY]);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "skips_stale", real_data->skips[IJK_PACING_SKIP_STALE]);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "skips_shed", real_data->skips[IJK_PACING_SKIP_SHED]);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "repeats_starved", real_data->repeats[IJK_PACING_REPEAT_STARVED]);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "repeats_sync", real_data->repeats[IJK_PACING_REPEAT_SYNC]);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "repeats_refresh", real_data->repeats[IJK_PACING_REPEAT_REFRESH]);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "avdiff_avg_us", real_data->avdiff_avg_us);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "avdiff_max_us", real_data->avdiff_max_us);
+            for (i = 0; i < IJK_PACING_AVDIFF_BUCKETS; i++) {
+                snprintf(key, sizeof(key), "avdiff_hist_%d", i);
+                J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, key, real_data->avdiff_hist[i]);
+            }
+            J4AC_Bundle__putInt__withCString__catchAll(env, jbundle, "windows", real_data->nb_windows);
+            for (i = 0; i < real_data->nb_windows; i++) {
+                snprintf(key, sizeof(key), "window_%d_start_ms", i);
+                J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, key, real_data->windows[i].start_ms);
+                snprintf(key, sizeof(key), "window_%d_avdiff_avg_us", i);
+                J4AC_Bundle__putInt__withCString__catchAll(env, jbundle, key, real_data->windows[i].avdiff_avg_us);
+                snprintf(key, sizeof(key), "window_%d_avdiff_max_us", i);
+                J4AC_Bundle__putInt__withCString__catchAll(env, jbundle, key, real_data->windows[i].avdiff_max_us);
+            }
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "audio_underruns", real_data->audio_underruns);
+            J4AC_Bundle__putLong__withCString__catchAll(env, jbundle, "audio_underrun_us", real_data->audio_underrun_us);
+            J4AC_IjkMediaPlayer__onNativeInvoke(env, weak_thiz, what, jbundle);
+            if (J4A_ExceptionCheck__catchAll(env))
+                goto fail;
+            ret = 0;
+            break;
+        }
         default: {
             ret = 0;
         }
@@ -972,122 +1080,126 @@ inline static void post_event(JNIEnv *env, jobject weak_this, int what, int arg1
     // MPTRACE("post_event()=void");
 }
 
+#define MESSAGE_LOOP_BATCH 32
+
 static void message_loop_n(JNIEnv *env, EMMediaPlayer *mp)
 {
     jobject weak_thiz = (jobject) emmp_get_weak_thiz(mp);
     JNI_CHECK_GOTO(weak_thiz, env, NULL, "mpjni: message_loop_n: null weak_thiz", LABEL_RETURN);
 
     while (1) {
+        AVMessage msgs[MESSAGE_LOOP_BATCH];
         AVMessage msg;
+        int i;
 
-        int retval = emmp_get_msg(mp, &msg, 1);
+        int retval = emmp_get_msgs(mp, msgs, MESSAGE_LOOP_BATCH, -1);
         if (retval < 0)
             break;
 
-        // block-get should never return 0
-        assert(retval > 0);
-
-        switch (msg.what) {
-        case FFP_MSG_FLUSH:
-            MPTRACE("FFP_MSG_FLUSH:\n");
-            post_event(env, weak_thiz, MEDIA_NOP, 0, 0);
-            break;
-        case FFP_MSG_ERROR:
-            MPTRACE("FFP_MSG_ERROR: %d\n", msg.arg1);
-            post_event(env, weak_thiz, MEDIA_ERROR, MEDIA_ERROR_IJK_PLAYER, msg.arg1);
-            break;
-        case FFP_MSG_PREPARED:
-            MPTRACE("FFP_MSG_PREPARED:\n");
-            post_event(env, weak_thiz, MEDIA_PREPARED, 0, 0);
-            break;
-        case FFP_MSG_COMPLETED:
-            MPTRACE("FFP_MSG_COMPLETED:\n");
-            post_event(env, weak_thiz, MEDIA_PLAYBACK_COMPLETE, 0, 0);
-            break;
-        case FFP_MSG_VIDEO_SIZE_CHANGED:
-            MPTRACE("FFP_MSG_VIDEO_SIZE_CHANGED: %d, %d\n", msg.arg1, msg.arg2);
-            post_event(env, weak_thiz, MEDIA_SET_VIDEO_SIZE, msg.arg1, msg.arg2);
-            break;
-        case FFP_MSG_SAR_CHANGED:
-            MPTRACE("FFP_MSG_SAR_CHANGED: %d, %d\n", msg.arg1, msg.arg2);
-            post_event(env, weak_thiz, MEDIA_SET_VIDEO_SAR, msg.arg1, msg.arg2);
-            break;
-        case FFP_MSG_VIDEO_RENDERING_START:
-            MPTRACE("FFP_MSG_VIDEO_RENDERING_START:\n");
-            post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_VIDEO_RENDERING_START, 0);
-            break;
-        case FFP_MSG_VIDEO_DECODE_FIRST_I_FRAME:
-            MPTRACE("FFP_MSG_VIDEO_DECODE_FIRST_I_FRAME;\n");
-            post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_VIDEO_FIRST_I_FRAME_DECODED, 0);
-            break;
-        case FFP_MSG_AUDIO_RENDERING_START:
-            MPTRACE("FFP_MSG_AUDIO_RENDERING_START:\n");
-            post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_AUDIO_RENDERING_START, 0);
-            break;
-        case FFP_MSG_VIDEO_ROTATION_CHANGED:
-            MPTRACE("FFP_MSG_VIDEO_ROTATION_CHANGED: %d\n", msg.arg1);
-            post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_VIDEO_ROTATION_CHANGED, msg.arg1);
-            break;
-        case FFP_MSG_BUFFERING_START:
-            MPTRACE("FFP_MSG_BUFFERING_START:\n");
-            post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_BUFFERING_START, 0);
-            break;
-        case FFP_MSG_BUFFERING_END:
-            MPTRACE("FFP_MSG_BUFFERING_END:\n");
-            post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_BUFFERING_END, 0);
-            break;
-         case FFP_MSG_WARN_RECONNECT:
-             MPTRACE("FFP_MSG_WARN_RECONNECT\n");
-             post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_NETWORK_RECONNECT, 0);
-             break;
-        case FFP_MSG_ERROR_NET_DISCONNECT:
-            MPTRACE("FFP_MSG_ERROR_NET_DISCONNECT\n");
-            //if (emmp_get_reconnect_count(mp) > 0) {
-            //    emmp_restart(mp);
-            //}else {
-            post_event(env, weak_thiz, MEDIA_ERROR, MEDIA_ERROR_NETWORK_DISCONNECT, 0);
-            //}
-            break;
-        case FFP_MSG_BUFFERING_UPDATE:
-            // MPTRACE("FFP_MSG_BUFFERING_UPDATE: %d, %d", msg.arg1, msg.arg2);
-            post_event(env, weak_thiz, MEDIA_BUFFERING_UPDATE, msg.arg1, msg.arg2);
-            break;
-        case FFP_MSG_BUFFERING_BYTES_UPDATE:
-            break;
-        case FFP_MSG_BUFFERING_TIME_UPDATE:
-            break;
-        case FFP_MSG_SEEK_COMPLETE:
-            MPTRACE("FFP_MSG_SEEK_COMPLETE:\n");
-            post_event(env, weak_thiz, MEDIA_SEEK_COMPLETE, 0, 0);
-            break;
-        case FFP_MSG_PLAYBACK_STATE_CHANGED:
-            break;
-        case FFP_MSG_ERROR_UNSUPPORTED_FORMAT:
-            MPTRACE("FFP_MSG_ERROR_UNSUPPORTED_FORMAT");
-            post_event(env, weak_thiz, MEDIA_ERROR_UNSUPPORTED, 0, 0);
-            break;
-        case FFP_MSG_ERROR_CONNECT_FAILD:
-            MPTRACE("FFP_MSG_ERROR_CONNECT_FAILD");
-            post_event(env, weak_thiz, MEDIA_ERROR, MEDIA_ERROR_NETWORK_DISCONNECT, msg.arg1);
-            break;
-        case FFP_MSG_PROGRESS:
-            //MPTRACE("FFP_MSG_PROGRESS");
-            post_event(env, weak_thiz, MEDIA_PLAY_PROGRESS, msg.arg1, msg.arg2);
-            break;
-        case FFP_MSG_STREAM_UNIX_TIME:
-            post_event(env, weak_thiz, MEDIA_PLAY_STREAM_UNIX_TIME, msg.arg1, msg.arg2);
-            break;
-        case FFP_CHANGE_VIDEO_SOURCE_SUCCESS:
-            MPTRACE("FFP_CHANGE_VIDEO_SOURCE_SUCCESS");
-            post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_VIDEO_SOURCE_CHANGED, 0);
-            break;
-        case FFP_MSG_EXIT_READ_THREAD:
-            post_event(env, weak_thiz, MEDIA_EXIT_READ, 0, 0);
-            break;
-
-        default:
-            ALOGE("unknown FFP_MSG_xxx(%d)\n", msg.what);
-            break;
+        for (i = 0; i < retval; i++) {
+            msg = msgs[i];
+            switch (msg.what) {
+            case FFP_MSG_FLUSH:
+                MPTRACE("FFP_MSG_FLUSH:\n");
+                post_event(env, weak_thiz, MEDIA_NOP, 0, 0);
+                break;
+            case FFP_MSG_ERROR:
+                MPTRACE("FFP_MSG_ERROR: %d\n", msg.arg1);
+                post_event(env, weak_thiz, MEDIA_ERROR, MEDIA_ERROR_IJK_PLAYER, msg.arg1);
+                break;
+            case FFP_MSG_PREPARED:
+                MPTRACE("FFP_MSG_PREPARED:\n");
+                post_event(env, weak_thiz, MEDIA_PREPARED, 0, 0);
+                break;
+            case FFP_MSG_COMPLETED:
+                MPTRACE("FFP_MSG_COMPLETED:\n");
+                post_event(env, weak_thiz, MEDIA_PLAYBACK_COMPLETE, 0, 0);
+                break;
+            case FFP_MSG_VIDEO_SIZE_CHANGED:
+                MPTRACE("FFP_MSG_VIDEO_SIZE_CHANGED: %d, %d\n", msg.arg1, msg.arg2);
+                post_event(env, weak_thiz, MEDIA_SET_VIDEO_SIZE, msg.arg1, msg.arg2);
+                break;
+            case FFP_MSG_SAR_CHANGED:
+                MPTRACE("FFP_MSG_SAR_CHANGED: %d, %d\n", msg.arg1, msg.arg2);
+                post_event(env, weak_thiz, MEDIA_SET_VIDEO_SAR, msg.arg1, msg.arg2);
+                break;
+            case FFP_MSG_VIDEO_RENDERING_START:
+                MPTRACE("FFP_MSG_VIDEO_RENDERING_START:\n");
+                post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_VIDEO_RENDERING_START, 0);
+                break;
+            case FFP_MSG_VIDEO_DECODE_FIRST_I_FRAME:
+                MPTRACE("FFP_MSG_VIDEO_DECODE_FIRST_I_FRAME;\n");
+                post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_VIDEO_FIRST_I_FRAME_DECODED, 0);
+                break;
+            case FFP_MSG_AUDIO_RENDERING_START:
+                MPTRACE("FFP_MSG_AUDIO_RENDERING_START:\n");
+                post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_AUDIO_RENDERING_START, 0);
+                break;
+            case FFP_MSG_VIDEO_ROTATION_CHANGED:
+                MPTRACE("FFP_MSG_VIDEO_ROTATION_CHANGED: %d\n", msg.arg1);
+                post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_VIDEO_ROTATION_CHANGED, msg.arg1);
+                break;
+            case FFP_MSG_BUFFERING_START:
+                MPTRACE("FFP_MSG_BUFFERING_START:\n");
+                post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_BUFFERING_START, 0);
+                break;
+            case FFP_MSG_BUFFERING_END:
+                MPTRACE("FFP_MSG_BUFFERING_END:\n");
+                post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_BUFFERING_END, 0);
+                break;
+             case FFP_MSG_WARN_RECONNECT:
+                 MPTRACE("FFP_MSG_WARN_RECONNECT\n");
+                 post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_NETWORK_RECONNECT, 0);
+                 break;
+            case FFP_MSG_ERROR_NET_DISCONNECT:
+                MPTRACE("FFP_MSG_ERROR_NET_DISCONNECT\n");
+                //if (emmp_get_reconnect_count(mp) > 0) {
+                //    emmp_restart(mp);
+                //}else {
+                post_event(env, weak_thiz, MEDIA_ERROR, MEDIA_ERROR_NETWORK_DISCONNECT, 0);
+                //}
+                break;
+            case FFP_MSG_BUFFERING_UPDATE:
+                // MPTRACE("FFP_MSG_BUFFERING_UPDATE: %d, %d", msg.arg1, msg.arg2);
+                post_event(env, weak_thiz, MEDIA_BUFFERING_UPDATE, msg.arg1, msg.arg2);
+                break;
+            case FFP_MSG_BUFFERING_BYTES_UPDATE:
+                break;
+            case FFP_MSG_BUFFERING_TIME_UPDATE:
+                break;
+            case FFP_MSG_SEEK_COMPLETE:
+                MPTRACE("FFP_MSG_SEEK_COMPLETE:\n");
+                post_event(env, weak_thiz, MEDIA_SEEK_COMPLETE, 0, 0);
+                break;
+            case FFP_MSG_PLAYBACK_STATE_CHANGED:
+                break;
+            case FFP_MSG_ERROR_UNSUPPORTED_FORMAT:
+                MPTRACE("FFP_MSG_ERROR_UNSUPPORTED_FORMAT");
+                post_event(env, weak_thiz, MEDIA_ERROR_UNSUPPORTED, 0, 0);
+                break;
+            case FFP_MSG_ERROR_CONNECT_FAILD:
+                MPTRACE("FFP_MSG_ERROR_CONNECT_FAILD");
+                post_event(env, weak_thiz, MEDIA_ERROR, MEDIA_ERROR_NETWORK_DISCONNECT, msg.arg1);
+                break;
+            case FFP_MSG_PROGRESS:
+                //MPTRACE("FFP_MSG_PROGRESS");
+                post_event(env, weak_thiz, MEDIA_PLAY_PROGRESS, msg.arg1, msg.arg2);
+                break;
+            case FFP_MSG_STREAM_UNIX_TIME:
+                post_event(env, weak_thiz, MEDIA_PLAY_STREAM_UNIX_TIME, msg.arg1, msg.arg2);
+                break;
+            case FFP_CHANGE_VIDEO_SOURCE_SUCCESS:
+                MPTRACE("FFP_CHANGE_VIDEO_SOURCE_SUCCESS");
+                post_event(env, weak_thiz, MEDIA_INFO, MEDIA_INFO_VIDEO_SOURCE_CHANGED, 0);
+                break;
+            case FFP_MSG_EXIT_READ_THREAD:
+                post_event(env, weak_thiz, MEDIA_EXIT_READ, 0, 0);
+                break;
+
+            default:
+                ALOGE("unknown FFP_MSG_xxx(%d)\n", msg.what);
+                break;
+            }
         }
     }
 
@@ -1191,6 +1303,150 @@ IjkMediaPlayer_native_setLogLevel(JNIEnv *env, jclass clazz, jint level)
     ALOGD("moncleanup\n");
 }
 
+static void
+IjkMediaPlayer_native_setMemoryBudget(JNIEnv *env, jclass clazz, jlong bytes)
+{
+    MPTRACE("%s(%lld)\n", __func__, (long long)bytes);
+    emmp_global_set_memory_budget(bytes);
+}
+
+static void
+IjkMediaPlayer_native_setNetworkType(JNIEnv *env, jclass clazz, jint type)
+{
+    MPTRACE("%s(%d)\n", __func__, type);
+    emmp_global_set_network_type(type);
+}
+
+static jlong
+IjkMediaPlayer_native_getThroughputEstimate(JNIEnv *env, jclass clazz, jstring url, jint percentile)
+{
+    IjkThroughputEstimate estimate;
+    const char *c_url = NULL;
+    int ret;
+
+    if (url)
+        c_url = (*env)->GetStringUTFChars(env, url, NULL);
+    ret = emmp_global_get_throughput_estimate(c_url, &estimate);
+    if (c_url)
+        (*env)->ReleaseStringUTFChars(env, url, c_url);
+    if (ret < 0)
+        return -1;
+
+    switch (percentile) {
+        case 10: return estimate.p10;
+        case 50: return estimate.p50;
+        case 90: return estimate.p90;
+        default: return estimate.ewma;
+    }
+}
+
+static jint
+IjkMediaPlayer_native_loadThroughput(JNIEnv *env, jclass clazz, jstring path)
+{
+    const char *c_path;
+    jint ret;
+
+    if (!path)
+        return -1;
+    c_path = (*env)->GetStringUTFChars(env, path, NULL);
+    ret = emmp_global_load_throughput(c_path);
+    (*env)->ReleaseStringUTFChars(env, path, c_path);
+    return ret;
+}
+
+static jint
+IjkMediaPlayer_native_saveThroughput(JNIEnv *env, jclass clazz, jstring path)
+{
+    const char *c_path;
+    jint ret;
+
+    if (!path)
+        return -1;
+    c_path = (*env)->GetStringUTFChars(env, path, NULL);
+    ret = emmp_global_save_throughput(c_path);
+    (*env)->ReleaseStringUTFChars(env, path, c_path);
+    return ret;
+}
+
+static jint
+IjkMediaPlayer_native_startTrace(JNIEnv *env, jclass clazz)
+{
+    MPTRACE("%s\n", __func__);
+    return emmp_global_start_trace();
+}
+
+static void
+IjkMediaPlayer_native_stopTrace(JNIEnv *env, jclass clazz)
+{
+    MPTRACE("%s\n", __func__);
+    emmp_global_stop_trace();
+}
+
+static jint
+IjkMediaPlayer_native_dumpTrace(JNIEnv *env, jclass clazz, jstring path)
+{
+    const char *c_path;
+    jint ret;
+
+    if (!path)
+        return -1;
+    c_path = (*env)->GetStringUTFChars(env, path, NULL);
+    ret = emmp_global_dump_trace(c_path);
+    (*env)->ReleaseStringUTFChars(env, path, c_path);
+    return ret;
+}
+
+static jlong
+IjkMediaPlayer_native_createThumbnailer(JNIEnv *env, jclass clazz, jstring url, jint count, jint width, jint height, jint columns)
+{
+    IjkThumbnailParams params = jni_thumbnail_params(count, width, height, columns);
+    IjkThumbnailer *thumbnailer;
+    const char *c_url;
+
+    if (!url)
+        return 0;
+    c_url = (*env)->GetStringUTFChars(env, url, NULL);
+    thumbnailer = ijk_thumbnailer_create(c_url, NULL, &params);
+    (*env)->ReleaseStringUTFChars(env, url, c_url);
+    return (jlong)(intptr_t)thumbnailer;
+}
+
+/* runs the thumbnailer and returns its sprite sheet as ARGB_8888 pixels */
+static jintArray
+IjkMediaPlayer_native_runThumbnailer(JNIEnv *env, jclass clazz, jlong handle)
+{
+    IjkThumbnailer *thumbnailer = (IjkThumbnailer *)(intptr_t)handle;
+    const uint8_t *sprite;
+    jintArray pixels = NULL;
+    int width, height;
+
+    if (ijk_thumbnailer_run(thumbnailer, NULL, NULL) <= 0)
+        return NULL;
+    sprite = ijk_thumbnailer_get_sprite(thumbnailer, &width, &height, NULL);
+    if (!sprite)
+        return NULL;
+
+    pixels = (*env)->NewIntArray(env, width * height);
+    if (!pixels || J4A_ExceptionCheck__catchAll(env))
+        return NULL;
+    (*env)->SetIntArrayRegion(env, pixels, 0, width * height, (const jint *)sprite);
+    return pixels;
+}
+
+static void
+IjkMediaPlayer_native_abortThumbnailer(JNIEnv *env, jclass clazz, jlong handle)
+{
+    ijk_thumbnailer_abort((IjkThumbnailer *)(intptr_t)handle);
+}
+
+static void
+IjkMediaPlayer_native_releaseThumbnailer(JNIEnv *env, jclass clazz, jlong handle)
+{
+    IjkThumbnailer *thumbnailer = (IjkThumbnailer *)(intptr_t)handle;
+
+    ijk_thumbnailer_destroy(&thumbnailer);
+}
+
 static void
 IjkMediaPlayer_native_setPlaybackRate(JNIEnv *env, jclass thiz, jfloat rate)
 {
@@ -1268,6 +1524,8 @@ static JNINativeMethod g_methods[] = {
     { "_start",                 "()V",      (void *) IjkMediaPlayer_start },
     { "_stop",                  "()V",      (void *) IjkMediaPlayer_stop },
     { "seekTo",                 "(J)V",     (void *) IjkMediaPlayer_seekTo },
+    { "timeshiftGoLive",        "()I",      (void *) IjkMediaPlayer_timeshiftGoLive },
+    { "detachSharedSource",     "()I",      (void *) IjkMediaPlayer_detachSharedSource },
     { "_pause",                 "()V",      (void *) IjkMediaPlayer_pause },
     { "isPlaying",              "()Z",      (void *) IjkMediaPlayer_isPlaying },
     {"_set_record_status",      "(I)V",     (void *) IjkMediaPlayer_set_record_status},
@@ -1293,6 +1551,7 @@ static JNINativeMethod g_methods[] = {
     { "_getPropertyFloat",      "(IF)F",                    (void *) ijkMediaPlayer_getPropertyFloat },
     { "_setPropertyFloat",      "(IF)V",                    (void *) ijkMediaPlayer_setPropertyFloat },
     { "_getPropertyLong",       "(IJ)J",                    (void *) ijkMediaPlayer_getPropertyLong },
+    { "_createThumbnailer",     "(IIII)J",                  (void *) IjkMediaPlayer_createThumbnailer },
     { "_setPropertyLong",       "(IJ)V",                    (void *) ijkMediaPlayer_setPropertyLong },
     { "_setStreamSelected",     "(IZ)V",                    (void *) ijkMediaPlayer_setStreamSelected },
 
@@ -1300,6 +1559,18 @@ static JNINativeMethod g_methods[] = {
     { "native_profileEnd",      "()V",                      (void *) IjkMediaPlayer_native_profileEnd },
 
     { "native_setLogLevel",     "(I)V",                     (void *) IjkMediaPlayer_native_setLogLevel },
+    { "native_setMemoryBudget", "(J)V",                     (void *) IjkMediaPlayer_native_setMemoryBudget },
+    { "native_setNetworkType",  "(I)V",                     (void *) IjkMediaPlayer_native_setNetworkType },
+    { "native_getThroughputEstimate", "(Ljava/lang/String;I)J", (void *) IjkMediaPlayer_native_getThroughputEstimate },
+    { "native_loadThroughput",  "(Ljava/lang/String;)I",    (void *) IjkMediaPlayer_native_loadThroughput },
+    { "native_saveThroughput",  "(Ljava/lang/String;)I",    (void *) IjkMediaPlayer_native_saveThroughput },
+    { "native_startTrace",      "()I",                      (void *) IjkMediaPlayer_native_startTrace },
+    { "native_stopTrace",       "()V",                      (void *) IjkMediaPlayer_native_stopTrace },
+    { "native_dumpTrace",       "(Ljava/lang/String;)I",    (void *) IjkMediaPlayer_native_dumpTrace },
+    { "native_createThumbnailer", "(Ljava/lang/String;IIII)J", (void *) IjkMediaPlayer_native_createThumbnailer },
+    { "native_runThumbnailer",  "(J)[I",                    (void *) IjkMediaPlayer_native_runThumbnailer },
+    { "native_abortThumbnailer", "(J)V",                    (void *) IjkMediaPlayer_native_abortThumbnailer },
+    { "native_releaseThumbnailer", "(J)V",                  (void *) IjkMediaPlayer_native_releaseThumbnailer },
     { "_setPlaybackRate",       "(F)V",                     (void *) IjkMediaPlayer_native_setPlaybackRate },
     { "_changeVideoSource",     "(Ljava/lang/String;I)I",    (void *) IjkMediaPlayer_changeVideoSource},
     { "_changeMultiVideoSource",     "(Ljava/lang/String;I)I",(void *) IjkMediaPlayer_changeMultiVideoSource},
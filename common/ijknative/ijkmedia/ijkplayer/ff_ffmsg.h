@@ -90,4 +90,56 @@
 #define FFP_PROP_INT64_ASYNC_STATISTIC_BUF_CAPACITY     20203
 
 #define FFP_PROP_INT64_LATEST_SEEK_LOAD_DURATION               20300
+#define FFP_PROP_INT64_STREAM_INFO_DURATION                    20301
+#define FFP_PROP_INT64_FIRST_FRAME_DURATION                    20302
+
+#define FFP_PROP_INT64_TIMESHIFT_START                         20400
+#define FFP_PROP_INT64_TIMESHIFT_END                           20401
+#define FFP_PROP_INT64_TIMESHIFT_SEEK_LATENCY                  20402
+#define FFP_PROP_INT64_TIMESHIFT_BYTES_WRITTEN                 20403
+#define FFP_PROP_INT64_TIMESHIFT_WRITE_COUNT                   20404
+
+#define FFP_PROP_INT64_VISIBLE                                 20500
+#define FFP_PROP_INT64_MEMORY_USAGE                            20501
+#define FFP_PROP_INT64_MEMORY_QUOTA                            20502
+#define FFP_PROP_INT64_MEMORY_TOTAL_USAGE                      20503
+
+#define FFP_PROP_INT64_OVERLAY_POOL_HIT_RATE                   20600
+#define FFP_PROP_INT64_OVERLAY_POOL_AVOIDED_ALLOC_US           20601
+#define FFP_PROP_INT64_OVERLAY_POOL_CACHED_BYTES               20602
+
+#define FFP_PROP_INT64_HTTP_POOL_REUSED_COUNT                   20700
+#define FFP_PROP_INT64_HTTP_POOL_FRESH_COUNT                    20701
+#define FFP_PROP_INT64_HTTP_POOL_IDLE_COUNT                     20702
+
+#define FFP_PROP_INT64_TLS_HANDSHAKE_COUNT                      20800
+#define FFP_PROP_INT64_TLS_HANDSHAKE_AVG_US                     20801
+#define FFP_PROP_INT64_TLS_RESUMPTION_RATE                      20802
+
+#define FFP_PROP_INT64_THROUGHPUT_ESTIMATE                      20900
+#define FFP_PROP_INT64_THROUGHPUT_P10                           20901
+#define FFP_PROP_INT64_THROUGHPUT_P90                           20902
+
+#define FFP_PROP_INT64_DECODE_SHED_LEVEL                        21000
+#define FFP_PROP_INT64_DECODE_SHED_DROPPED                      21001
+#define FFP_PROP_INT64_DECODE_SHED_SAVED_MS                     21002
+
+#define FFP_PROP_INT64_SHARED_SOURCE_ROLE                       21100
+#define FFP_PROP_INT64_SHARED_SOURCE_SUBSCRIBERS                21101
+#define FFP_PROP_INT64_SHARED_SOURCE_PUBLISHED_FRAMES           21102
+#define FFP_PROP_INT64_SHARED_SOURCE_DROPPED_FRAMES             21103
+
+#define FFP_PROP_INT64_AUDIO_ONLY                               21200
+
+/* microseconds unless counted, see IjkPacingSnapshot */
+#define FFP_PROP_INT64_PACING_FRAMES                            21300
+#define FFP_PROP_INT64_PACING_ERROR_AVG                         21301
+#define FFP_PROP_INT64_PACING_ERROR_MAX                         21302
+#define FFP_PROP_INT64_PACING_INTERVAL_JITTER                   21303
+#define FFP_PROP_INT64_PACING_SKIPPED_FRAMES                    21304
+#define FFP_PROP_INT64_PACING_REPEATED_FRAMES                   21305
+#define FFP_PROP_INT64_PACING_AVDIFF_AVG                        21306
+#define FFP_PROP_INT64_PACING_AVDIFF_MAX                        21307
+#define FFP_PROP_INT64_PACING_AUDIO_UNDERRUNS                   21308
+#define FFP_PROP_INT64_PACING_AUDIO_UNDERRUN_DURATION           21309
 #endif
@@ -27,85 +27,195 @@
 #include "ff_ffinc.h"
 #include "ff_ffmsg.h"
 
-// #define FFP_SHOW_MSG_RECYCLE
+/*
+ * Producers (read_thread, decoders, the audio callback) do not lock: a slot
+ * is claimed with a CAS on head and published through its sequence number,
+ * and a sleeping consumer is woken by posting a semaphore. Only the consumer
+ * side (get/flush/remove) takes the mutex, and the consumer does not hold it
+ * while it sleeps. When the ring is full, messages go to an overflow list
+ * under the mutex, read after the ring, so none is lost.
+ *
+ * Idempotent messages (progress, buffering, size) are coalesced: at most one
+ * of each is queued, in the ring or the overflow list, and it carries the
+ * latest arguments when it is read.
+ */
+
+// #define FFP_SHOW_MSG_STAT
+
+#define MSG_QUEUE_SIZE          1024    /* power of two */
+#define MSG_COALESCE_NB         6
+#define MSG_COALESCE_CELLS      4       /* power of two */
+#define FFP_MSG_REMOVED         (-1)
 
 typedef struct AVMessage {
     int what;
     int arg1;
     int arg2;
-    struct AVMessage *next;
 } AVMessage;
 
+typedef struct AVMessageSlot {
+    unsigned int seq;
+    AVMessage msg;
+} AVMessageSlot;
+
+typedef struct AVMessageCell {
+    int arg1;
+    int arg2;
+} AVMessageCell;
+
+typedef struct AVMessageNode {
+    AVMessage msg;
+    struct AVMessageNode *next;
+} AVMessageNode;
+
 typedef struct MessageQueue {
-    AVMessage *first_msg, *last_msg;
-    int nb_messages;
+    AVMessageSlot *slots;
+    unsigned int head;          // next slot to claim, shared by producers
+    unsigned int tail;          // next slot to read, consumer side only
     int abort_request;
+    int waiting;                // consumer is about to sleep on sem
     SDL_mutex *mutex;
-    SDL_cond *cond;
-    int64_t last_progress;
-    AVMessage *recycle_msg;
-    int recycle_count;
-    int alloc_count;
+    SDL_sem *sem;
+    int last_progress;
+
+    int coalesce_pending[MSG_COALESCE_NB];
+    unsigned int coalesce_seq[MSG_COALESCE_NB];
+    unsigned int coalesce_latest[MSG_COALESCE_NB];
+    AVMessageCell coalesce_cells[MSG_COALESCE_NB][MSG_COALESCE_CELLS];
+
+    AVMessageNode *overflow_first;  // under mutex
+    AVMessageNode *overflow_last;
+    int overflow_count;
+
+    int put_count;
+    int coalesce_count;
+    int drop_count;
 } MessageQueue;
 
+inline static int msg_coalesce_index(int what)
+{
+    switch (what) {
+    case FFP_MSG_PROGRESS:                  return 0;
+    case FFP_MSG_BUFFERING_UPDATE:          return 1;
+    case FFP_MSG_BUFFERING_BYTES_UPDATE:    return 2;
+    case FFP_MSG_BUFFERING_TIME_UPDATE:     return 3;
+    case FFP_MSG_VIDEO_SIZE_CHANGED:        return 4;
+    case FFP_MSG_SAR_CHANGED:               return 5;
+    default:                                return -1;
+    }
+}
+
+/*
+ * The consumer publishes 'waiting' before its last look at the queue, so a
+ * producer either sees it or its message is seen. Only the producer which
+ * clears it posts, a post left over after a timeout costs one empty loop.
+ */
+inline static void msg_queue_wakeup(MessageQueue *q)
+{
+    if (__atomic_exchange_n(&q->waiting, 0, __ATOMIC_SEQ_CST))
+        SDL_SemPost(q->sem);
+}
+
+inline static int msg_queue_put_overflow(MessageQueue *q, AVMessage *msg)
+{
+    AVMessageNode *node = av_em_mallocz(sizeof(AVMessageNode));
+
+    if (!node) {
+        __atomic_add_fetch(&q->drop_count, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    node->msg = *msg;
+
+    SDL_LockMutex(q->mutex);
+    if (q->overflow_last)
+        q->overflow_last->next = node;
+    else
+        q->overflow_first = node;
+    q->overflow_last = node;
+    __atomic_add_fetch(&q->overflow_count, 1, __ATOMIC_SEQ_CST);
+    SDL_UnlockMutex(q->mutex);
+
+    msg_queue_wakeup(q);
+    return 0;
+}
+
 inline static int msg_queue_put_private(MessageQueue *q, AVMessage *msg)
 {
-    AVMessage *msg1;
+    AVMessageSlot *slot;
+    unsigned int pos;
+    int dif;
 
-    if (q->abort_request)
+    if (__atomic_load_n(&q->abort_request, __ATOMIC_ACQUIRE) || !q->slots)
         return -1;
 
-#ifdef FFP_MERGE
-    msg1 = av_em_alloc(sizeof(AVMessage));
-#else
-    msg1 = q->recycle_msg;
-    if (msg1) {
-        q->recycle_msg = msg1->next;
-        q->recycle_count++;
-    } else {
-        q->alloc_count++;
-        msg1 = av_em_alloc(sizeof(AVMessage));
-    }
-#ifdef FFP_SHOW_MSG_RECYCLE
-    int total_count = q->recycle_count + q->alloc_count;
-    if (!(total_count % 10)) {
-        av_em_log(NULL, AV_LOG_DEBUG, "msg-recycle \t%d + \t%d = \t%d\n", q->recycle_count, q->alloc_count, total_count);
+    /* once messages overflowed, later ones queue behind them */
+    if (__atomic_load_n(&q->overflow_count, __ATOMIC_SEQ_CST) > 0)
+        goto overflow;
+
+    pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    for (;;) {
+        slot = &q->slots[pos & (MSG_QUEUE_SIZE - 1)];
+        dif  = (int)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (dif < 0) {
+            goto overflow;
+        } else {
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        }
     }
-#endif
-#endif
-    if (!msg1)
-        return -1;
 
-    *msg1 = *msg;
-    msg1->next = NULL;
+    slot->msg = *msg;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&q->put_count, 1, __ATOMIC_RELAXED);
 
-    if (!q->last_msg)
-        q->first_msg = msg1;
-    else
-        q->last_msg->next = msg1;
-    q->last_msg = msg1;
-    q->nb_messages++;
-    SDL_CondSignal(q->cond);
+    msg_queue_wakeup(q);
     return 0;
+
+overflow:
+    return msg_queue_put_overflow(q, msg);
 }
 
-inline static int msg_queue_put(MessageQueue *q, AVMessage *msg)
+inline static int msg_queue_put_coalesce(MessageQueue *q, int index, AVMessage *msg)
 {
+    AVMessageCell *cell;
+    unsigned int seq;
     int ret;
 
-    SDL_LockMutex(q->mutex);
+    seq  = __atomic_add_fetch(&q->coalesce_seq[index], 1, __ATOMIC_RELAXED);
+    cell = &q->coalesce_cells[index][seq & (MSG_COALESCE_CELLS - 1)];
+    cell->arg1 = msg->arg1;
+    cell->arg2 = msg->arg2;
+    __atomic_store_n(&q->coalesce_latest[index], seq, __ATOMIC_SEQ_CST);
+
+    if (__atomic_exchange_n(&q->coalesce_pending[index], 1, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&q->coalesce_count, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    ret = msg_queue_put_private(q, msg);
+    if (ret < 0)
+        __atomic_store_n(&q->coalesce_pending[index], 0, __ATOMIC_SEQ_CST);
+    return ret;
+}
+
+inline static int msg_queue_put(MessageQueue *q, AVMessage *msg)
+{
+    int index;
+
     if (msg->what == FFP_MSG_PROGRESS) {
-        int64_t last_diff = msg->arg1 - q->last_progress;
-        if (llabs(last_diff) < 50 || last_diff < 0 && last_diff > -100) {
-            SDL_UnlockMutex(q->mutex);
+        int last_diff = msg->arg1 - __atomic_load_n(&q->last_progress, __ATOMIC_RELAXED);
+        if (abs(last_diff) < 50 || (last_diff < 0 && last_diff > -100))
             return 0;
-        }
+        __atomic_store_n(&q->last_progress, msg->arg1, __ATOMIC_RELAXED);
     }
-    ret = msg_queue_put_private(q, msg);
-    q->last_progress = msg->arg1;
-    SDL_UnlockMutex(q->mutex);
 
-    return ret;
+    index = msg_coalesce_index(msg->what);
+    if (index >= 0)
+        return msg_queue_put_coalesce(q, index, msg);
+
+    return msg_queue_put_private(q, msg);
 }
 
 inline static void msg_init_msg(AVMessage *msg)
@@ -142,29 +252,70 @@ inline static void msg_queue_put_simple3(MessageQueue *q, int what, int arg1, in
 
 inline static void msg_queue_init(MessageQueue *q)
 {
+    unsigned int i;
+
     memset(q, 0, sizeof(MessageQueue));
+    q->slots = av_em_mallocz_array(MSG_QUEUE_SIZE, sizeof(AVMessageSlot));
+    if (q->slots) {
+        for (i = 0; i < MSG_QUEUE_SIZE; i++)
+            q->slots[i].seq = i;
+    }
     q->mutex = SDL_CreateMutex();
-    q->cond = SDL_CreateCond();
+    q->sem = SDL_CreateSemaphore(0);
     q->abort_request = 1;
 }
 
+/* consumer side, q->mutex held; returns 1 for a message, 0 if empty */
+inline static int msg_queue_pop_l(MessageQueue *q, AVMessage *msg)
+{
+    AVMessageSlot *slot;
+    AVMessageCell *cell;
+    unsigned int pos;
+    int index;
+
+    if (!q->slots)
+        return 0;
+
+    for (;;) {
+        pos  = q->tail;
+        slot = &q->slots[pos & (MSG_QUEUE_SIZE - 1)];
+        if ((int)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1)) < 0) {
+            AVMessageNode *node = q->overflow_first;
+            if (!node)
+                return 0;
+            *msg = node->msg;
+            q->overflow_first = node->next;
+            if (!q->overflow_first)
+                q->overflow_last = NULL;
+            av_em_free(node);
+            __atomic_sub_fetch(&q->overflow_count, 1, __ATOMIC_SEQ_CST);
+        } else {
+            *msg = slot->msg;
+            __atomic_store_n(&slot->seq, pos + MSG_QUEUE_SIZE, __ATOMIC_RELEASE);
+            q->tail = pos + 1;
+        }
+
+        if (msg->what == FFP_MSG_REMOVED)
+            continue;
+
+        index = msg_coalesce_index(msg->what);
+        if (index >= 0) {
+            __atomic_store_n(&q->coalesce_pending[index], 0, __ATOMIC_SEQ_CST);
+            cell = &q->coalesce_cells[index][__atomic_load_n(&q->coalesce_latest[index], __ATOMIC_SEQ_CST) & (MSG_COALESCE_CELLS - 1)];
+            msg->arg1 = cell->arg1;
+            msg->arg2 = cell->arg2;
+        }
+        return 1;
+    }
+}
+
 inline static void msg_queue_flush(MessageQueue *q)
 {
-    AVMessage *msg, *msg1;
+    AVMessage msg;
 
     SDL_LockMutex(q->mutex);
-    for (msg = q->first_msg; msg != NULL; msg = msg1) {
-        msg1 = msg->next;
-#ifdef FFP_MERGE
-        av_em_freep(&msg);
-#else
-        msg->next = q->recycle_msg;
-        q->recycle_msg = msg;
-#endif
-    }
-    q->last_msg = NULL;
-    q->first_msg = NULL;
-    q->nb_messages = 0;
+    while (msg_queue_pop_l(q, &msg))
+        ;
     SDL_UnlockMutex(q->mutex);
 }
 
@@ -172,114 +323,129 @@ inline static void msg_queue_destroy(MessageQueue *q)
 {
     msg_queue_flush(q);
 
-    SDL_LockMutex(q->mutex);
-    while(q->recycle_msg) {
-        AVMessage *msg = q->recycle_msg;
-        if (msg)
-            q->recycle_msg = msg->next;
-        av_em_freep(&msg);
-    }
-    SDL_UnlockMutex(q->mutex);
+#ifdef FFP_SHOW_MSG_STAT
+    av_em_log(NULL, AV_LOG_DEBUG, "msg-stat put:%d coalesced:%d dropped:%d\n", q->put_count, q->coalesce_count, q->drop_count);
+#endif
 
+    av_em_freep(&q->slots);
     SDL_DestroyMutex(q->mutex);
-    SDL_DestroyCond(q->cond);
+    SDL_DestroySemaphore(q->sem);
 }
 
 inline static void msg_queue_abort(MessageQueue *q)
 {
     SDL_LockMutex(q->mutex);
 
-    q->abort_request = 1;
-
-    SDL_CondSignal(q->cond);
+    __atomic_store_n(&q->abort_request, 1, __ATOMIC_SEQ_CST);
 
     SDL_UnlockMutex(q->mutex);
+
+    msg_queue_wakeup(q);
 }
 
 inline static void msg_queue_start(MessageQueue *q)
 {
+    AVMessage msg;
+
     SDL_LockMutex(q->mutex);
-    q->abort_request = 0;
+    __atomic_store_n(&q->abort_request, 0, __ATOMIC_RELEASE);
+    SDL_UnlockMutex(q->mutex);
 
-    AVMessage msg;
     msg_init_msg(&msg);
     msg.what = FFP_MSG_FLUSH;
     msg_queue_put_private(q, &msg);
-    SDL_UnlockMutex(q->mutex);
 }
 
-/* return < 0 if aborted, 0 if no msg and > 0 if msg.  */
-inline static int msg_queue_get(MessageQueue *q, AVMessage *msg, int block)
+/*
+ * timeout_ms < 0 waits forever, 0 polls.
+ * return < 0 if aborted, 0 if no msg and > 0 if msg.
+ */
+inline static int msg_queue_get_timeout(MessageQueue *q, AVMessage *msg, int timeout_ms)
 {
-    AVMessage *msg1;
+    int64_t deadline = timeout_ms > 0 ? SDL_GetTickHR() + timeout_ms : 0;
+    int64_t wait_ms = 0;
     int ret;
 
     SDL_LockMutex(q->mutex);
 
     for (;;) {
-        if (q->abort_request) {
+        if (__atomic_load_n(&q->abort_request, __ATOMIC_ACQUIRE)) {
             ret = -1;
             break;
         }
 
-        msg1 = q->first_msg;
-        if (msg1) {
-            q->first_msg = msg1->next;
-            if (!q->first_msg)
-                q->last_msg = NULL;
-            q->nb_messages--;
-            *msg = *msg1;
-#ifdef FFP_MERGE
-            av_em_free(msg1);
-#else
-            msg1->next = q->recycle_msg;
-            q->recycle_msg = msg1;
-#endif
+        if (msg_queue_pop_l(q, msg)) {
             ret = 1;
             break;
-        } else if (!block) {
+        }
+
+        if (timeout_ms == 0) {
             ret = 0;
             break;
-        } else {
-            SDL_CondWait(q->cond, q->mutex);
+        } else if (timeout_ms > 0) {
+            wait_ms = deadline - (int64_t)SDL_GetTickHR();
+            if (wait_ms <= 0) {
+                ret = 0;
+                break;
+            }
+        }
+
+        /* publish 'waiting' before the last look, a producer either sees it or we see its message */
+        __atomic_store_n(&q->waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&q->abort_request, __ATOMIC_SEQ_CST)) {
+            __atomic_store_n(&q->waiting, 0, __ATOMIC_SEQ_CST);
+            ret = -1;
+            break;
+        }
+        if (msg_queue_pop_l(q, msg)) {
+            __atomic_store_n(&q->waiting, 0, __ATOMIC_SEQ_CST);
+            ret = 1;
+            break;
         }
+        SDL_UnlockMutex(q->mutex);
+        if (timeout_ms < 0)
+            SDL_SemWait(q->sem);
+        else
+            SDL_SemWaitTimeout(q->sem, (uint32_t)wait_ms);
+        SDL_LockMutex(q->mutex);
+        __atomic_store_n(&q->waiting, 0, __ATOMIC_SEQ_CST);
     }
     SDL_UnlockMutex(q->mutex);
     return ret;
 }
 
-inline static void msg_queue_remove(MessageQueue *q, int what)
+/* return < 0 if aborted, 0 if no msg and > 0 if msg.  */
+inline static int msg_queue_get(MessageQueue *q, AVMessage *msg, int block)
 {
-    AVMessage **p_msg, *msg, *last_msg;
-    SDL_LockMutex(q->mutex);
+    return msg_queue_get_timeout(q, msg, block ? -1 : 0);
+}
 
-    last_msg = q->first_msg;
+/* messages still being published by a producer are not removed */
+inline static void msg_queue_remove(MessageQueue *q, int what)
+{
+    AVMessageNode *node;
+    AVMessageSlot *slot;
+    unsigned int pos;
+    int index;
 
-    if (!q->abort_request && q->first_msg) {
-        p_msg = &q->first_msg;
-        while (*p_msg) {
-            msg = *p_msg;
+    SDL_LockMutex(q->mutex);
 
-            if (msg->what == what) {
-                *p_msg = msg->next;
-#ifdef FFP_MERGE
-                av_em_free(msg);
-#else
-                msg->next = q->recycle_msg;
-                q->recycle_msg = msg;
-#endif
-                q->nb_messages--;
-            } else {
-                last_msg = msg;
-                p_msg = &msg->next;
-            }
+    if (!__atomic_load_n(&q->abort_request, __ATOMIC_ACQUIRE) && q->slots) {
+        for (pos = q->tail;; pos++) {
+            slot = &q->slots[pos & (MSG_QUEUE_SIZE - 1)];
+            if ((int)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1)) < 0)
+                break;
+            if (slot->msg.what == what)
+                slot->msg.what = FFP_MSG_REMOVED;
         }
-
-        if (q->first_msg) {
-            q->last_msg = last_msg;
-        } else {
-            q->last_msg = NULL;
+        for (node = q->overflow_first; node; node = node->next) {
+            if (node->msg.what == what)
+                node->msg.what = FFP_MSG_REMOVED;
         }
+
+        index = msg_coalesce_index(what);
+        if (index >= 0)
+            __atomic_store_n(&q->coalesce_pending[index], 0, __ATOMIC_SEQ_CST);
     }
 
     SDL_UnlockMutex(q->mutex);
@@ -67,6 +67,7 @@
 #include "ff_fferror.h"
 #include "ff_ffpipeline.h"
 #include "ff_ffpipenode.h"
+#include "pipeline/ffpipenode_ffplay_vdec.h"
 #include "ff_ffplay_debug.h"
 #include "ffplay_format_def.h"
 #include "version.h"
@@ -133,6 +134,8 @@ static void free_picture(Frame *vp);
 
 static void toggle_pause(FFPlayer *ffp, int pause_on);
 
+static void pacing_report(FFPlayer *ffp);
+
 static int packet_queue_put_private(PacketQueue *q, AVEMPacket *pkt)
 {
     MyAVPacketList *pkt1;
@@ -194,6 +197,7 @@ static int packet_queue_put(PacketQueue *q, AVEMPacket *pkt)
 
     SDL_LockMutex(q->mutex);
     ret = packet_queue_put_private(q, pkt);
+    IJK_TRACE_COUNTER(q->trace_name, q->nb_packets);
     SDL_UnlockMutex(q->mutex);
 
     if (pkt != &flush_pkt && ret < 0)
@@ -270,6 +274,22 @@ static void packet_queue_destroy(PacketQueue *q)
     SDL_DestroyCond(q->cond);
 }
 
+/* give recycled nodes beyond 'keep' back to the allocator */
+static void packet_queue_trim_recycle(PacketQueue *q, int keep)
+{
+    MyAVPacketList **p_pkt, *pkt;
+
+    SDL_LockMutex(q->mutex);
+    for (p_pkt = &q->recycle_pkt; *p_pkt && keep > 0; p_pkt = &(*p_pkt)->next)
+        keep--;
+    while (*p_pkt) {
+        pkt = *p_pkt;
+        *p_pkt = pkt->next;
+        av_em_freep(&pkt);
+    }
+    SDL_UnlockMutex(q->mutex);
+}
+
 static void packet_queue_abort(PacketQueue *q)
 {
     SDL_LockMutex(q->mutex);
@@ -312,6 +332,7 @@ static int packet_queue_get(PacketQueue *q, AVEMPacket *pkt, int block, int *ser
             q->nb_packets--;
             q->size -= pkt1->pkt.size + sizeof(*pkt1);
             q->duration -= pkt1->pkt.duration;
+            IJK_TRACE_COUNTER(q->trace_name, q->nb_packets);
             *pkt = pkt1->pkt;
             if (serial)
                 *serial = pkt1->serial;
@@ -327,7 +348,9 @@ static int packet_queue_get(PacketQueue *q, AVEMPacket *pkt, int block, int *ser
             ret = 0;
             break;
         } else {
+            IJK_TRACE_BEGIN("packet_queue_wait");
             SDL_CondWait(q->cond, q->mutex);
+            IJK_TRACE_END("packet_queue_wait");
         }
     }
     SDL_UnlockMutex(q->mutex);
@@ -347,6 +370,8 @@ static int packet_queue_get_or_buffering(FFPlayer *ffp, PacketQueue *q, AVEMPack
             return -1;
         else if (new_packet == 0) {
             if (q->is_buffer_indicator && !*finished) {
+                if (!ffp->is->buffering_on)
+                    ijk_bufpolicy_on_stall(ffp->buf_policy, ijk_get_timems());
                 ffp_toggle_buffering(ffp, 1);
             }
             new_packet = packet_queue_get(q, pkt, 1, serial);
@@ -382,6 +407,7 @@ static void decoder_init(Decoder *d, AVEMCodecContext *avctx, PacketQueue *queue
     d->first_frame_decoded_time = SDL_GetTickHR();
     d->first_frame_decoded = 0;
     d->clear_picture_flushed = 0;
+    d->shared_time = NAN;
     SDL_ProfilerReset(&d->decode_profiler, -1);
 }
 
@@ -403,7 +429,7 @@ int64_t check_tx_stream_unix_time(uint8_t *buffer) {
     return ret;
 }
 
-static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSubtitle *sub) {
+static int decoder_decode_packets(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSubtitle *sub) {
     int got_frame = 0;
     do {
         int ret = -1;
@@ -431,16 +457,29 @@ static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSub
                         ffp_frame_queue_empty(&ffp->is->pictq);
                         d->clear_picture_flushed = 0;
                     }
+                    if (ffp->shared_role == FFP_SHARED_PUBLISHER)
+                        ijk_shared_source_flush(ffp->shared_src, d->avctx->codec_type);
                 }
             } while (pkt.data == flush_pkt.data || d->queue->serial != d->pkt_serial);
             av_em_packet_unref(&d->pkt);
             d->pkt_temp = d->pkt = pkt;
             d->packet_pending = 1;
+            if (d->avctx->codec_type == AVMEDIA_TYPE_VIDEO && ffp->is->decshed &&
+                ijk_decshed_drop_packet(ffp->is->decshed, pkt.data, pkt.size, pkt.flags & AV_PKT_FLAG_KEY)) {
+                IJK_TRACE_INSTANT("decode_shed_drop", pkt.size);
+                ijk_pacing_frame_skipped(ffp->pacing, IJK_PACING_SKIP_SHED);
+                d->packet_pending = 0;
+                continue;
+            }
         }
 
         switch (d->avctx->codec_type) {
             case AVMEDIA_TYPE_VIDEO:
+                IJK_TRACE_BEGIN("decode_video");
+                SDL_ProfilerBegin(&d->decode_profiler);
                 ret = avcodec_em_decode_video2(d->avctx, frame, &got_frame, &d->pkt_temp);
+                SDL_ProfilerEnd(&d->decode_profiler);
+                IJK_TRACE_END("decode_video");
                 if (got_frame) {
                     AVEMRational tb = ffp->is->video_st->time_base;
                     SDL_SpeedSampler3Add(&ffp->stat.video_bitrate_sampler, d->pkt_temp.dts * av_em_q2d(tb) * 1000, d->pkt_temp.size);
@@ -458,7 +497,9 @@ static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSub
                 }
                 break;
             case AVMEDIA_TYPE_AUDIO:
+                IJK_TRACE_BEGIN("decode_audio");
                 ret = avcodec_em_decode_audio4(d->avctx, frame, &got_frame, &d->pkt_temp);
+                IJK_TRACE_END("decode_audio");
                 //printf("decode one audio frame, ret:%d, got_frame:%d.\n", ret, got_frame);
                 if (got_frame) {
                     AVEMRational tb = ffp->is->audio_st->time_base;
@@ -501,9 +542,111 @@ static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSub
             }
         }
     } while (!got_frame && !d->finished);
+
+    if (got_frame && ffp->shared_role == FFP_SHARED_PUBLISHER)
+        ijk_shared_source_put_frame(ffp->shared_src, d->avctx->codec_type, frame);
     return got_frame;
 }
 
+#define SHARED_SOURCE_WAIT_MS           10
+/* own frames this far before the last shared one are the same stream catching up */
+#define SHARED_SOURCE_SPLICE_WINDOW     10.0
+
+static double decoder_frame_time(FFPlayer *ffp, Decoder *d, AVFrame *frame)
+{
+    if (frame->pts == AV_NOPTS_VALUE)
+        return NAN;
+    if (d->avctx->codec_type == AVMEDIA_TYPE_AUDIO)
+        return frame->sample_rate > 0 ? (double)frame->pts / frame->sample_rate : NAN;
+    return frame->pts * av_em_q2d(ffp->is->video_st->time_base);
+}
+
+/* the publisher flushed, drop what is queued of it like after a seek */
+static void decoder_shared_flush(FFPlayer *ffp, Decoder *d, int splicing)
+{
+    d->shared_time = NAN;
+    d->next_pts    = d->start_pts;
+    d->next_pts_tb = d->start_pts_tb;
+    if (splicing)
+        return;
+
+    SDL_LockMutex(d->queue->mutex);
+    d->queue->serial++;
+    d->pkt_serial = d->queue->serial;
+    SDL_UnlockMutex(d->queue->mutex);
+}
+
+/*
+ * Frames of the publisher. While splicing, the own packets are decoded
+ * alongside and their frames dropped until one is past the last shared
+ * frame, from then on the decoder is on its own.
+ */
+static int decoder_shared_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame)
+{
+    enum AVEMMediaType type = d->avctx->codec_type;
+    int ret;
+
+    for (;;) {
+        int splicing;
+
+        if (d->queue->abort_request)
+            return -1;
+        if (ffp->shared_abandon) {
+            d->shared = 0;
+            return decoder_decode_packets(ffp, d, frame, NULL);
+        }
+
+        splicing = ffp->shared_role == FFP_SHARED_SPLICING;
+        if (!splicing) {
+            /* nothing is read in the packet queue, keep the frames in its serial */
+            d->pkt_serial = d->queue->serial;
+        } else if (d->packet_pending || d->queue->nb_packets > 0) {
+            ret = decoder_decode_packets(ffp, d, frame, NULL);
+            if (ret < 0)
+                return ret;
+            if (ret > 0) {
+                double t = decoder_frame_time(ffp, d, frame);
+
+                if (isnan(d->shared_time) || isnan(t) ||
+                    t > d->shared_time || t <= d->shared_time - SHARED_SOURCE_SPLICE_WINDOW) {
+                    av_em_log(ffp, AV_LOG_INFO, "shared source: %s spliced at %.3f\n",
+                              av_em_get_media_type_string(type), t);
+                    d->shared = 0;
+                    return 1;
+                }
+                av_em_frame_unref(frame);
+            }
+        }
+
+        ret = ijk_shared_subscriber_get_frame(ffp->shared_subscriber, type, frame,
+                                              splicing ? 0 : SHARED_SOURCE_WAIT_MS);
+        if (ret == IJK_SHARED_SOURCE_FLUSH) {
+            decoder_shared_flush(ffp, d, splicing);
+        } else if (ret > 0) {
+            d->shared_time = decoder_frame_time(ffp, d, frame);
+            return 1;
+        } else if (ret < 0 || splicing) {
+            /* gone or nothing yet, unless own packets wait meanwhile */
+            if (!splicing || (!d->packet_pending && d->queue->nb_packets == 0))
+                SDL_Delay(SHARED_SOURCE_WAIT_MS);
+        }
+    }
+}
+
+/* shared frames are plain AVFrames, hardware decoders render to their own surface */
+static IJKFF_Pipenode *decoder_open_video_node(FFPlayer *ffp)
+{
+    if (ffp->shared_role != FFP_SHARED_NONE)
+        return ffpipenode_create_video_decoder_from_ffplay(ffp);
+    return ffpipeline_open_video_decoder(ffp->pipeline, ffp);
+}
+
+static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSubtitle *sub) {
+    if (d->shared)
+        return decoder_shared_frame(ffp, d, frame);
+    return decoder_decode_packets(ffp, d, frame, sub);
+}
+
 static void decoder_destroy(Decoder *d) {
     av_em_packet_unref(&d->pkt);
     avcodec_em_free_context(&d->avctx);
@@ -540,6 +683,8 @@ static int frame_queue_init(FrameQueue *f, PacketQueue *pktq, int max_size, int
     }
     f->pktq = pktq;
     f->max_size = FFMIN(max_size, FRAME_QUEUE_SIZE);
+    f->depth = f->max_size;
+    f->ring = f->max_size;
     f->keep_last = !!keep_last;
     for (i = 0; i < f->max_size; i++)
         if (!(f->queue[i].frame = av_em_frame_alloc()))
@@ -576,6 +721,27 @@ static void frame_queue_empty(FrameQueue *f)
     
 }
 
+/* limit the number of queued frames, the ring follows on the next push */
+static void frame_queue_set_depth(FrameQueue *f, int depth)
+{
+    SDL_LockMutex(f->mutex);
+    f->depth = av_clip(depth, 1, f->max_size);
+    SDL_CondSignal(f->cond);
+    SDL_UnlockMutex(f->mutex);
+}
+
+/* return the number of slots holding an overlay */
+static int frame_queue_nb_pictures(FrameQueue *f)
+{
+    int i, ret = 0;
+    SDL_LockMutex(f->mutex);
+    for (i = 0; i < f->max_size; i++)
+        if (f->queue[i].bmp)
+            ret++;
+    SDL_UnlockMutex(f->mutex);
+    return ret;
+}
+
 static void frame_queue_signal(FrameQueue *f)
 {
     SDL_LockMutex(f->mutex);
@@ -585,12 +751,12 @@ static void frame_queue_signal(FrameQueue *f)
 
 static Frame *frame_queue_peek(FrameQueue *f)
 {
-    return &f->queue[(f->rindex + f->rindex_shown) % f->max_size];
+    return &f->queue[(f->rindex + f->rindex_shown) % f->ring];
 }
 
 static Frame *frame_queue_peek_next(FrameQueue *f)
 {
-    return &f->queue[(f->rindex + f->rindex_shown + 1) % f->max_size];
+    return &f->queue[(f->rindex + f->rindex_shown + 1) % f->ring];
 }
 
 static Frame *frame_queue_peek_last(FrameQueue *f)
@@ -602,7 +768,7 @@ static Frame *frame_queue_peek_writable(FrameQueue *f)
 {
     /* wait until we have space to put a new frame */
     SDL_LockMutex(f->mutex);
-    while (f->size >= f->max_size &&
+    while (f->size >= FFMIN(f->depth, f->ring) &&
            !f->pktq->abort_request) {
         SDL_CondWait(f->cond, f->mutex);
     }
@@ -627,17 +793,35 @@ static Frame *frame_queue_peek_readable(FrameQueue *f)
     if (f->pktq->abort_request)
         return NULL;
 
-    return &f->queue[(f->rindex + f->rindex_shown) % f->max_size];
+    return &f->queue[(f->rindex + f->rindex_shown) % f->ring];
 }
 
 static void frame_queue_push(FrameQueue *f)
 {
-    if (++f->windex == f->max_size)
-        f->windex = 0;
+    int i, released = 0, ring = 0;
+
     SDL_LockMutex(f->mutex);
+    if (++f->windex == f->ring && f->ring < f->depth) {
+        /* the readable frames do not wrap here, grow the ring in place */
+        f->ring = f->depth;
+    } else if (f->windex == f->ring ||
+               (f->windex >= f->depth && f->rindex < f->windex)) {
+        /* wrap early once the depth dropped, slots past the ring are unused */
+        released = f->windex;
+        ring     = f->ring;
+        f->ring   = FFMAX(f->windex, 1);
+        f->windex = 0;
+    }
     f->size++;
     SDL_CondSignal(f->cond);
     SDL_UnlockMutex(f->mutex);
+
+    /* only the writer allocates overlays, so their slots can be freed unlocked */
+    for (i = released; i < ring; i++) {
+        frame_queue_unref_item(&f->queue[i]);
+        free_picture(&f->queue[i]);
+        f->queue[i].allocated = 0;
+    }
 }
 
 static void frame_queue_next(FrameQueue *f)
@@ -647,9 +831,9 @@ static void frame_queue_next(FrameQueue *f)
         return;
     }
     frame_queue_unref_item(&f->queue[f->rindex]);
-    if (++f->rindex == f->max_size)
-        f->rindex = 0;
     SDL_LockMutex(f->mutex);
+    if (++f->rindex == f->ring)
+        f->rindex = 0;
     f->size--;
     SDL_CondSignal(f->cond);
     SDL_UnlockMutex(f->mutex);
@@ -815,8 +999,9 @@ static void video_image_display2(FFPlayer *ffp)
                     toggle_pause(ffp, 1);
                     ffp_set_mute_audio(ffp, is->muted);
                 }
+                ffp->stat.first_frame_duration = ijk_get_timems() - ffp->prepared_timems;
                 ffp_notify_msg1(ffp, FFP_MSG_VIDEO_RENDERING_START);
-                av_em_log(NULL, AV_LOG_INFO, "render first video frame!!\n");
+                av_em_log(NULL, AV_LOG_INFO, "render first video frame, takes time:%lld.\n", ffp->stat.first_frame_duration);
             }
         }
         
@@ -864,6 +1049,7 @@ static void stream_component_close(FFPlayer *ffp, int stream_index)
         em_swr_free(&is->swr_ctx);
         av_em_freep(&is->audio_buf1);
         av_em_freep(&is->audio_new_buffer);
+        ijk_timestretch_destroy(&is->time_stretch);
         is->audio_buf1_size = 0;
         is->audio_new_buffer_size = 0;
         is->audio_buf = NULL;
@@ -884,6 +1070,7 @@ static void stream_component_close(FFPlayer *ffp, int stream_index)
         decoder_abort(&is->viddec, &is->pictq);
         av_em_log(NULL, AV_LOG_ERROR, "AVMEDIA_TYPE_VIDEO step 2.\n");
         decoder_destroy(&is->viddec);
+        ijk_decshed_destroy(&is->decshed);
 
         av_em_log(NULL, AV_LOG_ERROR, "AVMEDIA_TYPE_VIDEO destroy.\n");
         break;
@@ -908,6 +1095,18 @@ static void stream_component_close(FFPlayer *ffp, int stream_index)
     }
 }
 
+/* once its decoders take no more frames from it */
+static void shared_source_release(FFPlayer *ffp)
+{
+    if (!ffp->shared_subscriber)
+        return;
+    ffp->shared_dropped = ijk_shared_subscriber_get_dropped(ffp->shared_subscriber);
+    ijk_shared_subscriber_destroy(&ffp->shared_subscriber);
+    ffp->shared_role    = FFP_SHARED_NONE;
+    ffp->shared_abandon = 0;
+    av_em_log(ffp, AV_LOG_INFO, "shared source: left, %"PRId64" frames dropped\n", ffp->shared_dropped);
+}
+
 static void stream_close(FFPlayer *ffp)
 {
     av_em_log(NULL, AV_LOG_INFO, "enter func:%s\n", __func__);
@@ -926,12 +1125,23 @@ static void stream_close(FFPlayer *ffp)
     if (is->subtitle_stream >= 0)
         stream_component_close(ffp, is->subtitle_stream);
 #endif
+    shared_source_release(ffp);
+    ijk_shared_source_destroy(&ffp->shared_src);
+    ffp->shared_role = FFP_SHARED_NONE;
     if (!is->prepared_source && is->ic) {
         avformat_em_close_input(&is->ic);
         is->ic = NULL;
     }
+    ijk_timeshift_destroy(&ffp->timeshift);
+    if (ffp->memgov) {
+        ijk_memgov_unregister(&ffp->memgov);
+        ffp->dcc.max_buffer_size = ffp->mem_max_buffer_size;
+    }
+    ijk_throughput_meter_destroy(&ffp->throughput_meter);
+    ijk_bufpolicy_destroy(&ffp->buf_policy);
     av_em_log(NULL, AV_LOG_DEBUG, "wait for video_refresh_tid\n");
     SDL_WaitThread(is->video_refresh_tid, NULL);
+    ijk_pacing_destroy(&ffp->pacing);
 
     packet_queue_destroy(&is->videoq);
     packet_queue_destroy(&is->audioq);
@@ -1041,6 +1251,7 @@ static void stream_toggle_pause_l(FFPlayer *ffp, int pause_on)
     VideoState *is = ffp->is;
     if (is->paused && !pause_on) {
         is->frame_timer += av_em_gettime_relative() / 1000000.0 - is->vidclk.last_updated;
+        ijk_pacing_break(ffp->pacing);
 #ifdef FFP_MERGE
         if (is->read_pause_return != AVERROR(ENOSYS)) {
             is->vidclk.paused = 0;
@@ -1182,8 +1393,10 @@ retry:
         if (frame_queue_nb_remaining(&is->pictq) == 0) {
             // nothing to do, no picture to display in the queue
             // SDL_VoutClear(ffp->vout);
+            if (!is->paused)
+                ijk_pacing_queue_empty(ffp->pacing, av_em_gettime_relative() / 1000000.0);
         } else {
-            double last_duration, duration, delay;
+            double last_duration, duration, delay, due;
             Frame *vp, *lastvp;
 
             /* dequeue the picture */
@@ -1191,6 +1404,7 @@ retry:
             vp = frame_queue_peek(&is->pictq);
 
             if (vp->serial != is->videoq.serial) {
+                ijk_pacing_frame_skipped(ffp->pacing, IJK_PACING_SKIP_STALE);
                 frame_queue_next(&is->pictq);
                 goto retry;
             }
@@ -1211,12 +1425,14 @@ retry:
            // av_em_log(NULL, AV_LOG_INFO, "time:%f, frame timer:%f, delay:%f.,last duration:%f\n", time, is->frame_timer, delay, last_duration);
             if (time < is->frame_timer + delay && delay < AV_SYNC_ONCE_WAIT_MAX_DELAY) {
                 *remaining_time = FFMIN(is->frame_timer + delay - time, *remaining_time);
+                IJK_TRACE_INSTANT("refresh_wait", (int64_t)(*remaining_time * 1000000));
                 goto display;
             } else {
                 *remaining_time  = 0;
             }
             
             is->frame_timer += delay;
+            due = is->frame_timer;
             if (delay > 0 && time - is->frame_timer > AV_SYNC_THRESHOLD_MAX)
                 is->frame_timer = time;
 
@@ -1224,6 +1440,8 @@ retry:
                 Frame *nextvp = frame_queue_peek_next(&is->pictq);
                 duration = vp_duration(is, vp, nextvp);
                 if(!is->step && (ffp->framedrop > 0 || (ffp->framedrop && get_master_sync_type(is) != AV_SYNC_VIDEO_MASTER)) && time > is->frame_timer + duration) {
+                    IJK_TRACE_INSTANT("refresh_drop_late", (int64_t)((time - is->frame_timer - duration) * 1000000));
+                    ijk_pacing_frame_skipped(ffp->pacing, IJK_PACING_SKIP_LATE);
                     frame_queue_next(&is->pictq);
                     goto retry;
                 }
@@ -1231,6 +1449,9 @@ retry:
 
             // FFP_MERGE: if (is->subtitle_st) { {...}
 
+            ijk_pacing_frame_shown(ffp->pacing, time, due, last_duration, delay,
+                                   get_master_sync_type(is) != AV_SYNC_VIDEO_MASTER ? vp->pts - get_master_clock(is) : NAN,
+                                   lastvp->serial == vp->serial);
             frame_queue_next(&is->pictq);
             is->force_refresh = 1;
 
@@ -1245,7 +1466,9 @@ retry:
 display:
         /* display picture */
         if (!ffp->display_disable && is->force_refresh && is->show_mode == SHOW_MODE_VIDEO && is->pictq.rindex_shown) {
+            IJK_TRACE_BEGIN("video_display");
             video_display2(ffp);
+            IJK_TRACE_END("video_display");
             if (!ffp->b_first_display_time) {
                 av_em_log(NULL, AV_LOG_INFO, "first refresh frame takes time:%lld.\n", ijk_get_timems() - ffp->prepared_timems);
                 ffp->b_first_display_time = 1;
@@ -1377,7 +1600,10 @@ static int queue_picture(FFPlayer *ffp, AVFrame *src_frame, double pts, double d
         //return 0;
     } else if (is->is_seeking) {
         is->is_seeking = 0;
-        ffp_notify_msg3(ffp, FFP_MSG_SEEK_COMPLETE, (int)fftime_to_milliseconds(is->seek_pos), 0);
+        if (is->audio_only_seek)
+            is->audio_only_seek = 0;
+        else
+            ffp_notify_msg3(ffp, FFP_MSG_SEEK_COMPLETE, (int)fftime_to_milliseconds(is->seek_pos), 0);
     }
     
     if (!(vp = frame_queue_peek_writable(&is->pictq)))
@@ -1453,6 +1679,36 @@ static int queue_picture(FFPlayer *ffp, AVFrame *src_frame, double pts, double d
     return 0;
 }
 
+static void decode_shedding_update(FFPlayer *ffp, double dpts)
+{
+    VideoState       *is    = ffp->is;
+    AVEMCodecContext *avctx = is->viddec.avctx;
+    AVEMRational      fr    = av_em_guess_frame_rate(is->ic, is->video_st, NULL);
+    double load = 0, lag = NAN;
+    int old_level = ijk_decshed_get_level(is->decshed);
+    int level;
+
+    if (fr.num > 0 && fr.den > 0)
+        load = is->viddec.decode_profiler.average_elapsed * av_em_q2d(fr) / 1000.0;
+    if (!isnan(dpts) && get_master_sync_type(is) != AV_SYNC_VIDEO_MASTER &&
+        is->viddec.pkt_serial == is->vidclk.serial) {
+        lag = get_master_clock(is) - dpts;
+        if (isnan(lag) || fabs(lag) >= AV_NOSYNC_THRESHOLD)
+            lag = NAN;
+    }
+
+    level = ijk_decshed_update(is->decshed, ijk_get_timems(), load, lag);
+    if (level == old_level)
+        return;
+
+    if (old_level == IJK_DECSHED_NONE)
+        is->decshed_skip_loop_filter = avctx->skip_loop_filter;
+    avctx->skip_loop_filter = level >= IJK_DECSHED_SKIP_LOOP_FILTER ?
+                              FFMAX(is->decshed_skip_loop_filter, AVDISCARD_NONREF) : is->decshed_skip_loop_filter;
+    av_em_log(ffp, AV_LOG_INFO, "decode shedding: level %d -> %d, load %.2f, lag %.3f\n",
+              old_level, level, load, lag);
+}
+
 static int get_video_frame(FFPlayer *ffp, AVFrame *frame)
 {
     VideoState *is = ffp->is;
@@ -1475,6 +1731,9 @@ static int get_video_frame(FFPlayer *ffp, AVFrame *frame)
 
         frame->sample_aspect_ratio = av_em_guess_sample_aspect_ratio(is->ic, is->video_st, frame);
 
+        if (is->decshed)
+            decode_shedding_update(ffp, dpts);
+
 #ifdef FFP_MERGE
         is->viddec_width  = frame->width;
         is->viddec_height = frame->height;
@@ -1492,6 +1751,7 @@ static int get_video_frame(FFPlayer *ffp, AVFrame *frame)
                     if (is->continuous_frame_drops_early > ffp->framedrop) {
                         is->continuous_frame_drops_early = 0;
                     } else {
+                        ijk_pacing_frame_skipped(ffp->pacing, IJK_PACING_SKIP_EARLY);
                         av_em_frame_unref(frame);
                         got_picture = 0;
                     }
@@ -1884,7 +2144,9 @@ static int ffplay_video_thread(void *arg)
         frame_rate = av_em_guess_frame_rate(is->ic, is->video_st, NULL);
         duration = (frame_rate.num && frame_rate.den ? av_em_q2d((AVEMRational){frame_rate.den, frame_rate.num}) : 0);
         pts = (frame->pts == AV_NOPTS_VALUE) ? NAN : frame->pts * av_em_q2d(tb);
+        IJK_TRACE_BEGIN("queue_picture");
         ret = queue_picture(ffp, frame, pts, duration, av_em_frame_get_pkt_pos(frame), is->viddec.pkt_serial);
+        IJK_TRACE_END("queue_picture");
         av_em_frame_unref(frame);
         if (ret < 0)
             goto the_end;
@@ -1980,6 +2242,102 @@ static int audio_resample_frame(uint8_t *in, uint8_t *out, int length, int need_
     return 0;
 }
 
+static int audio_can_convert_to_s16(int format)
+{
+    switch (format) {
+        case AV_SAMPLE_FMT_S16:
+        case AV_SAMPLE_FMT_S16P:
+        case AV_SAMPLE_FMT_S32:
+        case AV_SAMPLE_FMT_S32P:
+        case AV_SAMPLE_FMT_FLT:
+        case AV_SAMPLE_FMT_FLTP:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/***
+ interleave and narrow a frame to packed S16, rounding as swresample does without dither.
+***/
+static void audio_convert_to_s16(const AVFrame *frame, int channels, int16_t *dst)
+{
+    uint8_t * const *src = frame->extended_data;
+    int nb_samples = frame->nb_samples;
+    int i, ch;
+
+    switch (frame->format) {
+        case AV_SAMPLE_FMT_S16:
+            memcpy(dst, src[0], nb_samples * channels * sizeof(int16_t));
+            break;
+        case AV_SAMPLE_FMT_S16P:
+            for (ch = 0; ch < channels; ch++) {
+                const int16_t *in = (const int16_t *)src[ch];
+                for (i = 0; i < nb_samples; i++)
+                    dst[i * channels + ch] = in[i];
+            }
+            break;
+        case AV_SAMPLE_FMT_S32: {
+            const int32_t *in = (const int32_t *)src[0];
+            for (i = 0; i < nb_samples * channels; i++)
+                dst[i] = in[i] >> 16;
+            break;
+        }
+        case AV_SAMPLE_FMT_S32P:
+            for (ch = 0; ch < channels; ch++) {
+                const int32_t *in = (const int32_t *)src[ch];
+                for (i = 0; i < nb_samples; i++)
+                    dst[i * channels + ch] = in[i] >> 16;
+            }
+            break;
+        case AV_SAMPLE_FMT_FLT: {
+            const float *in = (const float *)src[0];
+            for (i = 0; i < nb_samples * channels; i++)
+                dst[i] = av_clip_int16(lrintf(in[i] * (1 << 15)));
+            break;
+        }
+        case AV_SAMPLE_FMT_FLTP:
+            for (ch = 0; ch < channels; ch++) {
+                const float *in = (const float *)src[ch];
+                for (i = 0; i < nb_samples; i++)
+                    dst[i * channels + ch] = av_clip_int16(lrintf(in[i] * (1 << 15)));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* The time stretcher stays in use while it holds input, so that going back
+ * to 1.0x plays out what it buffered instead of dropping it. */
+static IjkTimeStretch *audio_time_stretch(FFPlayer *ffp, Frame *af)
+{
+    VideoState *is = ffp->is;
+
+    if (!ffp->enable_sonic_handle || ffp->time_stretch_sonic)
+        return NULL;
+
+    if (!ijk_timestretch_match(is->time_stretch, is->audio_tgt.freq, is->audio_tgt.channels, is->audio_tgt.fmt)) {
+        ijk_timestretch_destroy(&is->time_stretch);
+        if (ffp->pf_playback_rate == 1.0f)
+            return NULL;
+        is->time_stretch = ijk_timestretch_create(is->audio_tgt.freq, is->audio_tgt.channels, is->audio_tgt.fmt);
+        if (!is->time_stretch) {
+            av_em_log(ffp, AV_LOG_ERROR, "cannot stretch %d Hz %s %d channels\n",
+                      is->audio_tgt.freq, av_em_get_sample_fmt_name(is->audio_tgt.fmt), is->audio_tgt.channels);
+            return NULL;
+        }
+        is->time_stretch_serial = af->serial;
+    }
+    if (is->time_stretch_serial != af->serial) {
+        ijk_timestretch_reset(is->time_stretch);
+        is->time_stretch_serial = af->serial;
+    }
+    if (ffp->pf_playback_rate == 1.0f && !ijk_timestretch_get_pending(is->time_stretch))
+        return NULL;
+    return is->time_stretch;
+}
+
 /**
  * Decode one audio frame and return its uncompressed size.
  *
@@ -1994,6 +2352,8 @@ static int audio_decode_frame(FFPlayer *ffp)
     int64_t dec_channel_layout;
     av_unused double audio_clock0;
     int wanted_nb_samples;
+    int direct;
+    IjkTimeStretch *stretch;
     Frame *af;
 
     if (is->paused || is->step)
@@ -2038,7 +2398,22 @@ static int audio_decode_frame(FFPlayer *ffp)
         af->frame->channel_layout : av_em_get_default_channel_layout(av_em_frame_get_channels(af->frame));
     wanted_nb_samples = synchronize_audio(is, af->frame->nb_samples);
 
-    if (af->frame->format        != is->audio_src.fmt            ||
+    /* same rate and layout and nothing to compensate: only the sample format
+     * may differ, which does not need a resampler. A live swr context is kept,
+     * it may still hold samples from an ongoing compensation. */
+    direct = !is->swr_ctx                                         &&
+             is->audio_tgt.fmt        == AV_SAMPLE_FMT_S16         &&
+             dec_channel_layout       == is->audio_tgt.channel_layout &&
+             af->frame->sample_rate   == is->audio_tgt.freq        &&
+             wanted_nb_samples        == af->frame->nb_samples     &&
+             audio_can_convert_to_s16(af->frame->format);
+
+    if (direct) {
+        is->audio_src.channel_layout = dec_channel_layout;
+        is->audio_src.channels       = av_em_frame_get_channels(af->frame);
+        is->audio_src.freq           = af->frame->sample_rate;
+        is->audio_src.fmt            = af->frame->format;
+    } else if (af->frame->format        != is->audio_src.fmt            ||
         dec_channel_layout       != is->audio_src.channel_layout ||
         af->frame->sample_rate   != is->audio_src.freq           ||
         /*ffp->pf_playback_rate_changed || by ccl*/
@@ -2083,8 +2458,27 @@ static int audio_decode_frame(FFPlayer *ffp)
          by ccl */
     }
 
-    if (is->swr_ctx) {
+    /* with time stretch the conversion writes straight into its input */
+    stretch = audio_time_stretch(ffp, af);
+
+    if (direct && af->frame->format != AV_SAMPLE_FMT_S16) {
+        resampled_data_size = af->frame->nb_samples * is->audio_tgt.channels * sizeof(int16_t);
+        if (stretch) {
+            uint8_t *dst = ijk_timestretch_get_input_buffer(stretch, af->frame->nb_samples);
+            if (!dst)
+                return AVERROR(ENOMEM);
+            audio_convert_to_s16(af->frame, is->audio_tgt.channels, (int16_t *)dst);
+            ijk_timestretch_commit_input(stretch, af->frame->nb_samples);
+        } else {
+            av_em_fast_malloc(&is->audio_buf1, &is->audio_buf1_size, resampled_data_size);
+            if (!is->audio_buf1)
+                return AVERROR(ENOMEM);
+            audio_convert_to_s16(af->frame, is->audio_tgt.channels, (int16_t *)is->audio_buf1);
+            is->audio_buf = is->audio_buf1;
+        }
+    } else if (is->swr_ctx) {
         const uint8_t **in = (const uint8_t **)af->frame->extended_data;
+        uint8_t *stretch_in = NULL;
         uint8_t **out = &is->audio_buf1;
         int out_count = (int)((int64_t)wanted_nb_samples * is->audio_tgt.freq /*/ ffp->pf_playback_rate by ccl*/ / af->frame->sample_rate + 256);
         int out_size  = av_em_samples_get_buffer_size(NULL, is->audio_tgt.channels, out_count, is->audio_tgt.fmt, 0);
@@ -2101,9 +2495,16 @@ static int audio_decode_frame(FFPlayer *ffp)
                 return -1;
             }
         }
-        av_em_fast_malloc(&is->audio_buf1, &is->audio_buf1_size, out_size);
-        if (!is->audio_buf1)
-            return AVERROR(ENOMEM);
+        if (stretch) {
+            stretch_in = ijk_timestretch_get_input_buffer(stretch, out_count);
+            if (!stretch_in)
+                return AVERROR(ENOMEM);
+            out = &stretch_in;
+        } else {
+            av_em_fast_malloc(&is->audio_buf1, &is->audio_buf1_size, out_size);
+            if (!is->audio_buf1)
+                return AVERROR(ENOMEM);
+        }
         len2 = em_swr_convert(is->swr_ctx, out, out_count, in, af->frame->nb_samples);
         if (len2 < 0) {
             av_em_log(NULL, AV_LOG_ERROR, "em_swr_convert() failed\n");
@@ -2114,52 +2515,64 @@ static int audio_decode_frame(FFPlayer *ffp)
             if (em_swr_init(is->swr_ctx) < 0)
                 em_swr_free(&is->swr_ctx);
         }
-        is->audio_buf = is->audio_buf1;
-        int bytes_per_sample = av_em_get_bytes_per_sample(is->audio_tgt.fmt);
-        resampled_data_size = len2 * is->audio_tgt.channels * bytes_per_sample;
-        
-#if defined(__ANDROID__)
-        if(ffp->pf_playback_rate != 1.0f && ffp->enable_sonic_handle){
-            if (ffp->sonic_handle == NULL) {
-                ffp->sonic_handle = emsonicCreateStream(is->audio_tgt.freq, is->audio_tgt.channels);
-                av_em_log(NULL, AV_LOG_ERROR, "create sonic stream simplerate is %d, channels is %d, simplebit is %d\n"
-                          , is->audio_tgt.freq
-                          , is->audio_tgt.channels
-                          , is->audio_tgt.fmt);
-            }
-            
-            av_em_fast_malloc(&is->audio_new_buffer, &is->audio_new_buffer_size, out_size * sizeof(short));
-            if (!is->audio_new_buffer){
-                return AVERROR(ENOMEM);
-            }
-            
-            for (int i = 0; i < (resampled_data_size / 2); i++){
-                is->audio_new_buffer[i] = (is->audio_buf1[i * 2] | (is->audio_buf1[i * 2 + 1] << 8));
-            }
-            
-            emsonicSetSpeed(ffp->sonic_handle, ffp->pf_playback_rate);
-            int ret_len = emsonicWriteShortToStream(ffp->sonic_handle
-                                                    , is->audio_new_buffer
-                                                    , resampled_data_size / (bytes_per_sample * is->audio_tgt.channels));
-            int numSamples = (int)(resampled_data_size / ( bytes_per_sample * is->audio_tgt.channels) / ffp->pf_playback_rate);
-            if (ret_len){
-                ret_len = emsonicReadShortFromStream(ffp->sonic_handle, is->audio_new_buffer, numSamples);
-            }
-
-            if (ret_len > 0) {
-                is->audio_buf = (uint8_t *)is->audio_new_buffer;
-                resampled_data_size = ret_len * bytes_per_sample * is->audio_tgt.channels;
-            }
-            else{
-                return -1;
-            }
-        }
-#endif
-        
+        if (stretch)
+            ijk_timestretch_commit_input(stretch, len2);
+        else
+            is->audio_buf = is->audio_buf1;
+        resampled_data_size = len2 * is->audio_tgt.channels * av_em_get_bytes_per_sample(is->audio_tgt.fmt);
+    } else if (stretch) {
+        if (ijk_timestretch_write(stretch, af->frame->data[0], af->frame->nb_samples) < 0)
+            return AVERROR(ENOMEM);
     } else {
         is->audio_buf = af->frame->data[0];
         resampled_data_size = data_size;
     }
+
+    if (stretch) {
+        int bytes_per_frame = is->audio_tgt.channels * av_em_get_bytes_per_sample(is->audio_tgt.fmt);
+        int max_frames = ijk_timestretch_get_max_output(stretch, ffp->pf_playback_rate);
+
+        av_em_fast_malloc(&is->audio_new_buffer, &is->audio_new_buffer_size, max_frames * bytes_per_frame);
+        if (!is->audio_new_buffer)
+            return AVERROR(ENOMEM);
+        /* may be 0 until a full pitch search window is buffered */
+        resampled_data_size = ijk_timestretch_process(stretch, ffp->pf_playback_rate,
+                                                      (uint8_t *)is->audio_new_buffer, max_frames) * bytes_per_frame;
+        is->audio_buf = (uint8_t *)is->audio_new_buffer;
+    } else if (ffp->pf_playback_rate != 1.0f && ffp->enable_sonic_handle && ffp->time_stretch_sonic) {
+        int bytes_per_frame = is->audio_tgt.channels * av_em_get_bytes_per_sample(is->audio_tgt.fmt);
+        int in_samples = resampled_data_size / bytes_per_frame;
+        int numSamples = (int)(in_samples / ffp->pf_playback_rate);
+        int ret_len;
+
+        if (ffp->sonic_handle == NULL) {
+            ffp->sonic_handle = emsonicCreateStream(is->audio_tgt.freq, is->audio_tgt.channels);
+            av_em_log(NULL, AV_LOG_ERROR, "create sonic stream simplerate is %d, channels is %d, simplebit is %d\n"
+                      , is->audio_tgt.freq
+                      , is->audio_tgt.channels
+                      , is->audio_tgt.fmt);
+        }
+
+        av_em_fast_malloc(&is->audio_new_buffer, &is->audio_new_buffer_size, FFMAX(numSamples, 1) * bytes_per_frame);
+        if (!is->audio_new_buffer){
+            return AVERROR(ENOMEM);
+        }
+
+        /* audio_buf already holds native-endian S16, sonic reads it in place */
+        emsonicSetSpeed(ffp->sonic_handle, ffp->pf_playback_rate);
+        ret_len = emsonicWriteShortToStream(ffp->sonic_handle, (short *)is->audio_buf, in_samples);
+        if (ret_len){
+            ret_len = emsonicReadShortFromStream(ffp->sonic_handle, is->audio_new_buffer, numSamples);
+        }
+
+        if (ret_len > 0) {
+            is->audio_buf = (uint8_t *)is->audio_new_buffer;
+            resampled_data_size = ret_len * bytes_per_frame;
+        }
+        else{
+            return -1;
+        }
+    }
     /*if (fabsf(ffp->pf_playback_rate) > 0.00001 &&
         fabsf(ffp->pf_playback_rate - 1.0f) > 0.00001) {
         wanted_nb_samples = resampled_data_size / ffp->pf_playback_rate;
@@ -2190,6 +2603,14 @@ static int audio_decode_frame(FFPlayer *ffp)
     else
         is->audio_clock = NAN;
     is->audio_clock_serial = af->serial;
+    /* the stretcher output ends pending input frames before audio_clock */
+    if (stretch) {
+        is->audio_stretch_delay = (double)ijk_timestretch_get_pending(stretch) / is->audio_tgt.freq;
+        is->audio_buf_speed = av_clipf(ffp->pf_playback_rate, IJK_TIMESTRETCH_MIN_SPEED, IJK_TIMESTRETCH_MAX_SPEED);
+    } else {
+        is->audio_stretch_delay = 0;
+        is->audio_buf_speed = 1.0;
+    }
 #ifdef FFP_SHOW_AUDIO_DELAY
     {
         static double last_clock;
@@ -2223,12 +2644,9 @@ static void sdl_audio_callback(void *opaque, Uint8 *stream, int len)
     }
     int play_channel_mode = ffp->play_channel_mode;
     ffp->audio_callback_time = av_em_gettime_relative();
+    IJK_TRACE_BEGIN("audio_callback");
     
-    if (ffp->pf_playback_rate_changed
-#if defined(__ANDROID__)
-        && !ffp->enable_sonic_handle
-#endif
-        ) {
+    if (ffp->pf_playback_rate_changed && !ffp->enable_sonic_handle) {
         ffp->pf_playback_rate_changed = 0;
         SDL_AoutSetPlaybackRate(ffp->aout, ffp->pf_playback_rate);
     }
@@ -2239,9 +2657,13 @@ static void sdl_audio_callback(void *opaque, Uint8 *stream, int len)
         //av_em_log(NULL, AV_LOG_INFO, "decode audio frame size:%d", audio_size);
            if (audio_size < 0) {
                 /* if error, just output silence */
+               IJK_TRACE_INSTANT("audio_underrun", len);
                is->audio_buf = NULL;
                is->audio_buf_size = SDL_AUDIO_MIN_BUFFER_SIZE / is->audio_tgt.frame_size * is->audio_tgt.frame_size;
+               if (!is->paused && !is->step && is->auddec.finished != is->audioq.serial && is->audio_tgt.bytes_per_sec > 0)
+                   ijk_pacing_audio_underrun(ffp->pacing, (int64_t)is->audio_buf_size * 1000000 / is->audio_tgt.bytes_per_sec);
            } else {
+               ijk_pacing_audio_played(ffp->pacing);
                if (is->show_mode != SHOW_MODE_VIDEO)
                    update_sample_display(is, (int16_t *)is->audio_buf, audio_size);
                is->audio_buf_size = audio_size;
@@ -2292,7 +2714,10 @@ static void sdl_audio_callback(void *opaque, Uint8 *stream, int len)
     /* Let's assume the audio driver that is used by SDL has two periods. */
     
     if (!isnan(is->audio_clock)) {
-        set_clock_at(&is->audclk, is->audio_clock - (double)(is->audio_write_buf_size) / is->audio_tgt.bytes_per_sec - SDL_AoutGetLatencySeconds(ffp->aout), is->audio_clock_serial, ffp->audio_callback_time / 1000000.0);
+        /* buffered output plays at audio_buf_speed media seconds per second */
+        if (is->audclk.speed != is->audio_buf_speed)
+            set_clock_speed(&is->audclk, is->audio_buf_speed);
+        set_clock_at(&is->audclk, is->audio_clock - is->audio_stretch_delay - ((double)(is->audio_write_buf_size) / is->audio_tgt.bytes_per_sec + SDL_AoutGetLatencySeconds(ffp->aout)) * is->audio_buf_speed, is->audio_clock_serial, ffp->audio_callback_time / 1000000.0);
         sync_clock_to_slave(&is->extclk, &is->audclk);
         //av_em_log(NULL, AV_LOG_INFO, "set audclk :%f.\n", is->audio_clock - (double)(is->audio_write_buf_size) / is->audio_tgt.bytes_per_sec);
         /*if (is->video_stream < 0 || ffp->video_clock_error)*/ {
@@ -2312,6 +2737,7 @@ static void sdl_audio_callback(void *opaque, Uint8 *stream, int len)
             }
         }
     }
+    IJK_TRACE_END("audio_callback");
 }
 
 static int audio_open(FFPlayer *opaque, int64_t wanted_channel_layout, int wanted_nb_channels, int wanted_sample_rate, struct AudioParams *audio_hw_params)
@@ -2401,6 +2827,16 @@ static int audio_open(FFPlayer *opaque, int64_t wanted_channel_layout, int wante
 int create_avformat_internal(FFPlayer *ffp, VideoState *is, char *filename, int play_type, AVEMInputFormat *iformat, AVEMFormatContext **ic_out);
 
 
+static int is_live_fast_open(FFPlayer *ffp, AVEMFormatContext *ic, int play_type)
+{
+    if (!ffp->live_fast_open || !ic->iformat)
+        return 0;
+    if (play_type != FFP_PLAY_MODE_FLV_LIVE && play_type != FFP_PLAY_MODE_RTMP)
+        return 0;
+    return !strcmp(ic->iformat->name, "flv") || !strcmp(ic->iformat->name, "live_flv") ||
+           !strcmp(ic->iformat->name, "live_rtmp");
+}
+
 static int prepare_source_internal(FFPlayer *ffp, VideoState *is, char *filename, int play_type, AVEMInputFormat *iformat, ffplay_format_t **ffp_format_out)
 {
     AVEMFormatContext *ic;
@@ -2414,7 +2850,15 @@ static int prepare_source_internal(FFPlayer *ffp, VideoState *is, char *filename
     opts = setup_find_stream_info_opts(ic, ffp->codec_opts);
     int orig_nb_streams = ic->nb_streams;
     int i = 0;
-    int err = avformat_em_find_stream_info(ic, opts);
+    int err = AVERROR(EAGAIN);
+    int64_t info_start_ms = ijk_get_timems();
+    if (is_live_fast_open(ffp, ic, play_type)) {
+        err = avformat_em_find_stream_info_fast(ic, ffp->live_fast_open_timeout * 1000LL);
+        av_em_log(NULL, AV_LOG_INFO, "fast open stream info ret:%d, takes time:%lld.\n", err, ijk_get_timems() - info_start_ms);
+    }
+    if (err == AVERROR(EAGAIN))
+        err = avformat_em_find_stream_info(ic, opts);
+    ffp->stat.stream_info_duration = ijk_get_timems() - info_start_ms;
     av_em_log(NULL, AV_LOG_INFO, "success find stream info takes time:%lld.\n", ijk_get_timems() - start_ms);
     ffplay_format_t *ffp_format = (ffplay_format_t *) av_em_mallocz(sizeof(ffplay_format_t));
     if (!ffp_format) {
@@ -2473,6 +2917,17 @@ static int prepare_source_internal(FFPlayer *ffp, VideoState *is, char *filename
     return ret;
 }
 
+static const char *ffp_audio_codec_name(FFPlayer *ffp, AVEMCodecContext *avctx)
+{
+    if (ffp->audio_codec_name)
+        return ffp->audio_codec_name;
+    /* its S32P output is narrowed to S16 in audio_decode_frame without swresample */
+    if (ffp->aac_fixed_decoder && avctx->codec_id == AV_CODEC_ID_AAC &&
+        avcodec_em_find_decoder_by_name("aac_fixed"))
+        return "aac_fixed";
+    return NULL;
+}
+
 static int stream_component_reconfigure(FFPlayer *ffp, AVEMFormatContext *ic, int stream_index)
 {
     VideoState *is = ffp->is;
@@ -2560,7 +3015,7 @@ static int stream_component_reconfigure(FFPlayer *ffp, AVEMFormatContext *ic, in
         av_em_codec_set_pkt_timebase(avctx, ic->streams[stream_index]->time_base);
         codec = avcodec_em_find_decoder(avctx->codec_id);
         switch (avctx->codec_type) {
-            case AVMEDIA_TYPE_AUDIO   : is->last_audio_stream    = stream_index; forced_codec_name = ffp->audio_codec_name; break;
+            case AVMEDIA_TYPE_AUDIO   : is->last_audio_stream    = stream_index; forced_codec_name = ffp_audio_codec_name(ffp, avctx); break;
                 // FFP_MERGE: case AVMEDIA_TYPE_SUBTITLE:
             case AVMEDIA_TYPE_VIDEO   : is->last_video_stream    = stream_index; forced_codec_name = ffp->video_codec_name; break;
             default: break;
@@ -2643,7 +3098,10 @@ static int stream_component_reconfigure(FFPlayer *ffp, AVEMFormatContext *ic, in
                 is->video_stream = stream_index;
                 is->video_st = ic->streams[stream_index];
                 decoder_init(&is->viddec, avctx, &is->videoq, is->continue_read_thread);
-                ffp->node_vdec = ffpipeline_open_video_decoder(ffp->pipeline, ffp);
+                ijk_decshed_destroy(&is->decshed);
+                if (ffp->decode_shedding)
+                    is->decshed = ijk_decshed_create(avctx->codec_id, avctx->extradata, avctx->extradata_size);
+                ffp->node_vdec = decoder_open_video_node(ffp);
                 if (!ffp->node_vdec)
                     goto fail;
                 if ((ret = decoder_start(&is->viddec, video_thread, ffp, "ff_video_dec")) < 0)
@@ -2728,7 +3186,7 @@ static int stream_component_open(FFPlayer *ffp, int stream_index)
     codec = avcodec_em_find_decoder(avctx->codec_id);
 
     switch (avctx->codec_type) {
-        case AVMEDIA_TYPE_AUDIO   : is->last_audio_stream    = stream_index; forced_codec_name = ffp->audio_codec_name; break;
+        case AVMEDIA_TYPE_AUDIO   : is->last_audio_stream    = stream_index; forced_codec_name = ffp_audio_codec_name(ffp, avctx); break;
         // FFP_MERGE: case AVMEDIA_TYPE_SUBTITLE:
         case AVMEDIA_TYPE_VIDEO   : is->last_video_stream    = stream_index; forced_codec_name = ffp->video_codec_name; break;
         default: break;
@@ -2804,6 +3262,7 @@ static int stream_component_open(FFPlayer *ffp, int stream_index)
         is->audio_st = ic->streams[stream_index];
 
         decoder_init(&is->auddec, avctx, &is->audioq, is->continue_read_thread);
+        is->auddec.shared = ffp->shared_role == FFP_SHARED_SUBSCRIBER;
         if ((is->ic->iformat->flags & (AVFMT_NOBINSEARCH | AVFMT_NOGENSEARCH | AVFMT_NO_BYTE_SEEK)) && !is->ic->iformat->read_seek) {
             is->auddec.start_pts = is->audio_st->start_time;
             is->auddec.start_pts_tb = is->audio_st->time_base;
@@ -2817,9 +3276,19 @@ static int stream_component_open(FFPlayer *ffp, int stream_index)
         is->video_stream = stream_index;
         is->video_st = ic->streams[stream_index];
         decoder_init(&is->viddec, avctx, &is->videoq, is->continue_read_thread);
-        ffp->node_vdec = ffpipeline_open_video_decoder(ffp->pipeline, ffp);
+        is->viddec.shared = ffp->shared_role == FFP_SHARED_SUBSCRIBER;
+        ijk_decshed_destroy(&is->decshed);
+        if (ffp->decode_shedding)
+            is->decshed = ijk_decshed_create(avctx->codec_id, avctx->extradata, avctx->extradata_size);
+        ffp->node_vdec = decoder_open_video_node(ffp);
         if (!ffp->node_vdec)
             goto fail;
+        /* keep overlay buffer allocation out of queue_picture */
+        if (ffp->stat.vdec_type == FFP_PROPV_DECODER_AVCODEC && avctx->pix_fmt != AV_PIX_FMT_NONE) {
+            int overlay_bytes = SDL_VoutFFmpeg_GetOverlayBufferSize(avctx->width, avctx->height, avctx->pix_fmt, ffp->overlay_format);
+            if (overlay_bytes > 0)
+                SDL_VoutOverlayPool_Prewarm(overlay_bytes, is->pictq.max_size);
+        }
         if ((ret = decoder_start(&is->viddec, video_thread, ffp, "ff_video_dec")) < 0)
             goto out;
         av_em_log(NULL, AV_LOG_INFO, "start ff video dec thread succ, takes time:%lld.\n", ijk_get_timems() - ffp->prepared_timems);
@@ -3116,7 +3585,10 @@ static int do_read_seek_internal(FFPlayer *ffp, VideoState *is)
     ffp_notify_msg3(ffp, FFP_MSG_BUFFERING_UPDATE, 0, 0);
     ffp->error = 0;
     av_em_log(NULL, AV_LOG_WARNING, "seek file , target:%lld", seek_target);
-    ret = avformat_em_seek_file(is->ic, -1, seek_min, seek_target, seek_max, is->seek_flags);
+    if (ffp->timeshift)
+        ret = ijk_timeshift_seek(ffp->timeshift, av_em_rescale(seek_target, 1000, AV_TIME_BASE));
+    else
+        ret = avformat_em_seek_file(is->ic, -1, seek_min, seek_target, seek_max, is->seek_flags);
     if (ret < 0 && ret != AVERROR_EOF) {
         av_em_log(NULL, AV_LOG_ERROR,
                "%s: error while seeking:%d\n", is->ic->filename, ret);
@@ -3213,6 +3685,11 @@ int create_avformat_internal(FFPlayer *ffp, VideoState *is, char *filename, int
     //av_em_dict_set(&ffp->format_opts, "http_proxy", "http://172.16.63.104:8888", 0);
     if (is && ffp->iformat_name)
         is->iformat = av_em_find_input_format(ffp->iformat_name);
+    if (!iformat && ffp->live_rtmp_direct && play_type == FFP_PLAY_MODE_RTMP &&
+        av_em_stristart(filename, "rtmp", NULL)) {
+        // NULL if the demuxer is not built in, the flv path is used then
+        iformat = av_em_find_input_format("live_rtmp");
+    }
     if ((av_em_stristart(filename, "http", NULL) && (play_type == FFP_PLAY_MODE_VOD_FLV || play_type == FFP_PLAY_MODE_VOD_HLS || play_type == FFP_PLAY_MODE_VOD_MP4)) ||
         av_em_stristr(filename, "emmul"))
     {
@@ -3226,7 +3703,18 @@ int create_avformat_internal(FFPlayer *ffp, VideoState *is, char *filename, int
         av_em_dict_set_int(&format_opts, "analyzeduration", 0, 0);
         av_em_dict_set_int(&format_opts, "dns_timeout", ffp->dns_timeout, 0);
         av_em_dict_set_int(&format_opts, "dns_cache_count", ffp->dns_cache_count, 0);
-    }
+        if (play_type == FFP_PLAY_MODE_VOD_MP4 && ffp->mp4_moov_prefetch) {
+            av_em_dict_set_int(&format_opts, "moov_prefetch", 1, 0);
+            av_em_dict_set_int(&format_opts, "moov_cache", 1, 0);
+        }
+        if (play_type == FFP_PLAY_MODE_VOD_MP4)
+            av_em_dict_set_int(&format_opts, "split_interleave", ffp->mp4_split_interleave, 0);
+    } else if (ffp->live_fast_open && (play_type == FFP_PLAY_MODE_FLV_LIVE || play_type == FFP_PLAY_MODE_RTMP)) {
+        // probing is only the fallback of fast open, keep it short
+        av_em_dict_set_int(&format_opts, "analyzeduration", ffp->live_fast_open_timeout * 1000, AV_DICT_DONT_OVERWRITE);
+    }
+    if (play_type == FFP_PLAY_MODE_VOD_MP4 && ffp->mp4_compact_index)
+        av_em_dict_set_int(&format_opts, "compact_index", 1, 0);
     
     if (scan_all_pmts_set)
         av_em_dict_set(&format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE);
@@ -3454,7 +3942,369 @@ int ffp_delete_prepared_video_source(FFPlayer *ffp, int index)
 }
 
 
+/* report queue usage to the memory governor and apply the quota it returns */
+static void memgov_update(FFPlayer *ffp)
+{
+    VideoState *is = ffp->is;
+    int64_t frame_bytes = 0;
+    int64_t queue_usage;
+    int64_t quota;
+    int priority;
+    int depth;
+
+    if (!ffp->memgov)
+        return;
+
+    if (is->video_st && is->video_st->codecpar->width > 0 && is->video_st->codecpar->height > 0)
+        frame_bytes = (int64_t)is->video_st->codecpar->width * is->video_st->codecpar->height * 3 / 2;
+    queue_usage = is->audioq.size + is->videoq.size + frame_bytes * frame_queue_nb_pictures(&is->pictq);
+    ffp->mem_usage = queue_usage + ffp->stat.buf_parallel;
+
+    if (!is->paused)
+        priority = ffp->visible ? IJK_MEMGOV_PRIO_ACTIVE : IJK_MEMGOV_PRIO_PREPARED;
+    else if (ffp->first_video_frame_rendered || !is->video_st)
+        priority = IJK_MEMGOV_PRIO_PAUSED;
+    else
+        priority = IJK_MEMGOV_PRIO_PREPARED;
+
+    quota = ijk_memgov_update(ffp->memgov, priority, ffp->mem_usage);
+    ffp->mem_quota = quota;
+    ffp->mem_parallel_limit = quota < 0 ? -1 : FFMAX(quota - queue_usage, 0);
+    if (quota < 0) {
+        ffp->dcc.max_buffer_size = ffp->mem_max_buffer_size;
+        if (is->pictq.depth != is->pictq.max_size)
+            frame_queue_set_depth(&is->pictq, is->pictq.max_size);
+        return;
+    }
+
+    /* decoded pictures may take a quarter of the quota, packets get the rest */
+    depth = is->pictq.max_size;
+    if (frame_bytes > 0)
+        depth = (int)av_clip64(quota / 4 / frame_bytes, FFMIN(VIDEO_PICTURE_QUEUE_SIZE_MIN, is->pictq.max_size), is->pictq.max_size);
+    if (depth != is->pictq.depth)
+        frame_queue_set_depth(&is->pictq, depth);
+
+    ffp->dcc.max_buffer_size = (int)FFMIN(FFMAX(quota - frame_bytes * depth, IJK_MEMGOV_MIN_QUOTA / 2), ffp->mem_max_buffer_size);
+
+    if (ffp->mem_usage > quota || priority == IJK_MEMGOV_PRIO_PAUSED) {
+        packet_queue_trim_recycle(&is->videoq, PACKET_QUEUE_RECYCLE_KEEP);
+        packet_queue_trim_recycle(&is->audioq, PACKET_QUEUE_RECYCLE_KEEP);
+    }
+}
+
+static void timeshift_open(FFPlayer *ffp)
+{
+    ijk_timeshift_destroy(&ffp->timeshift);
+    if (!ffp->timeshift_dir || !is_ffp_in_live_mode(ffp))
+        return;
+    ffp->timeshift = ijk_timeshift_create(ffp->timeshift_dir, ffp->timeshift_window, ffp->timeshift_segment);
+    if (!ffp->timeshift)
+        av_em_log(NULL, AV_LOG_WARNING, "create timeshift in %s failed, play live only.\n", ffp->timeshift_dir);
+}
+
+/* a reconnect to the same stream keeps the rewind window, another source starts a new one */
+static void timeshift_source_changed(FFPlayer *ffp, int same_url, int prev_audio_stream, int prev_video_stream)
+{
+    VideoState *is = ffp->is;
+
+    if (ffp->timeshift && same_url &&
+        is->audio_stream == prev_audio_stream && is->video_stream == prev_video_stream) {
+        av_em_log(NULL, AV_LOG_INFO, "reconnected to the same stream, timeshift kept.\n");
+        return;
+    }
+    timeshift_open(ffp);
+}
+
+static void timeshift_record(FFPlayer *ffp, AVEMFormatContext *ic, AVEMPacket *pkt)
+{
+    VideoState *is = ffp->is;
+    int64_t pkt_ts;
+    int sync_point;
+
+    if (pkt->stream_index != is->audio_stream && pkt->stream_index != is->video_stream)
+        return;
+    pkt_ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+    if (pkt_ts == AV_NOPTS_VALUE)
+        return;
+    // audio only streams can restart from any packet
+    if (is->video_stream >= 0)
+        sync_point = pkt->stream_index == is->video_stream && (pkt->flags & AV_PKT_FLAG_KEY);
+    else
+        sync_point = 1;
+    ijk_timeshift_write(ffp->timeshift, pkt,
+                        av_em_rescale_q(pkt_ts, ic->streams[pkt->stream_index]->time_base, (AVEMRational){1, 1000}),
+                        sync_point);
+}
+
+/* record one packet of the broadcast without queueing it */
+static int timeshift_record_frame(FFPlayer *ffp, AVEMFormatContext *ic, AVEMPacket *pkt)
+{
+    int ret = av_em_read_frame(ic, pkt);
+    if (ret < 0)
+        return ret;
+    timeshift_record(ffp, ic, pkt);
+    av_em_packet_unref(pkt);
+    return 0;
+}
+
+/* network packets are always recorded, behind live the playback is fed from the ring */
+static int timeshift_read_frame(FFPlayer *ffp, AVEMFormatContext *ic, AVEMPacket *pkt)
+{
+    int ret = av_em_read_frame(ic, pkt);
+    if (!ffp->timeshift)
+        return ret;
+    if (ret >= 0)
+        timeshift_record(ffp, ic, pkt);
+    if (ijk_timeshift_is_live(ffp->timeshift))
+        return ret;
+    if (ret >= 0)
+        av_em_packet_unref(pkt);
+    return ijk_timeshift_read(ffp->timeshift, pkt);
+}
+
 /* this thread gets the stream from the disk or the network */
+#define SHARED_SOURCE_OPEN_TIMEOUT_MS   5000
+
+/*
+ * A live url another player publishes is subscribed to instead of opened,
+ * 1 with the streams of the publisher in *play_format. Otherwise the player
+ * publishes the url, unless somebody else does already.
+ */
+static int shared_source_prepare(FFPlayer *ffp, ffplay_format_t **play_format)
+{
+    VideoState *is = ffp->is;
+    IjkSharedSubscriber *subscriber = NULL;
+    ffplay_format_t *format = NULL;
+    int waited = 0;
+    int ret = 0;
+
+    if (!ffp->shared_source || !is_ffp_in_live_mode(ffp))
+        return 0;
+
+    /* the timeshift ring records what is read, a subscriber reads nothing */
+    if (!ffp->timeshift_dir)
+        subscriber = ijk_shared_subscriber_create(is->filename);
+    while (subscriber && !is->abort_request && waited < SHARED_SOURCE_OPEN_TIMEOUT_MS) {
+        ret = ijk_shared_subscriber_wait_streams(subscriber, 100);
+        if (ret != 0)
+            break;
+        waited += 100;
+    }
+    if (ret > 0)
+        format = av_em_mallocz(sizeof(ffplay_format_t));
+    if (format) {
+        memset(format->stream_index, -1, sizeof(int) * AVMEDIA_TYPE_NB);
+        av_em_strlcpy(format->filename, is->filename, sizeof(format->filename));
+        ret = ijk_shared_subscriber_create_context(subscriber, &format->ic,
+                                                   &format->stream_index[AVMEDIA_TYPE_VIDEO],
+                                                   &format->stream_index[AVMEDIA_TYPE_AUDIO]);
+        if (ret >= 0) {
+            if (ffp->video_disable)
+                format->stream_index[AVMEDIA_TYPE_VIDEO] = -1;
+            if (ffp->audio_disable)
+                format->stream_index[AVMEDIA_TYPE_AUDIO] = -1;
+            ffp->shared_subscriber = subscriber;
+            ffp->shared_role       = FFP_SHARED_SUBSCRIBER;
+            *play_format = format;
+            av_em_log(ffp, AV_LOG_INFO, "shared source: subscribed to %s\n", is->filename);
+            return 1;
+        }
+        av_em_free(format);
+    }
+    ijk_shared_subscriber_destroy(&subscriber);
+
+    ffp->shared_src = ijk_shared_source_publish(is->filename);
+    if (ffp->shared_src) {
+        ffp->shared_role = FFP_SHARED_PUBLISHER;
+        av_em_log(ffp, AV_LOG_INFO, "shared source: publishing %s\n", is->filename);
+    }
+    return 0;
+}
+
+static int shared_stream_matches(AVEMStream *st, AVEMFormatContext *ic, int stream_index)
+{
+    AVEMStream *own;
+
+    if (!st)
+        return 1;
+    if (stream_index < 0)
+        return 0;
+    own = ic->streams[stream_index];
+    return own->codecpar->codec_id == st->codecpar->codec_id &&
+           !av_em_cmp_q(own->time_base, st->time_base);
+}
+
+/*
+ * Opens the url by itself and swaps it in for the streams of the publisher,
+ * the decoders keep showing shared frames until their own ones catch up.
+ */
+static int shared_source_detach(FFPlayer *ffp)
+{
+    VideoState *is = ffp->is;
+    ffplay_format_t *play_format = NULL;
+    AVEMFormatContext *ic, *shared_ic;
+    int video_stream, audio_stream;
+    int ret;
+
+    ret = prepare_source_internal(ffp, NULL, ffp->input_filename, ffp->play_mode, NULL, &play_format);
+    if (ret < 0 || !play_format) {
+        if (play_format && play_format->ic)
+            avformat_em_close_input(&play_format->ic);
+        av_em_free(play_format);
+        return ret < 0 ? ret : -1;
+    }
+    ic = play_format->ic;
+    video_stream = play_format->stream_index[AVMEDIA_TYPE_VIDEO];
+    audio_stream = play_format->stream_index[AVMEDIA_TYPE_AUDIO];
+    av_em_free(play_format);
+    if (!shared_stream_matches(is->video_st, ic, video_stream) ||
+        !shared_stream_matches(is->audio_st, ic, audio_stream)) {
+        av_em_log(ffp, AV_LOG_WARNING, "shared source: streams of %s changed\n", ffp->input_filename);
+        avformat_em_close_input(&ic);
+        return AVERROR(EINVAL);
+    }
+
+    SDL_LockMutex(ffp->reconfigure_mutex);
+    shared_ic = is->ic;
+    is->ic = ic;
+    if (is->video_st) {
+        is->video_stream = video_stream;
+        is->video_st = ic->streams[video_stream];
+        is->video_st->discard = AVDISCARD_DEFAULT;
+    }
+    if (is->audio_st) {
+        is->audio_stream = audio_stream;
+        is->audio_st = ic->streams[audio_stream];
+        is->audio_st->discard = AVDISCARD_DEFAULT;
+    }
+    is->realtime = is_realtime(ic);
+    is->eof = 0;
+    ffp->stat.bit_rate = ic->bit_rate;
+    ffp->shared_role = FFP_SHARED_SPLICING;
+    SDL_UnlockMutex(ffp->reconfigure_mutex);
+
+    avformat_em_close_input(&shared_ic);
+    ijkmeta_set_avformat_context_l(ffp->meta, ic);
+    av_em_log(ffp, AV_LOG_INFO, "shared source: detached, splicing\n");
+    return 0;
+}
+
+/* 1 while only shared frames are played, nothing to read then */
+static int shared_source_read_step(FFPlayer *ffp, AVEMFormatContext **pic, SDL_mutex *wait_mutex)
+{
+    VideoState *is = ffp->is;
+
+    if (ffp->shared_role == FFP_SHARED_SUBSCRIBER) {
+        if (ffp->b_change_source) {
+            /* the decoders take their own packets from the new source */
+            ffp->shared_abandon = 1;
+            ffp->shared_role = FFP_SHARED_NONE;
+            return 0;
+        }
+        if (ffp->shared_detach_req || ijk_shared_subscriber_is_closed(ffp->shared_subscriber)) {
+            ffp->shared_detach_req = 0;
+            if (shared_source_detach(ffp) < 0) {
+                ffp->shared_abandon = 1;
+                ffp->shared_role = FFP_SHARED_NONE;
+                ffp_change_video_source(ffp, ffp->input_filename, ffp->play_mode);
+                return 0;
+            }
+            *pic = is->ic;
+            return 0;
+        }
+        ffp_toggle_buffering(ffp, 0);
+        SDL_LockMutex(wait_mutex);
+        IJK_TRACE_BEGIN("read_wait");
+        SDL_CondWaitTimeout(is->continue_read_thread, wait_mutex, 10);
+        IJK_TRACE_END("read_wait");
+        SDL_UnlockMutex(wait_mutex);
+        return 1;
+    }
+
+    /* splicing or abandoned, a paused decoder may hold on to a shared frame for long */
+    if ((is->video_stream < 0 || !is->viddec.shared) && (is->audio_stream < 0 || !is->auddec.shared))
+        shared_source_release(ffp);
+    return 0;
+}
+
+/* the source and subscriber go away under read_thread, property getters read these copies */
+static void shared_source_update_stat(FFPlayer *ffp)
+{
+    if (ffp->shared_subscriber)
+        ffp->shared_dropped = ijk_shared_subscriber_get_dropped(ffp->shared_subscriber);
+    if (ffp->shared_src) {
+        ffp->shared_subscribers = ijk_shared_source_get_subscribers(ffp->shared_src);
+        ffp->shared_published   = ijk_shared_source_get_published(ffp->shared_src);
+    }
+}
+
+/* a publisher changing to another url stops publishing */
+static void shared_source_changed(FFPlayer *ffp)
+{
+    VideoState *is = ffp->is;
+
+    if (ffp->shared_role != FFP_SHARED_PUBLISHER)
+        return;
+    if (strcmp(ffp->input_filename, is->filename)) {
+        /* its decoders may still be putting frames, the source goes in stream_close() */
+        ijk_shared_source_close(ffp->shared_src);
+        ffp->shared_role = FFP_SHARED_NONE;
+    } else {
+        ijk_shared_source_set_streams(ffp->shared_src, is->ic, is->video_stream, is->audio_stream);
+    }
+}
+
+/*
+ * Audio only playback closes the video stream, which also makes the demuxer
+ * discard its packets. Video comes back at the next keyframe, the audio and
+ * its clock go on meanwhile. Other than live, the demuxer has read ahead of
+ * the audio clock by the whole audio queue, so it seeks back to the clock:
+ * the audio packets it reads again up to there are dropped as after any seek.
+ */
+static void audio_only_update(FFPlayer *ffp)
+{
+    VideoState *is = ffp->is;
+    int stream;
+
+    if (ffp->audio_only && is->video_stream >= 0 && is->audio_stream >= 0) {
+        /* subscribers of this player show its pictures */
+        if (ffp->shared_role == FFP_SHARED_SPLICING ||
+            (ffp->shared_role == FFP_SHARED_PUBLISHER && ijk_shared_source_get_subscribers(ffp->shared_src) > 0))
+            return;
+        stream = is->video_stream;
+        stream_component_close(ffp, stream);
+        ffpipenode_free_p(&ffp->node_vdec);
+        SDL_LockMutex(is->pictq.mutex);
+        is->pictq_release_req = 1;
+        SDL_UnlockMutex(is->pictq.mutex);
+        is->audio_only_stream = stream;
+        av_em_log(ffp, AV_LOG_INFO, "audio only: video stream %d closed\n", stream);
+    } else if (!ffp->audio_only && is->audio_only_stream >= 0) {
+        stream = is->audio_only_stream;
+        is->audio_only_stream = -1;
+        /* a source changed meanwhile brings its own video stream */
+        if (is->video_stream >= 0 || stream >= is->ic->nb_streams ||
+            is->ic->streams[stream]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
+            return;
+        SDL_LockMutex(is->pictq.mutex);
+        is->pictq_release_req = 0;
+        SDL_UnlockMutex(is->pictq.mutex);
+        if (stream_component_open(ffp, stream) < 0) {
+            av_em_log(ffp, AV_LOG_ERROR, "audio only: reopen video stream %d failed\n", stream);
+            return;
+        }
+        is->is_seek_find_next_frame = 1;
+        if (!is_ffp_in_live_mode(ffp) && !ffp->timeshift && !is->seek_req) {
+            double clock = get_master_clock(is);
+            if (!isnan(clock)) {
+                is->audio_only_seek = 1;
+                stream_seek(is, (int64_t)(clock * AV_TIME_BASE), 0, 0);
+            }
+        }
+        av_em_log(ffp, AV_LOG_INFO, "audio only: video stream %d reopened\n", stream);
+    }
+}
+
 static int read_thread(void *arg)
 {
     FFPlayer *ffp = arg;
@@ -3475,6 +4325,7 @@ static int read_thread(void *arg)
     int reconnect_count = 0;
     ffplay_format_t *source_format;
     int source_play_type;
+    int64_t memgov_update_time = 0;
     av_em_log(NULL, AV_LOG_INFO, "enter thread:%s\n", __func__);
     if (!wait_mutex) {
         av_em_log(NULL, AV_LOG_FATAL, "SDL_CreateMutex(): %s\n", SDL_GetError());
@@ -3489,7 +4340,9 @@ static int read_thread(void *arg)
     is->reconnect_retry_count = 0;//
     is->show_mode = ffp->show_mode;
     ffplay_format_t *play_format = NULL;
-    ret = prepare_source_internal(ffp, ffp->is, is->filename, ffp->play_mode, is->iformat, &play_format);
+    ret = shared_source_prepare(ffp, &play_format);
+    if (ret <= 0)
+        ret = prepare_source_internal(ffp, ffp->is, is->filename, ffp->play_mode, is->iformat, &play_format);
     if (ret < 0 || !play_format) {
         ffp_notify_msg2(ffp, FFP_MSG_ERROR_CONNECT_FAILD, ret);
         ret = -1;
@@ -3536,6 +4389,8 @@ static int read_thread(void *arg)
         ret = -1;
         goto fail;
     }
+    if (ffp->shared_role == FFP_SHARED_PUBLISHER)
+        ijk_shared_source_set_streams(ffp->shared_src, ic, is->video_stream, is->audio_stream);
     if (is->audio_stream >= 0) {
         is->audioq.is_buffer_indicator = 1;
         is->buffer_indicator_queue = &is->audioq;
@@ -3570,6 +4425,7 @@ static int read_thread(void *arg)
         ffp_notify_msg3(ffp, FFP_MSG_VIDEO_SIZE_CHANGED, codecpar->width, codecpar->height);
         ffp_notify_msg3(ffp, FFP_MSG_SAR_CHANGED, codecpar->sample_aspect_ratio.num, codecpar->sample_aspect_ratio.den);
     }
+    timeshift_open(ffp);
     ffp->prepared = true;
     ffp_notify_msg1(ffp, FFP_MSG_PREPARED);
     
@@ -3593,8 +4449,18 @@ static int read_thread(void *arg)
     for (;;) {
         if (is->abort_request)
             break;
+        /* a changed source or a reconnect may have opened video again */
+        if (ffp->audio_only ? is->video_stream >= 0 : is->audio_only_stream >= 0)
+            audio_only_update(ffp);
+        shared_source_update_stat(ffp);
+        if (ffp->shared_subscriber && shared_source_read_step(ffp, &ic, wait_mutex))
+            continue;
         SDL_LockMutex(ffp->change_source_lock);
         if (ffp->b_change_source) {
+            int prev_audio_stream = is->audio_stream;
+            int prev_video_stream = is->video_stream;
+            int same_url;
+
             av_em_log(NULL, AV_LOG_INFO, "change video source");
             ffp->b_change_source = 0;
             flush_all_packets_frames(ffp);
@@ -3604,8 +4470,10 @@ static int read_thread(void *arg)
                 ffp->cur_format = NULL;
                 SDL_UnlockMutex(ffp->change_source_lock);
                 ret = do_change_video_source_internal(ffp, source_format, !is->prepared_source);
+                same_url = ffp->input_filename && !strcmp(ffp->input_filename, source_format->filename);
                 av_em_freep(&ffp->input_filename);
                 ffp->input_filename = strdup(source_format->filename);
+                ijk_throughput_meter_set_url(ffp->throughput_meter, ffp->input_filename);
                 is->prepared_source = 1;
                 ic = source_format->ic;
                 avformat_em_flush(ic);
@@ -3624,6 +4492,7 @@ static int read_thread(void *arg)
                 SDL_UnlockMutex(ffp->change_source_lock);
                 int64_t before_time = ijk_get_timems();
                 ffp->prepare_source_abort = 0;
+                ijk_throughput_meter_set_url(ffp->throughput_meter, ffp->new_video_path);
                 ret = prepare_source_internal(ffp, NULL, ffp->new_video_path, ffp->new_video_type, NULL, &ic_format);
                 av_em_log(NULL, AV_LOG_INFO, "prepare source takes time:%lld.\n", ijk_get_timems() - before_time);
                 if (ret < 0 || !ic_format) {
@@ -3635,6 +4504,7 @@ static int read_thread(void *arg)
                 is->prepared_source = 0;
                 ic = ic_format->ic;
                 ffp->play_mode = ffp->new_video_type;
+                same_url = ffp->input_filename && !strcmp(ffp->input_filename, ffp->new_video_path);
                 av_em_freep(&ffp->input_filename);
                 ffp->input_filename = strdup(ffp->new_video_path);
                 av_em_free(ic_format);
@@ -3642,6 +4512,8 @@ static int read_thread(void *arg)
             if (ret < 0) {
                 break;
             }
+            timeshift_source_changed(ffp, same_url, prev_audio_stream, prev_video_stream);
+            shared_source_changed(ffp);
             prev_io_tick_counter = 0;
             completed = 0;
             //ffp_start_l(ffp);
@@ -3661,8 +4533,8 @@ static int read_thread(void *arg)
                 av_em_log(NULL, AV_LOG_WARNING, "seek to end of stream.\n");
                 force_completed = 1;
             } else if (ret < 0) {
-                ffp->error = is->ic->pb->error;
-                if (is->ic->pb->error == AVERROR(ETIMEDOUT)) {
+                ffp->error = is->ic->pb ? is->ic->pb->error : ret;
+                if (ffp->error == AVERROR(ETIMEDOUT)) {
                     ffp_set_network_disconnect(ffp);
                 }
             } else {
@@ -3685,6 +4557,11 @@ static int read_thread(void *arg)
             is->queue_attachments_req = 0;
         }
 
+        if (ffp->memgov && av_em_gettime_relative() - memgov_update_time >= MEMGOV_UPDATE_INTERVAL) {
+            memgov_update(ffp);
+            memgov_update_time = av_em_gettime_relative();
+        }
+
         /* if the queue are full, no need to read more */
         if (ffp->infinite_buffer<1 && !is->seek_req &&
               (is->audioq.size + is->videoq.size > ffp->dcc.max_buffer_size
@@ -3693,9 +4570,19 @@ static int read_thread(void *arg)
             if (!is->eof) {
                 ffp_toggle_buffering(ffp, 0);
             }
+            /* keep recording the broadcast while the queues are full or playback is paused */
+            if (ffp->timeshift) {
+                ijk_timeshift_detach(ffp->timeshift);
+                if (timeshift_record_frame(ffp, ic, pkt) >= 0)
+                    continue;
+            }
+            /* what arrives meanwhile is paced by the queues, not the network */
+            ijk_throughput_meter_discard(ffp->throughput_meter);
             /* wait 10 ms */
             SDL_LockMutex(wait_mutex);
+            IJK_TRACE_BEGIN("read_wait");
             SDL_CondWaitTimeout(is->continue_read_thread, wait_mutex, 10);
+            IJK_TRACE_END("read_wait");
             SDL_UnlockMutex(wait_mutex);
             continue;
         }
@@ -3707,7 +4594,9 @@ static int read_thread(void *arg)
             // infinite wait may block shutdown
 standby:
             while (!is->abort_request && !is->seek_req && !ffp->b_change_source) {
+                IJK_TRACE_BEGIN("read_wait");
                 SDL_CondWaitTimeout(is->continue_read_thread, wait_mutex, 100);
+                IJK_TRACE_END("read_wait");
             }
             SDL_UnlockMutex(wait_mutex);
             if (ffp->b_change_source || is->seek_req) {
@@ -3728,7 +4617,13 @@ standby:
         }
         //av_em_log(NULL, AV_LOG_INFO, "will enter av read frame.\n");
         
-        ret = av_em_read_frame(ic, pkt);
+        IJK_TRACE_BEGIN("read_frame");
+        ret = timeshift_read_frame(ffp, ic, pkt);
+        IJK_TRACE_END("read_frame");
+        if (ret == AVERROR(EAGAIN)) {
+            // timeshift reader caught up with the live head
+            continue;
+        }
         if (ret < 0) {
             int pb_eof = 0;
             int pb_error = 0;
@@ -3736,7 +4631,7 @@ standby:
             if (is_ffp_in_live_mode(ffp)) {
                 int retcode = -ret;
                 av_em_log(NULL, AV_LOG_WARNING, "av read frame error:%c%c%c%c, pb error:%d.\n", \
-                          retcode & 0xFF, (retcode >> 8) & 0xFF, (retcode >> 16) & 0xFF, (retcode >> 24) & 0xFF, ic->pb->error);
+                          retcode & 0xFF, (retcode >> 8) & 0xFF, (retcode >> 16) & 0xFF, (retcode >> 24) & 0xFF, ic->pb ? ic->pb->error : 0);
 #if 0
                 reconnect_count++;
                 if (reconnect_count >= ffp->reconnect_count) {
@@ -3752,8 +4647,11 @@ standby:
                 if(reconnect_count){
                     av_em_log(NULL, AV_LOG_ERROR, "av read frame error, net disconnect.\n");
                     ffp_set_network_disconnect(ffp);
-                    ic->pb->error = 0;
-                    ic->pb->eof_reached = 0;
+                    // live_rtmp reads without an AVIOContext
+                    if (ic->pb) {
+                        ic->pb->error = 0;
+                        ic->pb->eof_reached = 0;
+                    }
                     is->abort_request = 1;
                     ffp_notify_msg1(ffp, FFP_MSG_ERROR_NET_DISCONNECT);
                     goto fail;
@@ -3766,7 +4664,9 @@ standby:
                 }
 #endif
                 SDL_LockMutex(wait_mutex);
+                IJK_TRACE_BEGIN("read_wait");
                 SDL_CondWaitTimeout(is->continue_read_thread, wait_mutex, 10);
+                IJK_TRACE_END("read_wait");
                 SDL_UnlockMutex(wait_mutex);
                 ffp_statistic_l(ffp);
 
@@ -3833,7 +4733,9 @@ standby:
             ic->pb->error = 0;
             ic->pb->eof_reached = 0;
             SDL_LockMutex(wait_mutex);
+            IJK_TRACE_BEGIN("read_wait");
             SDL_CondWaitTimeout(is->continue_read_thread, wait_mutex, 10);
+            IJK_TRACE_END("read_wait");
             SDL_UnlockMutex(wait_mutex);
             ffp_statistic_l(ffp);
             continue;
@@ -3955,6 +4857,7 @@ static VideoState *stream_open(FFPlayer *ffp, const char *filename, AVEMInputFor
     is->ytop    = 0;
     is->xleft   = 0;
     is->buffering_start_ms = -1;
+    is->audio_only_stream = -1;
     /* start video display */
     if (frame_queue_init(&is->pictq, &is->videoq, ffp->pictq_size, 1) < 0)
         goto fail;
@@ -3973,6 +4876,8 @@ static VideoState *stream_open(FFPlayer *ffp, const char *filename, AVEMInputFor
         0)
 #endif
         goto fail;
+    is->videoq.trace_name = "videoq";
+    is->audioq.trace_name = "audioq";
 
     if (!(is->continue_read_thread = SDL_CreateCond())) {
         av_em_log(NULL, AV_LOG_FATAL, "SDL_CreateCond(): %s\n", SDL_GetError());
@@ -3983,6 +4888,7 @@ static VideoState *stream_open(FFPlayer *ffp, const char *filename, AVEMInputFor
     init_clock(&is->audclk, &is->audioq.serial);
     init_clock(&is->extclk, &is->extclk.serial);
     is->audio_clock_serial = -1;
+    is->audio_buf_speed = 1.0;
     is->audio_volume = SDL_MIX_MAXVOLUME;
     is->muted = 0;
     is->av_sync_type = ffp->av_sync_type;
@@ -3991,6 +4897,15 @@ static VideoState *stream_open(FFPlayer *ffp, const char *filename, AVEMInputFor
     is->prepared_source = 0;
     is->reconnect_retry_count = 0;
     is->play_mutex = SDL_CreateMutex();
+    ffp->mem_max_buffer_size = ffp->dcc.max_buffer_size;
+    ffp->memgov = ijk_memgov_register();
+    ffp->throughput_meter = ijk_throughput_meter_create();
+    ijk_throughput_meter_set_url(ffp->throughput_meter, filename);
+    ffp->pacing = ijk_pacing_create();
+    if (ffp->adaptive_buffering)
+        ffp->buf_policy = ijk_bufpolicy_create(ffp->dcc.first_high_water_mark_in_ms,
+                                               ffp->dcc.next_high_water_mark_in_ms,
+                                               ffp->dcc.last_high_water_mark_in_ms);
     ffp->is = is;
    // is->pause_req = !ffp->start_on_prepared;
 
@@ -4033,12 +4948,41 @@ fail:
 // FFP_MERGE: options
 // FFP_MERGE: show_usage
 // FFP_MERGE: show_help_default
+/* pictures of a video stream closed for audio only playback */
+static void video_release_pictures(FFPlayer *ffp)
+{
+    VideoState *is = ffp->is;
+    FrameQueue *f = &is->pictq;
+    int i;
+
+    SDL_LockMutex(f->mutex);
+    if (is->pictq_release_req) {
+        for (i = 0; i < f->max_size; i++) {
+            frame_queue_unref_item(&f->queue[i]);
+            free_picture(&f->queue[i]);
+        }
+        f->rindex = 0;
+        f->windex = 0;
+        f->ring = f->depth;
+        f->size = 0;
+        f->rindex_shown = 0;
+        is->pictq_release_req = 0;
+    }
+    SDL_UnlockMutex(f->mutex);
+    /* the overlay buffers went back to the pool, free them unless another player uses them */
+    SDL_VoutOverlayPool_Trim(0);
+}
+
 static int video_refresh_thread(void *arg)
 {
     FFPlayer *ffp = arg;
     VideoState *is = ffp->is;
     double remaining_time = 0.0;
     while (!is->abort_request) {
+        if (is->pictq_release_req)
+            video_release_pictures(ffp);
+        if (ffp->inject_opaque && ijk_pacing_report_due(ffp->pacing, av_em_gettime_relative() / 1000))
+            pacing_report(ffp);
         if (remaining_time > 0.0) {
             av_em_usleep((int)(int64_t)(remaining_time * 1000000.0));
         }
@@ -4208,6 +5152,46 @@ void ffp_global_set_log_level(int log_level)
     av_em_log_set_level(av_level);
 }
 
+void ffp_global_set_memory_budget(int64_t bytes)
+{
+    ijk_memgov_set_budget(bytes);
+}
+
+void ffp_global_set_network_type(int type)
+{
+    ijk_throughput_set_network_type(type);
+}
+
+int ffp_global_get_throughput_estimate(const char *url, IjkThroughputEstimate *estimate)
+{
+    return ijk_throughput_get_estimate(url, estimate);
+}
+
+int ffp_global_load_throughput(const char *path)
+{
+    return ijk_throughput_load(path);
+}
+
+int ffp_global_save_throughput(const char *path)
+{
+    return ijk_throughput_save(path);
+}
+
+int ffp_global_start_trace(void)
+{
+    return ijk_trace_start();
+}
+
+void ffp_global_stop_trace(void)
+{
+    ijk_trace_stop();
+}
+
+int ffp_global_dump_trace(const char *path)
+{
+    return ijk_trace_dump(path);
+}
+
 static ijk_inject_callback s_inject_callback = NULL;
 int inject_callback(void *opaque, int type, void *data, size_t data_size)
 {
@@ -4221,6 +5205,14 @@ void ffp_global_set_inject_callback(ijk_inject_callback cb)
     s_inject_callback = cb;
 }
 
+static void pacing_report(FFPlayer *ffp)
+{
+    IjkPacingSnapshot snapshot;
+
+    ijk_pacing_get_snapshot(ffp->pacing, &snapshot);
+    inject_callback(ffp->inject_opaque, IJK_PACING_INJECT_SNAPSHOT, &snapshot, sizeof(snapshot));
+}
+
 void ffp_set_video_frame_callback(FFPlayer *ffp, ijk_present_video_frame_callback cb)
 {
     ffp->video_present_callback = cb;
@@ -4460,13 +5452,34 @@ static int app_func_event(AVApplicationContext *h, int message ,void *data, size
         return 0;
     if (message == AVAPP_EVENT_IO_TRAFFIC && sizeof(AVAppIOTraffic) == size) {
         AVAppIOTraffic *event = (AVAppIOTraffic *)(intptr_t)data;
-        if (event->bytes > 0)
+        if (event->bytes > 0) {
+            IJK_TRACE_INSTANT("io_read", event->bytes);
             SDL_SpeedSampler2Add(&ffp->stat.tcp_read_sampler, event->bytes);
+            ijk_throughput_meter_add_bytes(ffp->throughput_meter, event->bytes, av_em_gettime_relative() / 1000);
+        }
+    } else if (message == AVAPP_EVENT_ASYNC_READ_SPEED && sizeof(AVAppAsyncReadSpeed) == size) {
+        AVAppAsyncReadSpeed *speed = (AVAppAsyncReadSpeed *)(intptr_t)data;
+        if (speed->is_full_speed)
+            ijk_throughput_meter_add_sample(ffp->throughput_meter, speed->io_bytes, speed->elapsed_milli);
+    } else if (message == AVAPP_EVENT_WILL_HTTP_OPEN && sizeof(AVAppHttpEvent) == size) {
+        IJK_TRACE_BEGIN("http_open");
+    } else if (message == AVAPP_EVENT_DID_HTTP_OPEN && sizeof(AVAppHttpEvent) == size) {
+        AVAppHttpEvent *event = (AVAppHttpEvent *)(intptr_t)data;
+        IJK_TRACE_END("http_open");
+        ijk_throughput_meter_set_url(ffp->throughput_meter, event->url);
     } else if (message == AVAPP_EVENT_ASYNC_STATISTIC && sizeof(AVAppAsyncStatistic) == size) {
         AVAppAsyncStatistic *statistic =  (AVAppAsyncStatistic *) (intptr_t)data;
         ffp->stat.buf_backwards = statistic->buf_backwards;
         ffp->stat.buf_forwards = statistic->buf_forwards;
         ffp->stat.buf_capacity = statistic->buf_capacity;
+        ffp->stat.buf_parallel = statistic->buf_parallel;
+        statistic->buf_parallel_limit = ffp->mem_parallel_limit;
+    } else if (message == AVAPP_CTRL_WILL_TCP_OPEN) {
+        /* a failed connect gets no DID event, so these stay instants */
+        IJK_TRACE_INSTANT("tcp_will_open", 0);
+    } else if (message == AVAPP_CTRL_DID_TCP_OPEN && sizeof(AVAppTcpIOControl) == size) {
+        AVAppTcpIOControl *control = (AVAppTcpIOControl *)(intptr_t)data;
+        IJK_TRACE_INSTANT("tcp_did_open", control->error);
     }
     return inject_callback(ffp->inject_opaque, message , data, size);
 }
@@ -4741,12 +5754,51 @@ int ffp_seek_to_l(FFPlayer *ffp, long msec)
     // FIXME: 9 seek out of range
     // FIXME: 9 seekable
     av_em_log(ffp, AV_LOG_DEBUG, "stream_seek %"PRId64"(%d) + %"PRId64", \n", seek_pos, (int)msec, start_time);
+    if (!is->seek_req)
+        is->audio_only_seek = 0;
     stream_seek(is, seek_pos, 0, 0);
     ffp_toggle_buffering(ffp, 1);
     ffp_notify_msg3(ffp, FFP_MSG_BUFFERING_UPDATE, 0, 0);
     return 0;
 }
 
+int ffp_timeshift_go_live_l(FFPlayer *ffp)
+{
+    assert(ffp);
+    VideoState *is = ffp->is;
+    if (!is)
+        return EIJK_NULL_IS_PTR;
+    if (!ffp->timeshift)
+        return EIJK_INVALID_STATE;
+
+    // the ring lands on the newest key frame and hands over to the network once drained
+    stream_seek(is, milliseconds_to_fftime(ijk_timeshift_get_end_ms(ffp->timeshift)), 0, 0);
+    ffp_toggle_buffering(ffp, 1);
+    ffp_notify_msg3(ffp, FFP_MSG_BUFFERING_UPDATE, 0, 0);
+    return 0;
+}
+
+int ffp_detach_shared_source_l(FFPlayer *ffp)
+{
+    assert(ffp);
+    VideoState *is = ffp->is;
+    if (!is)
+        return EIJK_NULL_IS_PTR;
+
+    switch (ffp->shared_role) {
+        case FFP_SHARED_PUBLISHER:
+            // subscribers open the url by themselves, the frames put meanwhile still reach them
+            ijk_shared_source_close(ffp->shared_src);
+            return 0;
+        case FFP_SHARED_SUBSCRIBER:
+            ffp->shared_detach_req = 1;
+            SDL_CondSignal(is->continue_read_thread);
+            return 0;
+        default:
+            return EIJK_INVALID_STATE;
+    }
+}
+
 int  ffp_seek_to_offset(FFPlayer *ffp, int64_t offset)
 {
     assert(ffp);
@@ -4905,7 +5957,12 @@ void ffp_frame_queue_push(FrameQueue *f)
 
 int ffp_queue_picture(FFPlayer *ffp, AVFrame *src_frame, double pts, double duration, int64_t pos, int serial)
 {
-    return queue_picture(ffp, src_frame, pts, duration, pos, serial);
+    int ret;
+
+    IJK_TRACE_BEGIN("queue_picture");
+    ret = queue_picture(ffp, src_frame, pts, duration, pos, serial);
+    IJK_TRACE_END("queue_picture");
+    return ret;
 }
 
 int ffp_get_master_sync_type(VideoState *is)
@@ -4936,7 +5993,8 @@ void ffp_toggle_buffering_l(FFPlayer *ffp, int buffering_on)
             ffp_set_network_disconnect(ffp);
         }*/
     } else if (!buffering_on && is->buffering_on){
-        if (is_ffp_in_live_mode(ffp) && is->buffering_start_ms != -1 && ijk_get_timems() - is->buffering_start_ms > 1000) {
+        if (is_ffp_in_live_mode(ffp) && ffp->shared_role != FFP_SHARED_SUBSCRIBER &&
+            is->buffering_start_ms != -1 && ijk_get_timems() - is->buffering_start_ms > 1000) {
             ffp_change_video_source(ffp, ffp->input_filename, ffp->play_mode);
             return;
         }
@@ -4986,11 +6044,63 @@ void ffp_statistic_l(FFPlayer *ffp)
     ffp_video_statistic_l(ffp);
 }
 
+/* ms of media the adaptive policy wants before resuming, -1 to fall back to packet counts */
+static int ffp_get_buffering_resume_ms(FFPlayer *ffp)
+{
+    IjkThroughputEstimate estimate;
+    int64_t rate, low_rate = 0, bitrate;
+
+    if (!ffp->buf_policy || is_ffp_in_live_mode(ffp))
+        return -1;
+
+    rate = SDL_SpeedSampler2GetSpeed(&ffp->stat.tcp_read_sampler);
+    if (ijk_throughput_meter_get_estimate(&ffp->throughput_meter, &estimate) >= 0) {
+        low_rate = estimate.p10;
+        if (rate <= 0)
+            rate = estimate.ewma;
+    }
+
+    bitrate = SDL_SpeedSampler3GetSpeed(&ffp->stat.video_bitrate_sampler) +
+              SDL_SpeedSampler3GetSpeed(&ffp->stat.audio_bitrate_sampler);
+    if (bitrate <= 0)
+        bitrate = ffp->stat.bit_rate / 8;
+
+    return ijk_bufpolicy_get_resume_ms(ffp->buf_policy, ijk_get_timems(), rate, low_rate, bitrate);
+}
+
+/* ms of media in the shortest of the open queues, -1 if a queue has no durations */
+static int64_t ffp_get_cached_duration_ms(FFPlayer *ffp)
+{
+    VideoState *is = ffp->is;
+    int64_t cached = INT64_MAX;
+
+    if (is->audio_stream >= 0 && !is->audioq.abort_request) {
+        if (ffp->stat.audio_cache.packets > 0 && ffp->stat.audio_cache.duration <= 0)
+            return -1;
+        cached = FFMIN(cached, ffp->stat.audio_cache.duration);
+    }
+    if (is->video_stream >= 0 && !is->videoq.abort_request) {
+        if (ffp->stat.video_cache.packets > 0 && ffp->stat.video_cache.duration <= 0)
+            return -1;
+        cached = FFMIN(cached, ffp->stat.video_cache.duration);
+    }
+    return cached == INT64_MAX ? -1 : cached;
+}
+
 void ffp_check_buffering_l(FFPlayer *ffp)
 {
     VideoState *is            = ffp->is;
     if (is->buffer_indicator_queue && is->buffer_indicator_queue->nb_packets > 0) {
-        if (   (is->audioq.nb_packets > MIN_MIN_FRAMES || is->audio_stream < 0 || is->audioq.abort_request)
+        int resume_ms = ffp_get_buffering_resume_ms(ffp);
+        int64_t cached_ms = resume_ms >= 0 ? ffp_get_cached_duration_ms(ffp) : -1;
+
+        if (cached_ms >= 0) {
+            if (cached_ms >= resume_ms) {
+                av_em_log(ffp, AV_LOG_INFO, "adaptive buffering: resume with %d ms cached, threshold %d ms\n",
+                          (int)cached_ms, resume_ms);
+                ffp_toggle_buffering(ffp, 0);
+            }
+        } else if (   (is->audioq.nb_packets > MIN_MIN_FRAMES || is->audio_stream < 0 || is->audioq.abort_request)
                && (is->videoq.nb_packets > MIN_MIN_FRAMES || is->video_stream < 0 || is->videoq.abort_request)) {
             ffp_toggle_buffering(ffp, 0);
         }
@@ -5129,6 +6239,188 @@ void ffp_set_property_float(FFPlayer *ffp, int id, float value)
     }
 }
 
+static int64_t ffp_get_timeshift_property(FFPlayer *ffp, int id, int64_t default_value)
+{
+    IjkTimeshiftStat stat;
+    int64_t start_diff = 0;
+
+    if (!ffp || !ffp->timeshift || !ffp->is || !ffp->is->ic)
+        return default_value;
+    ijk_timeshift_get_stat(ffp->timeshift, &stat);
+    // same timeline as ffp_get_current_position_l
+    if (ffp->is->ic->start_time > 0 && ffp->is->ic->start_time != AV_NOPTS_VALUE)
+        start_diff = fftime_to_milliseconds(ffp->is->ic->start_time);
+    switch (id) {
+        case FFP_PROP_INT64_TIMESHIFT_START:
+            return FFMAX(stat.start_ms - start_diff, 0);
+        case FFP_PROP_INT64_TIMESHIFT_END:
+            return FFMAX(stat.end_ms - start_diff, 0);
+        case FFP_PROP_INT64_TIMESHIFT_SEEK_LATENCY:
+            return stat.last_seek_us;
+        case FFP_PROP_INT64_TIMESHIFT_BYTES_WRITTEN:
+            return stat.bytes_written;
+        case FFP_PROP_INT64_TIMESHIFT_WRITE_COUNT:
+            return stat.write_count;
+        default:
+            return default_value;
+    }
+}
+
+static int64_t ffp_get_overlay_pool_property(int id, int64_t default_value)
+{
+    SDL_VoutOverlayPoolStat stat;
+    int64_t total;
+
+    SDL_VoutOverlayPool_GetStat(&stat);
+    switch (id) {
+        case FFP_PROP_INT64_OVERLAY_POOL_HIT_RATE:
+            total = stat.hit_count + stat.miss_count;
+            return total > 0 ? stat.hit_count * 100 / total : default_value;
+        case FFP_PROP_INT64_OVERLAY_POOL_AVOIDED_ALLOC_US:
+            return stat.avoided_alloc_us;
+        case FFP_PROP_INT64_OVERLAY_POOL_CACHED_BYTES:
+            return stat.cached_bytes;
+        default:
+            return default_value;
+    }
+}
+
+static int64_t ffp_get_http_pool_property(int id, int64_t default_value)
+{
+    AVIOHTTPPoolStat stat;
+
+    avio_em_http_pool_get_stat(&stat);
+    switch (id) {
+        case FFP_PROP_INT64_HTTP_POOL_REUSED_COUNT:
+            return stat.reused;
+        case FFP_PROP_INT64_HTTP_POOL_FRESH_COUNT:
+            return stat.fresh;
+        case FFP_PROP_INT64_HTTP_POOL_IDLE_COUNT:
+            return stat.idle;
+        default:
+            return default_value;
+    }
+}
+
+static int64_t ffp_get_tls_property(int id, int64_t default_value)
+{
+    AVIOTLSStat stat;
+
+    avio_em_tls_get_stat(&stat);
+    switch (id) {
+        case FFP_PROP_INT64_TLS_HANDSHAKE_COUNT:
+            return stat.handshakes;
+        case FFP_PROP_INT64_TLS_HANDSHAKE_AVG_US:
+            return stat.handshakes > 0 ? stat.handshake_us / stat.handshakes : default_value;
+        case FFP_PROP_INT64_TLS_RESUMPTION_RATE:
+            return stat.handshakes > 0 ? stat.resumed * 100 / stat.handshakes : default_value;
+        default:
+            return default_value;
+    }
+}
+
+static int64_t ffp_get_throughput_property(FFPlayer *ffp, int id, int64_t default_value)
+{
+    IjkThroughputEstimate estimate;
+
+    if (!ffp || ijk_throughput_meter_get_estimate(&ffp->throughput_meter, &estimate) < 0)
+        return default_value;
+    switch (id) {
+        case FFP_PROP_INT64_THROUGHPUT_ESTIMATE:
+            return estimate.ewma;
+        case FFP_PROP_INT64_THROUGHPUT_P10:
+            return estimate.p10;
+        case FFP_PROP_INT64_THROUGHPUT_P90:
+            return estimate.p90;
+        default:
+            return default_value;
+    }
+}
+
+static int64_t ffp_get_decode_shedding_property(FFPlayer *ffp, int id, int64_t default_value)
+{
+    VideoState *is = ffp ? ffp->is : NULL;
+
+    if (!is || !is->decshed)
+        return default_value;
+    switch (id) {
+        case FFP_PROP_INT64_DECODE_SHED_LEVEL:
+            return ijk_decshed_get_level(is->decshed);
+        case FFP_PROP_INT64_DECODE_SHED_DROPPED:
+            return ijk_decshed_get_dropped(is->decshed);
+        case FFP_PROP_INT64_DECODE_SHED_SAVED_MS:
+            /* dropped pictures at the average cost of the decoded ones */
+            return ijk_decshed_get_dropped(is->decshed) * is->viddec.decode_profiler.average_elapsed;
+        default:
+            return default_value;
+    }
+}
+
+static int64_t ffp_get_shared_source_property(FFPlayer *ffp, int id, int64_t default_value)
+{
+    if (!ffp)
+        return default_value;
+    switch (id) {
+        case FFP_PROP_INT64_SHARED_SOURCE_ROLE:
+            return ffp->shared_role;
+        case FFP_PROP_INT64_SHARED_SOURCE_SUBSCRIBERS:
+            return ffp->shared_subscribers;
+        case FFP_PROP_INT64_SHARED_SOURCE_PUBLISHED_FRAMES:
+            return ffp->shared_published;
+        case FFP_PROP_INT64_SHARED_SOURCE_DROPPED_FRAMES:
+            return ffp->shared_dropped;
+        default:
+            return default_value;
+    }
+}
+
+static int64_t ffp_get_pacing_property(FFPlayer *ffp, int id, int64_t default_value)
+{
+    IjkPacingSnapshot snapshot;
+    int64_t sum = 0;
+    int i;
+
+    if (!ffp || !ffp->pacing)
+        return default_value;
+    ijk_pacing_get_snapshot(ffp->pacing, &snapshot);
+    switch (id) {
+        case FFP_PROP_INT64_PACING_FRAMES:
+            return snapshot.frames;
+        case FFP_PROP_INT64_PACING_ERROR_AVG:
+            return snapshot.error_avg_us;
+        case FFP_PROP_INT64_PACING_ERROR_MAX:
+            return snapshot.error_max_us;
+        case FFP_PROP_INT64_PACING_INTERVAL_JITTER:
+            return snapshot.interval_jitter_us;
+        case FFP_PROP_INT64_PACING_SKIPPED_FRAMES:
+            for (i = 0; i < IJK_PACING_SKIP_NB; i++)
+                sum += snapshot.skips[i];
+            return sum;
+        case FFP_PROP_INT64_PACING_REPEATED_FRAMES:
+            for (i = 0; i < IJK_PACING_REPEAT_NB; i++)
+                sum += snapshot.repeats[i];
+            return sum;
+        case FFP_PROP_INT64_PACING_AVDIFF_AVG:
+            return snapshot.avdiff_avg_us;
+        case FFP_PROP_INT64_PACING_AVDIFF_MAX:
+            return snapshot.avdiff_max_us;
+        case FFP_PROP_INT64_PACING_AUDIO_UNDERRUNS:
+            return snapshot.audio_underruns;
+        case FFP_PROP_INT64_PACING_AUDIO_UNDERRUN_DURATION:
+            return snapshot.audio_underrun_us;
+        default:
+            return default_value;
+    }
+}
+
+int ffp_get_pacing_snapshot(FFPlayer *ffp, IjkPacingSnapshot *snapshot)
+{
+    if (!ffp || !ffp->pacing || !snapshot)
+        return -1;
+    ijk_pacing_get_snapshot(ffp->pacing, snapshot);
+    return 0;
+}
+
 int64_t ffp_get_property_int64(FFPlayer *ffp, int id, int64_t default_value)
 {
     switch (id) {
@@ -5193,6 +6485,62 @@ int64_t ffp_get_property_int64(FFPlayer *ffp, int id, int64_t default_value)
             return ffp->stat.buf_capacity;
         case FFP_PROP_INT64_LATEST_SEEK_LOAD_DURATION:
             return ffp ? ffp->stat.latest_seek_load_duration : default_value;
+        case FFP_PROP_INT64_STREAM_INFO_DURATION:
+            return ffp ? ffp->stat.stream_info_duration : default_value;
+        case FFP_PROP_INT64_FIRST_FRAME_DURATION:
+            return ffp ? ffp->stat.first_frame_duration : default_value;
+        case FFP_PROP_INT64_TIMESHIFT_START:
+        case FFP_PROP_INT64_TIMESHIFT_END:
+        case FFP_PROP_INT64_TIMESHIFT_SEEK_LATENCY:
+        case FFP_PROP_INT64_TIMESHIFT_BYTES_WRITTEN:
+        case FFP_PROP_INT64_TIMESHIFT_WRITE_COUNT:
+            return ffp_get_timeshift_property(ffp, id, default_value);
+        case FFP_PROP_INT64_VISIBLE:
+            return ffp ? ffp->visible : default_value;
+        case FFP_PROP_INT64_AUDIO_ONLY:
+            return ffp ? ffp->audio_only : default_value;
+        case FFP_PROP_INT64_MEMORY_USAGE:
+            return ffp ? ffp->mem_usage : default_value;
+        case FFP_PROP_INT64_MEMORY_QUOTA:
+            return ffp ? ffp->mem_quota : default_value;
+        case FFP_PROP_INT64_MEMORY_TOTAL_USAGE:
+            return ijk_memgov_get_total_usage();
+        case FFP_PROP_INT64_OVERLAY_POOL_HIT_RATE:
+        case FFP_PROP_INT64_OVERLAY_POOL_AVOIDED_ALLOC_US:
+        case FFP_PROP_INT64_OVERLAY_POOL_CACHED_BYTES:
+            return ffp_get_overlay_pool_property(id, default_value);
+        case FFP_PROP_INT64_HTTP_POOL_REUSED_COUNT:
+        case FFP_PROP_INT64_HTTP_POOL_FRESH_COUNT:
+        case FFP_PROP_INT64_HTTP_POOL_IDLE_COUNT:
+            return ffp_get_http_pool_property(id, default_value);
+        case FFP_PROP_INT64_TLS_HANDSHAKE_COUNT:
+        case FFP_PROP_INT64_TLS_HANDSHAKE_AVG_US:
+        case FFP_PROP_INT64_TLS_RESUMPTION_RATE:
+            return ffp_get_tls_property(id, default_value);
+        case FFP_PROP_INT64_THROUGHPUT_ESTIMATE:
+        case FFP_PROP_INT64_THROUGHPUT_P10:
+        case FFP_PROP_INT64_THROUGHPUT_P90:
+            return ffp_get_throughput_property(ffp, id, default_value);
+        case FFP_PROP_INT64_DECODE_SHED_LEVEL:
+        case FFP_PROP_INT64_DECODE_SHED_DROPPED:
+        case FFP_PROP_INT64_DECODE_SHED_SAVED_MS:
+            return ffp_get_decode_shedding_property(ffp, id, default_value);
+        case FFP_PROP_INT64_SHARED_SOURCE_ROLE:
+        case FFP_PROP_INT64_SHARED_SOURCE_SUBSCRIBERS:
+        case FFP_PROP_INT64_SHARED_SOURCE_PUBLISHED_FRAMES:
+        case FFP_PROP_INT64_SHARED_SOURCE_DROPPED_FRAMES:
+            return ffp_get_shared_source_property(ffp, id, default_value);
+        case FFP_PROP_INT64_PACING_FRAMES:
+        case FFP_PROP_INT64_PACING_ERROR_AVG:
+        case FFP_PROP_INT64_PACING_ERROR_MAX:
+        case FFP_PROP_INT64_PACING_INTERVAL_JITTER:
+        case FFP_PROP_INT64_PACING_SKIPPED_FRAMES:
+        case FFP_PROP_INT64_PACING_REPEATED_FRAMES:
+        case FFP_PROP_INT64_PACING_AVDIFF_AVG:
+        case FFP_PROP_INT64_PACING_AVDIFF_MAX:
+        case FFP_PROP_INT64_PACING_AUDIO_UNDERRUNS:
+        case FFP_PROP_INT64_PACING_AUDIO_UNDERRUN_DURATION:
+            return ffp_get_pacing_property(ffp, id, default_value);
         default:
             return default_value;
     }
@@ -5203,11 +6551,31 @@ void ffp_set_property_int64(FFPlayer *ffp, int id, int64_t value)
     switch (id) {
         // case FFP_PROP_INT64_SELECTED_VIDEO_STREAM:
         // case FFP_PROP_INT64_SELECTED_AUDIO_STREAM:
+        case FFP_PROP_INT64_VISIBLE:
+            if (ffp)
+                ffp->visible = !!value;
+            break;
+        case FFP_PROP_INT64_AUDIO_ONLY:
+            if (ffp) {
+                ffp->audio_only = !!value;
+                if (ffp->is)
+                    SDL_CondSignal(ffp->is->continue_read_thread);
+            }
+            break;
         default:
             break;
     }
 }
 
+/* previews of the current source, opened with the same options as the player */
+IjkThumbnailer *ffp_create_thumbnailer(FFPlayer *ffp, const IjkThumbnailParams *params)
+{
+    if (!ffp || !ffp->input_filename)
+        return NULL;
+
+    return ijk_thumbnailer_create(ffp->input_filename, ffp->format_opts, params);
+}
+
 IjkMediaMeta *ffp_get_meta_l(FFPlayer *ffp)
 {
     if (!ffp)
@@ -32,6 +32,14 @@ void      ffp_global_init();
 void      ffp_global_uninit();
 void      ffp_global_set_log_report(int use_report);
 void      ffp_global_set_log_level(int log_level);
+void      ffp_global_set_memory_budget(int64_t bytes);
+void      ffp_global_set_network_type(int type);
+int       ffp_global_get_throughput_estimate(const char *url, IjkThroughputEstimate *estimate);
+int       ffp_global_load_throughput(const char *path);
+int       ffp_global_save_throughput(const char *path);
+int       ffp_global_start_trace(void);
+void      ffp_global_stop_trace(void);
+int       ffp_global_dump_trace(const char *path);
 void      ffp_global_set_inject_callback(ijk_inject_callback cb);
 void      ffp_set_video_frame_callback(FFPlayer *ffp, ijk_present_video_frame_callback cb);
 void      ffp_set_audio_frame_callback(FFPlayer *ffp, ijk_present_audio_frame_callback cb);
@@ -73,6 +81,8 @@ int       ffp_wait_stop_l(FFPlayer *ffp);
 int       ffp_seek_to_offset(FFPlayer *ffp, int64_t offset);
 /* all in milliseconds */
 int       ffp_seek_to_l(FFPlayer *ffp, long msec);
+int       ffp_timeshift_go_live_l(FFPlayer *ffp);
+int       ffp_detach_shared_source_l(FFPlayer *ffp);
 long      ffp_get_current_position_l(FFPlayer *ffp);
 long      ffp_get_duration_l(FFPlayer *ffp);
 long      ffp_get_playable_duration_l(FFPlayer *ffp);
@@ -128,6 +138,8 @@ float     ffp_get_property_float(FFPlayer *ffp, int id, float default_value);
 void      ffp_set_property_float(FFPlayer *ffp, int id, float value);
 int64_t   ffp_get_property_int64(FFPlayer *ffp, int id, int64_t default_value);
 void      ffp_set_property_int64(FFPlayer *ffp, int id, int64_t value);
+IjkThumbnailer *ffp_create_thumbnailer(FFPlayer *ffp, const IjkThumbnailParams *params);
+int       ffp_get_pacing_snapshot(FFPlayer *ffp, IjkPacingSnapshot *snapshot);
 
 int64_t check_tx_stream_unix_time(uint8_t *buffer);
 // must be freed with free();
@@ -66,6 +66,16 @@
 #include "ffplay_format_def.h"
 
 #include "ijksonic.h"
+#include "ijktimeshift.h"
+#include "ijkmemgov.h"
+#include "ijktimestretch.h"
+#include "ijkthroughput.h"
+#include "ijkbufpolicy.h"
+#include "ijkdecshed.h"
+#include "ijktrace.h"
+#include "ijkthumbnail.h"
+#include "ijksharedsrc.h"
+#include "ijkpacing.h"
 
 #define DEFAULT_HIGH_WATER_MARK_IN_BYTES        (256 * 1024)
 
@@ -93,6 +103,9 @@
 #define EXTERNAL_CLOCK_MIN_FRAMES 2
 #define EXTERNAL_CLOCK_MAX_FRAMES 10
 
+#define MEMGOV_UPDATE_INTERVAL      (500 * 1000)    /* us */
+#define PACKET_QUEUE_RECYCLE_KEEP   256
+
 /* Minimum SDL audio buffer size, in samples. */
 #define SDL_AUDIO_MIN_BUFFER_SIZE 512
 /* Calculate actual buffer size keeping in mind not cause too frequent audio callbacks */
@@ -148,6 +161,12 @@ static unsigned sws_flags = SWS_BICUBIC;
 
 #define FFP_PLAY_MAX_PREPARED_VIDEO_SOURCE 20
 
+/* FFPlayer.shared_role, see ijksharedsrc.h */
+#define FFP_SHARED_NONE         0
+#define FFP_SHARED_PUBLISHER    1
+#define FFP_SHARED_SUBSCRIBER   2   // fed by the publisher only
+#define FFP_SHARED_SPLICING     3   // own source open, decoders catching up
+
 typedef struct MyAVPacketList {
     AVEMPacket pkt;
     struct MyAVPacketList *next;
@@ -168,6 +187,7 @@ typedef struct PacketQueue {
     int alloc_count;
 
     int is_buffer_indicator;
+    const char *trace_name;
 } PacketQueue;
 
 // #define VIDEO_PICTURE_QUEUE_SIZE 3
@@ -225,6 +245,8 @@ typedef struct FrameQueue {
     int windex;
     int size;
     int max_size;
+    int depth;          /* <= max_size, lowered by the memory governor */
+    int ring;           /* slots the indexes wrap at, follows depth */
     int keep_last;
     int rindex_shown;
     SDL_mutex *mutex;
@@ -265,6 +287,8 @@ typedef struct Decoder {
     Uint64 first_frame_decoded_time;
     int    first_frame_decoded;
     int    clear_picture_flushed;
+    int    shared;          // frames come from ffp->shared_subscriber
+    double shared_time;     // of the last of them, seconds
 } Decoder;
 
 typedef struct VideoState {
@@ -325,11 +349,15 @@ typedef struct VideoState {
     int audio_hw_buf_size;
     uint8_t *audio_buf;
     uint8_t *audio_buf1;
-    short *audio_new_buffer; //sonic buffer
+    short *audio_new_buffer; //time stretch output
     //uint8_t *audio_buf2;
     unsigned int audio_buf_size; /* in bytes */
     unsigned int audio_buf1_size;
     unsigned int audio_new_buffer_size;
+    IjkTimeStretch *time_stretch;
+    int time_stretch_serial;
+    double audio_stretch_delay;     /* media seconds held in time_stretch */
+    double audio_buf_speed;         /* playback rate of the samples in audio_buf */
     //unsigned int audio_buf2_size;
     int audio_buf_index; /* in bytes */
     int audio_write_buf_size;
@@ -408,6 +436,8 @@ typedef struct VideoState {
 
     int dropping_frame;
     int is_video_high_fps; // above 30fps
+    IjkDecShed *decshed;
+    int decshed_skip_loop_filter;   // avctx->skip_loop_filter before shedding
     int is_video_high_res; // above 1080p
 
     PacketQueue *buffer_indicator_queue;
@@ -422,6 +452,10 @@ typedef struct VideoState {
     int reconnect_retry_count;
     
     int prepared_source; //current video source is prepared.
+
+    int audio_only_stream;  // video stream closed while playing audio only, -1 if none
+    int audio_only_seek;    // seeking back to the audio clock for the reopened video, not reported
+    int pictq_release_req;  // under pictq.mutex, the refresh thread may still show a picture
 } VideoState;
 
 /* options specified by the user */
@@ -514,10 +548,13 @@ typedef struct FFStatistic
     int64_t buf_backwards;
     int64_t buf_forwards;
     int64_t buf_capacity;
+    int64_t buf_parallel;
     SDL_SpeedSampler2 tcp_read_sampler;
     SDL_SpeedSampler3 video_bitrate_sampler;
     SDL_SpeedSampler3 audio_bitrate_sampler;
     int64_t latest_seek_load_duration;
+    int64_t stream_info_duration;
+    int64_t first_frame_duration;
 } FFStatistic;
 
 #define FFP_TCP_READ_SAMPLE_RANGE 2000
@@ -757,7 +794,50 @@ typedef struct FFPlayer {
     // add by ccl time 2020-10-21
     int prepare_source_abort;
     int audio_stream_type;
-    
+
+    int live_fast_open;
+    int live_fast_open_timeout;
+
+    char *timeshift_dir;
+    int timeshift_window;
+    int timeshift_segment;
+    IjkTimeshift *timeshift;
+
+    IjkMemGovClient *memgov;
+    int visible;
+    int mem_max_buffer_size;    /* dcc.max_buffer_size before the governor lowered it */
+    int64_t mem_usage;
+    int64_t mem_quota;
+    int64_t mem_parallel_limit; /* what the queues leave of the quota to async range downloads, -1 unlimited */
+
+    int live_rtmp_direct;
+    int aac_fixed_decoder;
+    int time_stretch_sonic;
+
+    IjkThroughputMeter *throughput_meter;
+
+    int adaptive_buffering;
+    IjkBufPolicy *buf_policy;
+
+    int decode_shedding;
+
+    int shared_source;
+    int shared_role;
+    IjkSharedSource *shared_src;
+    IjkSharedSubscriber *shared_subscriber;
+    int shared_detach_req;
+    int shared_abandon;             /* subscriber leaves without splicing */
+    int64_t shared_dropped;
+    int shared_subscribers;
+    int64_t shared_published;
+
+    int audio_only;                 /* no video demux and decode, e.g. in background */
+
+    IjkPacing *pacing;
+
+    int mp4_moov_prefetch;
+    int mp4_compact_index;
+    int mp4_split_interleave;
 } FFPlayer;
 
 #define fftime_to_milliseconds(ts) (av_em_rescale(ts, 1000, AV_TIME_BASE))
@@ -903,6 +983,47 @@ inline static void ffp_reset_internal(FFPlayer *ffp)
     //add by ccl time 2020-10-21
     ffp->prepare_source_abort = 0;
     ffp->audio_stream_type = 3;
+
+    ffp->live_fast_open = 1;
+    ffp->live_fast_open_timeout = 1500;
+
+    ffp->timeshift_window = 1800;
+    ffp->timeshift_segment = 10;
+    ffp->timeshift = NULL;
+
+    ffp->memgov = NULL;
+    ffp->visible = 1;
+    ffp->mem_max_buffer_size = 0;
+    ffp->mem_usage = 0;
+    ffp->mem_quota = -1;
+    ffp->mem_parallel_limit = -1;
+
+    ffp->live_rtmp_direct = 1;
+    ffp->aac_fixed_decoder = 0;
+    ffp->time_stretch_sonic = 0;
+
+    ffp->throughput_meter = NULL;
+
+    ffp->adaptive_buffering = 0;
+    ffp->buf_policy = NULL;
+
+    ffp->decode_shedding = 1;
+
+    ffp->shared_source = 0;
+    ffp->shared_role = FFP_SHARED_NONE;
+    ffp->shared_src = NULL;
+    ffp->shared_subscriber = NULL;
+    ffp->shared_detach_req = 0;
+    ffp->shared_abandon = 0;
+    ffp->shared_dropped = 0;
+    ffp->shared_subscribers = 0;
+    ffp->shared_published = 0;
+    ffp->audio_only = 0;
+    ffp->pacing = NULL;
+
+    ffp->mp4_moov_prefetch = 1;
+    ffp->mp4_compact_index = 1;
+    ffp->mp4_split_interleave = 8 * 1024 * 1024;
 }
 
 inline static void ffp_notify_msg1(FFPlayer *ffp, int what) {
@@ -77,6 +77,8 @@ static const AVOption ffp_context_options[] = {
         OPTION_OFFSET(infinite_buffer), OPTION_INT(0, 0, 1) },
     { "framedrop",                      "drop frames when cpu is too slow",
         OPTION_OFFSET(framedrop),       OPTION_INT(0, -1, 120) },
+    { "decode-shedding",                "skip loop filter, non-reference pictures, then whole GOPs before decoding when cpu is too slow",
+        OPTION_OFFSET(decode_shedding), OPTION_INT(1, 0, 1) },
     { "seek-at-start",                  "set offset of player should be seeked",
         OPTION_OFFSET(seek_at_start),       OPTION_INT64(0, 0, INT_MAX) },
     // FFP_MERGE: window_title
@@ -138,6 +140,8 @@ static const AVOption ffp_context_options[] = {
 
     { "packet-buffering",                   "pause output until enough packets have been read after stalling",
         OPTION_OFFSET(packet_buffering),    OPTION_INT(1, 0, 1) },
+    { "adaptive-buffering",                 "after stalling, resume at a buffer level picked from throughput, bitrate and recent stalls",
+        OPTION_OFFSET(adaptive_buffering),  OPTION_INT(0, 0, 1) },
     { "sync-av-start",                      "synchronise a/v start time",
         OPTION_OFFSET(sync_av_start),       OPTION_INT(1, 0, 1) },
     { "iformat",                            "force format",
@@ -186,6 +190,10 @@ static const AVOption ffp_context_options[] = {
     },
     { "enable_sonic_handle",                "audio sonic handle:enable",
       OPTION_OFFSET(enable_sonic_handle),    OPTION_INT(0, 0, 1) },
+    { "time_stretch_sonic",                 "change playback rate with the sonic library instead of the built-in time stretch",
+      OPTION_OFFSET(time_stretch_sonic),     OPTION_INT(0, 0, 1) },
+    { "aac-fixed-decoder",                  "decode AAC with the fixed-point decoder when it is built in",
+      OPTION_OFFSET(aac_fixed_decoder),     OPTION_INT(0, 0, 1) },
 
     { "audio_stream_type",                "audio stream typee",
       OPTION_OFFSET(audio_stream_type),    OPTION_INT(3, -1, 10) },
@@ -198,6 +206,36 @@ static const AVOption ffp_context_options[] = {
     
     {"dns_cache_count", "set count for dns cache size",
            OPTION_OFFSET(dns_cache_count), OPTION_INT(-1, -1, 10000)},
+
+    {"live_fast_open", "live flv/rtmp: take codec parameters from stream headers instead of probing",
+           OPTION_OFFSET(live_fast_open), OPTION_INT(1, 0, 1)},
+
+    {"live_fast_open_timeout", "live fast open: fall back to probing after this time (ms)",
+           OPTION_OFFSET(live_fast_open_timeout), OPTION_INT(1500, 100, 10000)},
+
+    {"live_rtmp_direct", "live rtmp: demux rtmp messages directly instead of the flv byte stream",
+           OPTION_OFFSET(live_rtmp_direct), OPTION_INT(1, 0, 1)},
+
+    {"timeshift_dir", "live timeshift: directory of the on-disk ring, disabled if not set",
+           OPTION_OFFSET(timeshift_dir), OPTION_STR(NULL)},
+
+    {"timeshift_window", "live timeshift: seekable window (seconds)",
+           OPTION_OFFSET(timeshift_window), OPTION_INT(1800, 60, 4 * 3600)},
+
+    {"timeshift_segment", "live timeshift: segment file duration (seconds)",
+           OPTION_OFFSET(timeshift_segment), OPTION_INT(10, 2, 120)},
+
+    {"shared_source", "live: show frames of another player of the same url instead of connecting and decoding again",
+           OPTION_OFFSET(shared_source), OPTION_INT(0, 0, 1)},
+
+    {"mp4_moov_prefetch", "http mp4: fetch a trailing moov over a second connection while reading ahead",
+           OPTION_OFFSET(mp4_moov_prefetch), OPTION_INT(1, 0, 1)},
+
+    {"mp4_compact_index", "mp4: keep the sample tables and index a window of samples at a time",
+           OPTION_OFFSET(mp4_compact_index), OPTION_INT(1, 0, 1)},
+
+    {"mp4_split_interleave", "http mp4: read each track over its own connection when tracks lie further apart than this many bytes, 0 to never",
+           OPTION_OFFSET(mp4_split_interleave), OPTION_INT(8 * 1024 * 1024, 0, INT_MAX)},
     
     { NULL }
 };
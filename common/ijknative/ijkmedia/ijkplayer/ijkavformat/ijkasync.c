@@ -46,6 +46,34 @@
 
 #define SHORT_SEEK_THRESHOLD    (256 * 1024)
 
+#define PARALLEL_MAX_CONNECTIONS    8
+#define PARALLEL_ADAPT_GAIN_PERCENT 115
+
+enum {
+    CHUNK_FREE = 0,
+    CHUNK_PENDING,
+    CHUNK_RUNNING,
+    CHUNK_DONE,
+    CHUNK_FAILED,
+};
+
+/* one byte range fetched over its own connection */
+typedef struct RangeChunk {
+    uint8_t        *data;
+    int64_t         pos;
+    int             size;
+    int             filled;     // written by the worker
+    int             consumed;   // moved into the ring
+    int             state;
+    int             cancel;
+} RangeChunk;
+
+typedef struct RangeWorker {
+    EMURLContext   *h;
+    RangeChunk     *chunk;
+    pthread_t       thread;
+} RangeWorker;
+
 typedef struct RingBuffer
 {
     AVFifoBuffer *fifo;
@@ -80,11 +108,45 @@ typedef struct Context {
     int             abort_request;
     AVEMIOInterruptCB interrupt_callback;
 
+    /* logical position right after the last byte in the ring */
+    int64_t         fill_pos;
+    /* c->inner is not at fill_pos, seek before reading from it */
+    int             inner_stale;
+
+    /* parallel range download */
+    char           *inner_url;
+    int             inner_flags;
+    AVEMDictionary   *inner_options;
+    /* what the workers open: the url the hooks and redirects resolved to,
+     * without the application context, its events stay on this thread */
+    char           *range_url;
+    AVEMDictionary   *range_options;
+    int64_t         inner_range_end;    // c->inner fills the ring up to here, the workers fetch what follows
+    int64_t         parallel_mem;       // allocated for chunk data
+    int64_t         parallel_mem_limit; // from the application, -1 for none
+    RangeChunk      chunks[PARALLEL_MAX_CONNECTIONS];
+    RangeWorker     workers[PARALLEL_MAX_CONNECTIONS];
+    int             nb_workers;
+    pthread_cond_t  cond_wakeup_worker;
+    int             parallel_active;
+    int             parallel_disabled;
+    int64_t         parallel_next;      // next byte to hand to a worker
+    int             parallel_k;         // connections in use
+    int             parallel_k_raised;
+    int             parallel_saturated;
+    int64_t         parallel_last_bps;
+    int64_t         window_chunk_bytes;
+    int64_t         window_chunk_us;
+    int             window_chunks;
+
     /* options */
     int64_t         forwards_capacity;
     int64_t         backwards_capacity;
     int64_t         app_ctx_intptr;
     AVApplicationContext *app_ctx;
+    int             parallel_connections;
+    int             parallel_chunk_size;
+    int64_t         parallel_healthy_bytes;
 } Context;
 
 static int ring_init(RingBuffer *ring, int64_t capacity, int64_t read_back_capacity)
@@ -190,7 +252,13 @@ static void call_inject_statistic(EMURLContext *h)
         statistic.buf_forwards  = ring_size(&c->ring);
         statistic.buf_backwards = ring_size_of_read_back(&c->ring);
         statistic.buf_capacity  = c->forwards_capacity + c->backwards_capacity;
+        statistic.buf_parallel  = c->parallel_mem;
+        statistic.buf_parallel_limit = -1;
         av_em_application_on_async_statistic(c->app_ctx, &statistic);
+
+        pthread_mutex_lock(&c->mutex);
+        c->parallel_mem_limit = statistic.buf_parallel_limit;
+        pthread_mutex_unlock(&c->mutex);
     }
 }
 
@@ -209,6 +277,382 @@ static void call_inject_async_fill_speed(EMURLContext *h, int is_full_speed, int
     }
 }
 
+static int64_t parallel_healthy_bytes(Context *c)
+{
+    return c->parallel_healthy_bytes > 0 ? c->parallel_healthy_bytes : c->forwards_capacity / 2;
+}
+
+/* chunk data counts against the forward capacity and the application's limit */
+static int64_t parallel_mem_budget_l(Context *c)
+{
+    if (c->parallel_mem_limit >= 0)
+        return FFMIN(c->forwards_capacity, c->parallel_mem_limit);
+    return c->forwards_capacity;
+}
+
+static void parallel_free_chunk_l(Context *c, RangeChunk *chunk)
+{
+    if (chunk->data) {
+        av_em_freep(&chunk->data);
+        c->parallel_mem -= c->parallel_chunk_size;
+    }
+}
+
+/* a free chunk, with its data allocated if the budget allows */
+static RangeChunk *parallel_get_free_chunk_l(Context *c)
+{
+    RangeChunk *spare = NULL;
+    int i;
+
+    for (i = 0; i < c->parallel_connections; i++) {
+        RangeChunk *chunk = &c->chunks[i];
+        if (chunk->state != CHUNK_FREE)
+            continue;
+        if (chunk->data)
+            return chunk;
+        if (!spare)
+            spare = chunk;
+    }
+    if (!spare || c->parallel_mem + c->parallel_chunk_size > parallel_mem_budget_l(c))
+        return NULL;
+
+    spare->data = av_em_alloc(c->parallel_chunk_size);
+    if (!spare->data)
+        return NULL;
+    c->parallel_mem += c->parallel_chunk_size;
+    return spare;
+}
+
+static int range_check_interrupt(void *arg)
+{
+    RangeWorker *w = arg;
+
+    if (w->chunk && w->chunk->cancel)
+        return 1;
+    return async_check_interrupt(w->h);
+}
+
+static RangeChunk *parallel_pick_pending_l(Context *c)
+{
+    RangeChunk *pick = NULL;
+    int i;
+
+    for (i = 0; i < c->parallel_connections; i++) {
+        RangeChunk *chunk = &c->chunks[i];
+        if (chunk->state == CHUNK_PENDING && (!pick || chunk->pos < pick->pos))
+            pick = chunk;
+    }
+    return pick;
+}
+
+static void parallel_account_chunk_l(Context *c, RangeChunk *chunk, int64_t elapsed)
+{
+    if (elapsed <= 0)
+        return;
+    c->window_chunk_bytes += chunk->size;
+    c->window_chunk_us    += elapsed;
+    c->window_chunks++;
+}
+
+/* fetch one chunk over a connection of its own, bounded by end_offset */
+static int range_fetch_chunk(RangeWorker *w, RangeChunk *chunk)
+{
+    EMURLContext       *h  = w->h;
+    Context            *c  = h->priv_data;
+    EMURLContext       *uc = NULL;
+    AVEMDictionary     *opts = NULL;
+    AVEMIOInterruptCB   interrupt_callback = {.callback = range_check_interrupt, .opaque = w};
+    int64_t             start = av_em_gettime_relative();
+    int                 filled = 0;
+    int                 ret;
+
+    av_em_dict_copy(&opts, c->range_options, 0);
+    av_em_dict_set_int(&opts, "offset", chunk->pos, 0);
+    av_em_dict_set_int(&opts, "end_offset", chunk->pos + chunk->size, 0);
+    ret = ffurl_em_open_whitelist(&uc, c->range_url, c->inner_flags, &interrupt_callback, &opts,
+                                  h->protocol_whitelist, h->protocol_blacklist, h);
+    av_em_dict_free(&opts);
+
+    while (ret >= 0 && filled < chunk->size) {
+        ret = ffurl_em_read(uc, chunk->data + filled, chunk->size - filled);
+        if (ret <= 0) {
+            if (ret == 0)
+                ret = AVERROR_EOF;
+            break;
+        }
+        filled += ret;
+
+        pthread_mutex_lock(&c->mutex);
+        chunk->filled = filled;
+        pthread_cond_signal(&c->cond_wakeup_background);
+        pthread_mutex_unlock(&c->mutex);
+    }
+    ffurl_em_closep(&uc);
+
+    if (filled < chunk->size)
+        return ret < 0 ? ret : AVERROR(EIO);
+
+    pthread_mutex_lock(&c->mutex);
+    parallel_account_chunk_l(c, chunk, av_em_gettime_relative() - start);
+    pthread_mutex_unlock(&c->mutex);
+    return 0;
+}
+
+static void *async_range_task(void *arg)
+{
+    RangeWorker  *w = arg;
+    EMURLContext *h = w->h;
+    Context      *c = h->priv_data;
+    RangeChunk   *chunk;
+    int           ret;
+
+    pthread_mutex_lock(&c->mutex);
+    while (!c->abort_request) {
+        chunk = parallel_pick_pending_l(c);
+        if (!chunk) {
+            pthread_cond_wait(&c->cond_wakeup_worker, &c->mutex);
+            continue;
+        }
+        chunk->state = CHUNK_RUNNING;
+        w->chunk     = chunk;
+        pthread_mutex_unlock(&c->mutex);
+
+        ret = range_fetch_chunk(w, chunk);
+
+        pthread_mutex_lock(&c->mutex);
+        w->chunk = NULL;
+        if (chunk->cancel) {
+            /* parallel download may be over, nobody else releases it */
+            parallel_free_chunk_l(c, chunk);
+            chunk->state = CHUNK_FREE;
+        } else if (ret < 0) {
+            av_em_log(h, AV_LOG_WARNING, "range %"PRId64"+%d failed: %s\n",
+                      chunk->pos, chunk->size, av_err2str(ret));
+            chunk->state = CHUNK_FAILED;
+        } else
+            chunk->state = CHUNK_DONE;
+        pthread_cond_signal(&c->cond_wakeup_background);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+
+/* give back the data of free chunks beyond the budget, all of it if budget is 0 */
+static void parallel_release_l(Context *c, int64_t budget)
+{
+    int i;
+
+    for (i = 0; i < c->parallel_connections && c->parallel_mem > budget; i++) {
+        RangeChunk *chunk = &c->chunks[i];
+        if (chunk->state == CHUNK_FREE)
+            parallel_free_chunk_l(c, chunk);
+    }
+}
+
+/* drop all ranges, running ones are released by their worker */
+static void parallel_cancel_l(Context *c)
+{
+    int i;
+
+    for (i = 0; i < c->parallel_connections; i++) {
+        RangeChunk *chunk = &c->chunks[i];
+        if (chunk->state == CHUNK_RUNNING)
+            chunk->cancel = 1;
+        else
+            chunk->state = CHUNK_FREE;
+    }
+    parallel_release_l(c, 0);
+}
+
+static int parallel_wanted_l(EMURLContext *h)
+{
+    Context *c = h->priv_data;
+
+    return c->parallel_connections > 1 && !c->parallel_active && !c->parallel_disabled &&
+           parallel_mem_budget_l(c) >= 2 * (int64_t)c->parallel_chunk_size &&
+           !c->io_eof_reached && c->logical_size > 0 &&
+           c->logical_size - c->fill_pos > 2 * (int64_t)c->parallel_chunk_size &&
+           ring_size(&c->ring) < parallel_healthy_bytes(c) / 4;
+}
+
+static void parallel_start_l(EMURLContext *h)
+{
+    Context *c = h->priv_data;
+    int i, ret;
+
+    for (i = c->nb_workers; i < c->parallel_connections; i++) {
+        c->workers[i].h = h;
+        ret = pthread_create(&c->workers[i].thread, NULL, async_range_task, &c->workers[i]);
+        if (ret) {
+            av_em_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(ret));
+            goto fail;
+        }
+        c->nb_workers++;
+    }
+
+    /* c->inner is at fill_pos already, it fetches the first range itself */
+    if (c->inner && !c->inner_stale)
+        c->inner_range_end = FFMIN(c->fill_pos + c->parallel_chunk_size, c->logical_size);
+    else
+        c->inner_range_end = c->fill_pos;
+
+    c->parallel_active    = 1;
+    c->parallel_next      = c->inner_range_end;
+    c->parallel_k         = 2;
+    c->parallel_k_raised  = 0;
+    c->parallel_saturated = 0;
+    c->parallel_last_bps  = 0;
+    c->window_chunk_bytes = 0;
+    c->window_chunk_us    = 0;
+    c->window_chunks      = 0;
+    av_em_log(h, AV_LOG_INFO, "parallel download from %"PRId64"\n", c->fill_pos);
+    return;
+fail:
+    c->parallel_disabled = 1;
+}
+
+/*
+ * Hill climbing on per-connection throughput: as long as adding a
+ * connection raises connections * per-flow rate, the flows are limited on
+ * their own (TCP ramp-up, per-connection shaping) and one more helps. When
+ * it does not, the link is full and the last step is undone.
+ */
+static void parallel_adapt_l(EMURLContext *h)
+{
+    Context *c = h->priv_data;
+    int64_t flow_bps, bps;
+
+    if (c->window_chunks < c->parallel_k || c->window_chunk_us <= 0)
+        return;
+
+    flow_bps = c->window_chunk_bytes * 1000000 / c->window_chunk_us;
+    bps      = flow_bps * c->parallel_k;
+    if (c->parallel_k_raised && bps * 100 < c->parallel_last_bps * PARALLEL_ADAPT_GAIN_PERCENT) {
+        c->parallel_k--;
+        c->parallel_k_raised  = 0;
+        c->parallel_saturated = 1;
+    } else if (!c->parallel_saturated && c->parallel_k < c->parallel_connections) {
+        c->parallel_k++;
+        c->parallel_k_raised = 1;
+    } else {
+        c->parallel_k_raised = 0;
+    }
+    av_em_log(h, AV_LOG_DEBUG, "parallel: %"PRId64" B/s per flow, %d connections\n",
+              flow_bps, c->parallel_k);
+
+    c->parallel_last_bps  = bps;
+    c->window_chunk_bytes = 0;
+    c->window_chunk_us    = 0;
+    c->window_chunks      = 0;
+}
+
+/* move ranges into the ring in order and keep parallel_k of them in flight */
+static int parallel_step_l(EMURLContext *h)
+{
+    Context    *c     = h->priv_data;
+    RingBuffer *ring  = &c->ring;
+    int         moved = 0;
+    int         busy  = 0;
+    int         failed = 0;
+    int         i;
+
+    for (i = 0; i < c->parallel_connections; i++) {
+        RangeChunk *chunk = &c->chunks[i];
+        int to_copy;
+
+        if (chunk->state == CHUNK_FREE || chunk->cancel)
+            continue;
+        if (chunk->state == CHUNK_FAILED) {
+            failed = 1;
+            continue;
+        }
+        if (c->fill_pos >= chunk->pos && c->fill_pos < chunk->pos + chunk->size) {
+            to_copy = FFMIN(chunk->filled - chunk->consumed, ring_space(ring));
+            if (to_copy > 0) {
+                ring_generic_write(ring, chunk->data + chunk->consumed, to_copy, NULL);
+                chunk->consumed += to_copy;
+                c->fill_pos     += to_copy;
+                moved           += to_copy;
+                /* the next range may be ready as well */
+                i = -1;
+                continue;
+            }
+        }
+    }
+
+    for (i = 0; i < c->parallel_connections; i++) {
+        RangeChunk *chunk = &c->chunks[i];
+        if (chunk->state == CHUNK_DONE && chunk->consumed >= chunk->size)
+            chunk->state = CHUNK_FREE;
+    }
+    parallel_release_l(c, parallel_mem_budget_l(c));
+
+    if (failed) {
+        /* the server does not like ranges, stay with one connection */
+        av_em_log(h, AV_LOG_WARNING, "parallel download disabled at %"PRId64"\n", c->fill_pos);
+        c->parallel_disabled = 1;
+        parallel_cancel_l(c);
+    } else if (ring_size(ring) < parallel_healthy_bytes(c) &&
+               parallel_mem_budget_l(c) >= 2 * (int64_t)c->parallel_chunk_size) {
+        parallel_adapt_l(h);
+        for (i = 0; i < c->parallel_connections; i++) {
+            if (c->chunks[i].state != CHUNK_FREE && !c->chunks[i].cancel)
+                busy++;
+        }
+        while (busy < c->parallel_k && c->parallel_next < c->logical_size) {
+            RangeChunk *chunk = parallel_get_free_chunk_l(c);
+            if (!chunk)
+                break;
+            chunk->pos      = c->parallel_next;
+            chunk->size     = (int)FFMIN(c->parallel_chunk_size, c->logical_size - c->parallel_next);
+            chunk->filled   = 0;
+            chunk->consumed = 0;
+            chunk->cancel   = 0;
+            chunk->state    = CHUNK_PENDING;
+            c->parallel_next += chunk->size;
+            busy++;
+            pthread_cond_broadcast(&c->cond_wakeup_worker);
+        }
+    }
+
+    busy = 0;
+    for (i = 0; i < c->parallel_connections; i++) {
+        if (c->chunks[i].state != CHUNK_FREE && !c->chunks[i].cancel)
+            busy++;
+    }
+    if (!busy) {
+        /* buffer is healthy, the memory went elsewhere, or nothing is left:
+         * back to the single connection */
+        c->parallel_active = 0;
+        parallel_release_l(c, 0);
+        if (c->fill_pos >= c->logical_size)
+            c->io_eof_reached = 1;
+        av_em_log(h, AV_LOG_INFO, "parallel download done at %"PRId64"\n", c->fill_pos);
+    }
+
+    return moved;
+}
+
+/* c->inner is closed while the range workers fetch, open it again at pos */
+static int64_t async_inner_seek(EMURLContext *h, int64_t pos)
+{
+    Context           *c    = h->priv_data;
+    AVEMDictionary    *opts = NULL;
+    AVEMIOInterruptCB  interrupt_callback = {.callback = async_check_interrupt, .opaque = h};
+    int                ret;
+
+    if (c->inner)
+        return ffurl_em_seek(c->inner, pos, SEEK_SET);
+
+    av_em_dict_copy(&opts, c->inner_options, 0);
+    av_em_dict_set_int(&opts, "offset", pos, 0);
+    ret = ffurl_em_open_whitelist(&c->inner, c->inner_url, c->inner_flags, &interrupt_callback, &opts,
+                                  h->protocol_whitelist, h->protocol_blacklist, h);
+    av_em_dict_free(&opts);
+    return ret < 0 ? ret : pos;
+}
+
 static void *async_buffer_task(void *arg)
 {
     EMURLContext   *h    = arg;
@@ -233,7 +677,16 @@ static void *async_buffer_task(void *arg)
         }
 
         if (c->seek_request) {
-            seek_ret = ffurl_em_seek(c->inner, c->seek_pos, c->seek_whence);
+            if (c->parallel_connections > 1 && !c->parallel_disabled && c->logical_size > 0) {
+                /* the range workers start over from seek_pos, c->inner catches up later */
+                parallel_cancel_l(c);
+                c->parallel_active = 0;
+                c->inner_stale     = 1;
+                seek_ret = c->seek_pos;
+            } else {
+                seek_ret = async_inner_seek(h, c->seek_pos);
+                c->inner_stale = 0;
+            }
             if (seek_ret < 0) {
                 c->io_eof_reached = 1;
                 c->io_error       = (int)seek_ret;
@@ -245,6 +698,8 @@ static void *async_buffer_task(void *arg)
             c->seek_completed = 1;
             c->seek_ret       = seek_ret;
             c->seek_request   = 0;
+            if (seek_ret >= 0)
+                c->fill_pos   = seek_ret;
 
             ring_reset(ring);
 
@@ -255,6 +710,57 @@ static void *async_buffer_task(void *arg)
             continue;
         }
 
+        if (parallel_wanted_l(h))
+            parallel_start_l(h);
+        if (c->parallel_active && c->inner && (c->inner_stale || c->fill_pos >= c->inner_range_end)) {
+            /* the workers fetch from here on, do not leave a response unread meanwhile */
+            c->inner_stale = 1;
+            pthread_mutex_unlock(&c->mutex);
+            ffurl_em_closep(&c->inner);
+            continue;
+        }
+        if (c->parallel_active) {
+            ret = parallel_step_l(h);
+            /* until the end of its range c->inner is read below, no chunk can move meanwhile */
+            if (c->parallel_active && c->fill_pos < c->inner_range_end)
+                goto read_inner;
+            if (ret <= 0 && c->parallel_active)
+                pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_mutex_unlock(&c->mutex);
+            if (ret > 0) {
+                count_bytes += ret;
+                if (count_bytes > FFMIN((1 * 1024 * 1024), c->forwards_capacity)) {
+                    int64_t now = av_em_gettime_relative();
+                    call_inject_async_fill_speed(h, is_full_speed, count_bytes, now - count_start_time_micro);
+                    is_full_speed = 1;
+                    count_bytes = 0;
+                    count_start_time_micro = now;
+                }
+                call_inject_statistic(h);
+            }
+            continue;
+        }
+
+        if (c->inner_stale && !c->io_eof_reached) {
+            int64_t fill_pos = c->fill_pos;
+            pthread_mutex_unlock(&c->mutex);
+            seek_ret = async_inner_seek(h, fill_pos);
+            pthread_mutex_lock(&c->mutex);
+            /* a seek request arriving meanwhile moves fill_pos again */
+            if (!c->seek_request && fill_pos == c->fill_pos) {
+                c->inner_stale = 0;
+                if (seek_ret < 0) {
+                    c->io_eof_reached = 1;
+                    c->io_error       = (int)seek_ret;
+                }
+            }
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_mutex_unlock(&c->mutex);
+            continue;
+        }
+
+read_inner:
         fifo_space = ring_space(ring);
         if (c->io_eof_reached || fifo_space <= 0) {
             pthread_cond_signal(&c->cond_wakeup_main);
@@ -263,11 +769,16 @@ static void *async_buffer_task(void *arg)
             is_full_speed = 0;
             continue;
         }
+        if (c->parallel_active)
+            fifo_space = (int)FFMIN(fifo_space, c->inner_range_end - c->fill_pos);
         pthread_mutex_unlock(&c->mutex);
 
         to_copy = FFMIN(4096, fifo_space);
         ret = ring_generic_write(ring, (void *)h, to_copy, (void *)wrapped_url_read);
         if (ret > 0) {
+            pthread_mutex_lock(&c->mutex);
+            c->fill_pos += ret;
+            pthread_mutex_unlock(&c->mutex);
             count_bytes += ret;
             if (count_bytes > FFMIN((1 * 1024 * 1024), c->forwards_capacity)) {
                 int64_t now = av_em_gettime_relative();
@@ -310,6 +821,15 @@ static int async_open(EMURLContext *h, const char *arg, int flags, AVEMDictionar
         c->app_ctx = (AVApplicationContext *)(intptr_t)c->app_ctx_intptr;
         av_em_dict_set_int(options, "ijkapplication", c->app_ctx_intptr, 0);
     }
+    if (c->parallel_connections > 1) {
+        /* c->inner is reopened with these after parallel download, before the inner open consumes them */
+        c->inner_url   = av_em_strdup(arg);
+        c->inner_flags = flags;
+        if (options)
+            av_em_dict_copy(&c->inner_options, *options, 0);
+        if (!c->inner_url)
+            c->parallel_disabled = 1;
+    }
     /* wrap interrupt callback */
     c->interrupt_callback = h->interrupt_callback;
     ret = ffurl_em_open_whitelist(&c->inner, arg, flags, &interrupt_callback, options, h->protocol_whitelist, h->protocol_blacklist, h);
@@ -321,6 +841,23 @@ static int async_open(EMURLContext *h, const char *arg, int flags, AVEMDictionar
     c->logical_size = ffurl_em_size(c->inner);
     h->is_streamed  = c->inner->is_streamed;
 
+    c->parallel_mem_limit = -1;
+    if (c->parallel_connections > 1 && !c->parallel_disabled) {
+        /* workers go straight to the http url the hooks and redirects resolved to,
+         * the application only sees the events of c->inner, on this thread */
+        uint8_t *location = NULL;
+
+        if (av_em_opt_get(c->inner, "location", AV_OPT_SEARCH_CHILDREN, &location) >= 0 && location && location[0]) {
+            c->range_url = (char *)location;
+        } else {
+            av_em_free(location);
+            av_em_log(h, AV_LOG_INFO, "no http location, parallel download disabled\n");
+            c->parallel_disabled = 1;
+        }
+        av_em_dict_copy(&c->range_options, c->inner_options, 0);
+        av_em_dict_set(&c->range_options, "ijkapplication", NULL, 0);
+    }
+
     ret = pthread_mutex_init(&c->mutex, NULL);
     if (ret != 0) {
         av_em_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", av_err2str(ret));
@@ -339,6 +876,15 @@ static int async_open(EMURLContext *h, const char *arg, int flags, AVEMDictionar
         goto cond_wakeup_background_fail;
     }
 
+    ret = pthread_cond_init(&c->cond_wakeup_worker, NULL);
+    if (ret != 0) {
+        av_em_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(ret));
+        goto cond_wakeup_worker_fail;
+    }
+
+    /* let the application set the chunk memory limit before ranges start */
+    call_inject_statistic(h);
+
     ret = pthread_create(&c->async_buffer_thread, NULL, async_buffer_task, h);
     if (ret) {
         av_em_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(ret));
@@ -348,6 +894,8 @@ static int async_open(EMURLContext *h, const char *arg, int flags, AVEMDictionar
     return 0;
 
 thread_fail:
+    pthread_cond_destroy(&c->cond_wakeup_worker);
+cond_wakeup_worker_fail:
     pthread_cond_destroy(&c->cond_wakeup_background);
 cond_wakeup_background_fail:
     pthread_cond_destroy(&c->cond_wakeup_main);
@@ -356,6 +904,10 @@ cond_wakeup_main_fail:
 mutex_fail:
     ffurl_em_close(c->inner);
 url_fail:
+    av_em_freep(&c->inner_url);
+    av_em_dict_free(&c->inner_options);
+    av_em_freep(&c->range_url);
+    av_em_dict_free(&c->range_options);
     ring_destroy(&c->ring);
 fifo_fail:
     return ret;
@@ -365,21 +917,35 @@ static int async_close(EMURLContext *h)
 {
     Context *c = h->priv_data;
     int      ret;
+    int      i;
 
     pthread_mutex_lock(&c->mutex);
     c->abort_request = 1;
     pthread_cond_signal(&c->cond_wakeup_background);
+    pthread_cond_broadcast(&c->cond_wakeup_worker);
     pthread_mutex_unlock(&c->mutex);
 
     ret = pthread_join(c->async_buffer_thread, NULL);
     if (ret != 0)
         av_em_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(ret));
+    for (i = 0; i < c->nb_workers; i++) {
+        ret = pthread_join(c->workers[i].thread, NULL);
+        if (ret != 0)
+            av_em_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(ret));
+    }
 
+    pthread_cond_destroy(&c->cond_wakeup_worker);
     pthread_cond_destroy(&c->cond_wakeup_background);
     pthread_cond_destroy(&c->cond_wakeup_main);
     pthread_mutex_destroy(&c->mutex);
     ffurl_em_close(c->inner);
     ring_destroy(&c->ring);
+    for (i = 0; i < PARALLEL_MAX_CONNECTIONS; i++)
+        av_em_freep(&c->chunks[i].data);
+    av_em_freep(&c->inner_url);
+    av_em_dict_free(&c->inner_options);
+    av_em_freep(&c->range_url);
+    av_em_dict_free(&c->range_options);
 
     return 0;
 }
@@ -535,6 +1101,12 @@ static const AVOption options[] = {
     { "async-backwards-capacity",   "max bytes that may be seek backward without seeking in inner protocol",
         OFFSET(backwards_capacity), AV_OPT_TYPE_INT64, {.i64 = 128 * 1024}, 128 * 1024, 128 * 1024 * 1024, D },
     { "ijkapplication", "AVApplicationContext", OFFSET(app_ctx_intptr), AV_OPT_TYPE_INT64, { .i64 = 0 }, INT64_MIN, INT64_MAX, .flags = D },
+    { "async-parallel-connections", "max connections fetching byte ranges in parallel while the buffer fills, 0 or 1 disables",
+        OFFSET(parallel_connections), AV_OPT_TYPE_INT, {.i64 = 0}, 0, PARALLEL_MAX_CONNECTIONS, D },
+    { "async-parallel-chunk-size", "bytes fetched per range request, the chunks in flight count against the forwards capacity",
+        OFFSET(parallel_chunk_size), AV_OPT_TYPE_INT, {.i64 = 512 * 1024}, 64 * 1024, 8 * 1024 * 1024, D },
+    { "async-parallel-healthy-bytes", "forward buffer at which parallel download stops, 0 for half the forwards capacity",
+        OFFSET(parallel_healthy_bytes), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, 128 * 1024 * 1024, D },
     {NULL},
 };
 
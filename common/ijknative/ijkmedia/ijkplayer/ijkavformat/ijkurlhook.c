@@ -435,11 +435,19 @@ static const AVOption ijkhttphook_options[] = {
 #undef D
 #undef OFFSET
 
+/* lets the options of the inner protocol, e.g. the http location, be read through the hook */
+static void *ijkurlhook_child_next(void *obj, void *prev)
+{
+    Context *c = obj;
+    return prev ? NULL : c->inner;
+}
+
 static const AVEMClass ijktcphook_context_class = {
     .class_name = "TcpHook",
     .item_name  = av_em_default_item_name,
     .option     = ijktcphook_options,
     .version    = LIBAVUTIL_VERSION_INT,
+    .child_next = ijkurlhook_child_next,
 };
 
 EMURLProtocol ijkem_ijktcphook_protocol = {
@@ -457,6 +465,7 @@ static const AVEMClass ijkhttphook_context_class = {
     .item_name  = av_em_default_item_name,
     .option     = ijkhttphook_options,
     .version    = LIBAVUTIL_VERSION_INT,
+    .child_next = ijkurlhook_child_next,
 };
 
 EMURLProtocol ijkem_ijkhttphook_protocol = {
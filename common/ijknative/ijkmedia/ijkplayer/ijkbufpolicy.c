@@ -0,0 +1,102 @@
+//
+// ijkbufpolicy.c
+//
+
+#include "ijkbufpolicy.h"
+#include <pthread.h>
+#include "libavutil/mem.h"
+
+#define BUFPOLICY_MAX_STALLS    16
+
+struct IjkBufPolicy {
+    pthread_mutex_t mutex;
+    int             min_ms;
+    int             step_ms;
+    int             max_ms;
+    int64_t         stalls[BUFPOLICY_MAX_STALLS];   // ring of stall times
+    int             nb_stalls;
+    int             stall_pos;
+};
+
+IjkBufPolicy *ijk_bufpolicy_create(int min_ms, int step_ms, int max_ms)
+{
+    IjkBufPolicy *policy = av_em_mallocz(sizeof(IjkBufPolicy));
+    if (!policy)
+        return NULL;
+
+    pthread_mutex_init(&policy->mutex, NULL);
+    policy->min_ms  = min_ms > 0 ? min_ms : 0;
+    policy->step_ms = step_ms > 0 ? step_ms : 0;
+    policy->max_ms  = max_ms > policy->min_ms ? max_ms : policy->min_ms;
+    return policy;
+}
+
+void ijk_bufpolicy_destroy(IjkBufPolicy **ppolicy)
+{
+    if (!ppolicy || !*ppolicy)
+        return;
+
+    pthread_mutex_destroy(&(*ppolicy)->mutex);
+    av_em_freep(ppolicy);
+}
+
+void ijk_bufpolicy_on_stall(IjkBufPolicy *policy, int64_t now_ms)
+{
+    if (!policy)
+        return;
+
+    pthread_mutex_lock(&policy->mutex);
+    policy->stalls[policy->stall_pos] = now_ms;
+    policy->stall_pos = (policy->stall_pos + 1) % BUFPOLICY_MAX_STALLS;
+    if (policy->nb_stalls < BUFPOLICY_MAX_STALLS)
+        policy->nb_stalls++;
+    pthread_mutex_unlock(&policy->mutex);
+}
+
+static int bufpolicy_recent_stalls_l(IjkBufPolicy *policy, int64_t now_ms)
+{
+    int recent = 0;
+    int i;
+
+    for (i = 0; i < policy->nb_stalls; i++) {
+        int64_t age = now_ms - policy->stalls[i];
+        if (age >= 0 && age < IJK_BUFPOLICY_STALL_WINDOW_MS)
+            recent++;
+    }
+    return recent;
+}
+
+int ijk_bufpolicy_get_resume_ms(IjkBufPolicy *policy, int64_t now_ms,
+                                int64_t rate, int64_t low_rate, int64_t bitrate)
+{
+    double ratio, deficit;
+    int64_t resume_ms, reachable_ms;
+
+    if (!policy || rate <= 0 || bitrate <= 0)
+        return -1;
+
+    if (low_rate <= 0 || low_rate > rate)
+        low_rate = rate;
+
+    /* 0 when the network safely outruns the media, 1 when it delivers nothing */
+    ratio = (double)low_rate / bitrate;
+    deficit = 1.0 - ratio / IJK_BUFPOLICY_SAFE_RATIO;
+    if (deficit < 0.0)
+        deficit = 0.0;
+
+    pthread_mutex_lock(&policy->mutex);
+    resume_ms  = policy->min_ms + (int64_t)(deficit * (policy->max_ms - policy->min_ms));
+    resume_ms += (int64_t)bufpolicy_recent_stalls_l(policy, now_ms) * policy->step_ms;
+    if (resume_ms > policy->max_ms)
+        resume_ms = policy->max_ms;
+
+    /* do not wait longer than IJK_BUFPOLICY_MAX_WAIT_MS at the current rate */
+    reachable_ms = IJK_BUFPOLICY_MAX_WAIT_MS * rate / bitrate;
+    if (resume_ms > reachable_ms)
+        resume_ms = reachable_ms;
+    if (resume_ms < policy->min_ms)
+        resume_ms = policy->min_ms;
+    pthread_mutex_unlock(&policy->mutex);
+
+    return (int)resume_ms;
+}
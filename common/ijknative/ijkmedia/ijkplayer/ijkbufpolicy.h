@@ -0,0 +1,47 @@
+//
+// ijkbufpolicy.h
+//
+// Adaptive rebuffering threshold.
+//
+// After a stall the player resumes once the queues hold the returned amount
+// of media. The amount follows the buffer based approaches (BBA, BOLA): the
+// less the network outruns the media, the larger the cushion, from min_ms
+// when the conservative download rate is IJK_BUFPOLICY_SAFE_RATIO times the
+// bitrate or more up to max_ms when it does not keep up at all. While the
+// download rate is below the bitrate the share of time spent stalled is
+// (1 - rate / bitrate) whatever the threshold is, so a larger cushion only
+// trades many short stalls for fewer long ones, which is what viewers
+// prefer. Every stall within IJK_BUFPOLICY_STALL_WINDOW_MS adds step_ms on
+// top, and the total is capped so that it can be downloaded within
+// IJK_BUFPOLICY_MAX_WAIT_MS.
+//
+// The policy has no clock of its own, time only enters through the
+// arguments.
+//
+
+#ifndef IJKMEDIA_IJKBUFPOLICY_H
+#define IJKMEDIA_IJKBUFPOLICY_H
+
+#include <stdint.h>
+
+#define IJK_BUFPOLICY_SAFE_RATIO        1.5
+#define IJK_BUFPOLICY_STALL_WINDOW_MS   (60 * 1000)
+#define IJK_BUFPOLICY_MAX_WAIT_MS       (10 * 1000)
+
+typedef struct IjkBufPolicy IjkBufPolicy;
+
+IjkBufPolicy *ijk_bufpolicy_create(int min_ms, int step_ms, int max_ms);
+void          ijk_bufpolicy_destroy(IjkBufPolicy **policy);
+
+/* playback ran dry */
+void          ijk_bufpolicy_on_stall(IjkBufPolicy *policy, int64_t now_ms);
+
+/*
+ * Rates in bytes per second, low_rate is a pessimistic download rate such
+ * as a low percentile, 0 if unknown. Returns the ms of media to buffer
+ * before resuming, -1 if download rate or bitrate is unknown.
+ */
+int           ijk_bufpolicy_get_resume_ms(IjkBufPolicy *policy, int64_t now_ms,
+                                          int64_t rate, int64_t low_rate, int64_t bitrate);
+
+#endif //IJKMEDIA_IJKBUFPOLICY_H
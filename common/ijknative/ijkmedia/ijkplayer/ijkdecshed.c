@@ -0,0 +1,191 @@
+//
+// ijkdecshed.c
+//
+
+#include "ijkdecshed.h"
+#include <math.h>
+#include "libavutil/mem.h"
+
+struct IjkDecShed {
+    enum AVEMCodecID codec_id;
+    int     nal_length_size;    // 0 for Annex B
+    int     max_temporal_id;    // HEVC, -1 while unknown
+    int     level;
+    int64_t last_change;
+    int     wait_keyframe;
+    int64_t dropped;
+};
+
+IjkDecShed *ijk_decshed_create(enum AVEMCodecID codec_id, const uint8_t *extradata, int extradata_size)
+{
+    IjkDecShed *shed = av_em_mallocz(sizeof(IjkDecShed));
+    if (!shed)
+        return NULL;
+
+    shed->codec_id        = codec_id;
+    shed->max_temporal_id = -1;
+    shed->last_change     = INT64_MIN / 2;
+
+    if (codec_id == AV_CODEC_ID_H264) {
+        /* avcC */
+        if (extradata && extradata_size >= 7 && extradata[0] == 1)
+            shed->nal_length_size = (extradata[4] & 3) + 1;
+    } else if (codec_id == AV_CODEC_ID_HEVC) {
+        /* hvcC, detected the way the hevc decoder does */
+        if (extradata && extradata_size >= 23 && (extradata[0] || extradata[1] || extradata[2] > 1)) {
+            int nb_temporal_layers = (extradata[21] >> 3) & 7;
+            shed->nal_length_size = (extradata[21] & 3) + 1;
+            if (nb_temporal_layers > 0)
+                shed->max_temporal_id = nb_temporal_layers - 1;
+        }
+    }
+    return shed;
+}
+
+void ijk_decshed_destroy(IjkDecShed **pshed)
+{
+    av_em_freep(pshed);
+}
+
+int ijk_decshed_update(IjkDecShed *shed, int64_t now_ms, double load, double lag)
+{
+    int overloaded, relaxed;
+
+    if (!shed)
+        return IJK_DECSHED_NONE;
+
+    overloaded = load > IJK_DECSHED_HIGH_LOAD || (!isnan(lag) && lag > IJK_DECSHED_HIGH_LAG);
+    relaxed    = load < IJK_DECSHED_LOW_LOAD && (isnan(lag) || lag < IJK_DECSHED_LOW_LAG);
+
+    if (overloaded) {
+        if (now_ms - shed->last_change >= IJK_DECSHED_ESCALATE_MS) {
+            int max_level = (!isnan(lag) && lag > IJK_DECSHED_KEYFRAME_LAG) ? IJK_DECSHED_DROP_TO_KEYFRAME
+                                                                             : IJK_DECSHED_DROP_NONREF;
+            if (shed->level < max_level) {
+                shed->level++;
+                shed->last_change = now_ms;
+                if (shed->level == IJK_DECSHED_DROP_TO_KEYFRAME)
+                    shed->wait_keyframe = 1;
+            } else if (shed->level == IJK_DECSHED_DROP_TO_KEYFRAME && max_level == IJK_DECSHED_DROP_TO_KEYFRAME &&
+                       !shed->wait_keyframe) {
+                /* still far behind after the last keyframe */
+                shed->wait_keyframe = 1;
+                shed->last_change = now_ms;
+            }
+        }
+    } else if (relaxed && shed->level > IJK_DECSHED_NONE) {
+        if (now_ms - shed->last_change >= IJK_DECSHED_RELAX_MS) {
+            shed->level--;
+            shed->last_change = now_ms;
+            if (shed->level < IJK_DECSHED_DROP_TO_KEYFRAME)
+                shed->wait_keyframe = 0;
+        }
+    }
+    return shed->level;
+}
+
+int ijk_decshed_get_level(IjkDecShed *shed)
+{
+    return shed ? shed->level : IJK_DECSHED_NONE;
+}
+
+int64_t ijk_decshed_get_dropped(IjkDecShed *shed)
+{
+    return shed ? shed->dropped : 0;
+}
+
+/* 1: non-reference slice, 0: reference slice, -1: not a slice */
+static int decshed_nal_is_nonref(IjkDecShed *shed, const uint8_t *nal, int size)
+{
+    if (shed->codec_id == AV_CODEC_ID_H264) {
+        int type = nal[0] & 0x1f;
+        if (type < 1 || type > 5)
+            return -1;
+        return (nal[0] & 0x60) == 0;
+    } else {
+        int type, temporal_id;
+        if (size < 2)
+            return -1;
+        type        = (nal[0] >> 1) & 0x3f;
+        temporal_id = (nal[1] & 7) - 1;
+        if (type > 31)
+            return -1;
+        if (temporal_id > shed->max_temporal_id)
+            shed->max_temporal_id = temporal_id;
+        /* sub-layer non-reference (TRAIL_N, TSA_N, STSA_N, RADL_N, RASL_N, RSV_VCL_N*),
+         * only pictures of the highest sub-layer are referenced by no one */
+        return type <= 14 && !(type & 1) && temporal_id == shed->max_temporal_id;
+    }
+}
+
+/* a picture can be dropped if it has slices and none of them is a reference */
+static int decshed_packet_is_nonref(IjkDecShed *shed, const uint8_t *data, int size)
+{
+    const uint8_t *p = data, *end = data + size;
+    int nb_slices = 0;
+
+    if (shed->nal_length_size > 0) {
+        while (end - p > shed->nal_length_size) {
+            int64_t nal_size = 0;
+            int i, ret;
+
+            for (i = 0; i < shed->nal_length_size; i++)
+                nal_size = (nal_size << 8) | *p++;
+            if (nal_size <= 0 || nal_size > end - p)
+                return 0;
+
+            ret = decshed_nal_is_nonref(shed, p, (int)nal_size);
+            if (ret == 0)
+                return 0;
+            nb_slices += ret > 0;
+            p += nal_size;
+        }
+    } else {
+        while (end - p > 3) {
+            const uint8_t *nal;
+            int ret;
+
+            if (p[0] || p[1] || p[2] != 1) {
+                p++;
+                continue;
+            }
+            nal = p + 3;
+            for (p = nal; end - p > 3 && (p[0] || p[1] || p[2] != 1); p++)
+                ;
+            if (end - p <= 3)
+                p = end;
+
+            ret = decshed_nal_is_nonref(shed, nal, (int)(p - nal));
+            if (ret == 0)
+                return 0;
+            nb_slices += ret > 0;
+        }
+    }
+    return nb_slices > 0;
+}
+
+int ijk_decshed_drop_packet(IjkDecShed *shed, const uint8_t *data, int size, int is_key)
+{
+    if (!shed || !data || size <= 0)
+        return 0;
+
+    if (shed->wait_keyframe) {
+        if (!is_key) {
+            shed->dropped++;
+            return 1;
+        }
+        shed->wait_keyframe = 0;
+        return 0;
+    }
+
+    if (shed->level < IJK_DECSHED_DROP_NONREF || is_key)
+        return 0;
+    if (shed->codec_id != AV_CODEC_ID_H264 && shed->codec_id != AV_CODEC_ID_HEVC)
+        return 0;
+
+    if (decshed_packet_is_nonref(shed, data, size)) {
+        shed->dropped++;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+//
+// ijkdecshed.h
+//
+// Load adaptive decode shedding.
+//
+// When the software decoder cannot keep up, dropping late frames after they
+// were decoded saves nothing. The shedder is a closed loop controller fed
+// with the decode cost per frame and the lag of video behind the master
+// clock, it escalates one level at a time while either is too high and
+// steps back once both show headroom again:
+//
+//   IJK_DECSHED_SKIP_LOOP_FILTER   no loop filter on non-reference frames
+//   IJK_DECSHED_DROP_NONREF        non-reference pictures are dropped as
+//                                  packets, before the decoder sees them
+//   IJK_DECSHED_DROP_TO_KEYFRAME   everything up to the next keyframe is
+//                                  dropped, only when far behind
+//
+// Non-reference pictures are found from nal_ref_idc for H.264 and from the
+// NAL unit type for HEVC, in both Annex B and length prefixed packets.
+// Other codecs only get the loop filter and keyframe levels.
+//
+
+#ifndef IJKMEDIA_IJKDECSHED_H
+#define IJKMEDIA_IJKDECSHED_H
+
+#include <stdint.h>
+#include "libavcodec/avcodec.h"
+
+enum {
+    IJK_DECSHED_NONE = 0,
+    IJK_DECSHED_SKIP_LOOP_FILTER,
+    IJK_DECSHED_DROP_NONREF,
+    IJK_DECSHED_DROP_TO_KEYFRAME,
+    IJK_DECSHED_NB,
+};
+
+/* escalate when a frame costs more than this share of its display time */
+#define IJK_DECSHED_HIGH_LOAD       0.9
+/* de-escalate below this share */
+#define IJK_DECSHED_LOW_LOAD        0.6
+/* seconds behind the master clock */
+#define IJK_DECSHED_HIGH_LAG        0.1
+#define IJK_DECSHED_LOW_LAG         0.02
+#define IJK_DECSHED_KEYFRAME_LAG    0.5
+/* least time between two level changes, going up and going down */
+#define IJK_DECSHED_ESCALATE_MS     500
+#define IJK_DECSHED_RELAX_MS        2000
+
+typedef struct IjkDecShed IjkDecShed;
+
+IjkDecShed *ijk_decshed_create(enum AVEMCodecID codec_id, const uint8_t *extradata, int extradata_size);
+void        ijk_decshed_destroy(IjkDecShed **shed);
+
+/*
+ * load is the decode time of a frame over its display time, lag how many
+ * seconds the last frame is behind the master clock (NAN if unknown).
+ * Returns the level in effect from now on.
+ */
+int         ijk_decshed_update(IjkDecShed *shed, int64_t now_ms, double load, double lag);
+int         ijk_decshed_get_level(IjkDecShed *shed);
+
+/* 1 if the packet should not be decoded at the current level */
+int         ijk_decshed_drop_packet(IjkDecShed *shed, const uint8_t *data, int size, int is_key);
+int64_t     ijk_decshed_get_dropped(IjkDecShed *shed);
+
+#endif //IJKMEDIA_IJKDECSHED_H
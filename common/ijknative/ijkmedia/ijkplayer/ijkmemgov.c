@@ -0,0 +1,128 @@
+//
+// ijkmemgov.c
+//
+
+#include "ijkmemgov.h"
+#include <pthread.h>
+#include "libavutil/mem.h"
+
+/* share of the budget above the per-client floor, by priority */
+static const int g_memgov_weights[IJK_MEMGOV_PRIO_NB] = { 4, 2, 1 };
+
+struct IjkMemGovClient {
+    int                     priority;
+    int64_t                 usage;
+    int64_t                 quota;
+    struct IjkMemGovClient *next;
+};
+
+static pthread_mutex_t  g_memgov_mutex = PTHREAD_MUTEX_INITIALIZER;
+static IjkMemGovClient *g_memgov_clients = NULL;
+static int64_t          g_memgov_budget = 0;
+
+static int64_t memgov_quota_l(IjkMemGovClient *client)
+{
+    IjkMemGovClient *c;
+    int64_t spare;
+    int nb_clients = 0;
+    int sum_weight = 0;
+
+    if (g_memgov_budget <= 0)
+        return -1;
+
+    for (c = g_memgov_clients; c; c = c->next) {
+        nb_clients++;
+        sum_weight += g_memgov_weights[c->priority];
+    }
+    if (nb_clients <= 0)
+        return g_memgov_budget;
+
+    spare = g_memgov_budget - (int64_t)nb_clients * IJK_MEMGOV_MIN_QUOTA;
+    if (spare <= 0)
+        return g_memgov_budget / nb_clients;
+
+    return IJK_MEMGOV_MIN_QUOTA + spare * g_memgov_weights[client->priority] / sum_weight;
+}
+
+void ijk_memgov_set_budget(int64_t bytes)
+{
+    pthread_mutex_lock(&g_memgov_mutex);
+    g_memgov_budget = bytes > 0 ? bytes : 0;
+    pthread_mutex_unlock(&g_memgov_mutex);
+}
+
+int64_t ijk_memgov_get_budget(void)
+{
+    int64_t budget;
+
+    pthread_mutex_lock(&g_memgov_mutex);
+    budget = g_memgov_budget;
+    pthread_mutex_unlock(&g_memgov_mutex);
+    return budget;
+}
+
+int64_t ijk_memgov_get_total_usage(void)
+{
+    IjkMemGovClient *c;
+    int64_t usage = 0;
+
+    pthread_mutex_lock(&g_memgov_mutex);
+    for (c = g_memgov_clients; c; c = c->next)
+        usage += c->usage;
+    pthread_mutex_unlock(&g_memgov_mutex);
+    return usage;
+}
+
+IjkMemGovClient *ijk_memgov_register(void)
+{
+    IjkMemGovClient *client = av_em_mallocz(sizeof(IjkMemGovClient));
+    if (!client)
+        return NULL;
+
+    client->priority = IJK_MEMGOV_PRIO_PREPARED;
+    client->quota    = -1;
+
+    pthread_mutex_lock(&g_memgov_mutex);
+    client->next = g_memgov_clients;
+    g_memgov_clients = client;
+    pthread_mutex_unlock(&g_memgov_mutex);
+    return client;
+}
+
+void ijk_memgov_unregister(IjkMemGovClient **pclient)
+{
+    IjkMemGovClient **p;
+
+    if (!pclient || !*pclient)
+        return;
+
+    pthread_mutex_lock(&g_memgov_mutex);
+    for (p = &g_memgov_clients; *p; p = &(*p)->next) {
+        if (*p == *pclient) {
+            *p = (*pclient)->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_memgov_mutex);
+
+    av_em_freep(pclient);
+}
+
+int64_t ijk_memgov_update(IjkMemGovClient *client, int priority, int64_t usage)
+{
+    int64_t quota;
+
+    if (!client)
+        return -1;
+
+    if (priority < 0 || priority >= IJK_MEMGOV_PRIO_NB)
+        priority = IJK_MEMGOV_PRIO_PAUSED;
+
+    pthread_mutex_lock(&g_memgov_mutex);
+    client->priority = priority;
+    client->usage    = usage;
+    client->quota    = memgov_quota_l(client);
+    quota = client->quota;
+    pthread_mutex_unlock(&g_memgov_mutex);
+    return quota;
+}
@@ -0,0 +1,41 @@
+//
+// ijkmemgov.h
+//
+// Process-wide memory governor for player buffers.
+//
+// Every open player registers a client and periodically reports how many
+// bytes its packet and picture queues hold together with its priority. The
+// governor splits one byte budget among all clients, higher priorities get
+// a larger share, and hands each client its quota back. Applying the quota
+// (shrinking queues, trimming recycle lists) is up to the player.
+//
+
+#ifndef IJKMEDIA_IJKMEMGOV_H
+#define IJKMEDIA_IJKMEMGOV_H
+
+#include <stdint.h>
+
+enum {
+    IJK_MEMGOV_PRIO_ACTIVE = 0,     // visible and playing
+    IJK_MEMGOV_PRIO_PREPARED,       // opened but not started, or playing hidden
+    IJK_MEMGOV_PRIO_PAUSED,
+    IJK_MEMGOV_PRIO_NB,
+};
+
+/* no client is squeezed below this, unless the budget itself is smaller */
+#define IJK_MEMGOV_MIN_QUOTA    (512 * 1024)
+
+typedef struct IjkMemGovClient IjkMemGovClient;
+
+/* 0 disables the governor, every client then gets -1 (unlimited) */
+void             ijk_memgov_set_budget(int64_t bytes);
+int64_t          ijk_memgov_get_budget(void);
+int64_t          ijk_memgov_get_total_usage(void);
+
+IjkMemGovClient *ijk_memgov_register(void);
+void             ijk_memgov_unregister(IjkMemGovClient **client);
+
+/* report usage and priority, returns the byte quota of this client or -1 */
+int64_t          ijk_memgov_update(IjkMemGovClient *client, int priority, int64_t usage);
+
+#endif //IJKMEDIA_IJKMEMGOV_H
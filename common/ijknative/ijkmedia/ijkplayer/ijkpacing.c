@@ -0,0 +1,319 @@
+//
+// ijkpacing.c
+//
+
+#include "ijkpacing.h"
+#include <math.h>
+#include <string.h>
+#include "libavutil/mem.h"
+#include "ijksdl/ijksdl_mutex.h"
+
+/* a picture held this much longer than its duration was held for sync */
+#define PACING_SYNC_HOLD        1.5
+
+static const double g_interval_edges[IJK_PACING_INTERVAL_BUCKETS - 1] = {
+    0.5, 0.8, 1.2, 1.5, 2.5, 3.5, 5.5,
+};
+
+static const double g_avdiff_edges[IJK_PACING_AVDIFF_BUCKETS - 1] = {
+    -0.200, -0.125, -0.045, -0.015, 0.015, 0.045, 0.125, 0.200,
+};
+
+struct IjkPacing {
+    SDL_mutex  *mutex;
+
+    int64_t     frames;
+    double      error_sum;
+    double      error_max;
+
+    int64_t     nb_intervals;
+    double      interval_sum;
+    double      interval_sum2;
+    int64_t     interval_hist[IJK_PACING_INTERVAL_BUCKETS];
+
+    int64_t     skips[IJK_PACING_SKIP_NB];
+    int64_t     repeats[IJK_PACING_REPEAT_NB];
+
+    double      last_shown;         // NAN after a break
+    double      last_due;
+    double      last_duration;
+    int         starved;            // the queue ran dry since the last picture
+
+    int64_t     nb_avdiffs;
+    double      avdiff_sum;
+    double      avdiff_max;
+    int64_t     avdiff_hist[IJK_PACING_AVDIFF_BUCKETS];
+
+    IjkPacingWindow windows[IJK_PACING_AVDIFF_WINDOWS];
+    int         next_window;
+    int         nb_windows;
+    int64_t     window_start_ms;
+    int         window_count;
+    double      window_sum;
+    double      window_max;
+
+    int         audio_started;      // audio thread, cleared by a break
+    int         audio_underrun;     // audio thread only
+    int64_t     audio_underruns;
+    int64_t     audio_underrun_us;
+
+    int64_t     last_report_ms;
+};
+
+static int pacing_bucket(const double *edges, int nb_edges, double value)
+{
+    int i;
+
+    for (i = 0; i < nb_edges; i++) {
+        if (value < edges[i])
+            break;
+    }
+    return i;
+}
+
+static int32_t pacing_to_us32(double seconds)
+{
+    double us = seconds * 1000000.0;
+
+    if (us > INT32_MAX)
+        return INT32_MAX;
+    if (us < -INT32_MAX)
+        return -INT32_MAX;
+    return (int32_t)us;
+}
+
+static void pacing_close_window(IjkPacing *pacing)
+{
+    IjkPacingWindow *window;
+
+    if (!pacing->window_count)
+        return;
+
+    window = &pacing->windows[pacing->next_window];
+    window->start_ms      = pacing->window_start_ms;
+    window->avdiff_avg_us = pacing_to_us32(pacing->window_sum / pacing->window_count);
+    window->avdiff_max_us = pacing_to_us32(pacing->window_max);
+
+    pacing->next_window = (pacing->next_window + 1) % IJK_PACING_AVDIFF_WINDOWS;
+    if (pacing->nb_windows < IJK_PACING_AVDIFF_WINDOWS)
+        pacing->nb_windows++;
+    pacing->window_count = 0;
+    pacing->window_sum   = 0;
+    pacing->window_max   = 0;
+}
+
+static void pacing_add_avdiff(IjkPacing *pacing, double now, double avdiff)
+{
+    int64_t now_ms = (int64_t)(now * 1000);
+
+    pacing->nb_avdiffs++;
+    pacing->avdiff_sum += avdiff;
+    if (fabs(avdiff) > pacing->avdiff_max)
+        pacing->avdiff_max = fabs(avdiff);
+    pacing->avdiff_hist[pacing_bucket(g_avdiff_edges, IJK_PACING_AVDIFF_BUCKETS - 1, avdiff)]++;
+
+    if (pacing->window_count && now_ms - pacing->window_start_ms >= IJK_PACING_WINDOW_MS)
+        pacing_close_window(pacing);
+    if (!pacing->window_count)
+        pacing->window_start_ms = now_ms;
+    pacing->window_count++;
+    pacing->window_sum += avdiff;
+    if (fabs(avdiff) > pacing->window_max)
+        pacing->window_max = fabs(avdiff);
+}
+
+IjkPacing *ijk_pacing_create(void)
+{
+    IjkPacing *pacing = av_em_mallocz(sizeof(IjkPacing));
+    if (!pacing)
+        return NULL;
+
+    pacing->mutex = SDL_CreateMutex();
+    if (!pacing->mutex) {
+        av_em_free(pacing);
+        return NULL;
+    }
+    pacing->last_shown = NAN;
+    return pacing;
+}
+
+void ijk_pacing_destroy(IjkPacing **ppacing)
+{
+    IjkPacing *pacing;
+
+    if (!ppacing || !*ppacing)
+        return;
+
+    pacing = *ppacing;
+    SDL_DestroyMutexP(&pacing->mutex);
+    av_em_freep(ppacing);
+}
+
+void ijk_pacing_frame_shown(IjkPacing *pacing, double now, double due, double duration,
+                            double delay, double avdiff, int continuous)
+{
+    double error;
+
+    if (!pacing)
+        return;
+
+    SDL_LockMutex(pacing->mutex);
+    error = now - due;
+    pacing->frames++;
+    pacing->error_sum += error;
+    if (fabs(error) > pacing->error_max)
+        pacing->error_max = fabs(error);
+
+    if (continuous && !isnan(pacing->last_shown)) {
+        double interval = now - pacing->last_shown;
+
+        pacing->nb_intervals++;
+        pacing->interval_sum  += interval;
+        pacing->interval_sum2 += interval * interval;
+
+        if (duration > 0) {
+            double ratio   = interval / duration;
+            int    repeats = (int)lrint(ratio) - 1;
+
+            pacing->interval_hist[pacing_bucket(g_interval_edges, IJK_PACING_INTERVAL_BUCKETS - 1, ratio)]++;
+            if (repeats > 0) {
+                int cause;
+                if (pacing->starved)
+                    cause = IJK_PACING_REPEAT_STARVED;
+                else if (delay > duration * PACING_SYNC_HOLD)
+                    cause = IJK_PACING_REPEAT_SYNC;
+                else
+                    cause = IJK_PACING_REPEAT_REFRESH;
+                pacing->repeats[cause] += repeats;
+            }
+        }
+    }
+    pacing->last_shown    = now;
+    pacing->last_due      = due;
+    pacing->last_duration = duration;
+    pacing->starved       = 0;
+
+    if (!isnan(avdiff))
+        pacing_add_avdiff(pacing, now, avdiff);
+    SDL_UnlockMutex(pacing->mutex);
+}
+
+void ijk_pacing_frame_skipped(IjkPacing *pacing, int cause)
+{
+    if (!pacing || cause < 0 || cause >= IJK_PACING_SKIP_NB)
+        return;
+
+    SDL_LockMutex(pacing->mutex);
+    pacing->skips[cause]++;
+    SDL_UnlockMutex(pacing->mutex);
+}
+
+void ijk_pacing_queue_empty(IjkPacing *pacing, double now)
+{
+    if (!pacing)
+        return;
+
+    SDL_LockMutex(pacing->mutex);
+    /* the picture on screen is over once its successor was due */
+    if (!isnan(pacing->last_shown) && pacing->last_duration > 0 &&
+        now > pacing->last_due + pacing->last_duration)
+        pacing->starved = 1;
+    SDL_UnlockMutex(pacing->mutex);
+}
+
+void ijk_pacing_break(IjkPacing *pacing)
+{
+    if (!pacing)
+        return;
+
+    SDL_LockMutex(pacing->mutex);
+    pacing->last_shown = NAN;
+    pacing->starved    = 0;
+    SDL_UnlockMutex(pacing->mutex);
+    __atomic_store_n(&pacing->audio_started, 0, __ATOMIC_RELAXED);
+}
+
+void ijk_pacing_audio_played(IjkPacing *pacing)
+{
+    if (!pacing)
+        return;
+
+    __atomic_store_n(&pacing->audio_started, 1, __ATOMIC_RELAXED);
+    pacing->audio_underrun = 0;
+}
+
+void ijk_pacing_audio_underrun(IjkPacing *pacing, int64_t silence_us)
+{
+    /* waiting for the first samples after open, seek or resume is no underrun */
+    if (!pacing || !__atomic_load_n(&pacing->audio_started, __ATOMIC_RELAXED))
+        return;
+
+    if (!pacing->audio_underrun) {
+        pacing->audio_underrun = 1;
+        __atomic_add_fetch(&pacing->audio_underruns, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&pacing->audio_underrun_us, silence_us, __ATOMIC_RELAXED);
+}
+
+void ijk_pacing_get_snapshot(IjkPacing *pacing, IjkPacingSnapshot *snapshot)
+{
+    int i, skip, nb_windows;
+
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (!pacing)
+        return;
+
+    SDL_LockMutex(pacing->mutex);
+    snapshot->frames = pacing->frames;
+    if (pacing->frames > 0)
+        snapshot->error_avg_us = (int64_t)(pacing->error_sum / pacing->frames * 1000000);
+    snapshot->error_max_us = (int64_t)(pacing->error_max * 1000000);
+
+    if (pacing->nb_intervals > 0) {
+        double mean     = pacing->interval_sum / pacing->nb_intervals;
+        double variance = pacing->interval_sum2 / pacing->nb_intervals - mean * mean;
+        snapshot->interval_avg_us    = (int64_t)(mean * 1000000);
+        snapshot->interval_jitter_us = variance > 0 ? (int64_t)(sqrt(variance) * 1000000) : 0;
+    }
+    memcpy(snapshot->interval_hist, pacing->interval_hist, sizeof(snapshot->interval_hist));
+    memcpy(snapshot->skips, pacing->skips, sizeof(snapshot->skips));
+    memcpy(snapshot->repeats, pacing->repeats, sizeof(snapshot->repeats));
+
+    if (pacing->nb_avdiffs > 0)
+        snapshot->avdiff_avg_us = (int64_t)(pacing->avdiff_sum / pacing->nb_avdiffs * 1000000);
+    snapshot->avdiff_max_us = (int64_t)(pacing->avdiff_max * 1000000);
+    memcpy(snapshot->avdiff_hist, pacing->avdiff_hist, sizeof(snapshot->avdiff_hist));
+
+    /* closed windows oldest first, then the open one, keeping the latest */
+    nb_windows = pacing->nb_windows + (pacing->window_count > 0);
+    skip = nb_windows > IJK_PACING_AVDIFF_WINDOWS ? nb_windows - IJK_PACING_AVDIFF_WINDOWS : 0;
+    for (i = skip; i < pacing->nb_windows; i++) {
+        int index = (pacing->next_window - pacing->nb_windows + i + IJK_PACING_AVDIFF_WINDOWS) % IJK_PACING_AVDIFF_WINDOWS;
+        snapshot->windows[snapshot->nb_windows++] = pacing->windows[index];
+    }
+    if (pacing->window_count > 0) {
+        IjkPacingWindow *window = &snapshot->windows[snapshot->nb_windows++];
+        window->start_ms      = pacing->window_start_ms;
+        window->avdiff_avg_us = pacing_to_us32(pacing->window_sum / pacing->window_count);
+        window->avdiff_max_us = pacing_to_us32(pacing->window_max);
+    }
+    SDL_UnlockMutex(pacing->mutex);
+
+    snapshot->audio_underruns   = __atomic_load_n(&pacing->audio_underruns, __ATOMIC_RELAXED);
+    snapshot->audio_underrun_us = __atomic_load_n(&pacing->audio_underrun_us, __ATOMIC_RELAXED);
+}
+
+int ijk_pacing_report_due(IjkPacing *pacing, int64_t now_ms)
+{
+    if (!pacing)
+        return 0;
+
+    if (!pacing->last_report_ms) {
+        pacing->last_report_ms = now_ms;
+        return 0;
+    }
+    if (now_ms - pacing->last_report_ms < IJK_PACING_REPORT_MS)
+        return 0;
+    pacing->last_report_ms = now_ms;
+    return 1;
+}
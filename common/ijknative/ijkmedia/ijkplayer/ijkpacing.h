@@ -0,0 +1,106 @@
+//
+// ijkpacing.h
+//
+// Frame pacing and A/V sync metrics.
+//
+// Fed by video_refresh with each picture it shows, skips and repeats, and
+// by the audio callback with each buffer it fills. It keeps:
+//
+//   presentation error     when a picture was shown against when it was
+//                          due, the lateness of the refresh loop itself
+//   display intervals      between two shown pictures, as a histogram in
+//                          units of the nominal frame duration plus mean
+//                          and jitter
+//   skips and repeats      by cause, a repeat being one more frame
+//                          duration a picture stayed on screen
+//   A/V offset             video pts against the master clock, as a
+//                          histogram and as one mean and max per window
+//   audio underruns        silence played while audio was expected
+//
+// Times are passed in by the caller, in the av_em_gettime_relative() time
+// base, so the metrics do not depend on a real clock.
+//
+
+#ifndef IJKMEDIA_IJKPACING_H
+#define IJKMEDIA_IJKPACING_H
+
+#include <stdint.h>
+
+/* inject callback type, data is an IjkPacingSnapshot */
+#define IJK_PACING_INJECT_SNAPSHOT      0x30001
+#define IJK_PACING_REPORT_MS            5000
+
+/* display interval over nominal duration: < 0.5, 0.8, 1.2, 1.5, 2.5, 3.5, 5.5, and above */
+#define IJK_PACING_INTERVAL_BUCKETS     8
+/* A/V offset in ms: < -200, -125, -45, -15, 15, 45, 125, 200, and above */
+#define IJK_PACING_AVDIFF_BUCKETS       9
+#define IJK_PACING_AVDIFF_WINDOWS       30
+#define IJK_PACING_WINDOW_MS            1000
+
+enum {
+    IJK_PACING_SKIP_LATE = 0,       // dropped by video_refresh, its display time had passed
+    IJK_PACING_SKIP_EARLY,          // dropped once decoded, already behind the master clock
+    IJK_PACING_SKIP_STALE,          // decoded before a seek or flush
+    IJK_PACING_SKIP_SHED,           // never decoded, see ijkdecshed.h
+    IJK_PACING_SKIP_NB,
+};
+
+enum {
+    IJK_PACING_REPEAT_STARVED = 0,  // no picture was ready when the shown one was over
+    IJK_PACING_REPEAT_SYNC,         // held to let the master clock catch up
+    IJK_PACING_REPEAT_REFRESH,      // the refresh loop itself was late
+    IJK_PACING_REPEAT_NB,
+};
+
+typedef struct IjkPacingWindow {
+    int64_t start_ms;
+    int32_t avdiff_avg_us;
+    int32_t avdiff_max_us;          // largest absolute offset
+} IjkPacingWindow;
+
+typedef struct IjkPacingSnapshot {
+    int64_t frames;                 // pictures shown
+    int64_t error_avg_us;           // shown minus due
+    int64_t error_max_us;
+    int64_t interval_avg_us;
+    int64_t interval_jitter_us;     // standard deviation
+    int64_t interval_hist[IJK_PACING_INTERVAL_BUCKETS];
+    int64_t skips[IJK_PACING_SKIP_NB];
+    int64_t repeats[IJK_PACING_REPEAT_NB];
+    int64_t avdiff_avg_us;          // video ahead of the master clock if positive
+    int64_t avdiff_max_us;          // largest absolute offset
+    int64_t avdiff_hist[IJK_PACING_AVDIFF_BUCKETS];
+    int     nb_windows;
+    IjkPacingWindow windows[IJK_PACING_AVDIFF_WINDOWS];     // oldest first, the last one still open
+    int64_t audio_underruns;
+    int64_t audio_underrun_us;      // silence played
+} IjkPacingSnapshot;
+
+typedef struct IjkPacing IjkPacing;
+
+IjkPacing  *ijk_pacing_create(void);
+void        ijk_pacing_destroy(IjkPacing **pacing);
+
+/*
+ * A picture is shown at now, seconds, after being due at due. duration is
+ * the nominal duration of the previous picture and delay how long it was
+ * actually held for sync, avdiff the pts of the new one minus the master
+ * clock, NAN if video is the master. continuous is 0 after a seek.
+ */
+void        ijk_pacing_frame_shown(IjkPacing *pacing, double now, double due, double duration,
+                                   double delay, double avdiff, int continuous);
+void        ijk_pacing_frame_skipped(IjkPacing *pacing, int cause);
+/* video_refresh found no picture to show */
+void        ijk_pacing_queue_empty(IjkPacing *pacing, double now);
+/* pause and resume, the next interval is not measured */
+void        ijk_pacing_break(IjkPacing *pacing);
+
+/* audio callback only, lock free */
+void        ijk_pacing_audio_played(IjkPacing *pacing);
+void        ijk_pacing_audio_underrun(IjkPacing *pacing, int64_t silence_us);
+
+void        ijk_pacing_get_snapshot(IjkPacing *pacing, IjkPacingSnapshot *snapshot);
+/* 1 every IJK_PACING_REPORT_MS, from a single thread */
+int         ijk_pacing_report_due(IjkPacing *pacing, int64_t now_ms);
+
+#endif //IJKMEDIA_IJKPACING_H
@@ -87,6 +87,46 @@ void emmp_global_set_log_level(int log_level)
     ijksdl_set_log_level(log_level);
 }
 
+void emmp_global_set_memory_budget(int64_t bytes)
+{
+    ffp_global_set_memory_budget(bytes);
+}
+
+void emmp_global_set_network_type(int type)
+{
+    ffp_global_set_network_type(type);
+}
+
+int emmp_global_get_throughput_estimate(const char *url, IjkThroughputEstimate *estimate)
+{
+    return ffp_global_get_throughput_estimate(url, estimate);
+}
+
+int emmp_global_load_throughput(const char *path)
+{
+    return ffp_global_load_throughput(path);
+}
+
+int emmp_global_save_throughput(const char *path)
+{
+    return ffp_global_save_throughput(path);
+}
+
+int emmp_global_start_trace(void)
+{
+    return ffp_global_start_trace();
+}
+
+void emmp_global_stop_trace(void)
+{
+    ffp_global_stop_trace();
+}
+
+int emmp_global_dump_trace(const char *path)
+{
+    return ffp_global_dump_trace(path);
+}
+
 void emmp_global_set_log_callback(ijksdl_log_callback cb)
 {
     ijksdl_set_log_callback(cb);
@@ -273,6 +313,26 @@ void emmp_set_property_int64(EMMediaPlayer *mp, int id, int64_t value)
     pthread_mutex_unlock(&mp->mutex);
 }
 
+IjkThumbnailer *emmp_create_thumbnailer(EMMediaPlayer *mp, const IjkThumbnailParams *params)
+{
+    assert(mp);
+
+    pthread_mutex_lock(&mp->mutex);
+    IjkThumbnailer *thumbnailer = ffp_create_thumbnailer(mp->ffplayer, params);
+    pthread_mutex_unlock(&mp->mutex);
+    return thumbnailer;
+}
+
+int emmp_get_pacing_snapshot(EMMediaPlayer *mp, IjkPacingSnapshot *snapshot)
+{
+    assert(mp);
+
+    pthread_mutex_lock(&mp->mutex);
+    int retval = ffp_get_pacing_snapshot(mp->ffplayer, snapshot);
+    pthread_mutex_unlock(&mp->mutex);
+    return retval;
+}
+
 IjkMediaMeta *emmp_get_meta_l(EMMediaPlayer *mp)
 {
     assert(mp);
@@ -696,6 +756,32 @@ int emmp_seek_to(EMMediaPlayer *mp, long msec)
     return retval;
 }
 
+int emmp_timeshift_go_live(EMMediaPlayer *mp)
+{
+    assert(mp);
+    MPTRACE("emmp_timeshift_go_live()\n");
+    pthread_mutex_lock(&mp->mutex);
+    int retval = ikjmp_chkst_seek_l(mp->mp_state);
+    if (retval == 0)
+        retval = ffp_timeshift_go_live_l(mp->ffplayer);
+    pthread_mutex_unlock(&mp->mutex);
+    MPTRACE("emmp_timeshift_go_live()=%d\n", retval);
+
+    return retval;
+}
+
+int emmp_detach_shared_source(EMMediaPlayer *mp)
+{
+    assert(mp);
+    MPTRACE("emmp_detach_shared_source()\n");
+    pthread_mutex_lock(&mp->mutex);
+    int retval = ffp_detach_shared_source_l(mp->ffplayer);
+    pthread_mutex_unlock(&mp->mutex);
+    MPTRACE("emmp_detach_shared_source()=%d\n", retval);
+
+    return retval;
+}
+
 int emmp_get_state(EMMediaPlayer *mp)
 {
     return mp->mp_state;
@@ -838,153 +924,177 @@ void *emmp_set_weak_thiz(EMMediaPlayer *mp, void *weak_thiz)
     return prev_weak_thiz;
 }
 
-int emmp_get_msg(EMMediaPlayer *mp, AVMessage *msg, int block)
+/* returns 0 for requests consumed here, 1 for messages the caller must see */
+static int emmp_handle_msg(EMMediaPlayer *mp, AVMessage *msg)
 {
-    assert(mp);
-    while (1) {
-        int continue_wait_next_msg = 0;
-        int retval = msg_queue_get(&mp->ffplayer->msg_queue, msg, block);
-        if (retval <= 0)
-            return retval;
+    int continue_wait_next_msg = 0;
+    int retval;
 
-        switch (msg->what) {
-        case FFP_MSG_PREPARED:
-            MPTRACE("emmp_get_msg: FFP_MSG_PREPARED\n");
-            ALOGI("%s:prepared takes time:%lld.\n", __func__, ijk_get_timems() - mp->start_msec);
-            pthread_mutex_lock(&mp->mutex);
-            if (mp->mp_state == MP_STATE_ASYNC_PREPARING) {
-                emmp_change_state_l(mp, MP_STATE_PREPARED);
-            } else {
-                // FIXME: 1: onError() ?
-                av_em_log(mp->ffplayer, AV_LOG_DEBUG, "FFP_MSG_PREPARED: expecting mp_state==MP_STATE_ASYNC_PREPARING\n");
-            }
-            if (ffp_is_paused_l(mp->ffplayer)) {
-                emmp_change_state_l(mp, MP_STATE_PAUSED);
-            }
-            pthread_mutex_unlock(&mp->mutex);
-            break;
-
-        case FFP_MSG_COMPLETED:
-            MPTRACE("emmp_get_msg: FFP_MSG_COMPLETED\n");
+    switch (msg->what) {
+    case FFP_MSG_PREPARED:
+        MPTRACE("emmp_get_msg: FFP_MSG_PREPARED\n");
+        ALOGI("%s:prepared takes time:%lld.\n", __func__, ijk_get_timems() - mp->start_msec);
+        pthread_mutex_lock(&mp->mutex);
+        if (mp->mp_state == MP_STATE_ASYNC_PREPARING) {
+            emmp_change_state_l(mp, MP_STATE_PREPARED);
+        } else {
+            // FIXME: 1: onError() ?
+            av_em_log(mp->ffplayer, AV_LOG_DEBUG, "FFP_MSG_PREPARED: expecting mp_state==MP_STATE_ASYNC_PREPARING\n");
+        }
+        if (ffp_is_paused_l(mp->ffplayer)) {
+            emmp_change_state_l(mp, MP_STATE_PAUSED);
+        }
+        pthread_mutex_unlock(&mp->mutex);
+        break;
 
-            pthread_mutex_lock(&mp->mutex);
-            //mp->restart = 1;
-            //mp->restart_from_beginning = 1;
-            emmp_change_state_l(mp, MP_STATE_COMPLETED);
-            pthread_mutex_unlock(&mp->mutex);
-            break;
-                
-        case FFP_MSG_ERROR_NET_DISCONNECT:
-            /*MPTRACE("emmp_get_msg: FFP_MSG_COMPLETED\n");
-            pthread_mutex_lock(&mp->mutex);
-            mp->restart = 1;
-            mp->error_occur = 1;
-            mp->restart_offset = msg->arg1;
-            //emmp_change_state_l(mp, MP_STATE_COMPLETED);
-            pthread_mutex_unlock(&mp->mutex);*/
-            break;
-        case FFP_MSG_ERROR_CONNECT_FAILD:
-            MPTRACE("FFP_MSG_ERROR_CONNECT_FAILED");
-            break;
+    case FFP_MSG_COMPLETED:
+        MPTRACE("emmp_get_msg: FFP_MSG_COMPLETED\n");
 
-        case FFP_MSG_SEEK_COMPLETE:
-            MPTRACE("emmp_get_msg: FFP_MSG_SEEK_COMPLETE\n");
+        pthread_mutex_lock(&mp->mutex);
+        //mp->restart = 1;
+        //mp->restart_from_beginning = 1;
+        emmp_change_state_l(mp, MP_STATE_COMPLETED);
+        pthread_mutex_unlock(&mp->mutex);
+        break;
+            
+    case FFP_MSG_ERROR_NET_DISCONNECT:
+        /*MPTRACE("emmp_get_msg: FFP_MSG_COMPLETED\n");
+        pthread_mutex_lock(&mp->mutex);
+        mp->restart = 1;
+        mp->error_occur = 1;
+        mp->restart_offset = msg->arg1;
+        //emmp_change_state_l(mp, MP_STATE_COMPLETED);
+        pthread_mutex_unlock(&mp->mutex);*/
+        break;
+    case FFP_MSG_ERROR_CONNECT_FAILD:
+        MPTRACE("FFP_MSG_ERROR_CONNECT_FAILED");
+        break;
+
+    case FFP_MSG_SEEK_COMPLETE:
+        MPTRACE("emmp_get_msg: FFP_MSG_SEEK_COMPLETE\n");
 
-            pthread_mutex_lock(&mp->mutex);
-            mp->seek_req = 0;
-            mp->seek_msec = 0;
-            pthread_mutex_unlock(&mp->mutex);
-            break;
+        pthread_mutex_lock(&mp->mutex);
+        mp->seek_req = 0;
+        mp->seek_msec = 0;
+        pthread_mutex_unlock(&mp->mutex);
+        break;
 
-        case FFP_REQ_START:
-            MPTRACE("emmp_get_msg: FFP_REQ_START\n");
-            continue_wait_next_msg = 1;
-            pthread_mutex_lock(&mp->mutex);
-            if (0 == ikjmp_chkst_start_l(mp->mp_state)) {
-                // FIXME: 8 check seekable
-                if (mp->restart && mp->ffplayer->play_mode != FFP_PLAY_MODE_FLV_LIVE && mp->ffplayer->play_mode != FFP_PLAY_MODE_RTMP) {
-                    if (mp->restart_from_beginning) {
-                        av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_START: restart from beginning\n");
-                        retval = ffp_start_from_l(mp->ffplayer, 0);
-                        if (retval == 0)
-                            emmp_change_state_l(mp, MP_STATE_STARTED);
-                    } else if (mp->error_occur) {
-                        av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_START: restart from beginning\n");
-                        retval = ffp_start_from_l(mp->ffplayer, mp->restart_offset);
-                        if (retval == 0)
-                            emmp_change_state_l(mp, MP_STATE_STARTED);
-                    } else {
-                        av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_START: restart from seek pos\n");
-                        retval = ffp_start_l(mp->ffplayer);
-                        if (retval == 0)
-                            emmp_change_state_l(mp, MP_STATE_STARTED);
-                    }
-                    mp->restart = 0;
-                    mp->restart_from_beginning = 0;
-                    mp->error_occur = 0;
+    case FFP_REQ_START:
+        MPTRACE("emmp_get_msg: FFP_REQ_START\n");
+        continue_wait_next_msg = 1;
+        pthread_mutex_lock(&mp->mutex);
+        if (0 == ikjmp_chkst_start_l(mp->mp_state)) {
+            // FIXME: 8 check seekable
+            if (mp->restart && mp->ffplayer->play_mode != FFP_PLAY_MODE_FLV_LIVE && mp->ffplayer->play_mode != FFP_PLAY_MODE_RTMP) {
+                if (mp->restart_from_beginning) {
+                    av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_START: restart from beginning\n");
+                    retval = ffp_start_from_l(mp->ffplayer, 0);
+                    if (retval == 0)
+                        emmp_change_state_l(mp, MP_STATE_STARTED);
+                } else if (mp->error_occur) {
+                    av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_START: restart from beginning\n");
+                    retval = ffp_start_from_l(mp->ffplayer, mp->restart_offset);
+                    if (retval == 0)
+                        emmp_change_state_l(mp, MP_STATE_STARTED);
                 } else {
-                    av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_START: start on fly\n");
+                    av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_START: restart from seek pos\n");
                     retval = ffp_start_l(mp->ffplayer);
                     if (retval == 0)
                         emmp_change_state_l(mp, MP_STATE_STARTED);
                 }
+                mp->restart = 0;
+                mp->restart_from_beginning = 0;
+                mp->error_occur = 0;
+            } else {
+                av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_START: start on fly\n");
+                retval = ffp_start_l(mp->ffplayer);
+                if (retval == 0)
+                    emmp_change_state_l(mp, MP_STATE_STARTED);
             }
-            pthread_mutex_unlock(&mp->mutex);
-            break;
-                
-        case FFP_CHANGE_VIDEO_SOURCE_SUCCESS:
-            MPTRACE("emmp_get_msg: FFP_CHANGE_VIDEO_SOURCE_SUCCESS\n");
-            pthread_mutex_lock(&mp->mutex);
-            emmp_change_state_l(mp, MP_STATE_STARTED);
-            pthread_mutex_unlock(&mp->mutex);
-            break;
+        }
+        pthread_mutex_unlock(&mp->mutex);
+        break;
+            
+    case FFP_CHANGE_VIDEO_SOURCE_SUCCESS:
+        MPTRACE("emmp_get_msg: FFP_CHANGE_VIDEO_SOURCE_SUCCESS\n");
+        pthread_mutex_lock(&mp->mutex);
+        emmp_change_state_l(mp, MP_STATE_STARTED);
+        pthread_mutex_unlock(&mp->mutex);
+        break;
 
-        case FFP_REQ_PAUSE:
-            MPTRACE("emmp_get_msg: FFP_REQ_PAUSE\n");
-            continue_wait_next_msg = 1;
-            pthread_mutex_lock(&mp->mutex);
-            if (0 == ikjmp_chkst_pause_l(mp->mp_state)) {
-                int pause_ret = ffp_pause_l(mp->ffplayer);
-                if (pause_ret == 0)
-                    emmp_change_state_l(mp, MP_STATE_PAUSED);
-            }
-            pthread_mutex_unlock(&mp->mutex);
-            break;
-        case FFP_REQ_STANDBY:
-            MPTRACE("emmp_get_msg: FFP_REQ_STANDBY\n");
-            continue_wait_next_msg = 1;
-            pthread_mutex_lock(&mp->mutex);
-            if (0 == ikjmp_chkst_pause_l(mp->mp_state)) {
-            int standby_ret = ffp_standby_l(mp->ffplayer);
-            if (standby_ret == 0)
+    case FFP_REQ_PAUSE:
+        MPTRACE("emmp_get_msg: FFP_REQ_PAUSE\n");
+        continue_wait_next_msg = 1;
+        pthread_mutex_lock(&mp->mutex);
+        if (0 == ikjmp_chkst_pause_l(mp->mp_state)) {
+            int pause_ret = ffp_pause_l(mp->ffplayer);
+            if (pause_ret == 0)
                 emmp_change_state_l(mp, MP_STATE_PAUSED);
-            }
-            pthread_mutex_unlock(&mp->mutex);
-            break;
+        }
+        pthread_mutex_unlock(&mp->mutex);
+        break;
+    case FFP_REQ_STANDBY:
+        MPTRACE("emmp_get_msg: FFP_REQ_STANDBY\n");
+        continue_wait_next_msg = 1;
+        pthread_mutex_lock(&mp->mutex);
+        if (0 == ikjmp_chkst_pause_l(mp->mp_state)) {
+        int standby_ret = ffp_standby_l(mp->ffplayer);
+        if (standby_ret == 0)
+            emmp_change_state_l(mp, MP_STATE_PAUSED);
+        }
+        pthread_mutex_unlock(&mp->mutex);
+        break;
 
-        case FFP_REQ_SEEK:
-            MPTRACE("emmp_get_msg: FFP_REQ_SEEK\n");
-            continue_wait_next_msg = 1;
+    case FFP_REQ_SEEK:
+        MPTRACE("emmp_get_msg: FFP_REQ_SEEK\n");
+        continue_wait_next_msg = 1;
 
-            pthread_mutex_lock(&mp->mutex);
-            if (0 == ikjmp_chkst_seek_l(mp->mp_state)) {
-                mp->restart_from_beginning = 0;
-                mp->error_occur = 0;
-                if (0 == ffp_seek_to_l(mp->ffplayer, msg->arg1)) {
-                    av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_SEEK: seek to %d\n", (int)msg->arg1);
-                }
+        pthread_mutex_lock(&mp->mutex);
+        if (0 == ikjmp_chkst_seek_l(mp->mp_state)) {
+            mp->restart_from_beginning = 0;
+            mp->error_occur = 0;
+            if (0 == ffp_seek_to_l(mp->ffplayer, msg->arg1)) {
+                av_em_log(mp->ffplayer, AV_LOG_DEBUG, "emmp_get_msg: FFP_REQ_SEEK: seek to %d\n", (int)msg->arg1);
             }
-            pthread_mutex_unlock(&mp->mutex);
-            break;
         }
+        pthread_mutex_unlock(&mp->mutex);
+        break;
+    }
 
-        if (continue_wait_next_msg)
-            continue;
+    return !continue_wait_next_msg;
+}
 
-        return retval;
+int emmp_get_msg(EMMediaPlayer *mp, AVMessage *msg, int block)
+{
+    assert(mp);
+    while (1) {
+        int retval = msg_queue_get(&mp->ffplayer->msg_queue, msg, block);
+        if (retval <= 0)
+            return retval;
+
+        if (emmp_handle_msg(mp, msg))
+            return retval;
+    }
+}
+
+int emmp_get_msgs(EMMediaPlayer *mp, AVMessage *msgs, int nb_msgs, int timeout_ms)
+{
+    int count = 0;
+
+    assert(mp);
+    assert(msgs);
+    while (count < nb_msgs) {
+        int retval = msg_queue_get_timeout(&mp->ffplayer->msg_queue, &msgs[count], count ? 0 : timeout_ms);
+        if (retval < 0)
+            return count ? count : retval;
+        else if (retval == 0)
+            break;
+
+        if (emmp_handle_msg(mp, &msgs[count]))
+            count++;
     }
 
-    return -1;
+    return count;
 }
 
 int emmp_get_reconnect_count(EMMediaPlayer *mp)
@@ -29,6 +29,9 @@
 
 #include "ijkmeta.h"
 #include "ijkutil.h"
+#include "ijkthroughput.h"
+#include "ijkthumbnail.h"
+#include "ijkpacing.h"
 
 #ifndef MPTRACE
 #define MPTRACE ALOGD
@@ -155,6 +158,14 @@ void            emmp_global_init();
 void            emmp_global_uninit();
 void            emmp_global_set_log_report(int use_report);
 void            emmp_global_set_log_level(int log_level);   // log_level = AV_LOG_xxx
+void            emmp_global_set_memory_budget(int64_t bytes);   // shared by all players, 0 = unlimited
+void            emmp_global_set_network_type(int type);         // IJK_NETWORK_xxx, throughput is kept per network type
+int             emmp_global_get_throughput_estimate(const char *url, IjkThroughputEstimate *estimate);
+int             emmp_global_load_throughput(const char *path);
+int             emmp_global_save_throughput(const char *path);
+int             emmp_global_start_trace(void);                  // -1 unless built with IJK_TRACE_ENABLED
+void            emmp_global_stop_trace(void);
+int             emmp_global_dump_trace(const char *path);       // Chrome trace JSON
 void            emmp_global_set_log_callback(ijksdl_log_callback cb);
 void            emmp_global_set_inject_callback(ijk_inject_callback cb);
 void            emmp_set_video_frame_present_callback(EMMediaPlayer *mp, ijk_present_video_frame_callback cb);
@@ -182,6 +193,8 @@ float           emmp_get_property_float(EMMediaPlayer *mp, int id, float default
 void            emmp_set_property_float(EMMediaPlayer *mp, int id, float value);
 int64_t         emmp_get_property_int64(EMMediaPlayer *mp, int id, int64_t default_value);
 void            emmp_set_property_int64(EMMediaPlayer *mp, int id, int64_t value);
+IjkThumbnailer *emmp_create_thumbnailer(EMMediaPlayer *mp, const IjkThumbnailParams *params);   // for the current source
+int             emmp_get_pacing_snapshot(EMMediaPlayer *mp, IjkPacingSnapshot *snapshot);     // -1 without a source
 
 // must be freed with free();
 IjkMediaMeta   *emmp_get_meta_l(EMMediaPlayer *mp);
@@ -207,6 +220,8 @@ void            emmp_mute(EMMediaPlayer *mp, int onoff);
 int             emmp_standby(EMMediaPlayer *mp);
 int             emmp_stop(EMMediaPlayer *mp);
 int             emmp_seek_to(EMMediaPlayer *mp, long msec);
+int             emmp_timeshift_go_live(EMMediaPlayer *mp);
+int             emmp_detach_shared_source(EMMediaPlayer *mp);
 int             emmp_get_state(EMMediaPlayer *mp);
 bool            emmp_is_playing(EMMediaPlayer *mp);
 long            emmp_get_current_position(EMMediaPlayer *mp);
@@ -221,6 +236,8 @@ void           *emmp_set_weak_thiz(EMMediaPlayer *mp, void *weak_thiz);
 
 /* return < 0 if aborted, 0 if no packet and > 0 if packet.  */
 int             emmp_get_msg(EMMediaPlayer *mp, AVMessage *msg, int block);
+/* drains up to nb_msgs per wakeup, timeout_ms < 0 waits forever; returns the count, < 0 if aborted */
+int             emmp_get_msgs(EMMediaPlayer *mp, AVMessage *msgs, int nb_msgs, int timeout_ms);
 int             emmp_get_reconnect_count(EMMediaPlayer *mp);int             emmp_get_reconnect_interval(EMMediaPlayer *mp);
 void             emmp_set_reconnect_count(EMMediaPlayer *mp, int count);
 void             emmp_set_reconnect_interval(EMMediaPlayer *mp, int interval);
@@ -0,0 +1,505 @@
+//
+// ijksharedsrc.c
+//
+
+#include "ijksharedsrc.h"
+#include <pthread.h>
+#include <string.h>
+#include "libavcodec/avcodec.h"
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "ijksdl/ijksdl_mutex.h"
+
+#define SHARED_TYPE_VIDEO   0
+#define SHARED_TYPE_AUDIO   1
+#define SHARED_TYPE_NB      2
+
+typedef struct SharedStream {
+    AVEMCodecParameters    *codecpar;       // NULL if the publisher has no such stream
+    AVEMRational            time_base;
+    AVEMRational            avg_frame_rate;
+    AVEMRational            r_frame_rate;
+    AVEMRational            sample_aspect_ratio;
+    int64_t                 start_time;
+    int64_t                 duration;
+    int                     disposition;
+    AVEMDictionary         *metadata;
+} SharedStream;
+
+typedef struct SharedFrameQueue {
+    AVFrame    *frames[IJK_SHARED_SOURCE_AUDIO_FRAMES];
+    int         max_size;
+    int         rindex;
+    int         size;
+    int         flushed;
+} SharedFrameQueue;
+
+struct IjkSharedSubscriber {
+    IjkSharedSource    *source;
+    SharedFrameQueue    queues[SHARED_TYPE_NB];
+    int64_t             dropped;
+};
+
+struct IjkSharedSource {
+    char                   *url;
+    int                     refcount;       // publisher and subscribers, under g_shared_mutex
+    IjkSharedSource        *next;
+
+    SDL_mutex              *mutex;
+    SDL_cond               *cond;
+    int                     closed;
+    int                     has_streams;
+    SharedStream            streams[SHARED_TYPE_NB];
+    int64_t                 start_time;
+    int64_t                 duration;
+    int64_t                 bit_rate;
+    IjkSharedSubscriber    *subscribers[IJK_SHARED_SOURCE_MAX_SUBSCRIBERS];
+    int                     nb_subscribers;
+    int64_t                 published;
+};
+
+/* subscribers never read through their context, closing it must not either */
+static AVEMInputFormat shared_source_iformat = {
+    .name       = "ijkshared",
+    .long_name  = "frames of another player",
+    .flags      = AVFMT_NOFILE,
+};
+
+static pthread_mutex_t  g_shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static IjkSharedSource *g_shared_sources = NULL;    // published ones only
+
+static int shared_type_index(enum AVEMMediaType type)
+{
+    switch (type) {
+        case AVMEDIA_TYPE_VIDEO:    return SHARED_TYPE_VIDEO;
+        case AVMEDIA_TYPE_AUDIO:    return SHARED_TYPE_AUDIO;
+        default:                    return -1;
+    }
+}
+
+static void shared_queue_clear(SharedFrameQueue *q)
+{
+    while (q->size > 0) {
+        av_em_frame_free(&q->frames[q->rindex]);
+        q->rindex = (q->rindex + 1) % q->max_size;
+        q->size--;
+    }
+    q->rindex = 0;
+}
+
+static void shared_stream_reset(SharedStream *stream)
+{
+    avcodec_em_parameters_free(&stream->codecpar);
+    av_em_dict_free(&stream->metadata);
+}
+
+static void shared_source_unref(IjkSharedSource *source)
+{
+    int i;
+
+    pthread_mutex_lock(&g_shared_mutex);
+    if (--source->refcount > 0) {
+        pthread_mutex_unlock(&g_shared_mutex);
+        return;
+    }
+    pthread_mutex_unlock(&g_shared_mutex);
+
+    for (i = 0; i < SHARED_TYPE_NB; i++)
+        shared_stream_reset(&source->streams[i]);
+    SDL_DestroyCondP(&source->cond);
+    SDL_DestroyMutexP(&source->mutex);
+    av_em_free(source->url);
+    av_em_free(source);
+}
+
+/* under g_shared_mutex */
+static IjkSharedSource *shared_source_find(const char *url)
+{
+    IjkSharedSource *source;
+
+    for (source = g_shared_sources; source; source = source->next) {
+        if (!strcmp(source->url, url))
+            return source;
+    }
+    return NULL;
+}
+
+IjkSharedSource *ijk_shared_source_publish(const char *url)
+{
+    IjkSharedSource *source;
+
+    if (!url)
+        return NULL;
+
+    source = av_em_mallocz(sizeof(IjkSharedSource));
+    if (!source)
+        return NULL;
+    source->url   = av_em_strdup(url);
+    source->mutex = SDL_CreateMutex();
+    source->cond  = SDL_CreateCond();
+    source->refcount = 1;
+    if (!source->url || !source->mutex || !source->cond) {
+        shared_source_unref(source);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_shared_mutex);
+    if (shared_source_find(url)) {
+        pthread_mutex_unlock(&g_shared_mutex);
+        shared_source_unref(source);
+        return NULL;
+    }
+    source->next = g_shared_sources;
+    g_shared_sources = source;
+    pthread_mutex_unlock(&g_shared_mutex);
+
+    return source;
+}
+
+void ijk_shared_source_close(IjkSharedSource *source)
+{
+    IjkSharedSource **p;
+
+    if (!source)
+        return;
+
+    pthread_mutex_lock(&g_shared_mutex);
+    for (p = &g_shared_sources; *p; p = &(*p)->next) {
+        if (*p == source) {
+            *p = source->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_shared_mutex);
+
+    SDL_LockMutex(source->mutex);
+    source->closed = 1;
+    SDL_CondBroadcast(source->cond);
+    SDL_UnlockMutex(source->mutex);
+}
+
+void ijk_shared_source_destroy(IjkSharedSource **psource)
+{
+    if (!psource || !*psource)
+        return;
+
+    ijk_shared_source_close(*psource);
+    shared_source_unref(*psource);
+    *psource = NULL;
+}
+
+static int shared_stream_copy(SharedStream *stream, AVEMStream *st)
+{
+    shared_stream_reset(stream);
+    stream->codecpar = avcodec_em_parameters_alloc();
+    if (!stream->codecpar || avcodec_em_parameters_copy(stream->codecpar, st->codecpar) < 0) {
+        shared_stream_reset(stream);
+        return AVERROR(ENOMEM);
+    }
+    stream->time_base           = st->time_base;
+    stream->avg_frame_rate      = st->avg_frame_rate;
+    stream->r_frame_rate        = st->r_frame_rate;
+    stream->sample_aspect_ratio = st->sample_aspect_ratio;
+    stream->start_time          = st->start_time;
+    stream->duration            = st->duration;
+    stream->disposition         = st->disposition;
+    av_em_dict_copy(&stream->metadata, st->metadata, 0);
+    return 0;
+}
+
+int ijk_shared_source_set_streams(IjkSharedSource *source, AVEMFormatContext *ic, int video_stream, int audio_stream)
+{
+    int ret = 0;
+
+    if (!source || !ic)
+        return AVERROR(EINVAL);
+
+    SDL_LockMutex(source->mutex);
+    shared_stream_reset(&source->streams[SHARED_TYPE_VIDEO]);
+    shared_stream_reset(&source->streams[SHARED_TYPE_AUDIO]);
+    if (video_stream >= 0 && video_stream < ic->nb_streams)
+        ret = shared_stream_copy(&source->streams[SHARED_TYPE_VIDEO], ic->streams[video_stream]);
+    if (ret >= 0 && audio_stream >= 0 && audio_stream < ic->nb_streams)
+        ret = shared_stream_copy(&source->streams[SHARED_TYPE_AUDIO], ic->streams[audio_stream]);
+    source->start_time  = ic->start_time;
+    source->duration    = ic->duration;
+    source->bit_rate    = ic->bit_rate;
+    source->has_streams = ret >= 0;
+    SDL_CondBroadcast(source->cond);
+    SDL_UnlockMutex(source->mutex);
+
+    return ret;
+}
+
+void ijk_shared_source_put_frame(IjkSharedSource *source, enum AVEMMediaType type, const AVFrame *frame)
+{
+    int t = shared_type_index(type);
+    int i;
+
+    if (!source || !frame || t < 0)
+        return;
+
+    SDL_LockMutex(source->mutex);
+    for (i = 0; i < source->nb_subscribers; i++) {
+        IjkSharedSubscriber *subscriber = source->subscribers[i];
+        SharedFrameQueue *q = &subscriber->queues[t];
+        AVFrame *clone;
+
+        if (q->size >= q->max_size) {
+            av_em_frame_free(&q->frames[q->rindex]);
+            q->rindex = (q->rindex + 1) % q->max_size;
+            q->size--;
+            subscriber->dropped++;
+        }
+        clone = av_em_frame_clone(frame);
+        if (!clone)
+            continue;
+        q->frames[(q->rindex + q->size) % q->max_size] = clone;
+        q->size++;
+    }
+    source->published++;
+    if (source->nb_subscribers > 0)
+        SDL_CondBroadcast(source->cond);
+    SDL_UnlockMutex(source->mutex);
+}
+
+void ijk_shared_source_flush(IjkSharedSource *source, enum AVEMMediaType type)
+{
+    int t = shared_type_index(type);
+    int i;
+
+    if (!source || t < 0)
+        return;
+
+    SDL_LockMutex(source->mutex);
+    for (i = 0; i < source->nb_subscribers; i++) {
+        SharedFrameQueue *q = &source->subscribers[i]->queues[t];
+        shared_queue_clear(q);
+        q->flushed = 1;
+    }
+    SDL_CondBroadcast(source->cond);
+    SDL_UnlockMutex(source->mutex);
+}
+
+int ijk_shared_source_get_subscribers(IjkSharedSource *source)
+{
+    int nb_subscribers;
+
+    if (!source)
+        return 0;
+    SDL_LockMutex(source->mutex);
+    nb_subscribers = source->nb_subscribers;
+    SDL_UnlockMutex(source->mutex);
+    return nb_subscribers;
+}
+
+int64_t ijk_shared_source_get_published(IjkSharedSource *source)
+{
+    int64_t published;
+
+    if (!source)
+        return 0;
+    SDL_LockMutex(source->mutex);
+    published = source->published;
+    SDL_UnlockMutex(source->mutex);
+    return published;
+}
+
+IjkSharedSubscriber *ijk_shared_subscriber_create(const char *url)
+{
+    IjkSharedSubscriber *subscriber;
+    IjkSharedSource *source;
+
+    if (!url)
+        return NULL;
+
+    subscriber = av_em_mallocz(sizeof(IjkSharedSubscriber));
+    if (!subscriber)
+        return NULL;
+    subscriber->queues[SHARED_TYPE_VIDEO].max_size = IJK_SHARED_SOURCE_VIDEO_FRAMES;
+    subscriber->queues[SHARED_TYPE_AUDIO].max_size = IJK_SHARED_SOURCE_AUDIO_FRAMES;
+
+    pthread_mutex_lock(&g_shared_mutex);
+    source = shared_source_find(url);
+    if (source)
+        source->refcount++;
+    pthread_mutex_unlock(&g_shared_mutex);
+    if (!source) {
+        av_em_free(subscriber);
+        return NULL;
+    }
+
+    SDL_LockMutex(source->mutex);
+    if (source->closed || source->nb_subscribers >= IJK_SHARED_SOURCE_MAX_SUBSCRIBERS) {
+        SDL_UnlockMutex(source->mutex);
+        shared_source_unref(source);
+        av_em_free(subscriber);
+        return NULL;
+    }
+    source->subscribers[source->nb_subscribers++] = subscriber;
+    subscriber->source = source;
+    SDL_UnlockMutex(source->mutex);
+
+    return subscriber;
+}
+
+void ijk_shared_subscriber_destroy(IjkSharedSubscriber **psubscriber)
+{
+    IjkSharedSubscriber *subscriber;
+    IjkSharedSource *source;
+    int i;
+
+    if (!psubscriber || !*psubscriber)
+        return;
+    subscriber = *psubscriber;
+    source = subscriber->source;
+
+    SDL_LockMutex(source->mutex);
+    for (i = 0; i < source->nb_subscribers; i++) {
+        if (source->subscribers[i] == subscriber) {
+            source->subscribers[i] = source->subscribers[--source->nb_subscribers];
+            break;
+        }
+    }
+    SDL_UnlockMutex(source->mutex);
+
+    for (i = 0; i < SHARED_TYPE_NB; i++)
+        shared_queue_clear(&subscriber->queues[i]);
+    shared_source_unref(source);
+    av_em_freep(psubscriber);
+}
+
+int ijk_shared_subscriber_wait_streams(IjkSharedSubscriber *subscriber, int timeout_ms)
+{
+    IjkSharedSource *source = subscriber->source;
+    int ret;
+
+    SDL_LockMutex(source->mutex);
+    if (!source->has_streams && !source->closed && timeout_ms > 0)
+        SDL_CondWaitTimeout(source->cond, source->mutex, timeout_ms);
+    if (source->has_streams)
+        ret = 1;
+    else
+        ret = source->closed ? AVERROR_EOF : 0;
+    SDL_UnlockMutex(source->mutex);
+
+    return ret;
+}
+
+static int shared_context_add_stream(AVEMFormatContext *ic, const SharedStream *stream)
+{
+    AVEMStream *st;
+
+    if (!stream->codecpar)
+        return -1;
+    st = avformat_em_new_stream(ic, NULL);
+    if (!st || avcodec_em_parameters_copy(st->codecpar, stream->codecpar) < 0)
+        return AVERROR(ENOMEM);
+    st->time_base           = stream->time_base;
+    st->avg_frame_rate      = stream->avg_frame_rate;
+    st->r_frame_rate        = stream->r_frame_rate;
+    st->sample_aspect_ratio = stream->sample_aspect_ratio;
+    st->start_time          = stream->start_time;
+    st->duration            = stream->duration;
+    st->disposition         = stream->disposition;
+    av_em_dict_copy(&st->metadata, stream->metadata, 0);
+    return st->index;
+}
+
+int ijk_shared_subscriber_create_context(IjkSharedSubscriber *subscriber, AVEMFormatContext **pic,
+                                         int *video_stream, int *audio_stream)
+{
+    IjkSharedSource *source = subscriber->source;
+    AVEMFormatContext *ic;
+    int ret = 0;
+
+    ic = avformat_em_alloc_context();
+    if (!ic)
+        return AVERROR(ENOMEM);
+    ic->iformat = &shared_source_iformat;
+    av_em_strlcpy(ic->filename, source->url, sizeof(ic->filename));
+
+    SDL_LockMutex(source->mutex);
+    if (!source->has_streams) {
+        ret = AVERROR(EAGAIN);
+    } else {
+        *video_stream = shared_context_add_stream(ic, &source->streams[SHARED_TYPE_VIDEO]);
+        *audio_stream = shared_context_add_stream(ic, &source->streams[SHARED_TYPE_AUDIO]);
+        if (*video_stream == AVERROR(ENOMEM) || *audio_stream == AVERROR(ENOMEM))
+            ret = AVERROR(ENOMEM);
+        ic->start_time = source->start_time;
+        ic->duration   = source->duration;
+        ic->bit_rate   = source->bit_rate;
+    }
+    SDL_UnlockMutex(source->mutex);
+
+    if (ret < 0) {
+        avformat_em_close_input(&ic);
+        return ret;
+    }
+    *pic = ic;
+    return 0;
+}
+
+int ijk_shared_subscriber_get_frame(IjkSharedSubscriber *subscriber, enum AVEMMediaType type,
+                                    AVFrame *frame, int timeout_ms)
+{
+    IjkSharedSource *source = subscriber->source;
+    int t = shared_type_index(type);
+    SharedFrameQueue *q;
+    int ret = 0;
+
+    if (t < 0)
+        return AVERROR(EINVAL);
+    q = &subscriber->queues[t];
+
+    SDL_LockMutex(source->mutex);
+    for (;;) {
+        if (q->flushed) {
+            q->flushed = 0;
+            ret = IJK_SHARED_SOURCE_FLUSH;
+            break;
+        }
+        if (q->size > 0) {
+            av_em_frame_move_ref(frame, q->frames[q->rindex]);
+            av_em_frame_free(&q->frames[q->rindex]);
+            q->rindex = (q->rindex + 1) % q->max_size;
+            q->size--;
+            ret = 1;
+            break;
+        }
+        if (source->closed) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        if (timeout_ms <= 0)
+            break;
+        SDL_CondWaitTimeout(source->cond, source->mutex, timeout_ms);
+        timeout_ms = 0;
+    }
+    SDL_UnlockMutex(source->mutex);
+
+    return ret;
+}
+
+int ijk_shared_subscriber_is_closed(IjkSharedSubscriber *subscriber)
+{
+    int closed;
+
+    SDL_LockMutex(subscriber->source->mutex);
+    closed = subscriber->source->closed;
+    SDL_UnlockMutex(subscriber->source->mutex);
+    return closed;
+}
+
+int64_t ijk_shared_subscriber_get_dropped(IjkSharedSubscriber *subscriber)
+{
+    int64_t dropped;
+
+    if (!subscriber)
+        return 0;
+    SDL_LockMutex(subscriber->source->mutex);
+    dropped = subscriber->dropped;
+    SDL_UnlockMutex(subscriber->source->mutex);
+    return dropped;
+}
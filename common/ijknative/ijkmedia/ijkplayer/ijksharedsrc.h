@@ -0,0 +1,65 @@
+//
+// ijksharedsrc.h
+//
+// Shared source for players showing the same live stream.
+//
+// The first player which opens a live url with shared-source set becomes
+// its publisher: it reads and decodes as usual and hands every decoded
+// frame to the source. Players opening the same url while it is published
+// subscribe instead of connecting. They get a demuxer-less copy of the
+// publisher's streams and a new reference to each decoded frame, which
+// they convert, sync and render with their own vout, aout, volume and
+// clocks. A subscriber which falls behind loses its oldest frames, the
+// publisher never waits for it.
+//
+// When the publisher goes away, or a subscriber asks to, the subscriber
+// opens the url by itself and keeps taking frames from the source until
+// its own decoder has caught up.
+//
+
+#ifndef IJKMEDIA_IJKSHAREDSRC_H
+#define IJKMEDIA_IJKSHAREDSRC_H
+
+#include <stdint.h>
+#include "libavformat/avformat.h"
+#include "libavutil/frame.h"
+
+#define IJK_SHARED_SOURCE_MAX_SUBSCRIBERS   8
+#define IJK_SHARED_SOURCE_VIDEO_FRAMES      8       // queued per subscriber
+#define IJK_SHARED_SOURCE_AUDIO_FRAMES      32
+
+/* ijk_shared_subscriber_get_frame(): the publisher flushed its decoder, older frames are gone */
+#define IJK_SHARED_SOURCE_FLUSH             2
+
+typedef struct IjkSharedSource IjkSharedSource;
+typedef struct IjkSharedSubscriber IjkSharedSubscriber;
+
+/* NULL if url is published already */
+IjkSharedSource     *ijk_shared_source_publish(const char *url);
+/* unpublishes url, subscribers see the end of the source and detach,
+ * frames put meanwhile still reach them */
+void                 ijk_shared_source_close(IjkSharedSource *source);
+/* closes, once no more frames are put */
+void                 ijk_shared_source_destroy(IjkSharedSource **source);
+int                  ijk_shared_source_set_streams(IjkSharedSource *source, AVEMFormatContext *ic, int video_stream, int audio_stream);
+/* takes a new reference for each subscriber */
+void                 ijk_shared_source_put_frame(IjkSharedSource *source, enum AVEMMediaType type, const AVFrame *frame);
+void                 ijk_shared_source_flush(IjkSharedSource *source, enum AVEMMediaType type);
+int                  ijk_shared_source_get_subscribers(IjkSharedSource *source);
+int64_t              ijk_shared_source_get_published(IjkSharedSource *source);
+
+/* NULL if url is not published or has IJK_SHARED_SOURCE_MAX_SUBSCRIBERS already */
+IjkSharedSubscriber *ijk_shared_subscriber_create(const char *url);
+void                 ijk_shared_subscriber_destroy(IjkSharedSubscriber **subscriber);
+/* 1 once the publisher has opened its streams, 0 on timeout, AVERROR_EOF if it went away before */
+int                  ijk_shared_subscriber_wait_streams(IjkSharedSubscriber *subscriber, int timeout_ms);
+/* a context without demuxer holding copies of the publisher's streams, -1 for a missing stream */
+int                  ijk_shared_subscriber_create_context(IjkSharedSubscriber *subscriber, AVEMFormatContext **ic,
+                                                          int *video_stream, int *audio_stream);
+/* 1 with a frame, IJK_SHARED_SOURCE_FLUSH, 0 on timeout, AVERROR_EOF once the source is closed */
+int                  ijk_shared_subscriber_get_frame(IjkSharedSubscriber *subscriber, enum AVEMMediaType type,
+                                                     AVFrame *frame, int timeout_ms);
+int                  ijk_shared_subscriber_is_closed(IjkSharedSubscriber *subscriber);
+int64_t              ijk_shared_subscriber_get_dropped(IjkSharedSubscriber *subscriber);
+
+#endif //IJKMEDIA_IJKSHAREDSRC_H
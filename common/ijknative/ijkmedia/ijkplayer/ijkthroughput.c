@@ -0,0 +1,443 @@
+//
+// ijkthroughput.c
+//
+
+#include "ijkthroughput.h"
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+
+#define THROUGHPUT_MAX_HOSTS            64
+#define THROUGHPUT_HOST_SIZE            64
+#define THROUGHPUT_HALF_LIFE_MS         5000
+/* shorter samples are dominated by request latency and socket buffering */
+#define THROUGHPUT_MIN_SAMPLE_MS        100
+#define THROUGHPUT_MIN_SAMPLE_BYTES     (16 * 1024)
+/* below this a host falls back to the network wide figures */
+#define THROUGHPUT_MIN_HOST_SAMPLES     3
+
+#define THROUGHPUT_FILE_TAG             "ijkthroughput 1"
+
+typedef struct ThroughputEntry {
+    char    host[THROUGHPUT_HOST_SIZE];     // empty for the network wide entry
+    int     network;
+    double  ewma;
+    double  ewma_weight;                    // the ewma starts at 0, divide by this to remove the bias
+    int64_t history[IJK_THROUGHPUT_HISTORY];
+    int     nb_history;
+    int     history_pos;
+    int64_t last_used;
+} ThroughputEntry;
+
+struct IjkThroughputMeter {
+    char    host[THROUGHPUT_HOST_SIZE];
+    int64_t window_start;                   // -1 while no window is open
+    int64_t window_bytes;
+    int     external_samples;
+};
+
+static pthread_mutex_t  g_throughput_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ThroughputEntry  g_throughput_networks[IJK_NETWORK_NB];
+static ThroughputEntry  g_throughput_hosts[THROUGHPUT_MAX_HOSTS];
+static int              g_throughput_nb_hosts = 0;
+static int              g_throughput_network = IJK_NETWORK_UNKNOWN;
+static int64_t          g_throughput_sequence = 0;
+
+/* "http://user@Host.example:8080/path" gives "host.example", empty for local paths */
+static void throughput_parse_host(char *host, const char *url)
+{
+    const char *p, *end, *at, *colon;
+    size_t len;
+
+    host[0] = 0;
+    if (!url)
+        return;
+
+    p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    end = p + strcspn(p, "/?#");
+    while ((at = memchr(p, '@', end - p)) != NULL)
+        p = at + 1;
+    if (*p == '[') {
+        const char *bracket = memchr(p, ']', end - p);
+        if (bracket)
+            end = bracket + 1;
+    } else if ((colon = memchr(p, ':', end - p)) != NULL) {
+        end = colon;
+    }
+
+    len = end - p;
+    if (len >= THROUGHPUT_HOST_SIZE)
+        len = THROUGHPUT_HOST_SIZE - 1;
+    for (size_t i = 0; i < len; i++)
+        host[i] = (char)tolower((unsigned char)p[i]);
+    host[len] = 0;
+}
+
+static ThroughputEntry *throughput_find_host_l(int network, const char *host, int create)
+{
+    ThroughputEntry *entry = NULL;
+    int i;
+
+    for (i = 0; i < g_throughput_nb_hosts; i++) {
+        if (g_throughput_hosts[i].network == network && !strcmp(g_throughput_hosts[i].host, host))
+            return &g_throughput_hosts[i];
+    }
+    if (!create)
+        return NULL;
+
+    if (g_throughput_nb_hosts < THROUGHPUT_MAX_HOSTS) {
+        entry = &g_throughput_hosts[g_throughput_nb_hosts++];
+    } else {
+        entry = &g_throughput_hosts[0];
+        for (i = 1; i < THROUGHPUT_MAX_HOSTS; i++) {
+            if (g_throughput_hosts[i].last_used < entry->last_used)
+                entry = &g_throughput_hosts[i];
+        }
+    }
+    memset(entry, 0, sizeof(*entry));
+    av_em_strlcpy(entry->host, host, sizeof(entry->host));
+    entry->network = network;
+    return entry;
+}
+
+static void throughput_entry_push_l(ThroughputEntry *entry, int64_t rate)
+{
+    entry->history[entry->history_pos] = rate;
+    entry->history_pos = (entry->history_pos + 1) % IJK_THROUGHPUT_HISTORY;
+    if (entry->nb_history < IJK_THROUGHPUT_HISTORY)
+        entry->nb_history++;
+    entry->last_used = ++g_throughput_sequence;
+}
+
+static void throughput_entry_add_l(ThroughputEntry *entry, int64_t rate, int64_t elapsed_ms)
+{
+    /* weigh by duration, so one long sample counts as much as several short ones */
+    double alpha = pow(0.5, (double)elapsed_ms / THROUGHPUT_HALF_LIFE_MS);
+
+    entry->ewma        = alpha * entry->ewma + (1.0 - alpha) * rate;
+    entry->ewma_weight = alpha * entry->ewma_weight + (1.0 - alpha);
+    throughput_entry_push_l(entry, rate);
+}
+
+static void throughput_entry_estimate_l(const ThroughputEntry *entry, IjkThroughputEstimate *estimate)
+{
+    int64_t sorted[IJK_THROUGHPUT_HISTORY];
+    int     n = entry->nb_history;
+    int     i, j;
+
+    for (i = 0; i < n; i++) {
+        int64_t v = entry->history[i];
+        for (j = i; j > 0 && sorted[j - 1] > v; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+
+    estimate->ewma       = entry->ewma_weight > 0 ? (int64_t)(entry->ewma / entry->ewma_weight) : 0;
+    estimate->p10        = sorted[(n - 1) * 10 / 100];
+    estimate->p50        = sorted[(n - 1) * 50 / 100];
+    estimate->p90        = sorted[(n - 1) * 90 / 100];
+    estimate->nb_samples = n;
+}
+
+static void throughput_add_sample_l(const char *host, int64_t bytes, int64_t elapsed_ms)
+{
+    int64_t rate;
+
+    if (!host[0] || bytes < THROUGHPUT_MIN_SAMPLE_BYTES || elapsed_ms < THROUGHPUT_MIN_SAMPLE_MS)
+        return;
+
+    rate = bytes * 1000 / elapsed_ms;
+    throughput_entry_add_l(&g_throughput_networks[g_throughput_network], rate, elapsed_ms);
+    throughput_entry_add_l(throughput_find_host_l(g_throughput_network, host, 1), rate, elapsed_ms);
+}
+
+static int throughput_get_estimate_l(const char *host, IjkThroughputEstimate *estimate)
+{
+    const ThroughputEntry *entry = NULL;
+
+    memset(estimate, 0, sizeof(*estimate));
+    if (host[0])
+        entry = throughput_find_host_l(g_throughput_network, host, 0);
+    if (entry && entry->nb_history >= THROUGHPUT_MIN_HOST_SAMPLES) {
+        throughput_entry_estimate_l(entry, estimate);
+        estimate->per_host = 1;
+        return 0;
+    }
+
+    entry = &g_throughput_networks[g_throughput_network];
+    if (entry->nb_history <= 0)
+        return -1;
+    throughput_entry_estimate_l(entry, estimate);
+    return 0;
+}
+
+void ijk_throughput_set_network_type(int type)
+{
+    if (type < 0 || type >= IJK_NETWORK_NB)
+        type = IJK_NETWORK_UNKNOWN;
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    g_throughput_network = type;
+    pthread_mutex_unlock(&g_throughput_mutex);
+}
+
+int ijk_throughput_get_network_type(void)
+{
+    int type;
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    type = g_throughput_network;
+    pthread_mutex_unlock(&g_throughput_mutex);
+    return type;
+}
+
+void ijk_throughput_add_sample(const char *url, int64_t bytes, int64_t elapsed_ms)
+{
+    char host[THROUGHPUT_HOST_SIZE];
+
+    throughput_parse_host(host, url);
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    throughput_add_sample_l(host, bytes, elapsed_ms);
+    pthread_mutex_unlock(&g_throughput_mutex);
+}
+
+int ijk_throughput_get_estimate(const char *url, IjkThroughputEstimate *estimate)
+{
+    char host[THROUGHPUT_HOST_SIZE];
+    int  ret;
+
+    if (!estimate)
+        return -1;
+
+    throughput_parse_host(host, url);
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    ret = throughput_get_estimate_l(host, estimate);
+    pthread_mutex_unlock(&g_throughput_mutex);
+    return ret;
+}
+
+void ijk_throughput_reset(void)
+{
+    pthread_mutex_lock(&g_throughput_mutex);
+    memset(g_throughput_networks, 0, sizeof(g_throughput_networks));
+    memset(g_throughput_hosts, 0, sizeof(g_throughput_hosts));
+    g_throughput_nb_hosts = 0;
+    g_throughput_sequence = 0;
+    pthread_mutex_unlock(&g_throughput_mutex);
+}
+
+static void throughput_write_entry(FILE *fp, int network, const ThroughputEntry *entry)
+{
+    int i;
+
+    if (entry->nb_history <= 0)
+        return;
+
+    fprintf(fp, "%d %s %.3f %.6f %d", network, entry->host[0] ? entry->host : "*",
+            entry->ewma, entry->ewma_weight, entry->nb_history);
+    /* oldest first */
+    for (i = 0; i < entry->nb_history; i++) {
+        int pos = (entry->history_pos - entry->nb_history + i + IJK_THROUGHPUT_HISTORY) % IJK_THROUGHPUT_HISTORY;
+        fprintf(fp, " %lld", (long long)entry->history[pos]);
+    }
+    fprintf(fp, "\n");
+}
+
+int ijk_throughput_save(const char *path)
+{
+    char  tmp_path[1024];
+    FILE *fp;
+    int   i, ret;
+
+    if (!path || snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path))
+        return -1;
+
+    fp = fopen(tmp_path, "w");
+    if (!fp)
+        return -1;
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    fprintf(fp, "%s\n", THROUGHPUT_FILE_TAG);
+    for (i = 0; i < IJK_NETWORK_NB; i++)
+        throughput_write_entry(fp, i, &g_throughput_networks[i]);
+    for (i = 0; i < g_throughput_nb_hosts; i++)
+        throughput_write_entry(fp, g_throughput_hosts[i].network, &g_throughput_hosts[i]);
+    pthread_mutex_unlock(&g_throughput_mutex);
+
+    ret = ferror(fp) ? -1 : 0;
+    if (fclose(fp) != 0)
+        ret = -1;
+    if (ret == 0 && rename(tmp_path, path) != 0)
+        ret = -1;
+    if (ret < 0)
+        remove(tmp_path);
+    return ret;
+}
+
+int ijk_throughput_load(const char *path)
+{
+    char  line[1024];
+    char  host[THROUGHPUT_HOST_SIZE];
+    FILE *fp;
+
+    if (!path)
+        return -1;
+
+    fp = fopen(path, "r");
+    if (!fp)
+        return -1;
+
+    if (!fgets(line, sizeof(line), fp) || strncmp(line, THROUGHPUT_FILE_TAG, strlen(THROUGHPUT_FILE_TAG))) {
+        fclose(fp);
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    while (fgets(line, sizeof(line), fp)) {
+        ThroughputEntry *entry;
+        double ewma, ewma_weight;
+        int    network, nb_history, consumed = 0;
+        char  *p;
+        int    i;
+
+        if (sscanf(line, "%d %63s %lf %lf %d%n", &network, host, &ewma, &ewma_weight, &nb_history, &consumed) != 5)
+            continue;
+        if (network < 0 || network >= IJK_NETWORK_NB || nb_history <= 0 || nb_history > IJK_THROUGHPUT_HISTORY)
+            continue;
+
+        if (!strcmp(host, "*")) {
+            entry = &g_throughput_networks[network];
+        } else {
+            /* what this launch measured already is fresher */
+            if (throughput_find_host_l(network, host, 0))
+                continue;
+            entry = throughput_find_host_l(network, host, 1);
+        }
+        if (entry->nb_history > 0)
+            continue;
+
+        entry->ewma        = ewma;
+        entry->ewma_weight = ewma_weight;
+        p = line + consumed;
+        for (i = 0; i < nb_history; i++) {
+            char   *end;
+            int64_t rate = strtoll(p, &end, 10);
+            if (end == p)
+                break;
+            throughput_entry_push_l(entry, rate);
+            p = end;
+        }
+    }
+    pthread_mutex_unlock(&g_throughput_mutex);
+
+    fclose(fp);
+    return 0;
+}
+
+IjkThroughputMeter *ijk_throughput_meter_create(void)
+{
+    IjkThroughputMeter *meter = av_em_mallocz(sizeof(IjkThroughputMeter));
+    if (!meter)
+        return NULL;
+
+    meter->window_start = -1;
+    return meter;
+}
+
+void ijk_throughput_meter_destroy(IjkThroughputMeter **pmeter)
+{
+    IjkThroughputMeter *meter;
+
+    if (!pmeter)
+        return;
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    meter = *pmeter;
+    *pmeter = NULL;
+    pthread_mutex_unlock(&g_throughput_mutex);
+    av_em_free(meter);
+}
+
+void ijk_throughput_meter_set_url(IjkThroughputMeter *meter, const char *url)
+{
+    char host[THROUGHPUT_HOST_SIZE];
+
+    if (!meter)
+        return;
+
+    throughput_parse_host(host, url);
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    if (strcmp(host, meter->host)) {
+        av_em_strlcpy(meter->host, host, sizeof(meter->host));
+        meter->window_start = -1;
+    }
+    pthread_mutex_unlock(&g_throughput_mutex);
+}
+
+void ijk_throughput_meter_add_bytes(IjkThroughputMeter *meter, int64_t bytes, int64_t now_ms)
+{
+    if (!meter || bytes <= 0)
+        return;
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    if (meter->external_samples) {
+        /* the socket is read by a cache we cannot see throttling in */
+    } else if (meter->window_start < 0 || now_ms < meter->window_start) {
+        /* these bytes arrived before the window opened */
+        meter->window_start = now_ms;
+        meter->window_bytes = 0;
+    } else {
+        meter->window_bytes += bytes;
+        if (now_ms - meter->window_start >= IJK_THROUGHPUT_WINDOW_MS) {
+            throughput_add_sample_l(meter->host, meter->window_bytes, now_ms - meter->window_start);
+            meter->window_start = now_ms;
+            meter->window_bytes = 0;
+        }
+    }
+    pthread_mutex_unlock(&g_throughput_mutex);
+}
+
+void ijk_throughput_meter_add_sample(IjkThroughputMeter *meter, int64_t bytes, int64_t elapsed_ms)
+{
+    if (!meter)
+        return;
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    meter->external_samples = 1;
+    throughput_add_sample_l(meter->host, bytes, elapsed_ms);
+    pthread_mutex_unlock(&g_throughput_mutex);
+}
+
+void ijk_throughput_meter_discard(IjkThroughputMeter *meter)
+{
+    if (!meter)
+        return;
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    meter->window_start = -1;
+    meter->window_bytes = 0;
+    pthread_mutex_unlock(&g_throughput_mutex);
+}
+
+int ijk_throughput_meter_get_estimate(IjkThroughputMeter **pmeter, IjkThroughputEstimate *estimate)
+{
+    int ret = -1;
+
+    if (!pmeter || !estimate)
+        return -1;
+
+    pthread_mutex_lock(&g_throughput_mutex);
+    if (*pmeter)
+        ret = throughput_get_estimate_l((*pmeter)->host, estimate);
+    pthread_mutex_unlock(&g_throughput_mutex);
+    return ret;
+}
@@ -0,0 +1,74 @@
+//
+// ijkthroughput.h
+//
+// Process-wide network throughput estimator.
+//
+// Every player feeds the bytes its IO paths read through a meter. The meter
+// cuts them into windows of at least IJK_THROUGHPUT_WINDOW_MS and hands each
+// window to the estimator as a sample, windows during which the reader was
+// throttled by full queues are dropped since they measure the player and
+// not the network. Samples are kept per network type and per host, and for
+// the network type as a whole, as a bias corrected EWMA plus the
+// percentiles of the last IJK_THROUGHPUT_HISTORY samples.
+//
+// The estimator has no clock of its own, time only enters through the
+// arguments, so feeding it the same trace always gives the same estimate.
+// It can be saved to and loaded from a file to survive app launches.
+//
+
+#ifndef IJKMEDIA_IJKTHROUGHPUT_H
+#define IJKMEDIA_IJKTHROUGHPUT_H
+
+#include <stdint.h>
+
+enum {
+    IJK_NETWORK_UNKNOWN = 0,
+    IJK_NETWORK_WIFI,
+    IJK_NETWORK_CELLULAR,
+    IJK_NETWORK_ETHERNET,
+    IJK_NETWORK_NB,
+};
+
+#define IJK_THROUGHPUT_WINDOW_MS    500
+#define IJK_THROUGHPUT_HISTORY      32
+
+typedef struct IjkThroughputEstimate {
+    int64_t ewma;               // bytes per second
+    int64_t p10;
+    int64_t p50;
+    int64_t p90;
+    int     nb_samples;         // samples in the percentile history
+    int     per_host;           // 0 if the host is unknown and the network wide figures were used
+} IjkThroughputEstimate;
+
+typedef struct IjkThroughputMeter IjkThroughputMeter;
+
+void    ijk_throughput_set_network_type(int type);
+int     ijk_throughput_get_network_type(void);
+
+/* url may be a full url or a bare host name */
+void    ijk_throughput_add_sample(const char *url, int64_t bytes, int64_t elapsed_ms);
+/* 0 on success, -1 if nothing is known for the current network type */
+int     ijk_throughput_get_estimate(const char *url, IjkThroughputEstimate *estimate);
+void    ijk_throughput_reset(void);
+
+/* 0 on success, -1 on io error; loading merges into what is already known */
+int     ijk_throughput_load(const char *path);
+int     ijk_throughput_save(const char *path);
+
+IjkThroughputMeter *ijk_throughput_meter_create(void);
+/* clears *meter under the lock ijk_throughput_meter_get_estimate() reads it with */
+void    ijk_throughput_meter_destroy(IjkThroughputMeter **meter);
+
+/* host the following bytes come from, e.g. after a redirect */
+void    ijk_throughput_meter_set_url(IjkThroughputMeter *meter, const char *url);
+void    ijk_throughput_meter_add_bytes(IjkThroughputMeter *meter, int64_t bytes, int64_t now_ms);
+/* a sample measured elsewhere, e.g. a full speed fill of the async cache,
+ * the meter then stops cutting its own windows */
+void    ijk_throughput_meter_add_sample(IjkThroughputMeter *meter, int64_t bytes, int64_t elapsed_ms);
+/* the reader was throttled, drop the current window */
+void    ijk_throughput_meter_discard(IjkThroughputMeter *meter);
+/* takes the owner's pointer so another thread may call it while the meter is destroyed */
+int     ijk_throughput_meter_get_estimate(IjkThroughputMeter **meter, IjkThroughputEstimate *estimate);
+
+#endif //IJKMEDIA_IJKTHROUGHPUT_H
@@ -0,0 +1,420 @@
+//
+// ijkthumbnail.c
+//
+
+#include "ijkthumbnail.h"
+#include <string.h>
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libavutil/avstring.h"
+#include "libswscale/swscale.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "ijksdl/ijksdl_mutex.h"
+#include "ijksdl/ijksdl_thread.h"
+
+/* packets read after a seek before giving up on a preview */
+#define THUMBNAIL_MAX_READS     2000
+
+typedef struct ThumbnailJob {
+    AVEMPacket  pkt;            // the keyframe, empty if none was found
+} ThumbnailJob;
+
+struct IjkThumbnailer {
+    char                   *url;
+    AVEMDictionary         *format_opts;
+    IjkThumbnailParams      params;
+    volatile int            abort_request;
+
+    AVEMFormatContext      *ic;
+    AVEMStream             *st;
+    int                     width;
+    int                     height;
+
+    SDL_mutex              *mutex;
+    SDL_cond               *cond;
+    ThumbnailJob           *jobs;
+    int                     nb_ready;       // jobs demuxed, in order
+    int                     next_job;       // next job to decode
+    int                     demux_done;
+    int                     nb_extracted;
+    ijk_thumbnail_callback  cb;
+    void                   *opaque;
+
+    uint8_t                *sprite;
+    int                     sprite_width;
+    int                     sprite_height;
+
+    SDL_Thread              threads[IJK_THUMBNAIL_MAX_THREADS];
+    int                     nb_threads;
+};
+
+IjkThumbnailer *ijk_thumbnailer_create(const char *url, AVEMDictionary *format_opts, const IjkThumbnailParams *params)
+{
+    IjkThumbnailer *thumbnailer;
+
+    if (!url || !params || params->count <= 0 || params->count > IJK_THUMBNAIL_MAX_COUNT ||
+        params->width <= 0 || params->height < 0)
+        return NULL;
+
+    thumbnailer = av_em_mallocz(sizeof(IjkThumbnailer));
+    if (!thumbnailer)
+        return NULL;
+
+    thumbnailer->params = *params;
+    if (thumbnailer->params.threads <= 0)
+        thumbnailer->params.threads = av_em_cpu_count();
+    thumbnailer->params.threads = av_clip(thumbnailer->params.threads, 1, IJK_THUMBNAIL_MAX_THREADS);
+
+    thumbnailer->url   = av_em_strdup(url);
+    thumbnailer->jobs  = av_em_mallocz_array(params->count, sizeof(ThumbnailJob));
+    thumbnailer->mutex = SDL_CreateMutex();
+    thumbnailer->cond  = SDL_CreateCond();
+    if (!thumbnailer->url || !thumbnailer->jobs || !thumbnailer->mutex || !thumbnailer->cond ||
+        av_em_dict_copy(&thumbnailer->format_opts, format_opts, 0) < 0) {
+        ijk_thumbnailer_destroy(&thumbnailer);
+        return NULL;
+    }
+    /* events of the player application context would be counted as its own */
+    av_em_dict_set(&thumbnailer->format_opts, "ijkapplication", NULL, 0);
+    av_em_dict_set_int(&thumbnailer->format_opts, "rw_timeout", IJK_THUMBNAIL_TIMEOUT_US, AV_DICT_DONT_OVERWRITE);
+    if (av_em_stristart(url, "http", NULL))
+        av_em_dict_set_int(&thumbnailer->format_opts, "timeout", IJK_THUMBNAIL_TIMEOUT_US, AV_DICT_DONT_OVERWRITE);
+    return thumbnailer;
+}
+
+void ijk_thumbnailer_destroy(IjkThumbnailer **pthumbnailer)
+{
+    IjkThumbnailer *thumbnailer;
+    int i;
+
+    if (!pthumbnailer || !*pthumbnailer)
+        return;
+    thumbnailer = *pthumbnailer;
+
+    if (thumbnailer->jobs) {
+        for (i = 0; i < thumbnailer->params.count; i++)
+            av_em_packet_unref(&thumbnailer->jobs[i].pkt);
+    }
+    av_em_freep(&thumbnailer->jobs);
+    avformat_em_close_input(&thumbnailer->ic);
+    av_em_dict_free(&thumbnailer->format_opts);
+    av_em_freep(&thumbnailer->url);
+    av_em_freep(&thumbnailer->sprite);
+    SDL_DestroyCondP(&thumbnailer->cond);
+    SDL_DestroyMutexP(&thumbnailer->mutex);
+    av_em_freep(pthumbnailer);
+}
+
+void ijk_thumbnailer_abort(IjkThumbnailer *thumbnailer)
+{
+    if (!thumbnailer)
+        return;
+
+    SDL_LockMutex(thumbnailer->mutex);
+    thumbnailer->abort_request = 1;
+    SDL_CondBroadcast(thumbnailer->cond);
+    SDL_UnlockMutex(thumbnailer->mutex);
+}
+
+int ijk_thumbnailer_get_size(IjkThumbnailer *thumbnailer, int *width, int *height)
+{
+    if (!thumbnailer || !thumbnailer->width)
+        return -1;
+    if (width)
+        *width = thumbnailer->width;
+    if (height)
+        *height = thumbnailer->height;
+    return 0;
+}
+
+const uint8_t *ijk_thumbnailer_get_sprite(IjkThumbnailer *thumbnailer, int *width, int *height, int *linesize)
+{
+    if (!thumbnailer || !thumbnailer->sprite)
+        return NULL;
+    if (width)
+        *width = thumbnailer->sprite_width;
+    if (height)
+        *height = thumbnailer->sprite_height;
+    if (linesize)
+        *linesize = thumbnailer->sprite_width * 4;
+    return thumbnailer->sprite;
+}
+
+static int thumbnail_interrupt_cb(void *opaque)
+{
+    IjkThumbnailer *thumbnailer = opaque;
+    return thumbnailer->abort_request;
+}
+
+static int thumbnail_open_input(IjkThumbnailer *thumbnailer)
+{
+    AVEMFormatContext *ic;
+    AVEMCodecParameters *par;
+    int i, ret;
+
+    ic = avformat_em_alloc_context();
+    if (!ic)
+        return AVERROR(ENOMEM);
+    ic->interrupt_callback.callback = thumbnail_interrupt_cb;
+    ic->interrupt_callback.opaque   = thumbnailer;
+
+    ret = avformat_em_open_input(&ic, thumbnailer->url, NULL, &thumbnailer->format_opts);
+    if (ret < 0)
+        return ret;
+    thumbnailer->ic = ic;
+
+    ret = avformat_em_find_stream_info(ic, NULL);
+    if (ret < 0)
+        return ret;
+    if (ic->duration <= 0 || ic->duration == AV_NOPTS_VALUE)
+        return AVERROR(ENOSYS);
+
+    ret = av_em_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (ret < 0)
+        return ret;
+    thumbnailer->st = ic->streams[ret];
+
+    /* the demuxers skip what is discarded, flv even non keyframes */
+    for (i = 0; i < ic->nb_streams; i++)
+        ic->streams[i]->discard = AVDISCARD_ALL;
+    thumbnailer->st->discard = AVDISCARD_NONKEY;
+
+    par = thumbnailer->st->codecpar;
+    if (par->width <= 0 || par->height <= 0)
+        return AVERROR_INVALIDDATA;
+
+    thumbnailer->width  = thumbnailer->params.width;
+    thumbnailer->height = thumbnailer->params.height;
+    if (!thumbnailer->height) {
+        AVEMRational sar = par->sample_aspect_ratio;
+        double aspect = (double)par->width / par->height;
+        if (sar.num > 0 && sar.den > 0)
+            aspect = aspect * sar.num / sar.den;
+        thumbnailer->height = FFMAX(2, (int)(thumbnailer->width / aspect + 1) & ~1);
+    }
+
+    if (thumbnailer->params.columns > 0) {
+        int columns = FFMIN(thumbnailer->params.columns, thumbnailer->params.count);
+        int rows    = (thumbnailer->params.count + columns - 1) / columns;
+        thumbnailer->sprite_width  = columns * thumbnailer->width;
+        thumbnailer->sprite_height = rows * thumbnailer->height;
+        thumbnailer->sprite = av_em_mallocz((size_t)thumbnailer->sprite_width * thumbnailer->sprite_height * 4);
+        if (!thumbnailer->sprite)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+/* the first keyframe at or before the middle of the index-th interval */
+static void thumbnail_demux_job(IjkThumbnailer *thumbnailer, int index, AVEMPacket *pkt)
+{
+    AVEMFormatContext *ic = thumbnailer->ic;
+    AVEMStream *st = thumbnailer->st;
+    int64_t start = ic->start_time != AV_NOPTS_VALUE ? ic->start_time : 0;
+    int64_t target = start + ic->duration * (2 * index + 1) / (2 * thumbnailer->params.count);
+    int reads;
+
+    av_em_init_packet(pkt);
+    if (av_em_seek_frame(ic, st->index, av_em_rescale_q(target, AV_TIME_BASE_Q, st->time_base), AVSEEK_FLAG_BACKWARD) < 0 &&
+        avformat_em_seek_file(ic, -1, INT64_MIN, target, target, 0) < 0)
+        return;
+
+    for (reads = 0; reads < THUMBNAIL_MAX_READS && !thumbnailer->abort_request; reads++) {
+        if (av_em_read_frame(ic, pkt) < 0)
+            break;
+        if (pkt->stream_index == st->index && (pkt->flags & AV_PKT_FLAG_KEY))
+            return;
+        av_em_packet_unref(pkt);
+    }
+    av_em_packet_unref(pkt);
+}
+
+static AVEMCodecContext *thumbnail_open_decoder(IjkThumbnailer *thumbnailer)
+{
+    AVEMCodecParameters *par = thumbnailer->st->codecpar;
+    AVEMCodecContext *avctx;
+    AVEMCodec *codec;
+    AVEMDictionary *opts = NULL;
+    int lowres = 0;
+
+    codec = avcodec_em_find_decoder(par->codec_id);
+    if (!codec)
+        return NULL;
+    avctx = avcodec_em_alloc_context3(NULL);
+    if (!avctx)
+        return NULL;
+    if (avcodec_em_parameters_to_context(avctx, par) < 0)
+        goto fail;
+    av_em_codec_set_pkt_timebase(avctx, thumbnailer->st->time_base);
+
+    /* decode at the smallest size which still covers the preview */
+    while (lowres < av_em_codec_get_max_lowres(codec) &&
+           (par->width >> (lowres + 1)) >= thumbnailer->width &&
+           (par->height >> (lowres + 1)) >= thumbnailer->height)
+        lowres++;
+    av_em_codec_set_lowres(avctx, lowres);
+    if (lowres)
+        av_em_dict_set_int(&opts, "lowres", lowres, 0);
+
+    avctx->skip_frame  = AVDISCARD_NONKEY;
+    avctx->thread_count = 1;
+    if (avcodec_em_open2(avctx, codec, &opts) < 0)
+        goto fail;
+    av_em_dict_free(&opts);
+    return avctx;
+fail:
+    av_em_dict_free(&opts);
+    avcodec_em_free_context(&avctx);
+    return NULL;
+}
+
+/* a keyframe alone may only come out when the decoder is drained */
+static int thumbnail_decode(AVEMCodecContext *avctx, AVEMPacket *pkt, AVFrame *frame)
+{
+    AVEMPacket pkt_temp = *pkt;
+    AVEMPacket drain;
+    int got_frame = 0;
+    int i;
+
+    avcodec_em_flush_buffers(avctx);
+    while (pkt_temp.size > 0 && !got_frame) {
+        int ret = avcodec_em_decode_video2(avctx, frame, &got_frame, &pkt_temp);
+        if (ret < 0)
+            return ret;
+        pkt_temp.data += pkt_temp.size;
+        pkt_temp.size  = 0;
+    }
+
+    av_em_init_packet(&drain);
+    drain.data = NULL;
+    drain.size = 0;
+    for (i = 0; i < 16 && !got_frame; i++) {
+        if (avcodec_em_decode_video2(avctx, frame, &got_frame, &drain) < 0)
+            break;
+    }
+    return got_frame ? 0 : AVERROR(EAGAIN);
+}
+
+static int thumbnail_worker(void *arg)
+{
+    IjkThumbnailer *thumbnailer = arg;
+    AVEMCodecContext *avctx = thumbnail_open_decoder(thumbnailer);
+    struct SwsContext *sws = NULL;
+    AVFrame *frame = av_em_frame_alloc();
+    uint8_t *tile = NULL;
+    int tile_linesize = thumbnailer->width * 4;
+
+    if (!thumbnailer->sprite)
+        tile = av_em_alloc((size_t)tile_linesize * thumbnailer->height);
+
+    while (avctx && frame && (thumbnailer->sprite || tile)) {
+        ThumbnailJob *job;
+        IjkThumbnail thumbnail;
+        uint8_t *dst;
+        int index;
+
+        SDL_LockMutex(thumbnailer->mutex);
+        while (!thumbnailer->abort_request && thumbnailer->next_job >= thumbnailer->nb_ready && !thumbnailer->demux_done)
+            SDL_CondWait(thumbnailer->cond, thumbnailer->mutex);
+        if (thumbnailer->abort_request || thumbnailer->next_job >= thumbnailer->nb_ready) {
+            SDL_UnlockMutex(thumbnailer->mutex);
+            break;
+        }
+        index = thumbnailer->next_job++;
+        job   = &thumbnailer->jobs[index];
+        SDL_UnlockMutex(thumbnailer->mutex);
+
+        if (!job->pkt.data || thumbnail_decode(avctx, &job->pkt, frame) < 0)
+            continue;
+
+        sws = em_sws_getCachedContext(sws, frame->width, frame->height, frame->format,
+                                      thumbnailer->width, thumbnailer->height, AV_PIX_FMT_BGRA,
+                                      SWS_FAST_BILINEAR, NULL, NULL, NULL);
+        if (!sws) {
+            av_em_frame_unref(frame);
+            continue;
+        }
+
+        if (thumbnailer->sprite) {
+            int columns = thumbnailer->sprite_width / thumbnailer->width;
+            tile_linesize = thumbnailer->sprite_width * 4;
+            dst = thumbnailer->sprite + (size_t)(index / columns) * thumbnailer->height * tile_linesize +
+                  (size_t)(index % columns) * thumbnailer->width * 4;
+        } else {
+            dst = tile;
+        }
+        em_sws_scale(sws, (const uint8_t * const *)frame->data, frame->linesize, 0, frame->height, &dst, &tile_linesize);
+
+        thumbnail.index    = index;
+        thumbnail.pts_ms   = frame->pkt_pts != AV_NOPTS_VALUE ?
+                             av_em_rescale_q(frame->pkt_pts, thumbnailer->st->time_base, (AVEMRational){1, 1000}) : -1;
+        thumbnail.data     = dst;
+        thumbnail.linesize = tile_linesize;
+        thumbnail.width    = thumbnailer->width;
+        thumbnail.height   = thumbnailer->height;
+        av_em_frame_unref(frame);
+
+        SDL_LockMutex(thumbnailer->mutex);
+        thumbnailer->nb_extracted++;
+        if (thumbnailer->cb && !thumbnailer->abort_request)
+            thumbnailer->cb(thumbnailer->opaque, &thumbnail);
+        SDL_UnlockMutex(thumbnailer->mutex);
+    }
+
+    em_sws_freeContext(sws);
+    av_em_free(tile);
+    av_em_frame_free(&frame);
+    avcodec_em_free_context(&avctx);
+    return 0;
+}
+
+int ijk_thumbnailer_run(IjkThumbnailer *thumbnailer, ijk_thumbnail_callback cb, void *opaque)
+{
+    int i, ret;
+
+    if (!thumbnailer || thumbnailer->ic)
+        return AVERROR(EINVAL);
+
+    ret = thumbnail_open_input(thumbnailer);
+    if (ret < 0)
+        return ret;
+
+    thumbnailer->cb     = cb;
+    thumbnailer->opaque = opaque;
+    for (i = 0; i < thumbnailer->params.threads; i++) {
+        if (!SDL_CreateThreadEx(&thumbnailer->threads[thumbnailer->nb_threads], thumbnail_worker, thumbnailer, "ff_thumbnail"))
+            break;
+        thumbnailer->nb_threads++;
+    }
+    if (!thumbnailer->nb_threads)
+        return AVERROR(ENOMEM);
+
+    /* keyframes are read in order so that the io only ever skips forward */
+    for (i = 0; i < thumbnailer->params.count && !thumbnailer->abort_request; i++) {
+        AVEMPacket pkt;
+
+        thumbnail_demux_job(thumbnailer, i, &pkt);
+        if (!pkt.data && i > 0 && thumbnailer->jobs[i - 1].pkt.data)
+            av_em_packet_ref(&pkt, &thumbnailer->jobs[i - 1].pkt);
+
+        SDL_LockMutex(thumbnailer->mutex);
+        thumbnailer->jobs[i].pkt = pkt;
+        thumbnailer->nb_ready++;
+        SDL_CondSignal(thumbnailer->cond);
+        SDL_UnlockMutex(thumbnailer->mutex);
+    }
+
+    SDL_LockMutex(thumbnailer->mutex);
+    thumbnailer->demux_done = 1;
+    SDL_CondBroadcast(thumbnailer->cond);
+    SDL_UnlockMutex(thumbnailer->mutex);
+
+    for (i = 0; i < thumbnailer->nb_threads; i++)
+        SDL_WaitThread(&thumbnailer->threads[i], NULL);
+    thumbnailer->nb_threads = 0;
+
+    if (thumbnailer->abort_request)
+        return AVERROR_EXIT;
+    return thumbnailer->nb_extracted;
+}
@@ -0,0 +1,67 @@
+//
+// ijkthumbnail.h
+//
+// Scrub preview extraction.
+//
+// Extracts evenly spaced previews of a VOD source without a second player.
+// One thread demuxes: for each preview it seeks through the demuxer index
+// (MP4 sample tables, FLV keyframe index or filepositions) and reads up to
+// the next keyframe, so only keyframes are downloaded, each once. A pool
+// of worker threads decodes them in parallel, each worker with its own
+// decoder set to skip every non keyframe and to the largest lowres that
+// still covers the preview size where the decoder supports it.
+//
+// Previews are scaled to BGRA, which is ARGB_8888 on little endian, and
+// handed to a callback and, if asked for, packed into one sprite sheet of
+// columns previews per row.
+//
+
+#ifndef IJKMEDIA_IJKTHUMBNAIL_H
+#define IJKMEDIA_IJKTHUMBNAIL_H
+
+#include <stdint.h>
+#include "libavutil/dict.h"
+
+#define IJK_THUMBNAIL_MAX_THREADS   4
+#define IJK_THUMBNAIL_MAX_COUNT     1024
+/* io timeout unless format_opts set one, run() fails instead of hanging on a stalled server */
+#define IJK_THUMBNAIL_TIMEOUT_US    (15 * 1000 * 1000)
+
+typedef struct IjkThumbnailParams {
+    int     count;          // previews, evenly spaced over the duration
+    int     width;
+    int     height;         // 0 to keep the aspect ratio of the video
+    int     threads;        // decoding threads, 0 for one per cpu up to IJK_THUMBNAIL_MAX_THREADS
+    int     columns;        // > 0 to pack the previews into a sprite sheet
+} IjkThumbnailParams;
+
+typedef struct IjkThumbnail {
+    int             index;
+    int64_t         pts_ms;     // of the keyframe actually shown
+    const uint8_t  *data;       // BGRA
+    int             linesize;
+    int             width;
+    int             height;
+} IjkThumbnail;
+
+/* called from the worker threads, one call at a time */
+typedef void (*ijk_thumbnail_callback)(void *opaque, const IjkThumbnail *thumbnail);
+
+typedef struct IjkThumbnailer IjkThumbnailer;
+
+/* format_opts are copied, e.g. the http headers of the player */
+IjkThumbnailer *ijk_thumbnailer_create(const char *url, AVEMDictionary *format_opts, const IjkThumbnailParams *params);
+void            ijk_thumbnailer_destroy(IjkThumbnailer **thumbnailer);
+
+/* blocks until done, returns the number of previews extracted or a negative AVERROR */
+int             ijk_thumbnailer_run(IjkThumbnailer *thumbnailer, ijk_thumbnail_callback cb, void *opaque);
+/* may be called from any thread, before or during run(), which then returns
+ * AVERROR_EXIT; destroy only once run() has returned */
+void            ijk_thumbnailer_abort(IjkThumbnailer *thumbnailer);
+
+/* size of one preview, valid once run() has opened the source */
+int             ijk_thumbnailer_get_size(IjkThumbnailer *thumbnailer, int *width, int *height);
+/* NULL unless columns > 0, previews that failed stay transparent */
+const uint8_t  *ijk_thumbnailer_get_sprite(IjkThumbnailer *thumbnailer, int *width, int *height, int *linesize);
+
+#endif //IJKMEDIA_IJKTHUMBNAIL_H
@@ -0,0 +1,537 @@
+//
+// ijktimeshift.c
+//
+
+#include "ijktimeshift.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "ijksdl/ijksdl_mutex.h"
+
+#define TIMESHIFT_WRITE_BUFFER_SIZE (256 * 1024)
+#define TIMESHIFT_MAX_SEGMENTS      1024
+#define TIMESHIFT_INDEX_INTERVAL_MS 500
+
+typedef struct TimeshiftIndexEntry {
+    int64_t time_ms;
+    int64_t offset;
+} TimeshiftIndexEntry;
+
+typedef struct TimeshiftRecordHeader {
+    int32_t stream_index;
+    int32_t flags;
+    int32_t size;
+    int32_t extradata_size;
+    int64_t time_ms;
+    int64_t pts;
+    int64_t dts;
+    int64_t duration;
+} TimeshiftRecordHeader;
+
+typedef struct TimeshiftSegment {
+    int                  in_use;
+    int64_t              start_ms;
+    int64_t              end_ms;
+    int64_t              size;          // bytes on disk, the head segment also has wbuf_len in memory
+    TimeshiftIndexEntry *index;
+    int                  nb_index;
+    int                  index_cap;
+} TimeshiftSegment;
+
+struct IjkTimeshift {
+    SDL_mutex        *mutex;
+    char             *dir;
+    int64_t           window_ms;
+    int64_t           segment_ms;
+
+    TimeshiftSegment *segments;
+    int               nb_slots;
+    int               max_slot_used;
+    int               head;             // slot being written, -1 before the first sync point
+    int               tail;             // oldest slot
+    int               count;
+
+    FILE             *wfp;
+    uint8_t          *wbuf;
+    int               wbuf_len;
+    int               broken;           // a segment could not be opened or written, recording stopped
+
+    FILE             *rfp;
+    int               rfp_slot;
+    int64_t           rfp_pos;
+    int               rslot;
+    int64_t           roffset;
+    int               live;
+
+    IjkTimeshiftStat  stat;
+};
+
+static void segment_path(IjkTimeshift *ts, int slot, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s/timeshift_%p_%d.seg", ts->dir, (void *)ts, slot);
+}
+
+/* bytes a reader may take from slot, the unflushed tail of the head segment included */
+static int64_t readable_size(IjkTimeshift *ts, int slot)
+{
+    return ts->segments[slot].size + (slot == ts->head ? ts->wbuf_len : 0);
+}
+
+static int write_file(IjkTimeshift *ts, const uint8_t *data, int size)
+{
+    if (!ts->wfp || fwrite(data, 1, size, ts->wfp) != (size_t)size) {
+        av_em_log(NULL, AV_LOG_ERROR, "timeshift: write segment failed.\n");
+        return AVERROR(EIO);
+    }
+    ts->segments[ts->head].size += size;
+    ts->stat.bytes_written += size;
+    ts->stat.write_count++;
+    return 0;
+}
+
+static int flush_write_buffer(IjkTimeshift *ts)
+{
+    int ret;
+
+    if (ts->wbuf_len <= 0)
+        return 0;
+    ret = write_file(ts, ts->wbuf, ts->wbuf_len);
+    ts->wbuf_len = 0;
+    return ret;
+}
+
+static int write_bytes(IjkTimeshift *ts, const uint8_t *data, int size)
+{
+    int ret;
+    if (size <= 0)
+        return 0;
+    if (ts->wbuf_len + size > TIMESHIFT_WRITE_BUFFER_SIZE) {
+        if ((ret = flush_write_buffer(ts)) < 0)
+            return ret;
+    }
+    if (size >= TIMESHIFT_WRITE_BUFFER_SIZE)
+        return write_file(ts, data, size);
+    memcpy(ts->wbuf + ts->wbuf_len, data, size);
+    ts->wbuf_len += size;
+    return 0;
+}
+
+static void close_reader(IjkTimeshift *ts)
+{
+    if (ts->rfp)
+        fclose(ts->rfp);
+    ts->rfp = NULL;
+    ts->rfp_slot = -1;
+    ts->rfp_pos = 0;
+}
+
+static void drop_tail_segment(IjkTimeshift *ts, int remove_file)
+{
+    TimeshiftSegment *seg = &ts->segments[ts->tail];
+    char path[1024];
+
+    if (!ts->live && ts->rslot == ts->tail) {
+        // reader fell out of the window, move it to the next oldest sync point
+        av_em_log(NULL, AV_LOG_WARNING, "timeshift: reader overrun by recycling, skip to next segment.\n");
+        if (ts->count > 1) {
+            ts->rslot = (ts->tail + 1) % ts->nb_slots;
+            ts->roffset = 0;
+        } else {
+            ts->live = 1;
+        }
+    }
+    if (ts->rfp_slot == ts->tail)
+        close_reader(ts);
+    if (remove_file) {
+        segment_path(ts, ts->tail, path, sizeof(path));
+        unlink(path);
+    }
+    seg->in_use = 0;
+    seg->nb_index = 0;
+    seg->size = 0;
+    ts->tail = (ts->tail + 1) % ts->nb_slots;
+    ts->count--;
+}
+
+static int open_segment(IjkTimeshift *ts, int64_t time_ms)
+{
+    char path[1024];
+    int slot;
+    int ret;
+    TimeshiftSegment *seg;
+
+    if ((ret = flush_write_buffer(ts)) < 0)
+        return ret;
+    if (ts->wfp) {
+        fclose(ts->wfp);
+        ts->wfp = NULL;
+    }
+
+    slot = ts->head < 0 ? 0 : (ts->head + 1) % ts->nb_slots;
+    if (ts->segments[slot].in_use)
+        drop_tail_segment(ts, 0);
+
+    segment_path(ts, slot, path, sizeof(path));
+    ts->wfp = fopen(path, "wb");
+    if (!ts->wfp) {
+        av_em_log(NULL, AV_LOG_ERROR, "timeshift: open %s failed.\n", path);
+        return AVERROR(EIO);
+    }
+    // records are batched in wbuf, stdio buffering would only copy them twice
+    setvbuf(ts->wfp, NULL, _IONBF, 0);
+
+    seg = &ts->segments[slot];
+    seg->in_use = 1;
+    seg->start_ms = time_ms;
+    seg->end_ms = time_ms;
+    seg->size = 0;
+    seg->nb_index = 0;
+    if (ts->head < 0)
+        ts->tail = slot;
+    ts->head = slot;
+    ts->count++;
+    if (slot > ts->max_slot_used)
+        ts->max_slot_used = slot;
+    return 0;
+}
+
+static void trim_window(IjkTimeshift *ts, int64_t time_ms)
+{
+    while (ts->count > 2 &&
+           time_ms - ts->segments[(ts->tail + 1) % ts->nb_slots].start_ms >= ts->window_ms)
+        drop_tail_segment(ts, 1);
+}
+
+static int add_index_entry(TimeshiftSegment *seg, int64_t time_ms, int64_t offset)
+{
+    if (seg->nb_index >= seg->index_cap) {
+        int cap = seg->index_cap ? seg->index_cap * 2 : 64;
+        TimeshiftIndexEntry *index = av_em_realloc(seg->index, cap * sizeof(TimeshiftIndexEntry));
+        if (!index)
+            return AVERROR(ENOMEM);
+        seg->index = index;
+        seg->index_cap = cap;
+    }
+    seg->index[seg->nb_index].time_ms = time_ms;
+    seg->index[seg->nb_index].offset = offset;
+    seg->nb_index++;
+    return 0;
+}
+
+static int read_bytes(IjkTimeshift *ts, uint8_t *dst, int size)
+{
+    int64_t on_disk = ts->segments[ts->rslot].size;
+    int64_t offset = ts->roffset;
+
+    if (offset + size > readable_size(ts, ts->rslot))
+        return AVERROR_INVALIDDATA;
+
+    if (offset < on_disk) {
+        int n = (int)FFMIN(size, on_disk - offset);
+        if (ts->rfp_slot != ts->rslot) {
+            char path[1024];
+            close_reader(ts);
+            segment_path(ts, ts->rslot, path, sizeof(path));
+            ts->rfp = fopen(path, "rb");
+            if (!ts->rfp)
+                return AVERROR(EIO);
+            ts->rfp_slot = ts->rslot;
+        }
+        if (ts->rfp_pos != offset || feof(ts->rfp)) {
+            clearerr(ts->rfp);
+            if (fseeko(ts->rfp, offset, SEEK_SET) < 0)
+                return AVERROR(EIO);
+        }
+        if (fread(dst, 1, n, ts->rfp) != (size_t)n)
+            return AVERROR(EIO);
+        ts->rfp_pos = offset + n;
+        dst += n;
+        offset += n;
+        size -= n;
+    }
+    if (size > 0)
+        memcpy(dst, ts->wbuf + (offset - on_disk), size);
+    ts->roffset = offset + size;
+    return 0;
+}
+
+IjkTimeshift *ijk_timeshift_create(const char *dir, int window_sec, int segment_sec)
+{
+    IjkTimeshift *ts;
+
+    if (!dir || !*dir || window_sec <= 0 || segment_sec <= 0)
+        return NULL;
+
+    ts = av_em_mallocz(sizeof(IjkTimeshift));
+    if (!ts)
+        return NULL;
+    ts->window_ms = window_sec * 1000LL;
+    ts->segment_ms = segment_sec * 1000LL;
+    ts->nb_slots = FFMIN(window_sec / segment_sec + 2, TIMESHIFT_MAX_SEGMENTS);
+    ts->head = -1;
+    ts->rfp_slot = -1;
+    ts->live = 1;
+    ts->dir = av_em_strdup(dir);
+    ts->wbuf = av_em_alloc(TIMESHIFT_WRITE_BUFFER_SIZE);
+    ts->segments = av_em_mallocz_array(ts->nb_slots, sizeof(TimeshiftSegment));
+    ts->mutex = SDL_CreateMutex();
+    if (!ts->dir || !ts->wbuf || !ts->segments || !ts->mutex) {
+        ijk_timeshift_destroy(&ts);
+        return NULL;
+    }
+    av_em_log(NULL, AV_LOG_INFO, "timeshift: window:%ds, segment:%ds, slots:%d, dir:%s\n",
+              window_sec, segment_sec, ts->nb_slots, dir);
+    return ts;
+}
+
+void ijk_timeshift_destroy(IjkTimeshift **pts)
+{
+    IjkTimeshift *ts;
+    char path[1024];
+    int i;
+
+    if (!pts || !*pts)
+        return;
+    ts = *pts;
+    close_reader(ts);
+    if (ts->wfp)
+        fclose(ts->wfp);
+    if (ts->segments) {
+        for (i = 0; i <= ts->max_slot_used && ts->dir; i++) {
+            segment_path(ts, i, path, sizeof(path));
+            unlink(path);
+        }
+        for (i = 0; i < ts->nb_slots; i++)
+            av_em_freep(&ts->segments[i].index);
+        av_em_freep(&ts->segments);
+    }
+    av_em_log(NULL, AV_LOG_INFO, "timeshift: bytes in:%"PRId64", bytes written:%"PRId64", writes:%"PRId64"\n",
+              ts->stat.bytes_in, ts->stat.bytes_written, ts->stat.write_count);
+    if (ts->mutex)
+        SDL_DestroyMutex(ts->mutex);
+    av_em_freep(&ts->wbuf);
+    av_em_freep(&ts->dir);
+    av_em_freep(pts);
+}
+
+int ijk_timeshift_write(IjkTimeshift *ts, AVEMPacket *pkt, int64_t time_ms, int sync_point)
+{
+    TimeshiftRecordHeader header;
+    TimeshiftSegment *seg;
+    uint8_t *extradata;
+    int extradata_size = 0;
+    int ret = 0;
+
+    SDL_LockMutex(ts->mutex);
+    if (ts->broken) {
+        ret = AVERROR(EIO);
+        goto end;
+    }
+    if (ts->head < 0 && !sync_point)
+        goto end;
+
+    seg = ts->head >= 0 ? &ts->segments[ts->head] : NULL;
+    if (!seg || (sync_point && time_ms - seg->start_ms >= ts->segment_ms)) {
+        if ((ret = open_segment(ts, time_ms)) < 0)
+            goto end;
+        trim_window(ts, time_ms);
+        seg = &ts->segments[ts->head];
+    }
+    if (sync_point &&
+        (!seg->nb_index || time_ms - seg->index[seg->nb_index - 1].time_ms >= TIMESHIFT_INDEX_INTERVAL_MS) &&
+        (ret = add_index_entry(seg, time_ms, readable_size(ts, ts->head))) < 0)
+        goto end;
+
+    extradata = av_em_packet_get_side_data(pkt, AV_PKT_DATA_NEW_EXTRADATA, &extradata_size);
+    if (!extradata)
+        extradata_size = 0;
+
+    memset(&header, 0, sizeof(header));
+    header.stream_index   = pkt->stream_index;
+    header.flags          = pkt->flags;
+    header.size           = pkt->size;
+    header.extradata_size = extradata_size;
+    header.time_ms        = time_ms;
+    header.pts            = pkt->pts;
+    header.dts            = pkt->dts;
+    header.duration       = pkt->duration;
+    if ((ret = write_bytes(ts, (const uint8_t *)&header, sizeof(header))) < 0 ||
+        (ret = write_bytes(ts, pkt->data, pkt->size)) < 0 ||
+        (ret = write_bytes(ts, extradata, extradata_size)) < 0)
+        goto end;
+
+    if (time_ms > seg->end_ms)
+        seg->end_ms = time_ms;
+    ts->stat.bytes_in += pkt->size;
+end:
+    if (ret < 0 && !ts->broken) {
+        /* a partly written record would misalign every later one, keep what is on disk */
+        av_em_log(NULL, AV_LOG_ERROR, "timeshift: recording stopped:%d.\n", ret);
+        ts->broken = 1;
+        ts->wbuf_len = 0;
+        if (ts->head >= 0) {
+            seg = &ts->segments[ts->head];
+            while (seg->nb_index > 0 && seg->index[seg->nb_index - 1].offset >= seg->size)
+                seg->nb_index--;
+        }
+        if (ts->wfp) {
+            fclose(ts->wfp);
+            ts->wfp = NULL;
+        }
+    }
+    SDL_UnlockMutex(ts->mutex);
+    return ret;
+}
+
+int ijk_timeshift_read(IjkTimeshift *ts, AVEMPacket *pkt)
+{
+    TimeshiftRecordHeader header;
+    TimeshiftSegment *seg;
+    uint8_t *extradata;
+    int ret = 0;
+
+    SDL_LockMutex(ts->mutex);
+    if (ts->live || ts->head < 0) {
+        ret = AVERROR(EAGAIN);
+        goto end;
+    }
+    for (;;) {
+        seg = &ts->segments[ts->rslot];
+        if (ts->roffset < readable_size(ts, ts->rslot))
+            break;
+        if (ts->rslot == ts->head) {
+            ts->live = 1;
+            ret = AVERROR(EAGAIN);
+            goto end;
+        }
+        ts->rslot = (ts->rslot + 1) % ts->nb_slots;
+        ts->roffset = 0;
+    }
+
+    if ((ret = read_bytes(ts, (uint8_t *)&header, sizeof(header))) < 0)
+        goto fail;
+    if (header.size < 0 || header.extradata_size < 0) {
+        ret = AVERROR_INVALIDDATA;
+        goto fail;
+    }
+    if ((ret = av_em_new_packet(pkt, header.size)) < 0)
+        goto fail;
+    if ((ret = read_bytes(ts, pkt->data, header.size)) < 0)
+        goto fail_unref;
+    if (header.extradata_size > 0) {
+        extradata = av_em_packet_new_side_data(pkt, AV_PKT_DATA_NEW_EXTRADATA, header.extradata_size);
+        if (!extradata) {
+            ret = AVERROR(ENOMEM);
+            goto fail_unref;
+        }
+        if ((ret = read_bytes(ts, extradata, header.extradata_size)) < 0)
+            goto fail_unref;
+    }
+    pkt->stream_index = header.stream_index;
+    pkt->flags        = header.flags;
+    pkt->pts          = header.pts;
+    pkt->dts          = header.dts;
+    pkt->duration     = header.duration;
+    ts->stat.read_ms  = header.time_ms;
+
+    // caught up, the next packet comes from the network directly
+    if (ts->rslot == ts->head && ts->roffset >= readable_size(ts, ts->head))
+        ts->live = 1;
+    goto end;
+
+fail_unref:
+    av_em_packet_unref(pkt);
+fail:
+    // a broken record makes the rest of the segment unusable
+    av_em_log(NULL, AV_LOG_ERROR, "timeshift: read record failed:%d, back to live.\n", ret);
+    ts->live = 1;
+end:
+    SDL_UnlockMutex(ts->mutex);
+    return ret;
+}
+
+int ijk_timeshift_seek(IjkTimeshift *ts, int64_t time_ms)
+{
+    int64_t start = av_em_gettime_relative();
+    TimeshiftSegment *seg;
+    int i, n, slot;
+    int ret = 0;
+
+    SDL_LockMutex(ts->mutex);
+    if (ts->count <= 0) {
+        ret = -1;
+        goto end;
+    }
+    // newest segment starting at or before the target, the oldest one otherwise
+    slot = ts->tail;
+    for (n = 0; n < ts->count; n++) {
+        i = (ts->tail + n) % ts->nb_slots;
+        if (ts->segments[i].start_ms > time_ms)
+            break;
+        slot = i;
+    }
+    seg = &ts->segments[slot];
+    ts->rslot = slot;
+    ts->roffset = 0;
+    for (i = seg->nb_index - 1; i >= 0; i--) {
+        if (seg->index[i].time_ms <= time_ms) {
+            ts->roffset = seg->index[i].offset;
+            break;
+        }
+    }
+    // a seek past the head lands on the newest sync point
+    ts->live = 0;
+    ts->stat.last_seek_us = av_em_gettime_relative() - start;
+    av_em_log(NULL, AV_LOG_INFO, "timeshift: seek %"PRId64"ms -> slot:%d offset:%"PRId64", takes %"PRId64"us\n",
+              time_ms, slot, ts->roffset, ts->stat.last_seek_us);
+end:
+    SDL_UnlockMutex(ts->mutex);
+    return ret;
+}
+
+void ijk_timeshift_detach(IjkTimeshift *ts)
+{
+    SDL_LockMutex(ts->mutex);
+    if (ts->live && ts->head >= 0) {
+        ts->rslot = ts->head;
+        ts->roffset = readable_size(ts, ts->head);
+        ts->live = 0;
+    }
+    SDL_UnlockMutex(ts->mutex);
+}
+
+int ijk_timeshift_is_live(IjkTimeshift *ts)
+{
+    int live;
+    SDL_LockMutex(ts->mutex);
+    live = ts->live;
+    SDL_UnlockMutex(ts->mutex);
+    return live;
+}
+
+int64_t ijk_timeshift_get_end_ms(IjkTimeshift *ts)
+{
+    int64_t end_ms = 0;
+    SDL_LockMutex(ts->mutex);
+    if (ts->head >= 0)
+        end_ms = ts->segments[ts->head].end_ms;
+    SDL_UnlockMutex(ts->mutex);
+    return end_ms;
+}
+
+void ijk_timeshift_get_stat(IjkTimeshift *ts, IjkTimeshiftStat *stat)
+{
+    SDL_LockMutex(ts->mutex);
+    *stat = ts->stat;
+    stat->segment_count = ts->count;
+    stat->live = ts->live;
+    if (ts->count > 0) {
+        stat->start_ms = ts->segments[ts->tail].start_ms;
+        stat->end_ms = ts->segments[ts->head].end_ms;
+    }
+    SDL_UnlockMutex(ts->mutex);
+}
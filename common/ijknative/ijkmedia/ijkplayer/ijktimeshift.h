@@ -0,0 +1,49 @@
+//
+// ijktimeshift.h
+//
+// Disk-backed timeshift ring for live streams.
+//
+// Demuxed packets are appended to segment files which start on a sync
+// point and are recycled once they fall out of the window. Every sync
+// point is kept in a time->offset index so seeking costs one lookup and
+// one file open. The writer is single-threaded (read_thread), statistics
+// may be queried from any thread.
+//
+
+#ifndef IJKMEDIA_IJKTIMESHIFT_H
+#define IJKMEDIA_IJKTIMESHIFT_H
+
+#include <stdint.h>
+#include "libavformat/avformat.h"
+
+typedef struct IjkTimeshift IjkTimeshift;
+
+typedef struct IjkTimeshiftStat {
+    int64_t start_ms;           // oldest sync point still in the ring
+    int64_t end_ms;             // newest recorded packet
+    int64_t read_ms;            // last packet handed out by the reader
+    int64_t bytes_in;           // packet payload recorded
+    int64_t bytes_written;      // bytes written to disk, record headers included
+    int64_t write_count;        // number of write calls
+    int64_t last_seek_us;       // index lookup + reader reposition
+    int     segment_count;
+    int     live;               // reader follows the network directly
+} IjkTimeshiftStat;
+
+IjkTimeshift *ijk_timeshift_create(const char *dir, int window_sec, int segment_sec);
+void          ijk_timeshift_destroy(IjkTimeshift **ts);
+
+/* time_ms is the packet time on the stream timeline, sync_point marks a key frame */
+int           ijk_timeshift_write(IjkTimeshift *ts, AVEMPacket *pkt, int64_t time_ms, int sync_point);
+
+/* AVERROR(EAGAIN) once the reader has caught up with the recording head */
+int           ijk_timeshift_read(IjkTimeshift *ts, AVEMPacket *pkt);
+int           ijk_timeshift_seek(IjkTimeshift *ts, int64_t time_ms);
+
+/* stop following the network, playback continues from the current head */
+void          ijk_timeshift_detach(IjkTimeshift *ts);
+int           ijk_timeshift_is_live(IjkTimeshift *ts);
+int64_t       ijk_timeshift_get_end_ms(IjkTimeshift *ts);
+void          ijk_timeshift_get_stat(IjkTimeshift *ts, IjkTimeshiftStat *stat);
+
+#endif //IJKMEDIA_IJKTIMESHIFT_H
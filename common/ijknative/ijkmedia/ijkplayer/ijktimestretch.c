@@ -0,0 +1,452 @@
+//
+// ijktimestretch.c
+//
+
+#include "ijktimestretch.h"
+#include <math.h>
+#include <string.h>
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TS_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TS_SSE2 1
+#endif
+
+#define TS_MIN_PITCH    400     // Hz, shortest period searched
+#define TS_MAX_PITCH    65      // Hz, longest period searched
+#define TS_SEARCH_FREQ  4000    // rate of the coarse period search
+#define TS_FADE_BITS    14      // S16 cross-fade weights are Q14
+
+struct IjkTimeStretch {
+    int                 sample_rate;
+    int                 channels;
+    enum AVSampleFormat fmt;
+    int                 frame_size;
+
+    int                 min_period;
+    int                 max_period;
+    int                 max_required;
+    int                 skip;
+
+    /* input frames in_start .. in_start + in_count, mono keeps their mixdown */
+    uint8_t            *in;
+    float              *mono;
+    int                 in_capacity;
+    int                 in_start;
+    int                 in_count;
+    /* frames to pass through unchanged before the next period is handled */
+    int                 copy_left;
+
+    void               *weights;
+    float              *coarse;
+};
+
+/* SIMD kernels, the scalar loops handle the tails and other targets */
+
+static float ts_dot(const float *a, const float *b, int n)
+{
+    float sum = 0.0f;
+    int i = 0;
+#if defined(TS_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x2_t acc;
+
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i),     vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+    acc  = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    sum  = vget_lane_f32(vpadd_f32(acc, acc), 0);
+#elif defined(TS_SSE2)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i),     _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+    sum  = _mm_cvtss_f32(acc0);
+#endif
+    for (; i < n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+/* out = a * (1 - w) + b * w, w in Q14 */
+static void ts_fade_s16(int16_t *out, const int16_t *a, const int16_t *b, const int16_t *w, int n)
+{
+    int i = 0;
+#if defined(TS_NEON)
+    const int16x8_t one = vdupq_n_s16(1 << TS_FADE_BITS);
+
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t va  = vld1q_s16(a + i);
+        int16x8_t vb  = vld1q_s16(b + i);
+        int16x8_t vwb = vld1q_s16(w + i);
+        int16x8_t vwa = vsubq_s16(one, vwb);
+        int32x4_t lo  = vmull_s16(vget_low_s16(va),  vget_low_s16(vwa));
+        int32x4_t hi  = vmull_s16(vget_high_s16(va), vget_high_s16(vwa));
+
+        lo = vmlal_s16(lo, vget_low_s16(vb),  vget_low_s16(vwb));
+        hi = vmlal_s16(hi, vget_high_s16(vb), vget_high_s16(vwb));
+        vst1q_s16(out + i, vcombine_s16(vrshrn_n_s32(lo, TS_FADE_BITS),
+                                        vrshrn_n_s32(hi, TS_FADE_BITS)));
+    }
+#elif defined(TS_SSE2)
+    const __m128i one   = _mm_set1_epi16(1 << TS_FADE_BITS);
+    const __m128i round = _mm_set1_epi32(1 << (TS_FADE_BITS - 1));
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i va  = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb  = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i vwb = _mm_loadu_si128((const __m128i *)(w + i));
+        __m128i vwa = _mm_sub_epi16(one, vwb);
+        __m128i lo  = _mm_madd_epi16(_mm_unpacklo_epi16(va, vb), _mm_unpacklo_epi16(vwa, vwb));
+        __m128i hi  = _mm_madd_epi16(_mm_unpackhi_epi16(va, vb), _mm_unpackhi_epi16(vwa, vwb));
+
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), TS_FADE_BITS);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), TS_FADE_BITS);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = (a[i] * ((1 << TS_FADE_BITS) - w[i]) + b[i] * w[i] + (1 << (TS_FADE_BITS - 1))) >> TS_FADE_BITS;
+}
+
+static void ts_fade_flt(float *out, const float *a, const float *b, const float *w, int n)
+{
+    int i = 0;
+#if defined(TS_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t va = vld1q_f32(a + i);
+        vst1q_f32(out + i, vmlaq_f32(va, vsubq_f32(vld1q_f32(b + i), va), vld1q_f32(w + i)));
+    }
+#elif defined(TS_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b + i), va), _mm_loadu_ps(w + i))));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = a[i] + (b[i] - a[i]) * w[i];
+}
+
+static inline uint8_t *ts_in(IjkTimeStretch *ts, int frame)
+{
+    return ts->in + (size_t)(ts->in_start + frame) * ts->frame_size;
+}
+
+static void ts_consume(IjkTimeStretch *ts, int nb_frames)
+{
+    ts->in_start += nb_frames;
+    ts->in_count -= nb_frames;
+    if (ts->in_count == 0)
+        ts->in_start = 0;
+}
+
+/* cross-fade nb_frames from a to b into out */
+static void ts_fade(IjkTimeStretch *ts, uint8_t *out, const uint8_t *a, const uint8_t *b, int nb_frames)
+{
+    int n = nb_frames * ts->channels;
+    int t, c;
+
+    if (ts->fmt == AV_SAMPLE_FMT_S16) {
+        int16_t *w = ts->weights;
+        for (t = 0; t < nb_frames; t++) {
+            int16_t wt = (t * (1 << TS_FADE_BITS) + nb_frames / 2) / nb_frames;
+            for (c = 0; c < ts->channels; c++)
+                *w++ = wt;
+        }
+        ts_fade_s16((int16_t *)out, (const int16_t *)a, (const int16_t *)b, ts->weights, n);
+    } else {
+        float *w = ts->weights;
+        float scale = 1.0f / nb_frames;
+        for (t = 0; t < nb_frames; t++) {
+            for (c = 0; c < ts->channels; c++)
+                *w++ = t * scale;
+        }
+        ts_fade_flt((float *)out, (const float *)a, (const float *)b, ts->weights, n);
+    }
+}
+
+/* lag in [min_lag, max_lag] with the highest normalised correlation over len samples */
+static int ts_best_lag(const float *x, int min_lag, int max_lag, int len)
+{
+    float e0 = ts_dot(x, x, len);
+    float ep = ts_dot(x + min_lag, x + min_lag, len);
+    float best_score = -2.0f;
+    int best = min_lag;
+    int lag;
+
+    for (lag = min_lag; lag <= max_lag; lag++) {
+        float c = ts_dot(x, x + lag, len);
+        float norm = e0 * ep;
+        float score = norm > 1e-12f ? c / sqrtf(norm) : 0.0f;
+
+        if (score > best_score) {
+            best_score = score;
+            best = lag;
+        }
+        if (lag == max_lag)
+            break;
+        ep += x[lag + len] * x[lag + len] - x[lag] * x[lag];
+        if (ep < 0.0f)
+            ep = 0.0f;
+    }
+    return best;
+}
+
+static int ts_find_period(IjkTimeStretch *ts)
+{
+    const float *x = ts->mono + ts->in_start;
+    int min_lag = ts->min_period;
+    int max_lag = ts->max_period;
+
+    if (ts->skip > 1) {
+        int n = ts->max_required / ts->skip;
+        int i, j, lag;
+
+        for (i = 0; i < n; i++) {
+            float sum = 0.0f;
+            for (j = 0; j < ts->skip; j++)
+                sum += x[i * ts->skip + j];
+            ts->coarse[i] = sum;
+        }
+        lag = ts_best_lag(ts->coarse, FFMAX(ts->min_period / ts->skip, 1),
+                          ts->max_period / ts->skip, ts->max_period / ts->skip) * ts->skip;
+        min_lag = FFMAX(ts->min_period, lag - ts->skip);
+        max_lag = FFMIN(ts->max_period, lag + ts->skip);
+    }
+    return ts_best_lag(x, min_lag, max_lag, ts->max_period);
+}
+
+IjkTimeStretch *ijk_timestretch_create(int sample_rate, int channels, enum AVSampleFormat fmt)
+{
+    IjkTimeStretch *ts;
+
+    if (sample_rate < TS_MIN_PITCH * 2 || channels <= 0 || channels > 8 ||
+        (fmt != AV_SAMPLE_FMT_S16 && fmt != AV_SAMPLE_FMT_FLT))
+        return NULL;
+
+    ts = av_em_mallocz(sizeof(IjkTimeStretch));
+    if (!ts)
+        return NULL;
+
+    ts->sample_rate  = sample_rate;
+    ts->channels     = channels;
+    ts->fmt          = fmt;
+    ts->frame_size   = channels * av_em_get_bytes_per_sample(fmt);
+    ts->min_period   = sample_rate / TS_MIN_PITCH;
+    ts->max_period   = sample_rate / TS_MAX_PITCH;
+    ts->max_required = 2 * ts->max_period;
+    ts->skip         = FFMAX(sample_rate / TS_SEARCH_FREQ, 1);
+
+    ts->weights = av_em_malloc_array(ts->max_period * channels, fmt == AV_SAMPLE_FMT_S16 ? sizeof(int16_t) : sizeof(float));
+    ts->coarse  = av_em_malloc_array(ts->max_required / ts->skip + 1, sizeof(float));
+    if (!ts->weights || !ts->coarse) {
+        ijk_timestretch_destroy(&ts);
+        return NULL;
+    }
+    return ts;
+}
+
+void ijk_timestretch_destroy(IjkTimeStretch **ts)
+{
+    if (!ts || !*ts)
+        return;
+
+    av_em_freep(&(*ts)->in);
+    av_em_freep(&(*ts)->mono);
+    av_em_freep(&(*ts)->weights);
+    av_em_freep(&(*ts)->coarse);
+    av_em_freep(ts);
+}
+
+int ijk_timestretch_match(IjkTimeStretch *ts, int sample_rate, int channels, enum AVSampleFormat fmt)
+{
+    return ts && ts->sample_rate == sample_rate && ts->channels == channels && ts->fmt == fmt;
+}
+
+void ijk_timestretch_reset(IjkTimeStretch *ts)
+{
+    if (!ts)
+        return;
+
+    ts->in_start  = 0;
+    ts->in_count  = 0;
+    ts->copy_left = 0;
+}
+
+uint8_t *ijk_timestretch_get_input_buffer(IjkTimeStretch *ts, int nb_frames)
+{
+    if (!ts || nb_frames < 0)
+        return NULL;
+
+    if (ts->in_start + ts->in_count + nb_frames > ts->in_capacity) {
+        if (ts->in_start > 0) {
+            memmove(ts->in, ts_in(ts, 0), (size_t)ts->in_count * ts->frame_size);
+            memmove(ts->mono, ts->mono + ts->in_start, (size_t)ts->in_count * sizeof(float));
+            ts->in_start = 0;
+        }
+        if (ts->in_count + nb_frames > ts->in_capacity) {
+            int capacity = FFMAX(ts->in_count + nb_frames, ts->in_capacity * 2);
+            uint8_t *in  = av_em_realloc(ts->in, (size_t)capacity * ts->frame_size);
+            float *mono;
+
+            if (!in)
+                return NULL;
+            ts->in = in;
+            mono = av_em_realloc(ts->mono, (size_t)capacity * sizeof(float));
+            if (!mono)
+                return NULL;
+            ts->mono = mono;
+            ts->in_capacity = capacity;
+        }
+    }
+    return ts_in(ts, ts->in_count);
+}
+
+void ijk_timestretch_commit_input(IjkTimeStretch *ts, int nb_frames)
+{
+    float *mono;
+    int i, c;
+
+    if (!ts || nb_frames <= 0)
+        return;
+
+    mono = ts->mono + ts->in_start + ts->in_count;
+    if (ts->fmt == AV_SAMPLE_FMT_S16) {
+        const int16_t *in = (const int16_t *)ts_in(ts, ts->in_count);
+        float scale = 1.0f / (32768.0f * ts->channels);
+        for (i = 0; i < nb_frames; i++) {
+            int sum = 0;
+            for (c = 0; c < ts->channels; c++)
+                sum += *in++;
+            mono[i] = sum * scale;
+        }
+    } else {
+        const float *in = (const float *)ts_in(ts, ts->in_count);
+        float scale = 1.0f / ts->channels;
+        for (i = 0; i < nb_frames; i++) {
+            float sum = 0.0f;
+            for (c = 0; c < ts->channels; c++)
+                sum += *in++;
+            mono[i] = sum * scale;
+        }
+    }
+    ts->in_count += nb_frames;
+}
+
+int ijk_timestretch_write(IjkTimeStretch *ts, const uint8_t *data, int nb_frames)
+{
+    uint8_t *dst = ijk_timestretch_get_input_buffer(ts, nb_frames);
+
+    if (!dst)
+        return AVERROR(ENOMEM);
+    memcpy(dst, data, (size_t)nb_frames * ts->frame_size);
+    ijk_timestretch_commit_input(ts, nb_frames);
+    return 0;
+}
+
+static float ts_clip_speed(float speed)
+{
+    return av_clipf(speed, IJK_TIMESTRETCH_MIN_SPEED, IJK_TIMESTRETCH_MAX_SPEED);
+}
+
+int ijk_timestretch_get_max_output(IjkTimeStretch *ts, float speed)
+{
+    float expand;
+
+    if (!ts)
+        return 0;
+
+    /* a slow down step plays a period and then fades over at least as much
+     * input as it consumes, so output can run at twice the input */
+    speed  = ts_clip_speed(speed);
+    expand = speed >= 1.0f ? 1.0f : FFMAX(2.0f, 1.0f / speed);
+    return (int)ceilf(ts->in_count * expand) + ts->max_period;
+}
+
+int ijk_timestretch_process(IjkTimeStretch *ts, float speed, uint8_t *out, int max_frames)
+{
+    int produced = 0;
+
+    if (!ts || !out || max_frames <= 0)
+        return 0;
+
+    speed = ts_clip_speed(speed);
+    if (fabsf(speed - 1.0f) < 0.001f) {
+        int n = FFMIN(ts->in_count, max_frames);
+        memcpy(out, ts_in(ts, 0), (size_t)n * ts->frame_size);
+        ts_consume(ts, n);
+        ts->copy_left = 0;
+        return n;
+    }
+
+    for (;;) {
+        uint8_t *dst = out + (size_t)produced * ts->frame_size;
+        int room = max_frames - produced;
+        int period, fade, copy;
+
+        if (ts->copy_left > 0) {
+            int n = FFMIN3(ts->copy_left, ts->in_count, room);
+            if (n <= 0)
+                break;
+            memcpy(dst, ts_in(ts, 0), (size_t)n * ts->frame_size);
+            ts_consume(ts, n);
+            ts->copy_left -= n;
+            produced += n;
+            continue;
+        }
+        if (ts->in_count < ts->max_required)
+            break;
+
+        period = ts_find_period(ts);
+        if (speed > 1.0f) {
+            /* fade out of this period into the next one and drop it */
+            if (speed >= 2.0f) {
+                fade = FFMAX(lrintf(period / (speed - 1.0f)), 1);
+                copy = 0;
+            } else {
+                fade = period;
+                copy = lrintf(period * (2.0f - speed) / (speed - 1.0f));
+            }
+            if (fade > room)
+                break;
+            ts_fade(ts, dst, ts_in(ts, 0), ts_in(ts, period), fade);
+            ts_consume(ts, period + fade);
+            produced += fade;
+        } else {
+            /* play this period, then fade from the next one back into it */
+            if (speed < 0.5f) {
+                fade = FFMAX(lrintf(period * speed / (1.0f - speed)), 1);
+                copy = 0;
+            } else {
+                fade = period;
+                copy = lrintf(period * (2.0f * speed - 1.0f) / (1.0f - speed));
+            }
+            if (period + fade > room)
+                break;
+            memcpy(dst, ts_in(ts, 0), (size_t)period * ts->frame_size);
+            ts_fade(ts, dst + (size_t)period * ts->frame_size, ts_in(ts, period), ts_in(ts, 0), fade);
+            ts_consume(ts, fade);
+            produced += period + fade;
+        }
+        ts->copy_left = copy;
+    }
+    return produced;
+}
+
+int ijk_timestretch_get_pending(IjkTimeStretch *ts)
+{
+    return ts ? ts->in_count : 0;
+}
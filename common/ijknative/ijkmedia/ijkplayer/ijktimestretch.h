@@ -0,0 +1,53 @@
+//
+// ijktimestretch.h
+//
+// Pitch preserving time stretch for variable playback rate.
+//
+// The stretcher follows the pitch period of the signal: to speed up it
+// cross-fades one period into the next and drops it, to slow down it plays
+// a period and fades back to repeat it, copying the input unchanged in
+// between (PICOLA). The period is found by normalised autocorrelation on a
+// mono mixdown, first at about 4kHz and then refined at the full rate.
+//
+// Input is interleaved S16 or FLT. It can be written in place: a producer
+// such as swresample converts straight into the buffer returned by
+// ijk_timestretch_get_input_buffer() and commits what it wrote.
+//
+// Every output frame is a copy or a cross-fade of known input frames, so
+// the input not yet turned into output is exact: the last frame returned by
+// ijk_timestretch_process() is ijk_timestretch_get_pending() frames before
+// the end of the input written so far.
+//
+
+#ifndef IJKMEDIA_IJKTIMESTRETCH_H
+#define IJKMEDIA_IJKTIMESTRETCH_H
+
+#include <stdint.h>
+#include "libavutil/samplefmt.h"
+
+#define IJK_TIMESTRETCH_MIN_SPEED 0.25f
+#define IJK_TIMESTRETCH_MAX_SPEED 4.0f
+
+typedef struct IjkTimeStretch IjkTimeStretch;
+
+/* fmt is AV_SAMPLE_FMT_S16 or AV_SAMPLE_FMT_FLT, NULL on other formats */
+IjkTimeStretch *ijk_timestretch_create(int sample_rate, int channels, enum AVSampleFormat fmt);
+void            ijk_timestretch_destroy(IjkTimeStretch **ts);
+
+int             ijk_timestretch_match(IjkTimeStretch *ts, int sample_rate, int channels, enum AVSampleFormat fmt);
+/* drop all buffered input, e.g. after a seek */
+void            ijk_timestretch_reset(IjkTimeStretch *ts);
+
+/* room for nb_frames input frames, valid until the next call on ts */
+uint8_t        *ijk_timestretch_get_input_buffer(IjkTimeStretch *ts, int nb_frames);
+void            ijk_timestretch_commit_input(IjkTimeStretch *ts, int nb_frames);
+int             ijk_timestretch_write(IjkTimeStretch *ts, const uint8_t *data, int nb_frames);
+
+/* upper bound of the frames ijk_timestretch_process() returns at speed */
+int             ijk_timestretch_get_max_output(IjkTimeStretch *ts, float speed);
+/* stretch buffered input into out, returns the number of frames written */
+int             ijk_timestretch_process(IjkTimeStretch *ts, float speed, uint8_t *out, int max_frames);
+/* input frames written but not yet turned into output */
+int             ijk_timestretch_get_pending(IjkTimeStretch *ts);
+
+#endif //IJKMEDIA_IJKTIMESTRETCH_H
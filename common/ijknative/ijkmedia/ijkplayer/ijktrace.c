@@ -0,0 +1,287 @@
+//
+// ijktrace.c
+//
+
+#include "ijktrace.h"
+
+#if IJK_TRACE_ENABLED
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#if !defined(__APPLE__)
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+
+typedef struct IjkTraceEvent {
+    uint32_t    seq;            // index + 1 once written, 0 while being written
+    int         phase;
+    const char *name;
+    int64_t     ts;             // microseconds, av_em_gettime_relative()
+    int64_t     arg;
+} IjkTraceEvent;
+
+typedef struct IjkTraceRing {
+    IjkTraceEvent   events[IJK_TRACE_RING_SIZE];
+    uint32_t        write_index;    // written by the owner thread only
+    uint32_t        start_index;    // events before this were cleared
+    int             tid;
+    int             exited;
+    int64_t         last_ts;
+    char            name[32];
+} IjkTraceRing;
+
+volatile int ijk_trace_active = 0;
+
+static pthread_once_t   g_trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t    g_trace_key;
+static pthread_mutex_t  g_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static IjkTraceRing    *g_trace_rings[IJK_TRACE_MAX_THREADS];
+static int              g_trace_nb_rings;
+static int64_t          g_trace_base_ts;
+
+static __thread IjkTraceRing *tls_ring;
+static __thread int           tls_registered;
+
+static void trace_thread_exit(void *opaque)
+{
+    IjkTraceRing *ring = opaque;
+
+    pthread_mutex_lock(&g_trace_mutex);
+    ring->exited = 1;
+    pthread_mutex_unlock(&g_trace_mutex);
+}
+
+static void trace_init_once(void)
+{
+    pthread_key_create(&g_trace_key, trace_thread_exit);
+}
+
+static void trace_get_thread_info(IjkTraceRing *ring)
+{
+#if defined(__APPLE__)
+    ring->tid = (int)pthread_mach_thread_np(pthread_self());
+    if (pthread_getname_np(pthread_self(), ring->name, sizeof(ring->name)) != 0)
+        ring->name[0] = '\0';
+#else
+    ring->tid = (int)syscall(__NR_gettid);
+    if (prctl(PR_GET_NAME, ring->name, 0, 0, 0) != 0)
+        ring->name[0] = '\0';
+#endif
+    ring->name[sizeof(ring->name) - 1] = '\0';
+}
+
+/* a free slot, or else the ring of the thread which exited first */
+static IjkTraceRing *trace_register_thread(void)
+{
+    IjkTraceRing *ring = NULL;
+    int i;
+
+    pthread_once(&g_trace_once, trace_init_once);
+
+    pthread_mutex_lock(&g_trace_mutex);
+    if (g_trace_nb_rings < IJK_TRACE_MAX_THREADS) {
+        ring = av_em_mallocz(sizeof(IjkTraceRing));
+        if (ring)
+            g_trace_rings[g_trace_nb_rings++] = ring;
+    } else {
+        for (i = 0; i < g_trace_nb_rings; i++) {
+            IjkTraceRing *r = g_trace_rings[i];
+            if (r->exited && (!ring || r->last_ts < ring->last_ts))
+                ring = r;
+        }
+        if (ring) {
+            ring->exited = 0;
+            __atomic_store_n(&ring->start_index, ring->write_index, __ATOMIC_RELEASE);
+        }
+    }
+    if (ring) {
+        trace_get_thread_info(ring);
+        pthread_setspecific(g_trace_key, ring);
+    }
+    pthread_mutex_unlock(&g_trace_mutex);
+
+    return ring;
+}
+
+void ijk_trace_record(const char *name, int phase, int64_t arg)
+{
+    IjkTraceRing  *ring = tls_ring;
+    IjkTraceEvent *event;
+    uint32_t       index;
+
+    if (!name)
+        return;
+    if (!ring) {
+        /* register once, threads beyond IJK_TRACE_MAX_THREADS are not traced */
+        if (tls_registered)
+            return;
+        tls_registered = 1;
+        ring = tls_ring = trace_register_thread();
+        if (!ring)
+            return;
+    }
+
+    index = ring->write_index;
+    event = &ring->events[index & (IJK_TRACE_RING_SIZE - 1)];
+
+    __atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    event->phase = phase;
+    event->name  = name;
+    event->ts    = av_em_gettime_relative();
+    event->arg   = arg;
+    __atomic_store_n(&event->seq, index + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->write_index, index + 1, __ATOMIC_RELEASE);
+    ring->last_ts = event->ts;
+}
+
+int ijk_trace_start(void)
+{
+    pthread_mutex_lock(&g_trace_mutex);
+    if (!g_trace_base_ts)
+        g_trace_base_ts = av_em_gettime_relative();
+    pthread_mutex_unlock(&g_trace_mutex);
+
+    ijk_trace_active = 1;
+    return 0;
+}
+
+void ijk_trace_stop(void)
+{
+    ijk_trace_active = 0;
+}
+
+void ijk_trace_clear(void)
+{
+    int i;
+
+    pthread_mutex_lock(&g_trace_mutex);
+    for (i = 0; i < g_trace_nb_rings; i++) {
+        IjkTraceRing *ring = g_trace_rings[i];
+        __atomic_store_n(&ring->start_index, __atomic_load_n(&ring->write_index, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_trace_mutex);
+}
+
+static void trace_write_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+/* copy out the events still in the ring, skipping any overwritten meanwhile */
+static void trace_dump_ring(FILE *fp, IjkTraceRing *ring, int pid, int64_t base_ts, int *first)
+{
+    uint32_t end   = __atomic_load_n(&ring->write_index, __ATOMIC_ACQUIRE);
+    uint32_t start = __atomic_load_n(&ring->start_index, __ATOMIC_ACQUIRE);
+    uint32_t index;
+
+    if (end - start > IJK_TRACE_RING_SIZE)
+        start = end - IJK_TRACE_RING_SIZE;
+
+    fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+            *first ? "" : ",\n", pid, ring->tid);
+    trace_write_string(fp, ring->name[0] ? ring->name : "thread");
+    fputs("}}", fp);
+    *first = 0;
+
+    for (index = start; index != end; index++) {
+        IjkTraceEvent *slot = &ring->events[index & (IJK_TRACE_RING_SIZE - 1)];
+        IjkTraceEvent  event;
+        uint32_t       seq;
+
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        event = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq != index + 1 || __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+            continue;
+        if (!event.name)
+            continue;
+
+        fputs(",\n{\"name\":", fp);
+        trace_write_string(fp, event.name);
+        fprintf(fp, ",\"ph\":\"%c\",\"ts\":%"PRId64",\"pid\":%d,\"tid\":%d",
+                event.phase, event.ts - base_ts, pid, ring->tid);
+        switch (event.phase) {
+            case IJK_TRACE_PHASE_COUNTER:
+                fputs(",\"args\":{", fp);
+                trace_write_string(fp, event.name);
+                fprintf(fp, ":%"PRId64"}}", event.arg);
+                break;
+            case IJK_TRACE_PHASE_INSTANT:
+                fprintf(fp, ",\"s\":\"t\",\"args\":{\"arg\":%"PRId64"}}", event.arg);
+                break;
+            default:
+                fputc('}', fp);
+                break;
+        }
+    }
+}
+
+int ijk_trace_dump(const char *path)
+{
+    FILE *fp;
+    int first = 1;
+    int pid = (int)getpid();
+    int i, ret = 0;
+
+    if (!path)
+        return -1;
+    fp = fopen(path, "w");
+    if (!fp)
+        return -1;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", fp);
+    pthread_mutex_lock(&g_trace_mutex);
+    for (i = 0; i < g_trace_nb_rings; i++)
+        trace_dump_ring(fp, g_trace_rings[i], pid, g_trace_base_ts, &first);
+    pthread_mutex_unlock(&g_trace_mutex);
+    fputs("\n]}\n", fp);
+
+    if (ferror(fp))
+        ret = -1;
+    if (fclose(fp) != 0)
+        ret = -1;
+    return ret;
+}
+
+#else
+
+int ijk_trace_start(void)
+{
+    return -1;
+}
+
+void ijk_trace_stop(void)
+{
+}
+
+void ijk_trace_clear(void)
+{
+}
+
+int ijk_trace_dump(const char *path)
+{
+    return -1;
+}
+
+void ijk_trace_record(const char *name, int phase, int64_t arg)
+{
+}
+
+#endif
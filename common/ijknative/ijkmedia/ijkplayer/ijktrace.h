@@ -0,0 +1,67 @@
+//
+// ijktrace.h
+//
+// Cross-thread trace recorder.
+//
+// Every thread that records gets its own ring of IJK_TRACE_RING_SIZE events,
+// written only by that thread without locks, so recording costs a clock
+// read and a few stores. When a ring is full the oldest events are
+// overwritten. The rings of all threads, including those which have already
+// exited, are dumped as one Chrome trace JSON file which chrome://tracing
+// and ui.perfetto.dev both open.
+//
+// Tracing is compiled in only with -DIJK_TRACE_ENABLED=1, otherwise the
+// IJK_TRACE_xxx macros expand to nothing and the functions below are stubs
+// which return -1. When compiled in, nothing is recorded until
+// ijk_trace_start() is called.
+//
+// Event names must be string literals or otherwise outlive the dump.
+//
+
+#ifndef IJKMEDIA_IJKTRACE_H
+#define IJKMEDIA_IJKTRACE_H
+
+#include <stdint.h>
+
+#ifndef IJK_TRACE_ENABLED
+#define IJK_TRACE_ENABLED 0
+#endif
+
+#define IJK_TRACE_RING_SIZE     8192    // events per thread, power of 2
+#define IJK_TRACE_MAX_THREADS   64
+
+enum {
+    IJK_TRACE_PHASE_BEGIN = 'B',
+    IJK_TRACE_PHASE_END = 'E',
+    IJK_TRACE_PHASE_INSTANT = 'i',
+    IJK_TRACE_PHASE_COUNTER = 'C',
+};
+
+/* 0 on success, -1 if tracing is not compiled in */
+int     ijk_trace_start(void);
+void    ijk_trace_stop(void);
+/* drops everything recorded so far */
+void    ijk_trace_clear(void);
+/* 0 on success, -1 on io error or if tracing is not compiled in */
+int     ijk_trace_dump(const char *path);
+
+void    ijk_trace_record(const char *name, int phase, int64_t arg);
+
+#if IJK_TRACE_ENABLED
+extern volatile int ijk_trace_active;
+#define IJK_TRACE_RECORD(name, phase, arg) \
+    do { \
+        if (ijk_trace_active) \
+            ijk_trace_record(name, phase, arg); \
+    } while (0)
+#else
+/* unevaluated, but keeps variables only read for tracing used */
+#define IJK_TRACE_RECORD(name, phase, arg) do { (void)sizeof(name); (void)sizeof(arg); } while (0)
+#endif
+
+#define IJK_TRACE_BEGIN(name)           IJK_TRACE_RECORD(name, IJK_TRACE_PHASE_BEGIN, 0)
+#define IJK_TRACE_END(name)             IJK_TRACE_RECORD(name, IJK_TRACE_PHASE_END, 0)
+#define IJK_TRACE_INSTANT(name, arg)    IJK_TRACE_RECORD(name, IJK_TRACE_PHASE_INSTANT, arg)
+#define IJK_TRACE_COUNTER(name, value)  IJK_TRACE_RECORD(name, IJK_TRACE_PHASE_COUNTER, value)
+
+#endif //IJKMEDIA_IJKTRACE_H
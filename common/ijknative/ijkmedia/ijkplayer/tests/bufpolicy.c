@@ -0,0 +1,186 @@
+//
+// bufpolicy.c
+//
+// ijk_bufpolicy_get_resume_ms on its own, then replayed over synthetic
+// throughput traces against the fixed first_high_water_mark threshold.
+//
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/common.h"
+#include "libavutil/lfg.h"
+#include "ijkbufpolicy.h"
+
+#define MIN_MS          100
+#define STEP_MS         1000
+#define MAX_MS          5000
+#define BITRATE         125000      // bytes per second
+#define TICK_MS         10
+#define TRACE_MS        (30 * 60 * 1000)
+#define MAX_QUEUE_MS    30000
+#define RATE_HISTORY    64
+
+static int failed;
+
+#define EXPECT(cond, ...)                                   \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);     \
+            printf(__VA_ARGS__);                            \
+            printf("\n");                                   \
+            failed++;                                       \
+        }                                                   \
+    } while (0)
+
+static void test_resume_ms(void)
+{
+    IjkBufPolicy *p = ijk_bufpolicy_create(MIN_MS, STEP_MS, MAX_MS);
+    int ms;
+
+    EXPECT(ijk_bufpolicy_get_resume_ms(p, 0, 0, 0, BITRATE) == -1, "unknown rate");
+    EXPECT(ijk_bufpolicy_get_resume_ms(p, 0, BITRATE, 0, 0) == -1, "unknown bitrate");
+    EXPECT(ijk_bufpolicy_get_resume_ms(NULL, 0, BITRATE, 0, BITRATE) == -1, "no policy");
+
+    ms = ijk_bufpolicy_get_resume_ms(p, 0, BITRATE * 3 / 2, 0, BITRATE);
+    EXPECT(ms == MIN_MS, "safe rate gives %d", ms);
+    ms = ijk_bufpolicy_get_resume_ms(p, 0, BITRATE * 4, BITRATE / 2, BITRATE);
+    EXPECT(ms > MIN_MS && ms < MAX_MS, "low percentile below the bitrate gives %d", ms);
+    ms = ijk_bufpolicy_get_resume_ms(p, 0, BITRATE, BITRATE * 4, BITRATE);
+    EXPECT(ms == ijk_bufpolicy_get_resume_ms(p, 0, BITRATE, BITRATE, BITRATE),
+           "low rate above the rate is ignored");
+
+    /* never more than can be downloaded in IJK_BUFPOLICY_MAX_WAIT_MS */
+    ms = ijk_bufpolicy_get_resume_ms(p, 0, BITRATE / 10, 0, BITRATE);
+    EXPECT(ms == IJK_BUFPOLICY_MAX_WAIT_MS / 10, "slow network gives %d", ms);
+    ms = ijk_bufpolicy_get_resume_ms(p, 0, BITRATE / 1000, 0, BITRATE);
+    EXPECT(ms == MIN_MS, "stalled network gives %d", ms);
+
+    /* recent stalls add a step each, up to max_ms, and expire */
+    ijk_bufpolicy_on_stall(p, 1000);
+    ijk_bufpolicy_on_stall(p, 2000);
+    ms = ijk_bufpolicy_get_resume_ms(p, 3000, BITRATE * 2, 0, BITRATE);
+    EXPECT(ms == MIN_MS + 2 * STEP_MS, "two recent stalls give %d", ms);
+    ms = ijk_bufpolicy_get_resume_ms(p, 1000 + IJK_BUFPOLICY_STALL_WINDOW_MS, BITRATE * 2, 0, BITRATE);
+    EXPECT(ms == MIN_MS + STEP_MS, "one expired stall gives %d", ms);
+    ms = ijk_bufpolicy_get_resume_ms(p, 2000 + IJK_BUFPOLICY_STALL_WINDOW_MS, BITRATE * 2, 0, BITRATE);
+    EXPECT(ms == MIN_MS, "both expired give %d", ms);
+    for (ms = 0; ms < 20; ms++)
+        ijk_bufpolicy_on_stall(p, 10000 + ms);
+    ms = ijk_bufpolicy_get_resume_ms(p, 10100, BITRATE * 2, 0, BITRATE);
+    EXPECT(ms == MAX_MS, "many stalls give %d", ms);
+
+    ijk_bufpolicy_destroy(&p);
+    EXPECT(!p, "destroy clears the pointer");
+}
+
+typedef struct TraceStats {
+    int     stalls;
+    int64_t stall_ms;
+    int64_t play_ms;
+    int64_t longest_ms;
+} TraceStats;
+
+/*
+ * Download rate from a two state Markov chain redrawn every tick, the
+ * player resumes at the fixed MIN_MS or at the policy's level, with the
+ * mean and the minimum of the recent rates as rate and low_rate.
+ */
+static void replay(int64_t good, int64_t bad, int adaptive, unsigned seed, TraceStats *st)
+{
+    IjkBufPolicy *p = ijk_bufpolicy_create(MIN_MS, STEP_MS, MAX_MS);
+    int64_t history[RATE_HISTORY];
+    int64_t t, stall_start = 0;
+    double queue_ms = 0;
+    int nb_history = 0, bad_state = 0, stalled = 1;
+    AVLFG lfg;
+
+    av_em_lfg_init(&lfg, seed);
+    memset(st, 0, sizeof(*st));
+    for (t = 0; t < TRACE_MS; t += TICK_MS) {
+        int64_t rate;
+
+        if (av_lfg_get(&lfg) % 1000 < 3)
+            bad_state = !bad_state;
+        rate = (bad_state ? bad : good) * (70 + av_lfg_get(&lfg) % 61) / 100;
+        history[nb_history++ % RATE_HISTORY] = rate;
+
+        queue_ms += (double)rate * TICK_MS / BITRATE;
+        if (queue_ms > MAX_QUEUE_MS)
+            queue_ms = MAX_QUEUE_MS;
+
+        if (!stalled) {
+            queue_ms -= TICK_MS;
+            st->play_ms += TICK_MS;
+            if (queue_ms <= 0) {
+                queue_ms = 0;
+                stalled = 1;
+                stall_start = t;
+                st->stalls++;
+                ijk_bufpolicy_on_stall(p, t);
+            }
+        } else {
+            int threshold = MIN_MS;
+            st->stall_ms += TICK_MS;
+            if (adaptive) {
+                int i, n = FFMIN(nb_history, RATE_HISTORY);
+                int64_t sum = 0, low = INT64_MAX;
+                for (i = 0; i < n; i++) {
+                    sum += history[i];
+                    low = FFMIN(low, history[i]);
+                }
+                threshold = ijk_bufpolicy_get_resume_ms(p, t, sum / n, low, BITRATE);
+            }
+            if (queue_ms >= threshold) {
+                stalled = 0;
+                if (st->stalls)
+                    st->longest_ms = FFMAX(st->longest_ms, t - stall_start);
+            }
+        }
+    }
+    ijk_bufpolicy_destroy(&p);
+}
+
+static void test_traces(void)
+{
+    static const int64_t traces[][2] = {
+        { 400000,  20000 },     // bursts of nothing on a fast network
+        { 250000, 100000 },     // always ahead on average
+        { 180000,  60000 },     // often below the bitrate
+        { 140000, 110000 },     // just about the bitrate
+    };
+    int i, seed;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(traces); i++) {
+        for (seed = 1; seed <= 3; seed++) {
+            TraceStats fixed, adaptive;
+            double fixed_ratio, adaptive_ratio;
+
+            replay(traces[i][0], traces[i][1], 0, seed, &fixed);
+            replay(traces[i][0], traces[i][1], 1, seed, &adaptive);
+            fixed_ratio    = 100.0 * fixed.stall_ms / (fixed.stall_ms + fixed.play_ms);
+            adaptive_ratio = 100.0 * adaptive.stall_ms / (adaptive.stall_ms + adaptive.play_ms);
+            printf("trace %6"PRId64"/%6"PRId64" seed %d: fixed %4d stalls %5.2f%% longest %5"PRId64" ms, "
+                   "adaptive %4d stalls %5.2f%% longest %5"PRId64" ms\n",
+                   traces[i][0], traces[i][1], seed,
+                   fixed.stalls, fixed_ratio, fixed.longest_ms,
+                   adaptive.stalls, adaptive_ratio, adaptive.longest_ms);
+
+            /* fewer, longer stalls for about the same time spent stalled */
+            EXPECT(adaptive.stalls <= fixed.stalls, "more stalls than the fixed threshold");
+            EXPECT(adaptive_ratio <= fixed_ratio + 0.5, "rebuffering ratio grew by more than 0.5 points");
+            /* the level is chosen so it downloads within the wait cap at the
+             * rate of the moment, the rate may drop while waiting */
+            EXPECT(adaptive.longest_ms <= 3 * IJK_BUFPOLICY_MAX_WAIT_MS, "a stall took %"PRId64" ms",
+                   adaptive.longest_ms);
+        }
+    }
+}
+
+int main(void)
+{
+    test_resume_ms();
+    test_traces();
+    printf("bufpolicy: %d failed\n", failed);
+    return !!failed;
+}
@@ -0,0 +1,203 @@
+//
+// msg_queue.c
+//
+// MessageQueue under a stalled consumer: producers must not wait for it,
+// no message may be lost or reordered, coalesced ones included.
+//
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "ff_ffmsg_queue.h"
+
+#define STALL_MS            300
+#define MAX_PUT_MS          50
+#define STRESS_PRODUCERS    4
+#define STRESS_MESSAGES     100000
+#define MSG_TEST            10000
+
+static MessageQueue q;
+static int64_t put_max_ms;
+
+static void *stall_producer(void *arg)
+{
+    int i;
+    for (i = 0; i < 100; i++) {
+        int64_t t = SDL_GetTickHR();
+        msg_queue_put_simple3(&q, MSG_TEST, i, 0);
+        t = SDL_GetTickHR() - t;
+        if (t > put_max_ms)
+            put_max_ms = t;
+    }
+    return NULL;
+}
+
+/* the consumer got descheduled between publishing 'waiting' and sleeping */
+static int test_stall(void)
+{
+    pthread_t tid;
+    AVMessage msg;
+    int n = 0;
+
+    msg_queue_init(&q);
+    msg_queue_start(&q);
+    msg_queue_get(&q, &msg, 0);
+
+    put_max_ms = 0;
+    SDL_LockMutex(q.mutex);
+    __atomic_store_n(&q.waiting, 1, __ATOMIC_SEQ_CST);
+    pthread_create(&tid, NULL, stall_producer, NULL);
+    usleep(STALL_MS * 1000);
+    SDL_UnlockMutex(q.mutex);
+    pthread_join(tid, NULL);
+
+    while (msg_queue_get_timeout(&q, &msg, 10) > 0) {
+        if (msg.what != MSG_TEST || msg.arg1 != n)
+            break;
+        n++;
+    }
+    msg_queue_abort(&q);
+    msg_queue_destroy(&q);
+
+    printf("stall: %d of 100 delivered, slowest put %"PRId64" ms while the consumer stalled %d ms\n",
+           n, put_max_ms, STALL_MS);
+    return n == 100 && put_max_ms < MAX_PUT_MS ? 0 : 1;
+}
+
+/* a full ring, then coalesced messages behind the overflow list */
+static int test_overflow_coalesce(void)
+{
+    AVMessage msg;
+    int i, plain = 0, updates = 0, last_arg = -1, tail = 0, bad = 0;
+
+    msg_queue_init(&q);
+    msg_queue_start(&q);
+    msg_queue_get(&q, &msg, 0);
+
+    for (i = 0; i < MSG_QUEUE_SIZE + 100; i++)
+        msg_queue_put_simple3(&q, MSG_TEST, i, 0);
+    for (i = 1; i <= 3; i++)
+        msg_queue_put_simple3(&q, FFP_MSG_BUFFERING_UPDATE, i * 10, 0);
+    msg_queue_put_simple1(&q, FFP_MSG_COMPLETED);
+
+    while (msg_queue_get(&q, &msg, 0) > 0) {
+        if (msg.what == MSG_TEST) {
+            if (msg.arg1 != plain || updates || tail)
+                bad++;
+            plain++;
+        } else if (msg.what == FFP_MSG_BUFFERING_UPDATE) {
+            if (tail)
+                bad++;
+            updates++;
+            last_arg = msg.arg1;
+        } else if (msg.what == FFP_MSG_COMPLETED) {
+            tail++;
+        }
+    }
+    printf("overflow: %d plain, %d buffering update with %d, %d completed, %d out of order, %d dropped\n",
+           plain, updates, last_arg, tail, bad, q.drop_count);
+    msg_queue_abort(&q);
+    msg_queue_destroy(&q);
+    return plain == MSG_QUEUE_SIZE + 100 && updates == 1 && last_arg == 30 && tail == 1 && !bad ? 0 : 1;
+}
+
+static void *stress_producer(void *arg)
+{
+    long id = (long)arg;
+    int i;
+    for (i = 0; i < STRESS_MESSAGES; i++)
+        msg_queue_put_simple3(&q, MSG_TEST + id, i, 0);
+    return NULL;
+}
+
+/* producers run ahead of a late consumer, each one's messages stay in order */
+static int test_stress(void)
+{
+    pthread_t tid[STRESS_PRODUCERS];
+    int last[STRESS_PRODUCERS];
+    AVMessage msg;
+    long i, got = 0, bad = 0;
+
+    msg_queue_init(&q);
+    msg_queue_start(&q);
+    msg_queue_get(&q, &msg, 0);
+
+    for (i = 0; i < STRESS_PRODUCERS; i++) {
+        last[i] = -1;
+        pthread_create(&tid[i], NULL, stress_producer, (void *)i);
+    }
+    usleep(100 * 1000);
+    while (got < (long)STRESS_PRODUCERS * STRESS_MESSAGES && msg_queue_get_timeout(&q, &msg, 1000) > 0) {
+        int id = msg.what - MSG_TEST;
+        if (id < 0 || id >= STRESS_PRODUCERS || msg.arg1 != last[id] + 1)
+            bad++;
+        else
+            last[id] = msg.arg1;
+        got++;
+    }
+    for (i = 0; i < STRESS_PRODUCERS; i++)
+        pthread_join(tid[i], NULL);
+
+    printf("stress: %ld of %d delivered, %ld out of order, %d dropped\n",
+           got, STRESS_PRODUCERS * STRESS_MESSAGES, bad, q.drop_count);
+    msg_queue_abort(&q);
+    msg_queue_destroy(&q);
+    return got == (long)STRESS_PRODUCERS * STRESS_MESSAGES && !bad ? 0 : 1;
+}
+
+static void *late_put(void *arg)
+{
+    usleep(100 * 1000);
+    if (arg)
+        msg_queue_abort(&q);
+    else
+        msg_queue_put_simple1(&q, MSG_TEST);
+    return NULL;
+}
+
+/* a sleeping consumer wakes for a put and for abort, and times out when idle */
+static int test_wakeup(void)
+{
+    pthread_t tid;
+    AVMessage msg;
+    int64_t t, idle_ms, put_ms, abort_ms;
+    int idle_ret, put_ret, abort_ret;
+
+    msg_queue_init(&q);
+    msg_queue_start(&q);
+    msg_queue_get(&q, &msg, 0);
+
+    t = SDL_GetTickHR();
+    idle_ret = msg_queue_get_timeout(&q, &msg, 200);
+    idle_ms = SDL_GetTickHR() - t;
+
+    pthread_create(&tid, NULL, late_put, NULL);
+    t = SDL_GetTickHR();
+    put_ret = msg_queue_get(&q, &msg, 1);
+    put_ms = SDL_GetTickHR() - t;
+    pthread_join(tid, NULL);
+
+    pthread_create(&tid, NULL, late_put, &q);
+    t = SDL_GetTickHR();
+    abort_ret = msg_queue_get(&q, &msg, 1);
+    abort_ms = SDL_GetTickHR() - t;
+    pthread_join(tid, NULL);
+    msg_queue_destroy(&q);
+
+    printf("wakeup: idle %d after %"PRId64" ms, put %d after %"PRId64" ms, abort %d after %"PRId64" ms\n",
+           idle_ret, idle_ms, put_ret, put_ms, abort_ret, abort_ms);
+    return idle_ret == 0 && idle_ms >= 200 && idle_ms < 200 + MAX_PUT_MS &&
+           put_ret > 0 && put_ms < 100 + MAX_PUT_MS &&
+           abort_ret < 0 && abort_ms < 100 + MAX_PUT_MS ? 0 : 1;
+}
+
+int main(void)
+{
+    int ret = 0;
+
+    ret |= test_stall();
+    ret |= test_overflow_coalesce();
+    ret |= test_stress();
+    ret |= test_wakeup();
+    return ret;
+}
@@ -0,0 +1,212 @@
+//
+// pacing.c
+//
+// 30 fps content on a 60 Hz display over a synthetic clock, fed to the
+// pacing metrics the way video_refresh and the audio callback do: a
+// decoder stall, a hold for sync, a late refresh and a second with video
+// ahead must land in the expected buckets, causes and windows.
+//
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ijkpacing.h"
+
+#define FRAMES          300
+#define DURATION        (1.0 / 30)
+#define VSYNC           (1.0 / 60)
+/* off the ms grid, so windows are cut on whole frames */
+#define PHASE           (VSYNC / 4)
+
+#define STARVED_FRAME   62          // 60 and 61 come too late, the queue runs dry before
+#define SYNC_FRAME      150         // the audio clock stepped back, held 2 more frames
+#define LATE_FRAME      250         // the refresh loop missed 2 vsyncs, 251 is dropped
+#define AHEAD_FIRST     210         // video 40 ms ahead for one window
+#define AHEAD_LAST      239
+#define AHEAD           0.040
+
+#define AUDIO_BUFFER_US 21333       // 1024 samples at 48 kHz
+
+static int failed;
+
+#define EXPECT(cond, ...)                                   \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);     \
+            printf(__VA_ARGS__);                            \
+            printf("\n");                                   \
+            failed++;                                       \
+        }                                                   \
+    } while (0)
+
+typedef struct Schedule {
+    int     vsync;                  // shown at, -1 if dropped late
+    double  due;
+    double  delay;                  // how long the previous picture was held
+} Schedule;
+
+static void build_schedule(Schedule *s)
+{
+    int k;
+
+    for (k = 0; k < FRAMES; k++) {
+        int shift = k >= SYNC_FRAME ? 4 : 0;
+        s[k].vsync = 2 * k + shift;
+        s[k].due   = (k + shift / 2) * DURATION;
+        s[k].delay = DURATION;
+    }
+    s[STARVED_FRAME - 2].vsync = -1;
+    s[STARVED_FRAME - 1].vsync = -1;
+    s[SYNC_FRAME].delay = 3 * DURATION;
+    s[LATE_FRAME].vsync += 2;
+    s[LATE_FRAME + 1].vsync = -1;
+}
+
+static double vsync_time(int vsync)
+{
+    return vsync * VSYNC + PHASE;
+}
+
+static void test_video(void)
+{
+    static Schedule s[FRAMES];
+    IjkPacing *p = ijk_pacing_create();
+    IjkPacingSnapshot snap;
+    int64_t expected;
+    int n, next = 0, i;
+
+    build_schedule(s);
+    for (n = 0; next < FRAMES; n++) {
+        double now = vsync_time(n);
+
+        /* nothing decoded between 59 and 62 */
+        if (n >= 2 * (STARVED_FRAME - 2) && n < s[STARVED_FRAME].vsync)
+            ijk_pacing_queue_empty(p, now);
+        while (next < FRAMES && (s[next].vsync < 0 || s[next].vsync == n)) {
+            if (s[next].vsync < 0) {
+                ijk_pacing_frame_skipped(p, IJK_PACING_SKIP_LATE);
+            } else {
+                double avdiff = next >= AHEAD_FIRST && next <= AHEAD_LAST ? AHEAD : 0;
+                ijk_pacing_frame_shown(p, now, s[next].due, DURATION, s[next].delay, avdiff, 1);
+            }
+            next++;
+        }
+    }
+    ijk_pacing_get_snapshot(p, &snap);
+
+    printf("frames %"PRId64" error avg %"PRId64" max %"PRId64" us, interval avg %"PRId64" jitter %"PRId64" us\n",
+           snap.frames, snap.error_avg_us, snap.error_max_us, snap.interval_avg_us, snap.interval_jitter_us);
+    printf("intervals");
+    for (i = 0; i < IJK_PACING_INTERVAL_BUCKETS; i++)
+        printf(" %"PRId64, snap.interval_hist[i]);
+    printf(", repeats %"PRId64"/%"PRId64"/%"PRId64", late skips %"PRId64"\n",
+           snap.repeats[IJK_PACING_REPEAT_STARVED], snap.repeats[IJK_PACING_REPEAT_SYNC],
+           snap.repeats[IJK_PACING_REPEAT_REFRESH], snap.skips[IJK_PACING_SKIP_LATE]);
+
+    EXPECT(snap.frames == FRAMES - 3, "%"PRId64" frames shown", snap.frames);
+
+    /* 3 frame intervals for the stall and the hold, 2 for the late
+     * refresh, every other picture stayed its 2 vsyncs */
+    EXPECT(snap.interval_hist[5] == 2, "%"PRId64" intervals of 3 frames", snap.interval_hist[5]);
+    EXPECT(snap.interval_hist[4] == 1, "%"PRId64" intervals of 2 frames", snap.interval_hist[4]);
+    EXPECT(snap.interval_hist[2] == FRAMES - 3 - 1 - 3, "%"PRId64" regular intervals", snap.interval_hist[2]);
+    for (i = 0; i < IJK_PACING_INTERVAL_BUCKETS; i++)
+        EXPECT(i == 2 || i == 4 || i == 5 || !snap.interval_hist[i], "interval bucket %d: %"PRId64, i, snap.interval_hist[i]);
+    expected = (int64_t)((vsync_time(s[FRAMES - 1].vsync) - vsync_time(0)) / (FRAMES - 4) * 1000000);
+    EXPECT(llabs(snap.interval_avg_us - expected) <= 1, "interval avg %"PRId64", expected %"PRId64,
+           snap.interval_avg_us, expected);
+    EXPECT(snap.interval_jitter_us > 0 && snap.interval_jitter_us < 10000, "jitter %"PRId64, snap.interval_jitter_us);
+
+    EXPECT(snap.repeats[IJK_PACING_REPEAT_STARVED] == 2, "starved repeats %"PRId64, snap.repeats[IJK_PACING_REPEAT_STARVED]);
+    EXPECT(snap.repeats[IJK_PACING_REPEAT_SYNC] == 2, "sync repeats %"PRId64, snap.repeats[IJK_PACING_REPEAT_SYNC]);
+    EXPECT(snap.repeats[IJK_PACING_REPEAT_REFRESH] == 1, "refresh repeats %"PRId64, snap.repeats[IJK_PACING_REPEAT_REFRESH]);
+    EXPECT(snap.skips[IJK_PACING_SKIP_LATE] == 3, "late skips %"PRId64, snap.skips[IJK_PACING_SKIP_LATE]);
+
+    /* shown a quarter vsync after due, the late refresh 2 vsyncs more */
+    expected = (int64_t)((2 * VSYNC + PHASE) * 1000000);
+    EXPECT(llabs(snap.error_max_us - expected) <= 1, "error max %"PRId64, snap.error_max_us);
+    expected = (int64_t)(((FRAMES - 3) * PHASE + 2 * VSYNC) / (FRAMES - 3) * 1000000);
+    EXPECT(llabs(snap.error_avg_us - expected) <= 1, "error avg %"PRId64", expected %"PRId64, snap.error_avg_us, expected);
+
+    /* A/V offset: in sync but for one window */
+    EXPECT(snap.avdiff_hist[4] == FRAMES - 3 - 30 && snap.avdiff_hist[5] == 30,
+           "avdiff buckets %"PRId64"/%"PRId64, snap.avdiff_hist[4], snap.avdiff_hist[5]);
+    EXPECT(llabs(snap.avdiff_max_us - 40000) <= 1, "avdiff max %"PRId64, snap.avdiff_max_us);
+    expected = (int64_t)(AHEAD * 30 / (FRAMES - 3) * 1000000);
+    EXPECT(llabs(snap.avdiff_avg_us - expected) <= 1, "avdiff avg %"PRId64, snap.avdiff_avg_us);
+
+    EXPECT(snap.nb_windows == 10, "%d windows", snap.nb_windows);
+    for (i = 0; i < snap.nb_windows; i++) {
+        const IjkPacingWindow *w = &snap.windows[i];
+        int ahead = i == 7;
+
+        printf("window %d at %5"PRId64" ms: avg %6d max %6d us\n", i, w->start_ms, w->avdiff_avg_us, w->avdiff_max_us);
+        EXPECT(abs(w->avdiff_avg_us - (ahead ? 40000 : 0)) <= 1 && abs(w->avdiff_max_us - (ahead ? 40000 : 0)) <= 1,
+               "window %d avg %d max %d", i, w->avdiff_avg_us, w->avdiff_max_us);
+        if (i > 0)
+            EXPECT(w->start_ms - w[-1].start_ms >= IJK_PACING_WINDOW_MS &&
+                   w->start_ms - w[-1].start_ms < IJK_PACING_WINDOW_MS + 100, "window %d at %"PRId64, i, w->start_ms);
+    }
+    EXPECT(snap.windows[7].start_ms == (int64_t)(vsync_time(s[AHEAD_FIRST].vsync) * 1000),
+           "ahead window at %"PRId64, snap.windows[7].start_ms);
+
+    /* a seek or pause: the interval across it is not measured */
+    ijk_pacing_break(p);
+    ijk_pacing_queue_empty(p, vsync_time(n + 100));
+    ijk_pacing_frame_shown(p, vsync_time(n + 200), vsync_time(n + 200), DURATION, DURATION, 0, 1);
+    ijk_pacing_frame_shown(p, vsync_time(n + 300), vsync_time(n + 300), DURATION, DURATION, 0, 0);
+    ijk_pacing_frame_shown(p, vsync_time(n + 302), vsync_time(n + 302), DURATION, DURATION, NAN, 1);
+    ijk_pacing_get_snapshot(p, &snap);
+    EXPECT(snap.frames == FRAMES, "%"PRId64" frames", snap.frames);
+    EXPECT(snap.interval_hist[2] == FRAMES - 3 - 1 - 3 + 1 && snap.repeats[IJK_PACING_REPEAT_STARVED] == 2,
+           "intervals across a break were measured");
+    EXPECT(snap.avdiff_hist[4] == FRAMES - 3 - 30 + 2, "NAN avdiff counted");
+
+    ijk_pacing_destroy(&p);
+    EXPECT(!p, "destroy clears the pointer");
+}
+
+/* the audio callback: waits for data after open and seek are no underruns */
+static void test_audio(void)
+{
+    IjkPacing *p = ijk_pacing_create();
+    IjkPacingSnapshot snap;
+    int i;
+
+    for (i = 0; i < 10; i++)
+        ijk_pacing_audio_underrun(p, AUDIO_BUFFER_US);
+    for (i = 0; i < 100; i++)
+        ijk_pacing_audio_played(p);
+    for (i = 0; i < 5; i++)
+        ijk_pacing_audio_underrun(p, AUDIO_BUFFER_US);
+    for (i = 0; i < 100; i++)
+        ijk_pacing_audio_played(p);
+    for (i = 0; i < 2; i++)
+        ijk_pacing_audio_underrun(p, AUDIO_BUFFER_US);
+    ijk_pacing_audio_played(p);
+
+    ijk_pacing_break(p);
+    for (i = 0; i < 20; i++)
+        ijk_pacing_audio_underrun(p, AUDIO_BUFFER_US);
+    ijk_pacing_audio_played(p);
+
+    ijk_pacing_get_snapshot(p, &snap);
+    printf("audio underruns %"PRId64", %"PRId64" us of silence\n", snap.audio_underruns, snap.audio_underrun_us);
+    EXPECT(snap.audio_underruns == 2, "%"PRId64" underruns", snap.audio_underruns);
+    EXPECT(snap.audio_underrun_us == 7 * AUDIO_BUFFER_US, "%"PRId64" us of silence", snap.audio_underrun_us);
+    EXPECT(snap.frames == 0 && snap.nb_windows == 0, "video metrics without video");
+
+    EXPECT(!ijk_pacing_report_due(p, 1000), "first report");
+    EXPECT(!ijk_pacing_report_due(p, 1000 + IJK_PACING_REPORT_MS - 1), "report too early");
+    EXPECT(ijk_pacing_report_due(p, 1000 + IJK_PACING_REPORT_MS), "report not due");
+    ijk_pacing_destroy(&p);
+}
+
+int main(void)
+{
+    test_video();
+    test_audio();
+    printf("pacing: %d failed\n", failed);
+    return !!failed;
+}
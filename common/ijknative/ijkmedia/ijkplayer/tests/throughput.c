@@ -0,0 +1,320 @@
+//
+// throughput.c
+//
+// Replays read traces through the throughput estimator: the EWMA after a
+// rate change, the percentiles, per network and per host figures, the
+// meter's windows and save/load.
+//
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "libavutil/common.h"
+#include "ijkthroughput.h"
+
+#define HALF_LIFE_MS    5000
+
+static int failed;
+
+#define EXPECT(cond, ...)                                   \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);     \
+            printf(__VA_ARGS__);                            \
+            printf("\n");                                   \
+            failed++;                                       \
+        }                                                   \
+    } while (0)
+
+static void replay(const char *url, int64_t rate, int nb_samples, int64_t elapsed_ms)
+{
+    int i;
+    for (i = 0; i < nb_samples; i++)
+        ijk_throughput_add_sample(url, rate * elapsed_ms / 1000, elapsed_ms);
+}
+
+/* the EWMA follows a step with a HALF_LIFE_MS half life weighed by time */
+static void test_ewma(void)
+{
+    IjkThroughputEstimate e;
+    double a = pow(0.5, 500.0 / HALF_LIFE_MS), expected;
+
+    ijk_throughput_reset();
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+
+    replay("http://cdn.example/a.flv", 1000000, 1, 500);
+    ijk_throughput_get_estimate("cdn.example", &e);
+    EXPECT(llabs(e.ewma - 1000000) <= 1, "first sample gives %"PRId64", not the bias", e.ewma);
+
+    replay("http://cdn.example/a.flv", 1000000, 9, 500);
+    replay("http://cdn.example/a.flv", 200000, 10, 500);
+    ijk_throughput_get_estimate("cdn.example", &e);
+    expected = (1000000 * (1 - pow(a, 10)) * pow(a, 10) + 200000 * (1 - pow(a, 10))) / (1 - pow(a, 20));
+    EXPECT(llabs(e.ewma - (int64_t)expected) <= 1, "ewma %"PRId64" after 5 s at the new rate, expected %.0f",
+           e.ewma, expected);
+
+    /* one sample of 5 s moves it as far as ten of 500 ms */
+    ijk_throughput_reset();
+    replay("cdn.example", 1000000, 10, 500);
+    replay("cdn.example", 200000, 1, 5000);
+    ijk_throughput_get_estimate("cdn.example", &e);
+    EXPECT(llabs(e.ewma - (int64_t)expected) <= 1, "ewma %"PRId64" after one 5 s sample, expected %.0f",
+           e.ewma, expected);
+}
+
+static void test_percentiles(void)
+{
+    static const int order[] = { 17, 3, 29, 11, 1, 24, 8, 32, 14, 20, 5, 27, 2, 19, 30, 9,
+                                 22, 13, 6, 31, 16, 4, 25, 10, 28, 18, 7, 21, 12, 26, 15, 23 };
+    IjkThroughputEstimate e;
+    int i;
+
+    ijk_throughput_reset();
+    for (i = 0; i < 32; i++)
+        replay("cdn.example", order[i] * 100000, 1, 500);
+    ijk_throughput_get_estimate("cdn.example", &e);
+    EXPECT(e.nb_samples == IJK_THROUGHPUT_HISTORY, "%d samples", e.nb_samples);
+    EXPECT(e.p10 == 400000 && e.p50 == 1600000 && e.p90 == 2800000,
+           "p10/p50/p90 %"PRId64"/%"PRId64"/%"PRId64, e.p10, e.p50, e.p90);
+
+    /* only the last IJK_THROUGHPUT_HISTORY count */
+    replay("cdn.example", 50000, 8, 500);
+    ijk_throughput_get_estimate("cdn.example", &e);
+    EXPECT(e.p10 == 50000 && e.p50 == 1200000, "after 8 slow samples p10/p50 %"PRId64"/%"PRId64, e.p10, e.p50);
+
+    /* latency dominated samples are dropped */
+    ijk_throughput_add_sample("cdn.example", 1000, 500);
+    ijk_throughput_add_sample("cdn.example", 1000000, 50);
+    ijk_throughput_get_estimate("cdn.example", &e);
+    EXPECT(e.p10 == 50000 && e.nb_samples == IJK_THROUGHPUT_HISTORY, "short samples were counted");
+}
+
+static void test_networks_hosts(void)
+{
+    IjkThroughputEstimate e;
+    int i;
+
+    ijk_throughput_reset();
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+    EXPECT(ijk_throughput_get_estimate("a.example", &e) < 0, "estimate without samples");
+    replay("http://a.example/x", 2000000, 5, 500);
+    replay("http://b.example/x", 1000000, 5, 500);
+    ijk_throughput_set_network_type(IJK_NETWORK_CELLULAR);
+    replay("http://a.example/x", 300000, 5, 500);
+
+    ijk_throughput_get_estimate("https://user@A.Example:8443/live?x=1", &e);
+    EXPECT(e.per_host && e.p50 == 300000, "a on cellular: per_host %d p50 %"PRId64, e.per_host, e.p50);
+    ijk_throughput_get_estimate("b.example", &e);
+    EXPECT(!e.per_host && e.p50 == 300000, "b on cellular falls back to the network: per_host %d p50 %"PRId64,
+           e.per_host, e.p50);
+
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+    ijk_throughput_get_estimate("a.example", &e);
+    EXPECT(e.per_host && e.p50 == 2000000, "a on wifi p50 %"PRId64, e.p50);
+    ijk_throughput_get_estimate("b.example", &e);
+    EXPECT(e.per_host && e.p50 == 1000000, "b on wifi p50 %"PRId64, e.p50);
+    ijk_throughput_get_estimate("c.example", &e);
+    EXPECT(!e.per_host && e.nb_samples == 10, "c on wifi: per_host %d, %d samples", e.per_host, e.nb_samples);
+
+    /* a host needs a few samples of its own */
+    replay("c.example", 700000, 2, 500);
+    ijk_throughput_get_estimate("c.example", &e);
+    EXPECT(!e.per_host, "c used after 2 samples");
+    replay("c.example", 700000, 1, 500);
+    ijk_throughput_get_estimate("c.example", &e);
+    EXPECT(e.per_host && llabs(e.ewma - 700000) <= 1, "c after 3 samples: per_host %d ewma %"PRId64, e.per_host, e.ewma);
+
+    ijk_throughput_set_network_type(IJK_NETWORK_ETHERNET);
+    EXPECT(ijk_throughput_get_estimate("a.example", &e) < 0, "estimate on an unused network type");
+    ijk_throughput_set_network_type(IJK_NETWORK_NB);
+    EXPECT(ijk_throughput_get_network_type() == IJK_NETWORK_UNKNOWN, "invalid network type kept");
+
+    /* the least recently used host makes room */
+    ijk_throughput_reset();
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+    for (i = 0; i < 65; i++) {
+        char host[32];
+        snprintf(host, sizeof(host), "h%d.example", i);
+        replay(host, 100000 + i, 3, 500);
+    }
+    ijk_throughput_get_estimate("h0.example", &e);
+    EXPECT(!e.per_host, "h0 should have been evicted");
+    ijk_throughput_get_estimate("h64.example", &e);
+    EXPECT(e.per_host && llabs(e.ewma - 100064) <= 1, "h64 per_host %d", e.per_host);
+}
+
+/* reads of 4 KB arriving at 200 KB/s, with a throttled gap in the middle */
+static void test_meter(void)
+{
+    IjkThroughputMeter *meter = ijk_throughput_meter_create();
+    IjkThroughputEstimate e;
+    int64_t t;
+
+    ijk_throughput_reset();
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+    ijk_throughput_meter_set_url(meter, "http://live.example/s.flv");
+
+    for (t = 0; t <= 4000; t += 20)
+        ijk_throughput_meter_add_bytes(meter, 4096, t);
+    ijk_throughput_meter_get_estimate(&meter, &e);
+    EXPECT(e.nb_samples == 8 && e.p10 == 204800 && e.p90 == 204800,
+           "%d windows, p10 %"PRId64" p90 %"PRId64, e.nb_samples, e.p10, e.p90);
+
+    /* queues full for 3 s, then the socket buffer in one read: the window
+     * spanning it is dropped */
+    ijk_throughput_meter_discard(meter);
+    ijk_throughput_meter_add_bytes(meter, 65536, 7000);
+    for (t = 7020; t <= 9000; t += 20)
+        ijk_throughput_meter_add_bytes(meter, 4096, t);
+    ijk_throughput_meter_get_estimate(&meter, &e);
+    EXPECT(e.nb_samples == 12 && e.p10 == 204800, "after the gap %d windows, p10 %"PRId64, e.nb_samples, e.p10);
+
+    /* a redirect starts a new window for the new host */
+    ijk_throughput_meter_set_url(meter, "http://edge.example/s.flv");
+    for (t = 14000; t <= 16000; t += 20)
+        ijk_throughput_meter_add_bytes(meter, 8192, t);
+    ijk_throughput_meter_get_estimate(&meter, &e);
+    EXPECT(e.per_host && e.p50 == 409600, "edge per_host %d p50 %"PRId64, e.per_host, e.p50);
+
+    /* samples from the cache replace the windows */
+    ijk_throughput_meter_add_sample(meter, 1000000, 1000);
+    for (t = 16020; t <= 20000; t += 20)
+        ijk_throughput_meter_add_bytes(meter, 8192, t);
+    ijk_throughput_meter_get_estimate(&meter, &e);
+    EXPECT(e.nb_samples == 5 && e.ewma > 409600, "with external samples %d, ewma %"PRId64, e.nb_samples, e.ewma);
+
+    ijk_throughput_meter_destroy(&meter);
+    EXPECT(!meter && ijk_throughput_meter_get_estimate(&meter, &e) < 0, "estimate after destroy");
+}
+
+/* a link alternating between GOOD and BAD every 4 s, read in 20 ms ticks */
+static void test_trace(void)
+{
+    static const struct { int network; const char *url; int64_t good, bad; } traces[] = {
+        { IJK_NETWORK_WIFI,     "http://a.example/live.flv", 600000, 100000 },
+        { IJK_NETWORK_WIFI,     "http://b.example/live.flv", 300000, 200000 },
+        { IJK_NETWORK_CELLULAR, "http://a.example/live.flv", 150000,  40000 },
+    };
+    IjkThroughputEstimate e;
+    int i;
+
+    ijk_throughput_reset();
+    for (i = 0; i < FF_ARRAY_ELEMS(traces); i++) {
+        IjkThroughputMeter *meter = ijk_throughput_meter_create();
+        int64_t t;
+
+        ijk_throughput_set_network_type(traces[i].network);
+        ijk_throughput_meter_set_url(meter, traces[i].url);
+        for (t = 0; t <= 16000; t += 20) {
+            int64_t rate = t > 0 && ((t - 20) / 4000) % 2 ? traces[i].bad : traces[i].good;
+            ijk_throughput_meter_add_bytes(meter, rate * 20 / 1000, t);
+        }
+        ijk_throughput_meter_get_estimate(&meter, &e);
+        printf("network %d %-28s ewma %7"PRId64" p10 %7"PRId64" p50 %7"PRId64" p90 %7"PRId64" (%d samples%s)\n",
+               traces[i].network, traces[i].url, e.ewma, e.p10, e.p50, e.p90, e.nb_samples,
+               e.per_host ? ", host" : "");
+
+        /* half the windows at each rate, the last 4 s were slow */
+        EXPECT(e.per_host && e.nb_samples == 32, "%d samples", e.nb_samples);
+        EXPECT(e.p10 == traces[i].bad && e.p50 == traces[i].bad && e.p90 == traces[i].good,
+               "p10/p50/p90 %"PRId64"/%"PRId64"/%"PRId64, e.p10, e.p50, e.p90);
+        EXPECT(e.ewma > traces[i].bad && e.ewma < (traces[i].good + traces[i].bad) / 2,
+               "ewma %"PRId64, e.ewma);
+        ijk_throughput_meter_destroy(&meter);
+    }
+
+    /* the network keeps the last windows of any host, a keeps its own */
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+    ijk_throughput_get_estimate("c.example", &e);
+    printf("network %d %-28s ewma %7"PRId64" p10 %7"PRId64" p50 %7"PRId64" p90 %7"PRId64" (%d samples)\n",
+           IJK_NETWORK_WIFI, "*", e.ewma, e.p10, e.p50, e.p90, e.nb_samples);
+    EXPECT(!e.per_host && e.p10 == 200000 && e.p90 == 300000 && e.nb_samples == IJK_THROUGHPUT_HISTORY,
+           "wifi p10/p90 %"PRId64"/%"PRId64, e.p10, e.p90);
+    ijk_throughput_get_estimate("a.example", &e);
+    EXPECT(e.per_host && e.p10 == 100000 && e.p90 == 600000, "a on wifi p10/p90 %"PRId64"/%"PRId64, e.p10, e.p90);
+}
+
+static int same_estimate(const char *url, const IjkThroughputEstimate *a)
+{
+    IjkThroughputEstimate b;
+    if (ijk_throughput_get_estimate(url, &b) < 0)
+        return 0;
+    return llabs(a->ewma - b.ewma) <= 1 && a->p10 == b.p10 && a->p50 == b.p50 && a->p90 == b.p90 &&
+           a->nb_samples == b.nb_samples && a->per_host == b.per_host;
+}
+
+static void test_save_load(void)
+{
+    char path[] = "/tmp/ijkthroughput-test-XXXXXX";
+    IjkThroughputEstimate wifi_a, wifi_net, cell_a;
+    FILE *fp;
+    int fd;
+
+    fd = mkstemp(path);
+    if (fd < 0) {
+        EXPECT(0, "mkstemp");
+        return;
+    }
+    close(fd);
+
+    ijk_throughput_reset();
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+    replay("a.example", 2000000, 20, 500);
+    replay("a.example", 500000, 20, 500);
+    replay("b.example", 800000, 2, 500);
+    ijk_throughput_set_network_type(IJK_NETWORK_CELLULAR);
+    replay("a.example", 300000, 40, 500);
+    ijk_throughput_get_estimate("a.example", &cell_a);
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+    ijk_throughput_get_estimate("a.example", &wifi_a);
+    ijk_throughput_get_estimate("z.example", &wifi_net);
+    EXPECT(ijk_throughput_save(path) == 0, "save");
+
+    ijk_throughput_reset();
+    EXPECT(ijk_throughput_load(path) == 0, "load");
+    EXPECT(same_estimate("a.example", &wifi_a), "a on wifi differs after load");
+    EXPECT(same_estimate("z.example", &wifi_net), "wifi differs after load");
+    ijk_throughput_set_network_type(IJK_NETWORK_CELLULAR);
+    EXPECT(same_estimate("a.example", &cell_a), "a on cellular differs after load");
+
+    /* what was measured before the load is kept */
+    ijk_throughput_reset();
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+    replay("a.example", 100000, 3, 500);
+    EXPECT(ijk_throughput_load(path) == 0, "merge");
+    ijk_throughput_get_estimate("a.example", &wifi_a);
+    EXPECT(llabs(wifi_a.ewma - 100000) <= 1 && wifi_a.nb_samples == 3, "measured a was overwritten");
+    ijk_throughput_get_estimate("b.example", &wifi_a);
+    EXPECT(wifi_a.nb_samples == 3 && wifi_a.p50 == 100000, "b has too few samples, the network is used");
+
+    /* damaged files */
+    fp = fopen(path, "w");
+    fprintf(fp, "ijkthroughput 1\n1 x.example 5.0 0.5 40 1 2 3\n9 y.example 1 1 1 1\n1 w.example 300000.0 1.0 3 300000 300000 300000\n");
+    fclose(fp);
+    ijk_throughput_reset();
+    ijk_throughput_set_network_type(IJK_NETWORK_WIFI);
+    EXPECT(ijk_throughput_load(path) == 0, "load damaged");
+    EXPECT(ijk_throughput_get_estimate("x.example", &wifi_a) < 0, "bad entries loaded");
+    ijk_throughput_get_estimate("w.example", &wifi_a);
+    EXPECT(wifi_a.per_host && wifi_a.p50 == 300000, "good entry after bad ones");
+
+    fp = fopen(path, "w");
+    fprintf(fp, "something else\n1 * 1.0 1.0 1 1\n");
+    fclose(fp);
+    EXPECT(ijk_throughput_load(path) < 0, "file without the tag loaded");
+    EXPECT(ijk_throughput_load("/nonexistent/ijkthroughput") < 0, "missing file loaded");
+    remove(path);
+}
+
+int main(void)
+{
+    test_ewma();
+    test_percentiles();
+    test_networks_hosts();
+    test_meter();
+    test_trace();
+    test_save_load();
+    printf("throughput: %d failed\n", failed);
+    return !!failed;
+}
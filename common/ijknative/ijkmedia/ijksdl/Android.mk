@@ -53,6 +53,7 @@ LOCAL_SRC_FILES += gles2/vsh/mvp.vsh.c
 LOCAL_SRC_FILES += dummy/ijksdl_vout_dummy.c
 LOCAL_SRC_FILES += fastimage/fastimage_vout.c
 LOCAL_SRC_FILES += ffmpeg/ijksdl_vout_overlay_ffmpeg.c
+LOCAL_SRC_FILES += ffmpeg/ijksdl_vout_overlay_pool.c
 LOCAL_SRC_FILES += ffmpeg/abi_all/image_convert.c
 
 LOCAL_SRC_FILES += android/android_audiotrack.c
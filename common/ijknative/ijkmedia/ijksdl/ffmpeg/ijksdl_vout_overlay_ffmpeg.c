@@ -32,6 +32,7 @@
 #include "../ijksdl_video.h"
 #include "ijksdl_inc_ffmpeg.h"
 #include "ijksdl_image_convert.h"
+#include "ijksdl_vout_overlay_pool.h"
 
 struct SDL_VoutOverlay_Opaque {
     SDL_mutex *mutex;
@@ -95,7 +96,7 @@ static AVFrame *opaque_obtain_managed_frame_buffer(SDL_VoutOverlay_Opaque* opaqu
 
     AVFrame *managed_frame = opaque->managed_frame;
     int frame_bytes = av_em_image_get_buffer_size(managed_frame->format, managed_frame->width, managed_frame->height, 1);
-    AVEMBufferRef *frame_buffer_ref = av_em_buffer_alloc(frame_bytes);
+    AVEMBufferRef *frame_buffer_ref = SDL_VoutOverlayPool_Get(frame_bytes);
     if (!frame_buffer_ref)
         return NULL;
 
@@ -280,10 +281,8 @@ static SDL_Class g_vout_overlay_ffmpeg_class = {
     .name = "FFmpegVoutOverlay",
 };
 
-#ifndef __clang_analyzer__
-SDL_VoutOverlay *SDL_VoutFFmpeg_CreateOverlay(int width, int height, int frame_format, SDL_Vout *display)
+static Uint32 overlay_resolve_format(Uint32 overlay_format, int frame_format)
 {
-    Uint32 overlay_format = display->overlay_format;
     switch (overlay_format) {
         case SDL_FCC__GLES2: {
             switch (frame_format) {
@@ -304,95 +303,140 @@ SDL_VoutOverlay *SDL_VoutFFmpeg_CreateOverlay(int width, int height, int frame_f
         }
     }
 
-    SDLTRACE("SDL_VoutFFmpeg_CreateOverlay(w=%d, h=%d, fmt=%.4s(0x%x, dp=%p)\n",
-        width, height, (const char*) &overlay_format, overlay_format, display);
-
-    SDL_VoutOverlay *overlay = SDL_VoutOverlay_CreateInternal(sizeof(SDL_VoutOverlay_Opaque));
-    if (!overlay) {
-        ALOGE("overlay allocation failed");
-        return NULL;
-    }
-
-    SDL_VoutOverlay_Opaque *opaque = overlay->opaque;
-    opaque->mutex         = SDL_CreateMutex();
-    opaque->sws_flags     = SWS_BILINEAR;
-
-    overlay->opaque_class = &g_vout_overlay_ffmpeg_class;
-    overlay->format       = overlay_format;
-    overlay->pitches      = opaque->pitches;
-    overlay->pixels       = opaque->pixels;
-    overlay->w            = width;
-    overlay->h            = height;
-    overlay->free_l             = func_free_l;
-    overlay->lock               = func_lock;
-    overlay->unlock             = func_unlock;
-    overlay->func_fill_frame    = func_fill_frame;
+    return overlay_format;
+}
 
-    enum AVPixelFormat ff_format = AV_PIX_FMT_NONE;
-    int buf_width = width;
-    int buf_height = height;
+static int overlay_buffer_layout(Uint32 overlay_format, int width, enum AVPixelFormat *ff_format, int *buf_width, int *planes)
+{
+    *ff_format = AV_PIX_FMT_NONE;
+    *buf_width = width;
     switch (overlay_format) {
     case SDL_FCC_I420:
     case SDL_FCC_YV12: {
-        ff_format = AV_PIX_FMT_YUV420P;
+        *ff_format = AV_PIX_FMT_YUV420P;
         // FIXME: need runtime config
 #if defined(__ANDROID__)
         // 16 bytes align pitch for arm-neon image-convert
-        buf_width = IJKALIGN(width, 16); // 1 bytes per pixel for Y-plane
+        *buf_width = IJKALIGN(width, 16); // 1 bytes per pixel for Y-plane
 #elif defined(__APPLE__)
         // 2^n align for width
-        buf_width = width;
+        *buf_width = width;
         if (width > 0)
-            buf_width = 1 << (sizeof(int) * 8 - __builtin_clz(width));
+            *buf_width = 1 << (sizeof(int) * 8 - __builtin_clz(width));
 #else
-        buf_width = IJKALIGN(width, 16); // unknown platform
+        *buf_width = IJKALIGN(width, 16); // unknown platform
 #endif
-        opaque->planes = 3;
+        *planes = 3;
         break;
     }
     case SDL_FCC_I444P10LE: {
-        ff_format = AV_PIX_FMT_YUV444P10LE;
+        *ff_format = AV_PIX_FMT_YUV444P10LE;
         // FIXME: need runtime config
 #if defined(__ANDROID__)
         // 16 bytes align pitch for arm-neon image-convert
-        buf_width = IJKALIGN(width, 16); // 1 bytes per pixel for Y-plane
+        *buf_width = IJKALIGN(width, 16); // 1 bytes per pixel for Y-plane
 #elif defined(__APPLE__)
         // 2^n align for width
-        buf_width = width;
+        *buf_width = width;
         if (width > 0)
-            buf_width = 1 << (sizeof(int) * 8 - __builtin_clz(width));
+            *buf_width = 1 << (sizeof(int) * 8 - __builtin_clz(width));
 #else
-        buf_width = IJKALIGN(width, 16); // unknown platform
+        *buf_width = IJKALIGN(width, 16); // unknown platform
 #endif
-        opaque->planes = 3;
+        *planes = 3;
         break;
     }
     case SDL_FCC_RV16: {
-        ff_format = AV_PIX_FMT_RGB565;
-        buf_width = IJKALIGN(width, 8); // 2 bytes per pixel
-        opaque->planes = 1;
+        *ff_format = AV_PIX_FMT_RGB565;
+        *buf_width = IJKALIGN(width, 8); // 2 bytes per pixel
+        *planes = 1;
         break;
     }
     case SDL_FCC_RV24: {
-        ff_format = AV_PIX_FMT_RGB24;
+        *ff_format = AV_PIX_FMT_RGB24;
 #if defined(__ANDROID__)
         // 16 bytes align pitch for arm-neon image-convert
-        buf_width = IJKALIGN(width, 16); // 1 bytes per pixel for Y-plane
+        *buf_width = IJKALIGN(width, 16); // 1 bytes per pixel for Y-plane
 #elif defined(__APPLE__)
-        buf_width = width;
+        *buf_width = width;
 #else
-        buf_width = IJKALIGN(width, 16); // unknown platform
+        *buf_width = IJKALIGN(width, 16); // unknown platform
 #endif
-        opaque->planes = 1;
+        *planes = 1;
         break;
     }
     case SDL_FCC_RV32: {
-        ff_format = AV_PIX_FMT_0BGR32;
-        buf_width = IJKALIGN(width, 4); // 4 bytes per pixel
-        opaque->planes = 1;
+        *ff_format = AV_PIX_FMT_0BGR32;
+        *buf_width = IJKALIGN(width, 4); // 4 bytes per pixel
+        *planes = 1;
         break;
     }
     default:
+        return -1;
+    }
+
+    return 0;
+}
+
+/* bytes of the managed buffer, 0 if decoded frames are drawn directly */
+int SDL_VoutFFmpeg_GetOverlayBufferSize(int width, int height, int frame_format, Uint32 overlay_format)
+{
+    enum AVPixelFormat ff_format;
+    int buf_width;
+    int planes;
+
+    overlay_format = overlay_resolve_format(overlay_format, frame_format);
+    switch (overlay_format) {
+    case SDL_FCC_YV12:
+    case SDL_FCC_I420:
+        if (frame_format == AV_PIX_FMT_YUV420P || frame_format == AV_PIX_FMT_YUVJ420P)
+            return 0;
+        break;
+    case SDL_FCC_I444P10LE:
+        if (frame_format == AV_PIX_FMT_YUV444P10LE)
+            return 0;
+        break;
+    }
+
+    if (overlay_buffer_layout(overlay_format, width, &ff_format, &buf_width, &planes) < 0)
+        return -1;
+
+    return av_em_image_get_buffer_size(ff_format, buf_width, height, 1);
+}
+
+#ifndef __clang_analyzer__
+SDL_VoutOverlay *SDL_VoutFFmpeg_CreateOverlay(int width, int height, int frame_format, SDL_Vout *display)
+{
+    Uint32 overlay_format = overlay_resolve_format(display->overlay_format, frame_format);
+
+    SDLTRACE("SDL_VoutFFmpeg_CreateOverlay(w=%d, h=%d, fmt=%.4s(0x%x, dp=%p)\n",
+        width, height, (const char*) &overlay_format, overlay_format, display);
+
+    SDL_VoutOverlay *overlay = SDL_VoutOverlay_CreateInternal(sizeof(SDL_VoutOverlay_Opaque));
+    if (!overlay) {
+        ALOGE("overlay allocation failed");
+        return NULL;
+    }
+
+    SDL_VoutOverlay_Opaque *opaque = overlay->opaque;
+    opaque->mutex         = SDL_CreateMutex();
+    opaque->sws_flags     = SWS_BILINEAR;
+
+    overlay->opaque_class = &g_vout_overlay_ffmpeg_class;
+    overlay->format       = overlay_format;
+    overlay->pitches      = opaque->pitches;
+    overlay->pixels       = opaque->pixels;
+    overlay->w            = width;
+    overlay->h            = height;
+    overlay->free_l             = func_free_l;
+    overlay->lock               = func_lock;
+    overlay->unlock             = func_unlock;
+    overlay->func_fill_frame    = func_fill_frame;
+
+    enum AVPixelFormat ff_format = AV_PIX_FMT_NONE;
+    int buf_width = width;
+    int buf_height = height;
+    if (overlay_buffer_layout(overlay_format, width, &ff_format, &buf_width, &opaque->planes) < 0) {
         ALOGE("SDL_VoutFFmpeg_CreateOverlay(...): unknown format %.4s(0x%x)\n", (char*)&overlay_format, overlay_format);
         goto fail;
     }
@@ -30,5 +30,6 @@
 
 // TODO: 9 alignment to speed up memcpy when display
 SDL_VoutOverlay *SDL_VoutFFmpeg_CreateOverlay(int width, int height, int frame_format, SDL_Vout *vout);
+int              SDL_VoutFFmpeg_GetOverlayBufferSize(int width, int height, int frame_format, Uint32 overlay_format);
 
 #endif
@@ -0,0 +1,266 @@
+/*
+ * ijksdl_vout_overlay_pool.c
+ *      process-wide pool of overlay frame buffers
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ijksdl_vout_overlay_pool.h"
+
+#include <pthread.h>
+#include "libavutil/buffer.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "../ijksdl_misc.h"
+
+#define POOL_BUCKET_ALIGN       (64 * 1024)
+#define POOL_MAX_BUCKETS        16
+#define POOL_MAX_CACHED_BYTES   (48 * 1024 * 1024)
+#define POOL_IDLE_US            (10 * 1000 * 1000)
+#define POOL_TRIM_PERIOD_US     (1000 * 1000)
+
+/* lives in the first bytes of an idle buffer */
+typedef struct PoolEntry {
+    struct PoolEntry *next;
+    int64_t           idle_since;
+} PoolEntry;
+
+typedef struct PoolBucket {
+    int        size;
+    PoolEntry *free_list;
+    int        nb_free;
+    int        nb_used;     // handed out, their release callback points at this bucket
+} PoolBucket;
+
+static pthread_mutex_t          g_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static PoolBucket               g_pool_buckets[POOL_MAX_BUCKETS];
+static int                      g_pool_nb_buckets;
+static int64_t                  g_pool_last_trim;
+static int64_t                  g_pool_alloc_count;
+static SDL_VoutOverlayPoolStat  g_pool_stat;
+
+static PoolBucket *pool_find_bucket_l(int size)
+{
+    int i;
+
+    for (i = 0; i < g_pool_nb_buckets; i++) {
+        if (g_pool_buckets[i].size == size)
+            return &g_pool_buckets[i];
+    }
+
+    /* reuse a drained bucket before giving up */
+    for (i = 0; i < g_pool_nb_buckets; i++) {
+        if (!g_pool_buckets[i].free_list && !g_pool_buckets[i].nb_used) {
+            g_pool_buckets[i].size = size;
+            return &g_pool_buckets[i];
+        }
+    }
+    if (g_pool_nb_buckets >= POOL_MAX_BUCKETS)
+        return NULL;
+
+    g_pool_buckets[g_pool_nb_buckets].size = size;
+    return &g_pool_buckets[g_pool_nb_buckets++];
+}
+
+/* unlink idle entries, the caller frees them outside the lock */
+static PoolEntry *pool_collect_idle_l(int64_t now, int64_t idle_us)
+{
+    PoolEntry *trimmed = NULL;
+    PoolEntry **p_entry, *entry;
+    int i;
+
+    for (i = 0; i < g_pool_nb_buckets; i++) {
+        PoolBucket *bucket = &g_pool_buckets[i];
+        p_entry = &bucket->free_list;
+        while ((entry = *p_entry)) {
+            if (now - entry->idle_since >= idle_us) {
+                *p_entry = entry->next;
+                entry->next = trimmed;
+                trimmed = entry;
+                bucket->nb_free--;
+                g_pool_stat.cached_bytes  -= bucket->size;
+                g_pool_stat.trimmed_bytes += bucket->size;
+            } else {
+                p_entry = &entry->next;
+            }
+        }
+    }
+    g_pool_last_trim = now;
+    return trimmed;
+}
+
+static void pool_free_entries(PoolEntry *entry)
+{
+    PoolEntry *next;
+
+    for (; entry; entry = next) {
+        next = entry->next;
+        av_em_free(entry);
+    }
+}
+
+static void pool_release(void *opaque, uint8_t *data)
+{
+    PoolBucket *bucket = opaque;
+    PoolEntry  *entry  = (PoolEntry *)data;
+    PoolEntry  *trimmed = NULL;
+    int64_t     now    = av_em_gettime_relative();
+
+    pthread_mutex_lock(&g_pool_mutex);
+    bucket->nb_used--;
+    if (g_pool_stat.cached_bytes + bucket->size > POOL_MAX_CACHED_BYTES) {
+        pthread_mutex_unlock(&g_pool_mutex);
+        av_em_free(data);
+        return;
+    }
+    entry->idle_since = now;
+    entry->next = bucket->free_list;
+    bucket->free_list = entry;
+    bucket->nb_free++;
+    g_pool_stat.cached_bytes += bucket->size;
+    if (now - g_pool_last_trim >= POOL_TRIM_PERIOD_US)
+        trimmed = pool_collect_idle_l(now, POOL_IDLE_US);
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    pool_free_entries(trimmed);
+}
+
+static uint8_t *pool_alloc_timed(int size, int prewarm)
+{
+    int64_t start = av_em_gettime_relative();
+    uint8_t *data = av_em_alloc(size);
+    int64_t spent = av_em_gettime_relative() - start;
+
+    if (!data)
+        return NULL;
+
+    pthread_mutex_lock(&g_pool_mutex);
+    g_pool_stat.alloc_us += spent;
+    g_pool_alloc_count++;
+    if (prewarm)
+        g_pool_stat.prewarm_count++;
+    else
+        g_pool_stat.miss_count++;
+    pthread_mutex_unlock(&g_pool_mutex);
+    return data;
+}
+
+AVEMBufferRef *SDL_VoutOverlayPool_Get(int size)
+{
+    PoolBucket *bucket;
+    PoolEntry  *entry = NULL;
+    PoolEntry  *trimmed = NULL;
+    AVEMBufferRef *buf;
+    int64_t now = av_em_gettime_relative();
+    int bucket_size;
+
+    if (size <= 0)
+        return NULL;
+    bucket_size = IJKALIGN(size, POOL_BUCKET_ALIGN);
+
+    pthread_mutex_lock(&g_pool_mutex);
+    if (now - g_pool_last_trim >= POOL_TRIM_PERIOD_US)
+        trimmed = pool_collect_idle_l(now, POOL_IDLE_US);
+    bucket = pool_find_bucket_l(bucket_size);
+    if (bucket && bucket->free_list) {
+        entry = bucket->free_list;
+        bucket->free_list = entry->next;
+        bucket->nb_free--;
+        g_pool_stat.cached_bytes -= bucket->size;
+        g_pool_stat.hit_count++;
+    }
+    if (bucket)
+        bucket->nb_used++;
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    pool_free_entries(trimmed);
+
+    if (!bucket)
+        return av_em_buffer_alloc(size);
+
+    if (!entry)
+        entry = (PoolEntry *)pool_alloc_timed(bucket_size, 0);
+    if (entry)
+        buf = av_em_buffer_create((uint8_t *)entry, size, pool_release, bucket, 0);
+    else
+        buf = NULL;
+
+    if (!buf) {
+        av_em_free(entry);
+        pthread_mutex_lock(&g_pool_mutex);
+        bucket->nb_used--;
+        pthread_mutex_unlock(&g_pool_mutex);
+    }
+    return buf;
+}
+
+void SDL_VoutOverlayPool_Prewarm(int size, int count)
+{
+    PoolBucket *bucket;
+    uint8_t *data;
+    int bucket_size;
+    int missing;
+
+    if (size <= 0 || count <= 0)
+        return;
+    bucket_size = IJKALIGN(size, POOL_BUCKET_ALIGN);
+
+    pthread_mutex_lock(&g_pool_mutex);
+    bucket  = pool_find_bucket_l(bucket_size);
+    missing = bucket ? count - bucket->nb_free : 0;
+    if ((int64_t)missing * bucket_size + g_pool_stat.cached_bytes > POOL_MAX_CACHED_BYTES)
+        missing = (int)((POOL_MAX_CACHED_BYTES - g_pool_stat.cached_bytes) / bucket_size);
+    if (missing > 0)
+        bucket->nb_used += missing;
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    /* reserved as in use above, so the release path does the bookkeeping */
+    for (; missing > 0; missing--) {
+        data = pool_alloc_timed(bucket_size, 1);
+        if (!data)
+            break;
+        pool_release(bucket, data);
+    }
+    if (missing > 0) {
+        pthread_mutex_lock(&g_pool_mutex);
+        bucket->nb_used -= missing;
+        pthread_mutex_unlock(&g_pool_mutex);
+    }
+}
+
+void SDL_VoutOverlayPool_Trim(int64_t idle_ms)
+{
+    PoolEntry *trimmed;
+
+    pthread_mutex_lock(&g_pool_mutex);
+    trimmed = pool_collect_idle_l(av_em_gettime_relative(), idle_ms * 1000);
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    pool_free_entries(trimmed);
+}
+
+void SDL_VoutOverlayPool_GetStat(SDL_VoutOverlayPoolStat *stat)
+{
+    if (!stat)
+        return;
+
+    pthread_mutex_lock(&g_pool_mutex);
+    *stat = g_pool_stat;
+    if (g_pool_alloc_count > 0)
+        stat->avoided_alloc_us = g_pool_stat.hit_count * g_pool_stat.alloc_us / g_pool_alloc_count;
+    pthread_mutex_unlock(&g_pool_mutex);
+}
@@ -0,0 +1,51 @@
+/*
+ * ijksdl_vout_overlay_pool.h
+ *      process-wide pool of overlay frame buffers
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef IJKSDL__FFMPEG__IJKSDL_VOUT_OVERLAY_POOL_H
+#define IJKSDL__FFMPEG__IJKSDL_VOUT_OVERLAY_POOL_H
+
+#include <stdint.h>
+#include "ijksdl_inc_ffmpeg.h"
+
+/*
+ * Buffers are bucketed by size rounded up to 64KB, so overlays of one
+ * resolution share a bucket no matter which player or stream they belong
+ * to. Unreferencing a pooled AVEMBufferRef puts the memory back in its
+ * bucket; buffers left idle for a while are freed on the next pool access.
+ */
+
+typedef struct SDL_VoutOverlayPoolStat {
+    int64_t hit_count;
+    int64_t miss_count;
+    int64_t prewarm_count;
+    int64_t alloc_us;           // time spent in allocations, misses and pre-warming
+    int64_t avoided_alloc_us;   // hits * average allocation cost
+    int64_t cached_bytes;
+    int64_t trimmed_bytes;
+} SDL_VoutOverlayPoolStat;
+
+AVEMBufferRef  *SDL_VoutOverlayPool_Get(int size);
+void            SDL_VoutOverlayPool_Prewarm(int size, int count);
+/* free buffers idle for at least idle_ms, 0 frees all of them */
+void            SDL_VoutOverlayPool_Trim(int64_t idle_ms);
+void            SDL_VoutOverlayPool_GetStat(SDL_VoutOverlayPoolStat *stat);
+
+#endif
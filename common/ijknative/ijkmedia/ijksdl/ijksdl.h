@@ -37,5 +37,6 @@
 #include "ijksdl_vout.h"
 
 #include "ffmpeg/ijksdl_vout_overlay_ffmpeg.h"
+#include "ffmpeg/ijksdl_vout_overlay_pool.h"
 
 #endif
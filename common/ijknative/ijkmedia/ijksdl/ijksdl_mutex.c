@@ -25,8 +25,21 @@
 #include <errno.h>
 #include <assert.h>
 #include <sys/time.h>
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
 #include "ijksdl_inc_internal.h"
 
+struct SDL_sem {
+#ifdef __APPLE__
+    dispatch_semaphore_t id;
+#else
+    sem_t id;
+#endif
+};
+
 SDL_mutex *SDL_CreateMutex(void)
 {
     SDL_mutex *mutex;
@@ -171,3 +184,115 @@ int SDL_CondWait(SDL_cond *cond, SDL_mutex *mutex)
 
     return pthread_cond_wait(&cond->id, &mutex->id);
 }
+
+SDL_sem *SDL_CreateSemaphore(uint32_t initial_value)
+{
+    SDL_sem *sem;
+    sem = (SDL_sem *) mallocz(sizeof(SDL_sem));
+    if (!sem)
+        return NULL;
+
+#ifdef __APPLE__
+    sem->id = dispatch_semaphore_create(initial_value);
+    if (!sem->id) {
+#else
+    if (sem_init(&sem->id, 0, initial_value) != 0) {
+#endif
+        free(sem);
+        return NULL;
+    }
+
+    return sem;
+}
+
+void SDL_DestroySemaphore(SDL_sem *sem)
+{
+    if (sem) {
+#ifdef __APPLE__
+#if !__has_feature(objc_arc)
+        dispatch_release(sem->id);
+#endif
+        sem->id = NULL;
+#else
+        sem_destroy(&sem->id);
+#endif
+        free(sem);
+    }
+}
+
+void SDL_DestroySemaphoreP(SDL_sem **sem)
+{
+    if (sem) {
+        SDL_DestroySemaphore(*sem);
+        *sem = NULL;
+    }
+}
+
+int SDL_SemPost(SDL_sem *sem)
+{
+    assert(sem);
+    if (!sem)
+        return -1;
+
+#ifdef __APPLE__
+    dispatch_semaphore_signal(sem->id);
+    return 0;
+#else
+    return sem_post(&sem->id);
+#endif
+}
+
+int SDL_SemWaitTimeout(SDL_sem *sem, uint32_t ms)
+{
+#ifndef __APPLE__
+    struct timeval delta;
+    struct timespec abstime;
+#endif
+
+    assert(sem);
+    if (!sem)
+        return -1;
+
+#ifdef __APPLE__
+    if (dispatch_semaphore_wait(sem->id, dispatch_time(DISPATCH_TIME_NOW, (int64_t)ms * NSEC_PER_MSEC)) != 0)
+        return SDL_MUTEX_TIMEDOUT;
+    return 0;
+#else
+    gettimeofday(&delta, NULL);
+
+    abstime.tv_sec = delta.tv_sec + (ms / 1000);
+    abstime.tv_nsec = (delta.tv_usec + (ms % 1000) * 1000) * 1000;
+    if (abstime.tv_nsec >= 1000000000) {
+        abstime.tv_sec += 1;
+        abstime.tv_nsec -= 1000000000;
+    }
+
+    while (sem_timedwait(&sem->id, &abstime) != 0) {
+        if (errno == EINTR)
+            continue;
+        else if (errno == ETIMEDOUT)
+            return SDL_MUTEX_TIMEDOUT;
+        else
+            return -1;
+    }
+    return 0;
+#endif
+}
+
+int SDL_SemWait(SDL_sem *sem)
+{
+    assert(sem);
+    if (!sem)
+        return -1;
+
+#ifdef __APPLE__
+    dispatch_semaphore_wait(sem->id, DISPATCH_TIME_FOREVER);
+    return 0;
+#else
+    while (sem_wait(&sem->id) != 0) {
+        if (errno != EINTR)
+            return -1;
+    }
+    return 0;
+#endif
+}
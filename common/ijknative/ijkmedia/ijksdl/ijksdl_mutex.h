@@ -52,5 +52,15 @@ int         SDL_CondBroadcast(SDL_cond *cond);
 int         SDL_CondWaitTimeout(SDL_cond *cond, SDL_mutex *mutex, uint32_t ms);
 int         SDL_CondWait(SDL_cond *cond, SDL_mutex *mutex);
 
+/* posting never blocks, a post before the wait is not lost */
+typedef struct SDL_sem SDL_sem;
+
+SDL_sem    *SDL_CreateSemaphore(uint32_t initial_value);
+void        SDL_DestroySemaphore(SDL_sem *sem);
+void        SDL_DestroySemaphoreP(SDL_sem **sem);
+int         SDL_SemPost(SDL_sem *sem);
+int         SDL_SemWaitTimeout(SDL_sem *sem, uint32_t ms);
+int         SDL_SemWait(SDL_sem *sem);
+
 #endif
 
@@ -80,6 +80,10 @@ Uint64 SDL_GetTickHR(void)
         gettimeofday(&now, NULL);
         clock = now.tv_sec  * 1000 + now.tv_usec / 1000;
     }
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    clock = now.tv_sec * 1000 + now.tv_nsec / 1000000;
 #endif
     return (clock);
 }
@@ -70,6 +70,17 @@ typedef enum IJKLogLevel {
     k_IJK_LOG_SILENT  = 8,
 } IJKLogLevel;
 
+// count previews evenly spaced over a VOD source, packed columns per row, height 0 keeps the aspect ratio.
+// -extract blocks and runs once; -cancel may be called from any thread and makes it return nil early.
+// Reads give up after 15 seconds without data unless the player options set a timeout.
+@interface IJKThumbnailExtractor : NSObject
+
+- (instancetype)initWithURL:(NSString *)url count:(int)count size:(CGSize)size columns:(int)columns;
+- (UIImage *)extract;
+- (void)cancel;
+
+@end
+
 @interface EMFFMoviePlayerController : NSObject <IJKMediaPlayback>
 
 - (id)initWithContentURL:(NSURL *)aUrl
@@ -95,14 +106,31 @@ typedef enum IJKLogLevel {
 - (int)deletePreparedVideoSource:(int)index;
 - (void)setPlayChannelMode:(int)mode;
 - (void)setPauseInBackground:(BOOL)pause;
+- (void)setAudioOnlyInBackground:(BOOL)audioOnly;
 - (BOOL)isVideoToolboxOpen;
 
 - (void)setRotateMode: (int)degree;
 
 - (UIImage *)captureFrame;
+// previews of the current source, see IJKThumbnailExtractor; nil without a source
+- (IJKThumbnailExtractor *)thumbnailExtractorWithCount:(int)count size:(CGSize)size columns:(int)columns;
+// -extract of a new extractor, which cannot be cancelled; blocks
+- (UIImage *)thumbnailSpriteWithCount:(int)count size:(CGSize)size columns:(int)columns;
++ (UIImage *)thumbnailSpriteForURL:(NSString *)url count:(int)count size:(CGSize)size columns:(int)columns;
 + (void)setLogReport:(BOOL)preferLogReport;
 + (void)setLogLevel:(IJKLogLevel)logLevel;
 + (void)setLogOutput:(LogBlock)block;
+// throughput is estimated per network type (IJK_NETWORK_xxx), shared by all players
++ (void)setNetworkType:(int)type;
+// bytes per second from the host of url, percentile 10, 50 or 90, anything else for the average, -1 if unknown
++ (int64_t)throughputEstimateForURL:(NSString *)url percentile:(int)percentile;
++ (BOOL)loadThroughputFromFile:(NSString *)path;
++ (BOOL)saveThroughputToFile:(NSString *)path;
+// records playback events of all players, NO unless built with IJK_TRACE_ENABLED
++ (BOOL)startTrace;
++ (void)stopTrace;
+// Chrome trace JSON, open with chrome://tracing or ui.perfetto.dev
++ (BOOL)dumpTraceToFile:(NSString *)path;
 + (BOOL)checkIfFFmpegVersionMatch:(BOOL)showAlert;
 + (BOOL)checkIfPlayerVersionMatch:(BOOL)showAlert
                             major:(unsigned int)major
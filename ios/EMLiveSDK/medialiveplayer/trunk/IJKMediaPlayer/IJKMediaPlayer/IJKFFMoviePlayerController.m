@@ -129,6 +129,12 @@ static void emffplay_log_callback(int level, const char *buf, va_list vl)
 
 @end
 
+@interface IJKThumbnailExtractor()
+
+- (instancetype)initWithThumbnailer:(IjkThumbnailer *)thumbnailer;
+
+@end
+
 @implementation EMFFMoviePlayerController {
     EMMediaPlayer *_mediaPlayer;
     IJKSDLGLView *_glView;
@@ -146,6 +152,7 @@ static void emffplay_log_callback(int level, const char *buf, va_list vl)
 
     BOOL _keepScreenOnWhilePlaying;
     BOOL _pauseInBackground;
+    BOOL _audioOnlyInBackground;
     BOOL _isVideoToolboxOpen;
     BOOL _playingBeforeInterruption;
 
@@ -333,6 +340,7 @@ void EMFFIOStatCompleteRegister(void (*cb)(const char *url,
 
         [options applyTo:_mediaPlayer];
         _pauseInBackground = NO;
+        _audioOnlyInBackground = NO;
 
         _notificationManager = [[IJKNotificationManager alloc] init];
         [self registerApplicationObservers];
@@ -577,6 +585,11 @@ void EMFFIOStatCompleteRegister(void (*cb)(const char *url,
     _pauseInBackground = pause;
 }
 
+- (void)setAudioOnlyInBackground:(BOOL)audioOnly
+{
+    _audioOnlyInBackground = audioOnly;
+}
+
 - (BOOL)isVideoToolboxOpen
 {
     if (!_mediaPlayer)
@@ -645,6 +658,51 @@ inline static int getPlayerOption(IJKFFOptionCategory category)
     emmp_global_set_log_callback(emffplay_log_callback);
 }
 
++ (void)setNetworkType:(int)type
+{
+    emmp_global_set_network_type(type);
+}
+
++ (int64_t)throughputEstimateForURL:(NSString *)url percentile:(int)percentile
+{
+    IjkThroughputEstimate estimate;
+
+    if (emmp_global_get_throughput_estimate([url UTF8String], &estimate) < 0)
+        return -1;
+
+    switch (percentile) {
+        case 10: return estimate.p10;
+        case 50: return estimate.p50;
+        case 90: return estimate.p90;
+        default: return estimate.ewma;
+    }
+}
+
++ (BOOL)loadThroughputFromFile:(NSString *)path
+{
+    return emmp_global_load_throughput([path UTF8String]) == 0;
+}
+
++ (BOOL)saveThroughputToFile:(NSString *)path
+{
+    return emmp_global_save_throughput([path UTF8String]) == 0;
+}
+
++ (BOOL)startTrace
+{
+    return emmp_global_start_trace() == 0;
+}
+
++ (void)stopTrace
+{
+    emmp_global_stop_trace();
+}
+
++ (BOOL)dumpTraceToFile:(NSString *)path
+{
+    return emmp_global_dump_trace([path UTF8String]) == 0;
+}
+
 + (BOOL)checkIfFFmpegVersionMatch:(BOOL)showAlert;
 {
     const char *actualVersion = av_em_version_info();
@@ -1014,6 +1072,14 @@ inline static NSString *formatedSpeed(int64_t bytes, int64_t elapsed_milli) {
     float avdiff  = emmp_get_property_float(_mediaPlayer, FFP_PROP_FLOAT_AVDIFF, .0f);
     [_glView setHudValue:[NSString stringWithFormat:@"%.3f %.3f", avdelay, -avdiff] forKey:@"delay"];
 
+    int64_t jitter   = emmp_get_property_int64(_mediaPlayer, FFP_PROP_INT64_PACING_INTERVAL_JITTER, 0);
+    int64_t skipped  = emmp_get_property_int64(_mediaPlayer, FFP_PROP_INT64_PACING_SKIPPED_FRAMES, 0);
+    int64_t repeated = emmp_get_property_int64(_mediaPlayer, FFP_PROP_INT64_PACING_REPEATED_FRAMES, 0);
+    int64_t underrun = emmp_get_property_int64(_mediaPlayer, FFP_PROP_INT64_PACING_AUDIO_UNDERRUNS, 0);
+    [_glView setHudValue:[NSString stringWithFormat:@"jitter %.1fms, -%"PRId64" +%"PRId64", a-under %"PRId64"",
+                          jitter / 1000.0, skipped, repeated, underrun]
+                  forKey:@"pacing"];
+
     int64_t bitRate = emmp_get_property_int64(_mediaPlayer, FFP_PROP_INT64_BIT_RATE, 0);
     [_glView setHudValue:[NSString stringWithFormat:@"-%@, %@",
                           formatedSize(_asyncStat.buf_backwards),
@@ -1942,6 +2008,8 @@ static int ijkff_inject_callback(void *opaque, int message, void *data, size_t d
 - (void)applicationWillEnterForeground
 {
     ALOGI("EMFFMoviePlayerController:applicationWillEnterForeground: %d", (int)[UIApplication sharedApplication].applicationState);
+    if (_mediaPlayer)
+        emmp_set_property_int64(_mediaPlayer, FFP_PROP_INT64_AUDIO_ONLY, 0);
 }
 
 - (void)applicationDidBecomeActive
@@ -1963,6 +2031,9 @@ static int ijkff_inject_callback(void *opaque, int message, void *data, size_t d
 - (void)applicationDidEnterBackground
 {
     ALOGI("EMFFMoviePlayerController:applicationDidEnterBackground: %d", (int)[UIApplication sharedApplication].applicationState);
+    // stop reading and decoding video, nothing shows it in background
+    if (_mediaPlayer && _audioOnlyInBackground && !_pauseInBackground)
+        emmp_set_property_int64(_mediaPlayer, FFP_PROP_INT64_AUDIO_ONLY, 1);
     __weak __typeof(&*self)weakSelf = self;
     dispatch_async(dispatch_get_main_queue(), ^{
         if (_pauseInBackground) {
@@ -1987,5 +2058,106 @@ static int ijkff_inject_callback(void *opaque, int message, void *data, size_t d
     return [_glView captureFrame:2 :0 :0];
 }
 
+static UIImage *extractThumbnailSprite(IjkThumbnailer *thumbnailer)
+{
+    const uint8_t *sprite;
+    int width, height, linesize;
+    UIImage *image = nil;
+
+    if (ijk_thumbnailer_run(thumbnailer, NULL, NULL) <= 0)
+        return nil;
+    sprite = ijk_thumbnailer_get_sprite(thumbnailer, &width, &height, &linesize);
+    if (!sprite)
+        return nil;
+
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate((void *)sprite, width, height, 8, linesize, colorSpace,
+                                                 kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    if (context) {
+        CGImageRef cgImage = CGBitmapContextCreateImage(context);
+        image = [UIImage imageWithCGImage:cgImage];
+        CGImageRelease(cgImage);
+        CGContextRelease(context);
+    }
+    CGColorSpaceRelease(colorSpace);
+    return image;
+}
+
+static IjkThumbnailParams thumbnailParams(int count, CGSize size, int columns)
+{
+    IjkThumbnailParams params = {0};
+
+    params.count   = count;
+    params.width   = (int)size.width;
+    params.height  = (int)size.height;
+    params.columns = columns > 0 ? columns : 1;
+    return params;
+}
+
+- (IJKThumbnailExtractor *)thumbnailExtractorWithCount:(int)count size:(CGSize)size columns:(int)columns
+{
+    IjkThumbnailParams params = thumbnailParams(count, size, columns);
+    IjkThumbnailer *thumbnailer;
+
+    if (!_mediaPlayer)
+        return nil;
+    thumbnailer = emmp_create_thumbnailer(_mediaPlayer, &params);
+    if (!thumbnailer)
+        return nil;
+    return [[IJKThumbnailExtractor alloc] initWithThumbnailer:thumbnailer];
+}
+
+- (UIImage *)thumbnailSpriteWithCount:(int)count size:(CGSize)size columns:(int)columns
+{
+    return [[self thumbnailExtractorWithCount:count size:size columns:columns] extract];
+}
+
++ (UIImage *)thumbnailSpriteForURL:(NSString *)url count:(int)count size:(CGSize)size columns:(int)columns
+{
+    return [[[IJKThumbnailExtractor alloc] initWithURL:url count:count size:size columns:columns] extract];
+}
+
+@end
+
+@implementation IJKThumbnailExtractor {
+    IjkThumbnailer *_thumbnailer;
+}
+
+- (instancetype)initWithThumbnailer:(IjkThumbnailer *)thumbnailer
+{
+    self = [super init];
+    if (self)
+        _thumbnailer = thumbnailer;
+    else
+        ijk_thumbnailer_destroy(&thumbnailer);
+    return self;
+}
+
+- (instancetype)initWithURL:(NSString *)url count:(int)count size:(CGSize)size columns:(int)columns
+{
+    IjkThumbnailParams params = thumbnailParams(count, size, columns);
+    IjkThumbnailer *thumbnailer;
+
+    thumbnailer = ijk_thumbnailer_create([url UTF8String], NULL, &params);
+    if (!thumbnailer)
+        return nil;
+    return [self initWithThumbnailer:thumbnailer];
+}
+
+- (void)dealloc
+{
+    ijk_thumbnailer_destroy(&_thumbnailer);
+}
+
+- (UIImage *)extract
+{
+    return extractThumbnailSprite(_thumbnailer);
+}
+
+- (void)cancel
+{
+    ijk_thumbnailer_abort(_thumbnailer);
+}
+
 @end
 